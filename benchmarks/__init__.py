@@ -0,0 +1,12 @@
+"""Benchmarks of the algorithms package against Python builtins.
+
+Every suite times the package's algorithms and comparable Python builtins (or
+pure Python implementations, where there's no builtin) over a grid of
+deterministically generated inputs and sizes, and the results are written as
+JSON so that runs from different commits can be compared:
+
+    python -m benchmarks run --output new.json
+    python -m benchmarks compare old.json new.json --threshold 0.1
+
+See `python -m benchmarks --help` for the options, or use `make bench`.
+"""
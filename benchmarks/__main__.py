@@ -0,0 +1,118 @@
+"""Command line interface of the benchmarks: python -m benchmarks --help"""
+
+import argparse
+import sys
+
+from . import harness
+from .suites import SUITES
+
+
+def size(text):
+    """Parse a size, allowing scientific notation like 1e6."""
+    value = float(text)
+    if value != int(value) or value < 1:
+        raise argparse.ArgumentTypeError(f'invalid size {text!r}')
+    return int(value)
+
+
+def powers_of_ten(max_size):
+    sizes = []
+    value = 10
+    while value <= max_size:
+        sizes.append(value)
+        value *= 10
+    return sizes
+
+
+def run(options):
+    sizes = options.sizes or powers_of_ten(options.max_size)
+    cases = (case
+             for suite in options.suite or list(SUITES)
+             for case in SUITES[suite](sizes, options.seed, options)
+             if not options.filter
+             or any(f in case.name for f in options.filter))
+    results = harness.run(cases, options.repeat, options.min_time,
+                          log=None if options.quiet else sys.stderr)
+    meta = harness.metadata(sizes=sizes, seed=options.seed,
+                            repeat=options.repeat, min_time=options.min_time,
+                            suites=options.suite or list(SUITES),
+                            filter=options.filter,
+                            quadratic_max_size=options.quadratic_max_size,
+                            graph_max_size=options.graph_max_size,
+                            sample_size=options.sample_size)
+    harness.save(options.output, meta, results)
+    print(f'wrote {len(results)} results to {options.output}',
+          file=sys.stderr)
+    return 0
+
+
+def compare(options):
+    baseline = harness.load(options.baseline)
+    current = harness.load(options.current)
+    regressions = harness.compare(baseline, current, options.threshold,
+                                  options.min_seconds)
+    return 1 if regressions else 0
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        prog='python -m benchmarks',
+        description='Benchmark the algorithms package against Python '
+                    'builtins.')
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    p = commands.add_parser('run', help='run benchmarks and save the results')
+    p.add_argument('--output', '-o', default='benchmarks.json',
+                   help='JSON file for the results (default: %(default)s)')
+    p.add_argument('--suite', action='append', choices=list(SUITES),
+                   help='suite to run (repeatable; default: all)')
+    p.add_argument('--filter', '-k', action='append',
+                   help='only run benchmarks whose names contain this '
+                        'substring (repeatable)')
+    p.add_argument('--sizes', type=size, nargs='+',
+                   help='input sizes (default: powers of ten up to '
+                        '--max-size)')
+    p.add_argument('--max-size', type=size, default=10 ** 5,
+                   help='largest power of ten to use as a size, up to 1e8 '
+                        '(default: %(default)s)')
+    p.add_argument('--quadratic-max-size', type=size, default=10 ** 3,
+                   help='largest size for sorts on inputs that take them '
+                        'quadratic time (default: %(default)s)')
+    p.add_argument('--graph-max-size', type=size, default=10 ** 6,
+                   help='largest number of graph nodes '
+                        '(default: %(default)s)')
+    p.add_argument('--sample-size', type=size, default=100,
+                   help='sample size in the random suite '
+                        '(default: %(default)s)')
+    p.add_argument('--repeat', type=int, default=5,
+                   help='timing runs per benchmark, of which the fastest is '
+                        'reported (default: %(default)s)')
+    p.add_argument('--min-time', type=float, default=0.05,
+                   help='minimum seconds per timing run '
+                        '(default: %(default)s)')
+    p.add_argument('--seed', type=int, default=0,
+                   help='seed for generating inputs (default: %(default)s)')
+    p.add_argument('--quiet', '-q', action='store_true',
+                   help="don't print results as they're measured")
+    p.set_defaults(handler=run)
+
+    p = commands.add_parser('compare',
+                            help='compare two result files, exiting with '
+                                 'status 1 if anything got slower')
+    p.add_argument('baseline', help='JSON results to compare against')
+    p.add_argument('current', help='JSON results to check')
+    p.add_argument('--threshold', type=float, default=0.1,
+                   help='fraction by which a benchmark may slow down before '
+                        'it counts as a regression (default: %(default)s)')
+    p.add_argument('--min-seconds', type=float, default=1e-6,
+                   help="benchmarks faster than this aren't counted as "
+                        "regressions, since they're noisy "
+                        "(default: %(default)s)")
+    p.set_defaults(handler=compare)
+
+    options = parser.parse_args(argv)
+    return options.handler(options)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,49 @@
+"""Microbenchmark of the per-call overhead of the extension functions.
+
+Each function is called many times on tiny inputs, so that the time per call
+is dominated by argument parsing and dispatch rather than by the algorithms.
+
+Usage: python -m benchmarks.call_overhead [--number N] [--repeat R]
+"""
+
+import argparse
+import timeit
+
+SETUP = '''
+from algorithms.graph import bfs
+from algorithms.random import sample
+from algorithms.selection import min_max
+from algorithms.sort import insertion_sort, merge_sort
+small = [3, 1, 2]
+graph = {0: [1], 1: []}
+population = range(3)
+'''
+
+CASES = [
+    ('insertion_sort(small)', 'insertion_sort(small)'),
+    ('merge_sort(small, first=0, last=3)', 'merge_sort(small, first=0, last=3)'),
+    ('min_max(small)', 'min_max(small)'),
+    ('sample(population, 2, seed=0)', 'sample(population, 2, seed=0)'),
+    ('bfs(graph, 0)', 'bfs(graph, 0)'),
+    ('bfs(graph, roots=[0], with_depth=True)',
+     'bfs(graph, roots=[0], with_depth=True)'),
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--number', type=int, default=200000,
+                        help='calls per timing run')
+    parser.add_argument('--repeat', type=int, default=5,
+                        help='timing runs per case (the fastest is reported)')
+    args = parser.parse_args()
+
+    width = max(len(label) for label, _ in CASES)
+    for label, stmt in CASES:
+        times = timeit.repeat(stmt, SETUP, number=args.number,
+                              repeat=args.repeat)
+        print(f'{label:<{width}}  {1e9 * min(times) / args.number:8.1f} ns')
+
+
+if __name__ == '__main__':
+    main()
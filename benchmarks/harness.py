@@ -0,0 +1,166 @@
+"""Timing, result files, and comparisons between result files."""
+
+import dataclasses
+import datetime
+import gc
+import json
+import os
+import platform
+import subprocess
+import sys
+import time
+from typing import Callable, Dict, Iterable, List, Optional, Tuple
+
+# Version of the layout of result files
+FORMAT_VERSION = 1
+
+
+@dataclasses.dataclass
+class Case:
+    """A single benchmark: call `function(*setup())` on fresh arguments."""
+    suite: str
+    name: str
+    input: str
+    container: str
+    size: int
+    function: Callable
+    setup: Callable[[], tuple]
+
+    @property
+    def key(self) -> Tuple[str, str, str, str, int]:
+        return self.suite, self.name, self.input, self.container, self.size
+
+
+def time_calls(case: Case, number: int) -> float:
+    """Total time of `number` calls, excluding the time spent in setup."""
+    arguments = [case.setup() for _ in range(number)]
+    enabled = gc.isenabled()
+    gc.disable()
+    try:
+        start = time.perf_counter()
+        for args in arguments:
+            case.function(*args)
+        return time.perf_counter() - start
+    finally:
+        if enabled:
+            gc.enable()
+
+
+def measure(case: Case, repeat: int, min_time: float) -> Tuple[float, int]:
+    """Best time per call over `repeat` runs, each of which makes enough calls
+    to take at least `min_time` seconds, and the number of calls per run."""
+    number = 1
+    elapsed = time_calls(case, number)
+    while elapsed < min_time and number < 1_000_000:
+        # Aim a bit past the minimum, without growing too fast
+        factor = min(10.0, 1.2 * min_time / max(elapsed, 1e-9))
+        number = max(number + 1, int(number * factor))
+        elapsed = time_calls(case, number)
+    times = [elapsed] + [time_calls(case, number) for _ in range(repeat - 1)]
+    return min(times) / number, number
+
+
+def git_commit() -> Optional[str]:
+    """Commit of the working tree, or None outside of a git repository."""
+    try:
+        output = subprocess.run(['git', 'rev-parse', 'HEAD'],
+                                capture_output=True, text=True, check=True,
+                                cwd=os.path.dirname(__file__))
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    return output.stdout.strip()
+
+
+def metadata(**settings) -> Dict:
+    return {
+        'format': FORMAT_VERSION,
+        'commit': git_commit(),
+        'timestamp': datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        'python': sys.version,
+        'platform': platform.platform(),
+        'machine': platform.machine(),
+        'cpus': os.cpu_count(),
+        'settings': settings,
+    }
+
+
+def run(cases: Iterable[Case], repeat: int, min_time: float,
+        log=sys.stderr) -> List[Dict]:
+    """Time every case, reporting progress to `log`."""
+    results = []
+    for case in cases:
+        seconds, number = measure(case, repeat, min_time)
+        results.append({
+            'suite': case.suite,
+            'name': case.name,
+            'input': case.input,
+            'container': case.container,
+            'size': case.size,
+            'seconds': seconds,
+            'number': number,
+            'repeat': repeat,
+        })
+        if log:
+            print(f'{case.suite:<10} {case.name:<28} {case.input:<12} '
+                  f'{case.container:<6} {case.size:>10}  '
+                  f'{format_seconds(seconds)}', file=log, flush=True)
+    return results
+
+
+def format_seconds(seconds: float) -> str:
+    for unit, scale in (('s', 1), ('ms', 1e-3), ('us', 1e-6)):
+        if seconds >= scale:
+            return f'{seconds / scale:8.3f} {unit}'
+    return f'{seconds / 1e-9:8.1f} ns'
+
+
+def save(path: str, meta: Dict, results: List[Dict]) -> None:
+    with open(path, 'w') as file:
+        json.dump({'meta': meta, 'results': results}, file, indent=1)
+        file.write('\n')
+
+
+def load(path: str) -> Dict:
+    with open(path) as file:
+        data = json.load(file)
+    if data.get('meta', {}).get('format') != FORMAT_VERSION:
+        raise ValueError(f'{path}: unsupported result file format')
+    return data
+
+
+def result_key(result: Dict) -> Tuple[str, str, str, str, int]:
+    return (result['suite'], result['name'], result['input'],
+            result['container'], result['size'])
+
+
+def compare(baseline: Dict, current: Dict, threshold: float,
+            min_seconds: float = 0.0, out=sys.stdout) -> int:
+    """Print the ratio of current to baseline times of every benchmark in both
+    files, and return the number of regressions, i.e., benchmarks that got
+    slower by more than the fraction `threshold`. Benchmarks faster than
+    `min_seconds` in both files are too noisy to count as regressions."""
+    old = {result_key(r): r['seconds'] for r in baseline['results']}
+    new = {result_key(r): r['seconds'] for r in current['results']}
+    regressions = improvements = 0
+    for key in sorted(old.keys() & new.keys()):
+        ratio = new[key] / old[key] if old[key] > 0 else float('inf')
+        if ratio > 1 + threshold and max(old[key], new[key]) >= min_seconds:
+            status = 'SLOWER'
+            regressions += 1
+        elif ratio < 1 / (1 + threshold):
+            status = 'faster'
+            improvements += 1
+        else:
+            status = ''
+        suite, name, input_, container, size = key
+        print(f'{suite:<10} {name:<28} {input_:<12} {container:<6} '
+              f'{size:>10}  {format_seconds(old[key])} -> '
+              f'{format_seconds(new[key])}  {ratio:6.2f}x  {status}',
+              file=out)
+    for label, keys in (('only in baseline', old.keys() - new.keys()),
+                        ('only in current', new.keys() - old.keys())):
+        for key in sorted(keys):
+            print(f'{label}: {" ".join(map(str, key))}', file=out)
+    print(f'{regressions} regression(s) and {improvements} improvement(s) '
+          f'beyond {100 * threshold:g}%', file=out)
+    return regressions
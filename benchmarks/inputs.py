@@ -0,0 +1,160 @@
+"""Deterministic benchmark inputs.
+
+Every generator takes a size and a `random.Random` instance, so that the same
+seed always produces the same input.
+"""
+
+import array
+import math
+
+# Sequence distributions, each a function (size, rng) -> list. The integer
+# distributions are also benchmarked as typed arrays
+INTEGER_BOUND = 2 ** 31
+
+
+def random_values(size, rng):
+    """Uniformly random integers, almost all distinct."""
+    return [rng.randrange(INTEGER_BOUND) for _ in range(size)]
+
+
+def sorted_values(size, rng):
+    """Already sorted integers."""
+    return list(range(size))
+
+
+def reversed_values(size, rng):
+    """Integers sorted in decreasing order."""
+    return list(range(size, 0, -1))
+
+
+def few_unique(size, rng):
+    """Random integers with only 8 distinct values."""
+    return [rng.randrange(8) for _ in range(size)]
+
+
+def organ_pipe(size, rng):
+    """Increasing integers followed by decreasing integers."""
+    half = size // 2
+    return list(range(half)) + list(range(size - half, 0, -1))
+
+
+def sawtooth(size, rng):
+    """About sqrt(size) sorted runs of increasing integers."""
+    period = max(1, math.isqrt(size))
+    return [i % period for i in range(size)]
+
+
+def mixed_types(size, rng):
+    """Random mixture of ints and floats, which can't be put in an array."""
+    return [rng.randrange(INTEGER_BOUND) if rng.random() < 0.5
+            else rng.uniform(0, INTEGER_BOUND) for _ in range(size)]
+
+
+DISTRIBUTIONS = {
+    'random': random_values,
+    'sorted': sorted_values,
+    'reversed': reversed_values,
+    'few_unique': few_unique,
+    'organ_pipe': organ_pipe,
+    'sawtooth': sawtooth,
+    'mixed_types': mixed_types,
+}
+
+# Distributions that only make sense as lists of Python objects
+LIST_ONLY = {'mixed_types'}
+
+
+def as_container(values, container):
+    """Wrap a list of values in a given kind of container."""
+    if container == 'list':
+        return values
+    if container == 'array':
+        return array.array('q', values)
+    raise ValueError(f'unknown container {container!r}')
+
+
+# Graph workloads, each a function (num_nodes, rng) -> (n, sources, targets,
+# weights), where the edge lists are arrays of 32-bit vertices and the weights
+# are doubles. The actual number of nodes may be a bit smaller than requested
+
+def grid(num_nodes, rng):
+    """Square lattice with edges in both directions between neighbors."""
+    side = max(1, math.isqrt(num_nodes))
+    sources, targets = array.array('i'), array.array('i')
+    for r in range(side):
+        for c in range(side):
+            u = r * side + c
+            if c + 1 < side:
+                sources.extend((u, u + 1))
+                targets.extend((u + 1, u))
+            if r + 1 < side:
+                sources.extend((u, u + side))
+                targets.extend((u + side, u))
+    weights = array.array('d', (1.0 for _ in sources))
+    return side * side, sources, targets, weights
+
+
+def power_law(num_nodes, rng, degree=4):
+    """Preferential attachment (Barabasi-Albert) graph whose degrees follow a
+    power law, with edges in both directions."""
+    n = max(2, num_nodes)
+    sources, targets = array.array('i'), array.array('i')
+    # Every endpoint of every edge so far, so that sampling from this list
+    # picks nodes with probability proportional to their degrees
+    endpoints = [0, 1]
+    sources.extend((0, 1))
+    targets.extend((1, 0))
+    for u in range(2, n):
+        for v in {rng.choice(endpoints) for _ in range(degree)}:
+            sources.extend((u, v))
+            targets.extend((v, u))
+            endpoints.extend((u, v))
+    weights = array.array('d', (rng.uniform(1, 10) for _ in sources))
+    return n, sources, targets, weights
+
+
+def road(num_nodes, rng, keep=0.8, shortcuts=0.01):
+    """Road-network-like graph: a lattice with some streets removed and a few
+    short diagonal roads, so that degrees are small and the diameter is large,
+    with edge weights given by jittered Euclidean lengths."""
+    side = max(1, math.isqrt(num_nodes))
+    sources, targets = array.array('i'), array.array('i')
+    weights = array.array('d')
+
+    def connect(u, v, length):
+        w = length * rng.uniform(1.0, 1.5)
+        sources.extend((u, v))
+        targets.extend((v, u))
+        weights.extend((w, w))
+
+    for r in range(side):
+        for c in range(side):
+            u = r * side + c
+            if c + 1 < side and rng.random() < keep:
+                connect(u, u + 1, 1.0)
+            if r + 1 < side and rng.random() < keep:
+                connect(u, u + side, 1.0)
+            if r + 1 < side and c + 1 < side and rng.random() < shortcuts:
+                connect(u, u + side + 1, math.sqrt(2))
+    return side * side, sources, targets, weights
+
+
+GRAPHS = {
+    'grid': grid,
+    'power_law': power_law,
+    'road': road,
+}
+
+
+def adjacency(n, sources, targets, weights=None):
+    """Adjacency list (dict) of a graph, mapping neighbors to weights if the
+    graph is weighted."""
+    if weights is None:
+        graph = {u: [] for u in range(n)}
+        for u, v in zip(sources, targets):
+            graph[u].append(v)
+    else:
+        graph = {u: {} for u in range(n)}
+        for u, v, w in zip(sources, targets, weights):
+            graph[u][v] = w
+    return graph
@@ -0,0 +1,206 @@
+"""Benchmark suites, each a function returning the cases to run.
+
+Every suite takes the sizes to benchmark, a seed for the inputs, and the
+options parsed by __main__.py, and the names of the cases timing Python
+builtins (or pure Python code) rather than the package start with "python:".
+"""
+
+import collections
+import heapq
+import random
+
+from algorithms import graph as graph_module
+from algorithms import selection as selection_module
+from algorithms import sets as sets_module
+from algorithms import sort as sort_module
+from algorithms.random import sample
+
+from .harness import Case
+from .inputs import DISTRIBUTIONS, GRAPHS, LIST_ONLY, adjacency, as_container
+
+SORTS = [
+    'binary_insertion_sort',
+    'insertion_sort',
+    'heap_sort',
+    'merge_sort',
+    'quick_sort',
+    'quick_sort_random',
+    'sort',
+]
+
+# Inputs on which a sorting algorithm takes quadratic time, which are only
+# benchmarked up to a smaller size. None means every input
+QUADRATIC = {
+    'binary_insertion_sort': None,
+    'insertion_sort': None,
+    'quick_sort': {'sorted', 'reversed', 'few_unique', 'organ_pipe',
+                   'sawtooth'},
+    'quick_sort_random': {'few_unique'},
+}
+
+
+def rng_for(seed, *key):
+    """Random number generator seeded by `seed` and the identity of an input,
+    so that every input is the same no matter which other ones are made."""
+    return random.Random(f'{seed}:{":".join(map(str, key))}')
+
+
+def containers(distribution):
+    return ['list'] if distribution in LIST_ONLY else ['list', 'array']
+
+
+def sort_suite(sizes, seed, options):
+    for distribution, generate in DISTRIBUTIONS.items():
+        for size in sizes:
+            values = generate(size, rng_for(seed, distribution, size))
+            for container in containers(distribution):
+                data = as_container(values, container)
+                for name in SORTS:
+                    quadratic = QUADRATIC.get(name, ())
+                    if ((quadratic is None or distribution in quadratic)
+                            and size > options.quadratic_max_size):
+                        continue
+                    yield Case('sort', name, distribution, container, size,
+                               getattr(sort_module, name),
+                               lambda data=data: (data[:],))
+
+                if container == 'list':
+                    yield Case('sort', 'python:list.sort', distribution,
+                               container, size, list.sort,
+                               lambda data=data: (data[:],))
+                else:
+                    yield Case('sort', 'python:sorted', distribution,
+                               container, size, sorted,
+                               lambda data=data: (data,))
+
+
+def min_and_max(data):
+    return min(data), max(data)
+
+
+def selection_suite(sizes, seed, options):
+    for distribution, generate in DISTRIBUTIONS.items():
+        for size in sizes:
+            values = generate(size, rng_for(seed, distribution, size))
+            for container in containers(distribution):
+                data = as_container(values, container)
+                yield Case('selection', 'min_max', distribution, container,
+                           size, selection_module.min_max,
+                           lambda data=data: (data,))
+                yield Case('selection', 'python:min+max', distribution,
+                           container, size, min_and_max,
+                           lambda data=data: (data,))
+
+
+def random_suite(sizes, seed, options):
+    for size in sizes:
+        values = DISTRIBUTIONS['random'](size, rng_for(seed, 'random', size))
+        k = min(size, options.sample_size)
+        for container in ('list', 'array'):
+            data = as_container(values, container)
+            yield Case('random', 'sample', 'random', container, size,
+                       sample, lambda data=data: (data, k, seed))
+            rng = random.Random(seed)
+            yield Case('random', 'python:random.sample', 'random', container,
+                       size, rng.sample, lambda data=data: (data, k))
+
+
+def intersect_py(a, b):
+    """Intersection of two sorted lists through Python sets."""
+    return sorted(set(a).intersection(b))
+
+
+def sets_suite(sizes, seed, options):
+    # Intersections of sorted operands of equal sizes (merged) and of very
+    # different sizes (galloping)
+    for size in sizes:
+        rng = rng_for(seed, 'sets', size)
+        universe = range(4 * size)
+        long = sorted(rng.sample(universe, size))
+        for distribution, other in (
+                ('balanced', sorted(rng.sample(universe, size))),
+                ('skewed', sorted(rng.sample(universe, max(size // 100, 1))))):
+            for container in ('list', 'array'):
+                a = as_container(other, container)
+                b = as_container(long, container)
+                yield Case('sets', 'intersect', distribution, container, size,
+                           sets_module.intersect, lambda a=a, b=b: (a, b))
+                yield Case('sets', 'python:set.intersection', distribution,
+                           container, size, intersect_py,
+                           lambda a=a, b=b: (a, b))
+
+
+def consume(iterator):
+    collections.deque(iterator, maxlen=0)
+
+
+def bfs_py(graph, root):
+    """Breadth-first search of an adjacency list in pure Python."""
+    visited = {root}
+    queue = collections.deque([root])
+    while queue:
+        u = queue.popleft()
+        for v in graph[u]:
+            if v not in visited:
+                visited.add(v)
+                queue.append(v)
+    return visited
+
+
+def dijkstra_py(graph, source):
+    """Dijkstra's algorithm on a weighted adjacency list, using heapq."""
+    distance = {source: 0.0}
+    heap = [(0.0, source)]
+    while heap:
+        d, u = heapq.heappop(heap)
+        if d > distance[u]:
+            continue
+        for v, w in graph[u].items():
+            if d + w < distance.get(v, float('inf')):
+                distance[v] = d + w
+                heapq.heappush(heap, (d + w, v))
+    return distance
+
+
+def graph_suite(sizes, seed, options):
+    Graph = graph_module.Graph
+    for workload, generate in GRAPHS.items():
+        for size in sizes:
+            if size > options.graph_max_size:
+                continue
+            n, sources, targets, weights = generate(
+                size, rng_for(seed, workload, size))
+            g = Graph.from_edges(sources, targets, num_nodes=n,
+                                 weights=weights)
+            unweighted = adjacency(n, sources, targets)
+            weighted = adjacency(n, sources, targets, weights)
+
+            def case(name, function, *args):
+                return Case('graph', name, workload, 'graph', n, function,
+                            lambda: args)
+
+            yield case('Graph.from_edges', Graph.from_edges, sources, targets,
+                       n, weights)
+            yield case('Graph(mapping)', Graph, unweighted)
+            yield case('bfs', lambda g: consume(graph_module.bfs(g, 0)), g)
+            yield case('bfs(mapping)',
+                       lambda g: consume(graph_module.bfs(g, 0)), unweighted)
+            yield case('bfs_levels', graph_module.bfs_levels, g, [0])
+            yield case('connected_components',
+                       graph_module.connected_components, g)
+            yield case('pagerank',
+                       lambda g: graph_module.pagerank(g, max_iter=1000), g)
+            yield case('dijkstra', graph_module.dijkstra, g, 0)
+            yield case('dijkstra(mapping)', graph_module.dijkstra, weighted,
+                       0)
+            yield case('python:bfs', bfs_py, unweighted, 0)
+            yield case('python:dijkstra', dijkstra_py, weighted, 0)
+
+
+SUITES = {
+    'sort': sort_suite,
+    'selection': selection_suite,
+    'sets': sets_suite,
+    'random': random_suite,
+    'graph': graph_suite,
+}
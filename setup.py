@@ -70,11 +70,51 @@ CPP_EXTENSION_KWARGS = dict(
 )
 
 EXT_MODULES = [
+    Extension(
+        name='algorithms.containers',
+        sources=[
+            'src/c/modules/containersmodule.c',
+            'src/c/src/args.c',
+            'src/c/src/buffer.c',
+            'src/c/src/heap.c',
+            'src/c/src/instrument.c',
+            'src/c/src/parallel.c',
+            'src/c/src/partition.c',
+            'src/c/src/scratch.c',
+            'src/c/src/search.c',
+            'src/c/src/sort.c',
+            'src/c/src/sort_plan.c',
+            'src/c/src/sorted_list.c',
+            'src/c/src/typed_sort.c',
+            'src/c/src/utils.c',
+        ],
+        **C_EXTENSION_KWARGS,
+    ),
     Extension(
         name='algorithms.selection',
         sources=[
             'src/c/modules/selectionmodule.c',
+            'src/c/src/args.c',
+            'src/c/src/buffer.c',
+            'src/c/src/heap.c',
+            'src/c/src/instrument.c',
+            'src/c/src/parallel.c',
+            'src/c/src/quantile_sketch.c',
+            'src/c/src/scratch.c',
             'src/c/src/selection.c',
+            'src/c/src/typed_sort.c',
+            'src/c/src/utils.c',
+        ],
+        **C_EXTENSION_KWARGS,
+    ),
+    Extension(
+        name='algorithms.sets',
+        sources=[
+            'src/c/modules/setsmodule.c',
+            'src/c/src/buffer.c',
+            'src/c/src/instrument.c',
+            'src/c/src/search.c',
+            'src/c/src/sets.c',
             'src/c/src/utils.c',
         ],
         **C_EXTENSION_KWARGS,
@@ -83,10 +123,19 @@ EXT_MODULES = [
         name='algorithms.sort',
         sources=[
             'src/c/modules/sortmodule.c',
+            'src/c/src/args.c',
+            'src/c/src/buffer.c',
             'src/c/src/heap.c',
+            'src/c/src/incremental_sort.c',
+            'src/c/src/instrument.c',
+            'src/c/src/lexsort.c',
+            'src/c/src/parallel.c',
             'src/c/src/partition.c',
+            'src/c/src/scratch.c',
             'src/c/src/search.c',
             'src/c/src/sort.c',
+            'src/c/src/sort_plan.c',
+            'src/c/src/typed_sort.c',
             'src/c/src/utils.c',
         ],
         **C_EXTENSION_KWARGS,
@@ -95,6 +144,15 @@ EXT_MODULES = [
         name='algorithms.graph',
         sources=[
             'src/cpp/modules/graphmodule.cpp',
+            'src/cpp/src/args.cpp',
+            'src/cpp/src/bfs.cpp',
+            'src/cpp/src/buffer.cpp',
+            'src/cpp/src/components.cpp',
+            'src/cpp/src/dfs.cpp',
+            'src/cpp/src/graph.cpp',
+            'src/cpp/src/graph_file.cpp',
+            'src/cpp/src/shortest_paths.cpp',
+            'src/cpp/src/spmv.cpp',
         ],
         **CPP_EXTENSION_KWARGS,
     ),
@@ -102,6 +160,8 @@ EXT_MODULES = [
         name='algorithms.random',
         sources=[
             'src/cpp/modules/randommodule.cpp',
+            'src/cpp/src/args.cpp',
+            'src/cpp/src/buffer.cpp',
             'src/cpp/src/random.cpp',
         ],
         **CPP_EXTENSION_KWARGS,
@@ -120,12 +180,13 @@ setup(
     packages=find_packages(os.path.join('src', 'python')),
     package_dir={'': os.path.join('src', 'python')},
     ext_modules=EXT_MODULES,
+    python_requires='>=3.9',
     classifiers=[
         'Development Status :: 1 - Planning',
         'Intended Audience :: Developers',
         'Intended Audience :: Education',
         'Operating System :: OS Independent',
-        'Programming Language :: Python :: 3.8',
+        'Programming Language :: Python :: 3.9',
     ],
     zip_safe=False,
 )
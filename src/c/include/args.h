@@ -0,0 +1,38 @@
+#ifndef __ALGORITHMS_ARGS_H
+#define __ALGORITHMS_ARGS_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define ARG_PARSER_MAX_KEYWORDS 8
+
+// Argument parser for METH_FASTCALL | METH_KEYWORDS functions, which receive
+// their positional arguments as a C array followed by the values of their
+// keyword arguments, whose names are in a tuple, instead of in a new tuple and
+// dict on every call. Parsers are read-only and hold no Python objects, so
+// they're meant to be static variables shared by every interpreter and
+// thread, initialized like
+//
+//     static const char *const keywords[] = {"", "first", "last", NULL};
+//     static ArgParser parser = {
+//         .name = "merge_sort",
+//         .keywords = keywords,
+//         .required = 1,
+//         .positional = 3,
+//     };
+//
+// where the empty names of the first parameters mark them as positional-only
+typedef struct {
+    const char *name;                   // Function name for error messages
+    const char *const *keywords;        // NULL-terminated parameter names
+    Py_ssize_t required;                // Number of required parameters
+    Py_ssize_t positional;              // Number of positional parameters
+} ArgParser;
+
+// Match the arguments of a call to the parameters of `parser`, storing a
+// borrowed reference to the i-th parameter's argument in `out[i]`, or NULL if
+// it wasn't given. Returns 0 and sets an exception on failure
+int ParseArgs(const ArgParser *, PyObject *const *, Py_ssize_t, PyObject *,
+              PyObject **);
+
+#endif
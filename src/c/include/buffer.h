@@ -0,0 +1,80 @@
+#ifndef __ALGORITHMS_BUFFER_H
+#define __ALGORITHMS_BUFFER_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+// Machine representations of the items of typed buffers (e.g., array.array or
+// NumPy arrays exported through the buffer protocol). The typed kernels only
+// need to know how an item is stored, not which struct module format code
+// describes it, so, e.g., "l" and "q" are the same type on LP64 platforms
+typedef enum {
+    ITEM_INT8,
+    ITEM_INT16,
+    ITEM_INT32,
+    ITEM_INT64,
+    ITEM_UINT8,
+    ITEM_UINT16,
+    ITEM_UINT32,
+    ITEM_UINT64,
+    ITEM_FLOAT,
+    ITEM_DOUBLE,
+} ItemType;
+
+// Get a contiguous one-dimensional buffer of native integers or floating point
+// numbers, passing `flags` (e.g., PyBUF_WRITABLE) on to PyObject_GetBuffer.
+// Returns the type of the items, in which case the buffer must eventually be
+// released with PyBuffer_Release, or -1 if `obj` doesn't export such a buffer.
+// No exception is set in the latter case, so that callers can fall back to
+// treating `obj` as a sequence of Python objects
+int GetTypedBuffer(PyObject *, Py_buffer *, int);
+
+// Type of the items described by a struct module format code (e.g., "i", or
+// "<i" for a standard size), or -1 if it isn't a supported numeric code
+int GetFormatItemType(const char *);
+
+// Create a Python int or float from the i-th item of a typed buffer
+PyObject *GetTypedItem(const void *, ItemType, Py_ssize_t);
+
+// Create an array.array of `n` zeros of a given type, and export its buffer to
+// `view` for filling it in (e.g., without the GIL). The buffer must eventually
+// be released with PyBuffer_Release. Returns NULL on failure
+PyObject *NewTypedArray(ItemType, Py_ssize_t, Py_buffer *);
+
+// Call the instantiation of a typed algorithm (one function per item type,
+// suffixed with the type, e.g., RadixSort_int32) for the item type `type`, as
+// `result = name##_suffix(...)`
+#define DISPATCH(result, type, name, ...)                                      \
+    do {                                                                       \
+        switch (type) {                                                        \
+            case ITEM_INT8: result = name##_int8(__VA_ARGS__); break;          \
+            case ITEM_INT16: result = name##_int16(__VA_ARGS__); break;        \
+            case ITEM_INT32: result = name##_int32(__VA_ARGS__); break;        \
+            case ITEM_INT64: result = name##_int64(__VA_ARGS__); break;        \
+            case ITEM_UINT8: result = name##_uint8(__VA_ARGS__); break;        \
+            case ITEM_UINT16: result = name##_uint16(__VA_ARGS__); break;      \
+            case ITEM_UINT32: result = name##_uint32(__VA_ARGS__); break;      \
+            case ITEM_UINT64: result = name##_uint64(__VA_ARGS__); break;      \
+            case ITEM_FLOAT: result = name##_float(__VA_ARGS__); break;        \
+            case ITEM_DOUBLE: result = name##_double(__VA_ARGS__); break;      \
+        }                                                                      \
+    } while (0)  // To force a semicolon
+
+// Same as DISPATCH, for algorithms that can't fail
+#define DISPATCH_VOID(type, name, ...)                                         \
+    do {                                                                       \
+        switch (type) {                                                        \
+            case ITEM_INT8: name##_int8(__VA_ARGS__); break;                   \
+            case ITEM_INT16: name##_int16(__VA_ARGS__); break;                 \
+            case ITEM_INT32: name##_int32(__VA_ARGS__); break;                 \
+            case ITEM_INT64: name##_int64(__VA_ARGS__); break;                 \
+            case ITEM_UINT8: name##_uint8(__VA_ARGS__); break;                 \
+            case ITEM_UINT16: name##_uint16(__VA_ARGS__); break;               \
+            case ITEM_UINT32: name##_uint32(__VA_ARGS__); break;               \
+            case ITEM_UINT64: name##_uint64(__VA_ARGS__); break;               \
+            case ITEM_FLOAT: name##_float(__VA_ARGS__); break;                 \
+            case ITEM_DOUBLE: name##_double(__VA_ARGS__); break;               \
+        }                                                                      \
+    } while (0)  // To force a semicolon
+
+#endif
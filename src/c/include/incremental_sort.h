@@ -0,0 +1,52 @@
+#ifndef __ALGORITHMS_INCREMENTAL_SORT_H
+#define __ALGORITHMS_INCREMENTAL_SORT_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+// Bottom-up merge sort of an array of Python objects that can stop after any
+// number of comparisons and resume later, so that a large sort can be spread
+// over many short steps (e.g., between the callbacks of an event loop). Runs
+// of width 1, 2, 4, ... are merged pairwise from one array into the other, and
+// the position in the current merge is kept in the sort instead of on the call
+// stack, so a step can stop in the middle of a merge.
+//
+// Every item is referenced exactly once by the sort: it's either already
+// merged, in `dst[0,k)`, or still to be merged, in `src[i,mid)` or `src[j,n)`
+typedef struct {
+    PyObject **src;             // Runs of the current pass
+    PyObject **dst;             // Merged runs of the current pass
+    Py_ssize_t n;
+    Py_ssize_t width;           // Width of the runs of the current pass
+    Py_ssize_t mid;             // End of the left run of the current merge
+    Py_ssize_t hi;              // End of the right run of the current merge
+    Py_ssize_t i;               // Next item of the left run
+    Py_ssize_t j;               // Next item of the right run
+    Py_ssize_t k;               // Next position in `dst`
+    Py_ssize_t pass;            // Number of finished passes
+    Py_ssize_t comparisons;     // Number of comparisons so far
+} IncrementalSort;
+
+// Start sorting the items of an iterable, taking references to them. Returns
+// 0 and sets an exception on failure
+int IncrementalSortInit(IncrementalSort *, PyObject *);
+
+// Sort for at most `budget` comparisons, or until `seconds` have passed if
+// `seconds` is positive (the clock is checked every few comparisons, so a step
+// may run a little longer). Returns 1 if the items are sorted, 0 if the sort
+// was stopped first, and -1 if a comparison failed, with an exception set. A
+// failed comparison leaves the sort where it was, so it can be resumed
+int IncrementalSortStep(IncrementalSort *, Py_ssize_t, double);
+
+// Whether the items are sorted, and the fraction of the sort that's done
+int IncrementalSortDone(const IncrementalSort *);
+double IncrementalSortProgress(const IncrementalSort *);
+
+// Call `visit` on every item, stopping at the first nonzero return value,
+// which is returned (as in tp_traverse)
+int IncrementalSortVisit(const IncrementalSort *, visitproc, void *);
+
+// Release the items and the arrays, leaving an empty sort
+void IncrementalSortClear(IncrementalSort *);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef __ALGORITHMS_INSTRUMENT_H
+#define __ALGORITHMS_INSTRUMENT_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+// Opt-in operation counting, switched on by algorithms.instrument(). While
+// `Instrumenting` is zero, every counter below costs a single well-predicted
+// branch. Every thread counts the operations of its current call separately,
+// and adds them to totals shared by every thread and interpreter, under a
+// lock, when the call ends. Counters are only touched by code handling Python
+// objects, so the typed buffer kernels report their calls and times but no
+// operations
+typedef struct {
+    unsigned long long comparisons;     // Rich comparisons of Python objects
+    unsigned long long swaps;           // Calls to Swap
+    unsigned long long moves;           // Other writes of array elements
+    unsigned long long allocations;     // Temporary arrays and lists
+    Py_ssize_t depth;                   // Current recursion depth
+    Py_ssize_t max_depth;               // Largest recursion depth
+} Counters;
+
+extern _Atomic int Instrumenting;
+extern _Thread_local Counters Count;
+
+// Add `n` to one of the counters of the current call
+#define COUNT(counter, n) ((void) (Instrumenting && (Count.counter += (n))))
+
+// Track recursion depth: every COUNT_ENTER needs a matching COUNT_LEAVE
+#define COUNT_ENTER()                                                          \
+    ((void) (Instrumenting && ++Count.depth > Count.max_depth                  \
+             && (Count.max_depth = Count.depth)))
+#define COUNT_LEAVE() ((void) (Instrumenting && Count.depth--))
+
+// Counts of the call enclosing an instrumented call (e.g., a sort called from
+// a comparison made by another sort), restored when the inner call ends
+typedef struct {
+    Counters outer;
+    double start;
+} InstrumentedCall;
+
+// Start counting the operations of a call, saving the counts of any enclosing
+// call
+void InstrumentBegin(InstrumentedCall *);
+
+// Add the counts and wall time of a call to the totals of the algorithm
+// `name`, which must be a string with static storage duration
+void InstrumentEnd(InstrumentedCall *, const char *);
+
+// Module function _instrument(enable), used by algorithms.instrument(): a true
+// argument resets the totals and starts counting, and a false one stops
+// counting and returns the totals as a dict mapping algorithm names to dicts
+// of counters
+PyObject *Instrument(PyObject *, PyObject *);
+extern const char Instrument_doc[];
+
+#define INSTRUMENT_METHODDEF                                                   \
+    {                                                                          \
+        .ml_name = "_instrument",                                              \
+        .ml_meth = (PyCFunction) Instrument,                                   \
+        .ml_flags = METH_O,                                                    \
+        .ml_doc = Instrument_doc,                                              \
+    }
+
+#endif
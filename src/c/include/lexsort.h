@@ -0,0 +1,45 @@
+#ifndef __ALGORITHMS_LEXSORT_H
+#define __ALGORITHMS_LEXSORT_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "buffer.h"
+
+// Lexicographic sorting by several keys, e.g., the columns of a table or the
+// fields of fixed-width records. Rows are sorted by permuting an array of their
+// indices with one stable sort per key, from the last key to the first (least
+// significant digit order), so that each sort only breaks the ties left by the
+// keys before it.
+
+// Unboxed numbers of a given type, the i-th of which is at `base + i * stride`
+// (e.g., the items of a typed buffer, or a field of an array of records). The
+// numbers don't have to be aligned
+typedef struct {
+    const char *base;
+    Py_ssize_t stride;
+    ItemType type;
+    int descending;
+} TypedColumn;
+
+// Stably sort the row indices `perm[0,n)` lexicographically by the typed
+// columns `columns[0,k)`, the first of which is the most significant, by radix
+// sorting pairs of indices and keys made from the numbers (see radix.h). The
+// keys of adjacent columns are packed into one 64-bit key as long as they fit,
+// e.g., four int16 columns take a single radix sort. Returns 0 if memory
+// allocation failed, and 1 otherwise. Doesn't touch any Python objects, so it
+// can run without the GIL
+int TypedLexSort(const TypedColumn *, Py_ssize_t, Py_ssize_t *, Py_ssize_t);
+
+// Stably sort the row indices `perm[0,n)` by the items of `a` (in decreasing
+// order if `descending` is nonzero), comparing them with <, by a merge sort on
+// the indices. Returns 0 if a comparison or memory allocation failed, with an
+// exception set, and 1 otherwise
+int ArgSort(PyObject **, int, Py_ssize_t *, Py_ssize_t);
+
+// Reorder `n` records of `size` bytes each, so that the i-th record becomes
+// the record previously at `perm[i]`. Returns 0 if memory allocation failed,
+// and 1 otherwise. Can run without the GIL
+int PermuteRecords(char *, Py_ssize_t, const Py_ssize_t *, Py_ssize_t);
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef __ALGORITHMS_MODULE_H
+#define __ALGORITHMS_MODULE_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+#include <string.h>
+
+// Helpers for extension modules with multi-phase initialization (PEP 489).
+// Their state (e.g., their types, which are heap types) lives in the module
+// object instead of in static variables, so every interpreter that imports a
+// module gets its own copy, and nothing is shared between interpreters except
+// for internals that are safe to share between threads.
+
+// Slots at the end of the m_slots of every module, declaring that it supports
+// subinterpreters with their own GILs (Python 3.12+), whose objects are never
+// shared, and running without the GIL on free-threaded builds (Python 3.13+),
+// where their mutable objects (e.g., sorted lists, traversals, and the reverse
+// graphs cached by Graph objects) are locked by critical sections
+#ifdef Py_mod_multiple_interpreters
+#define MODULE_INTERPRETERS_SLOT                                               \
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#else
+#define MODULE_INTERPRETERS_SLOT
+#endif
+#ifdef Py_mod_gil
+#define MODULE_GIL_SLOT {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#else
+#define MODULE_GIL_SLOT
+#endif
+#define MODULE_THREADING_SLOTS MODULE_INTERPRETERS_SLOT MODULE_GIL_SLOT
+
+// Critical sections (Python 3.13+), which lock an object, or two, on
+// free-threaded builds and do nothing otherwise. A thread suspends its
+// critical sections while it waits (e.g., after releasing the GIL, or for
+// another lock), so objects that release the GIL or run Python code while
+// they're being modified still need to mark themselves busy. Older versions
+// don't have them, and need no locks
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
+
+// Flags of heap types added in Python 3.10, which older versions do without:
+// types that can't be changed like static types, and types without tp_new
+#ifndef Py_TPFLAGS_IMMUTABLETYPE
+#define Py_TPFLAGS_IMMUTABLETYPE 0
+#endif
+#ifndef Py_TPFLAGS_DISALLOW_INSTANTIATION
+#define Py_TPFLAGS_DISALLOW_INSTANTIATION 0
+#endif
+
+// A function as the value of a module or type slot. ISO C doesn't convert
+// function pointers to void pointers, but every platform Python runs on can
+// round-trip them through an integer
+#define SLOT_FUNCTION(f) ((void *) (uintptr_t) (f))
+
+// Create a heap type from `spec` for a module, and add it to the module under
+// the last component of its dotted name if `add` is nonzero. Returns a new
+// reference to the type, or NULL on failure
+static inline PyTypeObject *
+NewModuleType(PyObject *module, PyType_Spec *spec, int add)
+{
+    PyObject *type = PyType_FromModuleAndSpec(module, spec, NULL);
+
+    if (type && add) {
+        Py_INCREF(type);
+        if (PyModule_AddObject(module, strrchr(spec->name, '.') + 1,
+                               type) < 0) {
+            Py_DECREF(type);
+            Py_CLEAR(type);
+        }
+    }
+    return (PyTypeObject *) type;
+}
+
+// Borrowed reference to the module, created from `def`, that defined `type`
+// or its first base class defined by such a module (e.g., for a subclass of a
+// type of the module), or NULL with an exception set
+static inline PyObject *
+GetModuleOfType(PyTypeObject *type, PyModuleDef *def)
+{
+#if PY_VERSION_HEX >= 0x030B0000
+    return PyType_GetModuleByDef(type, def);
+#else
+    PyObject *mro = type->tp_mro, *module;
+    PyTypeObject *base;
+    Py_ssize_t i;
+
+    for (i = 0; mro && i < PyTuple_GET_SIZE(mro); ++i) {
+        base = (PyTypeObject *) PyTuple_GET_ITEM(mro, i);
+        if (!PyType_HasFeature(base, Py_TPFLAGS_HEAPTYPE)) continue;
+        module = ((PyHeapTypeObject *) base)->ht_module;
+        if (module && PyModule_GetDef(module) == def) return module;
+    }
+    PyErr_Format(PyExc_TypeError, "'%s' isn't a type of module '%s'",
+                 type->tp_name, def->m_name);
+    return NULL;
+#endif
+}
+
+#endif
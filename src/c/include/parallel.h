@@ -0,0 +1,20 @@
+#ifndef __ALGORITHMS_PARALLEL_H
+#define __ALGORITHMS_PARALLEL_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+// C counterparts of the helpers in src/cpp/include/parallel.h
+
+// Resolve a user-supplied thread count: non-positive means "use every core"
+int NumThreads(int);
+
+// Call `body(context, begin, end)` on up to `threads` contiguous chunks of the
+// range `[0,n)`, each in its own thread (the calling thread takes the first
+// chunk). Unlike the C++ version, there's no minimum chunk size, so callers
+// should pass ranges of sizable units of work, like whole sub-arrays to sort.
+// The bodies run concurrently, so they mustn't touch Python objects
+void ParallelFor(int, Py_ssize_t, void (*)(void *, Py_ssize_t, Py_ssize_t),
+                 void *);
+
+#endif
@@ -4,7 +4,12 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include <stdint.h>
+
 Py_ssize_t Partition(PyObject **, const Py_ssize_t, const Py_ssize_t);
-Py_ssize_t PartitionRandom(PyObject **, const Py_ssize_t, const Py_ssize_t);
+Py_ssize_t PartitionRandom(PyObject **, const Py_ssize_t, const Py_ssize_t,
+                           uint64_t *);
+int Partition3Way(PyObject **, const Py_ssize_t, const Py_ssize_t,
+                  Py_ssize_t *, Py_ssize_t *, uint64_t *);
 
 #endif
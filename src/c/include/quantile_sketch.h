@@ -0,0 +1,93 @@
+#ifndef __ALGORITHMS_QUANTILE_SKETCH_H
+#define __ALGORITHMS_QUANTILE_SKETCH_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+
+// Smallest, default, and largest accuracy parameters of a sketch
+#define SKETCH_MIN_K 8
+#define SKETCH_DEFAULT_K 200
+#define SKETCH_MAX_K 65535
+
+// Bound on the levels of a sketch, which has fewer: level h items stand for 2^h
+// items of the stream, so this is enough for any stream whose length fits in
+// 64 bits
+#define SKETCH_MAX_LEVELS 64
+
+// Items of one level of a sketch, which are sorted except at level 0
+typedef struct {
+    double *items;
+    Py_ssize_t size;
+    Py_ssize_t allocated;
+} SketchLevel;
+
+// KLL sketch (Karnin, Lang, and Liberty, "Optimal Quantile Approximation in
+// Streams") of a stream of numbers: a summary of O(k) numbers from which the
+// rank of any number, or the number of any rank, can be estimated to within
+// about SketchError(k) * n, where n is the length of the stream. New numbers
+// go into level 0. When the sketch is full, the lowest level holding at least
+// its capacity is compacted: it's sorted, and every other item (starting from
+// a random one of the first two) moves up a level, where it's worth twice as
+// many numbers. Level capacities shrink geometrically going down, so most of
+// the memory goes to the top levels, which summarize most of the stream.
+//
+// Sketches are plain C structures allocated with malloc, so updating them
+// doesn't need the GIL. They must be initialized with SketchInit. Functions
+// returning int return 0 if memory allocation failed (without setting an
+// exception), leaving the sketch valid but possibly missing some numbers
+typedef struct {
+    int k;
+    int num_levels;
+    uint64_t count;             // Numbers in the stream (excluding NaNs)
+    double min;                 // Smallest and largest numbers in the stream
+    double max;
+    uint64_t random;            // State of the generator of compaction offsets
+    Py_ssize_t size;            // Items in all the levels...
+    Py_ssize_t capacity;        // ... which are compacted beyond this size
+    SketchLevel levels[SKETCH_MAX_LEVELS];
+
+    // Every item in order with its cumulative weight, for queries. Rebuilt by
+    // SketchPrepare after updates
+    double *view;
+    uint64_t *ranks;
+    int view_valid;
+} QuantileSketch;
+
+void SketchInit(QuantileSketch *, int, uint64_t);
+void SketchFree(QuantileSketch *);
+
+// Approximate rank error (as a fraction of the length of the stream) of a
+// sketch with a given accuracy parameter, with 99% confidence
+double SketchError(int);
+
+// Smallest accuracy parameter whose rank error is at most a given fraction
+int SketchAccuracy(double);
+
+// Add the numbers `a[0,n)`, skipping NaNs
+int SketchUpdate(QuantileSketch *, const double *, Py_ssize_t);
+
+// Add the numbers summarized by another sketch, which must not be the same
+// sketch. The accuracy parameter becomes the smaller of the two
+int SketchMerge(QuantileSketch *, const QuantileSketch *);
+
+// Sort the items of a sketch for queries. The queries below need a prepared
+// nonempty sketch
+int SketchPrepare(QuantileSketch *);
+
+// Number whose normalized rank is approximately `q` (in `[0,1]`)
+double SketchQuantile(const QuantileSketch *, double);
+
+// Approximate fraction of the numbers of the stream less than or equal to `x`
+double SketchRank(const QuantileSketch *, double);
+
+// Compact serialization of a sketch, in the machine's byte order
+size_t SketchSerializedSize(const QuantileSketch *);
+void SketchSerialize(const QuantileSketch *, char *);
+
+// Replace the contents of an initialized sketch with deserialized ones.
+// Returns -1 if the data is invalid, leaving the sketch unchanged
+int SketchDeserialize(QuantileSketch *, const char *, size_t);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __ALGORITHMS_RADIX_H
+#define __ALGORITHMS_RADIX_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Keys for radix sorting: unsigned integers in the same order as the numbers
+// they come from. Signed integers have their sign bits flipped. Floating point
+// numbers have their sign bits set if they're nonnegative, and all their bits
+// flipped otherwise, so that more negative numbers get smaller keys. Negative
+// zero gets the key of zero, so that radix sorts treat them as equal like <
+// does, and NaNs go before -inf or after inf, depending on their sign bits
+
+static inline uint64_t
+FloatKey(float x)
+{
+    uint32_t bits = 0;
+    if (x != 0.0f) memcpy(&bits, &x, sizeof(bits));
+    return (bits & UINT32_C(0x80000000)) ? ~bits : bits | UINT32_C(0x80000000);
+}
+
+static inline uint64_t
+DoubleKey(double x)
+{
+    uint64_t bits = 0;
+    if (x != 0.0) memcpy(&bits, &x, sizeof(bits));
+    return (bits & (UINT64_C(1) << 63)) ? ~bits : bits | (UINT64_C(1) << 63);
+}
+
+static inline uint64_t
+Int64Key(int64_t x)
+{
+    return (uint64_t) x ^ (UINT64_C(1) << 63);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __ALGORITHMS_RNG_H
+#define __ALGORITHMS_RNG_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+// xorshift64* pseudorandom number generator for choosing random pivots
+static inline uint64_t
+NextRandom(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+// splitmix64 finalizer, which spreads every bit of `x` over the result
+static inline uint64_t
+MixBits(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+// State of the generator of the calling thread, which is seeded on first use
+// and then advanced by every call that draws from it, so consecutive calls
+// draw different numbers. Threads never share a state, so no locking is
+// needed. The seed mixes the time in nanoseconds, the address of the state
+// (which differs between threads, and between processes with address space
+// layout randomization), and a counter of the seeded states
+static inline uint64_t *
+ThreadRandomState(void)
+{
+    static _Thread_local uint64_t state = 0;
+    static atomic_uint_fast64_t seeded = 0;
+    struct timespec ts;
+
+    if (!state) {
+        timespec_get(&ts, TIME_UTC);
+        state = MixBits((uint64_t) ts.tv_sec * UINT64_C(1000000000)
+                        + (uint64_t) ts.tv_nsec)
+            ^ MixBits((uint64_t) (uintptr_t) &state)
+            ^ MixBits(atomic_fetch_add(&seeded, 1)
+                      + UINT64_C(0x9E3779B97F4A7C15));
+        if (!state) state = 1;
+    }
+    return &state;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __ALGORITHMS_SCRATCH_H
+#define __ALGORITHMS_SCRATCH_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+// Pool of scratch buffers for the kernels that need temporary arrays (merge
+// and radix sorts), so that sorting many lists in a loop doesn't allocate and
+// free a buffer every time. The pool is shared by every thread and guarded by
+// a mutex, so it can be used without the GIL. Idle buffers are kept as long as
+// their total size is at most a cap, and freed by ReleaseScratchBuffers
+
+// Get a buffer of at least `size` bytes, or NULL if out of memory (with no
+// exception set). The buffer must be given back with ReturnScratch
+void *AcquireScratch(size_t);
+void ReturnScratch(void *);
+
+// Free every idle buffer, returning the number of bytes freed
+size_t ReleaseScratchBuffers(void);
+
+// Set the most bytes of idle buffers to keep, returning the previous cap
+size_t SetScratchCap(size_t);
+
+// Statistics of the pool
+typedef struct {
+    size_t cached;          // Bytes of idle buffers
+    size_t buffers;         // Number of idle buffers
+    size_t high_water;      // Largest buffer requested, in bytes
+    size_t cap;             // Most bytes of idle buffers to keep
+    size_t hits;            // Requests served by idle buffers...
+    size_t misses;          // ... or by allocating new ones
+} ScratchInfo;
+
+void GetScratchInfo(ScratchInfo *);
+
+#endif
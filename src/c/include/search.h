@@ -6,4 +6,12 @@
 
 Py_ssize_t BinarySearch(PyObject **, PyObject *, Py_ssize_t, Py_ssize_t);
 
+// Bisection of the sorted array `a[first,last)`: the first index in
+// `[first,last]` whose item is greater than or equal to (BisectLeft) or greater
+// than (BisectRight) `value`, or -1 if a comparison failed. Unlike
+// BinarySearch, only items of `a[first,last)` are compared, with one
+// comparison per halving, however many of them are equal to `value`
+Py_ssize_t BisectLeft(PyObject **, PyObject *, Py_ssize_t, Py_ssize_t);
+Py_ssize_t BisectRight(PyObject **, PyObject *, Py_ssize_t, Py_ssize_t);
+
 #endif
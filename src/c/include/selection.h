@@ -4,6 +4,28 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include "buffer.h"
+
 PyObject *MinMax(PyObject **, const Py_ssize_t);
 
+// Counterpart of MinMax for a nonempty array of unboxed numbers of a given
+// type, which finds the positions of its smallest and largest items. It doesn't
+// touch any Python objects, so it can run without the GIL
+void TypedMinMax(const void *, ItemType, const Py_ssize_t, Py_ssize_t *,
+                 Py_ssize_t *);
+
+// Sliding window minima and maxima of `a[0,n)`: a tuple of two lists whose
+// i-th items are the smallest and largest items of `a[i,i+window)`, for every
+// i in `[0,n-window]`. Each item enters and leaves a monotonic deque of
+// candidates for the minimum (and maximum) once, so this takes O(n) time
+// whatever the window size. Returns NULL on failure
+PyObject *RollingMinMax(PyObject **, const Py_ssize_t, const Py_ssize_t);
+
+// Counterpart of RollingMinMax for arrays of unboxed numbers of a given type,
+// which writes the `n - window + 1` minima and maxima to `mins` and `maxs`.
+// Returns 0 if memory allocation failed, and doesn't touch any Python objects,
+// so it can run without the GIL
+int TypedRollingMinMax(const void *, ItemType, const Py_ssize_t,
+                       const Py_ssize_t, void *, void *);
+
 #endif
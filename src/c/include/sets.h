@@ -0,0 +1,49 @@
+#ifndef __ALGORITHMS_SETS_H
+#define __ALGORITHMS_SETS_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "buffer.h"
+
+// Set operations on sorted arrays, e.g., posting lists or sorted ID columns.
+// The inputs may contain duplicates, but the outputs don't: each function
+// writes the distinct items of its result to `out` in increasing order and
+// returns how many there are. The results are unspecified if an input isn't
+// sorted (or, for floating point numbers, contains NaNs).
+//
+// The functions on Python objects compare items with <, and return -1 if a
+// comparison failed. The items written to `out` are borrowed references to
+// items of the inputs. Their typed counterparts work on arrays of unboxed
+// numbers of a given type, and can't fail, so they can run without the GIL.
+//
+// `out` must have room for n items for Unique and Difference, min(n, m) items
+// for Intersect, and n + m items for Union, and may be the same array as the
+// first input for Unique, Intersect, and Difference.
+
+// Distinct items of `a[0,n)`
+Py_ssize_t Unique(PyObject **, Py_ssize_t, PyObject **);
+Py_ssize_t TypedUnique(const void *, ItemType, Py_ssize_t, void *);
+
+// Items of `a[0,n)` that are also in `b[0,m)`. Each item of the shorter array
+// is looked up in the longer one by galloping (exponential search followed by
+// binary search) if it's much longer, and the arrays are merged otherwise
+Py_ssize_t Intersect(PyObject **, Py_ssize_t, PyObject **, Py_ssize_t,
+                     PyObject **);
+Py_ssize_t TypedIntersect(const void *, Py_ssize_t, const void *, Py_ssize_t,
+                          ItemType, void *);
+
+// Items of `a[0,n)` or `b[0,m)`
+Py_ssize_t Union(PyObject **, Py_ssize_t, PyObject **, Py_ssize_t,
+                 PyObject **);
+Py_ssize_t TypedUnion(const void *, Py_ssize_t, const void *, Py_ssize_t,
+                      ItemType, void *);
+
+// Items of `a[0,n)` that aren't in `b[0,m)`, galloping through `b` if it's
+// much longer than `a`
+Py_ssize_t Difference(PyObject **, Py_ssize_t, PyObject **, Py_ssize_t,
+                      PyObject **);
+Py_ssize_t TypedDifference(const void *, Py_ssize_t, const void *, Py_ssize_t,
+                           ItemType, void *);
+
+#endif
@@ -4,6 +4,8 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include "buffer.h"
+
 int BinaryInsertionSort(PyObject **, const Py_ssize_t, const Py_ssize_t);
 int InsertionSort(PyObject **, const Py_ssize_t, const Py_ssize_t);
 int HeapSort(PyObject **, const Py_ssize_t, const Py_ssize_t);
@@ -11,4 +13,32 @@ int MergeSort(PyObject **, const Py_ssize_t, const Py_ssize_t);
 int QuickSort(PyObject **, const Py_ssize_t, const Py_ssize_t);
 int QuickSortRandom(PyObject **, const Py_ssize_t, const Py_ssize_t);
 
+// Used by the sort() dispatcher: a natural merge sort that's linear on sorted
+// or reversed inputs, and a three-way quick sort that's linear on inputs with
+// a fixed number of distinct items
+int AdaptiveMergeSort(PyObject **, const Py_ssize_t, const Py_ssize_t);
+int QuickSort3Way(PyObject **, const Py_ssize_t, const Py_ssize_t);
+
+// Counterparts of the algorithms above for arrays of unboxed numbers of a given
+// type, which don't touch any Python objects and so can run without the GIL
+int TypedBinaryInsertionSort(void *, ItemType, const Py_ssize_t,
+                             const Py_ssize_t);
+int TypedInsertionSort(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+int TypedHeapSort(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+int TypedMergeSort(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+int TypedQuickSort(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+int TypedQuickSortRandom(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+int TypedRadixSort(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+
+// Radix sort chunks of a typed array in parallel, with `threads` threads (all
+// cores if not positive), and merge them
+int TypedParallelSort(void *, ItemType, const Py_ssize_t, const Py_ssize_t,
+                      int);
+
+// Helpers for choosing a typed sorting algorithm: the number of items of
+// `a[first,last)` less than their predecessors, and reversal of `a[first,last)`
+Py_ssize_t TypedCountDescents(const void *, ItemType, const Py_ssize_t,
+                              const Py_ssize_t);
+void TypedReverse(void *, ItemType, const Py_ssize_t, const Py_ssize_t);
+
 #endif
@@ -0,0 +1,52 @@
+#ifndef __ALGORITHMS_SORT_PLAN_H
+#define __ALGORITHMS_SORT_PLAN_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "buffer.h"
+
+// Algorithms the sort() dispatcher chooses from
+typedef enum {
+    SORT_NONE,                  // The input is already sorted
+    SORT_REVERSE,               // The input is strictly decreasing
+    SORT_BINARY_INSERTION,
+    SORT_ADAPTIVE_MERGE,
+    SORT_QUICK_3WAY,
+    SORT_RADIX,
+    SORT_PARALLEL_RADIX,
+} SortAlgorithm;
+
+// What the sort() dispatcher found out about its input by probing it, and the
+// algorithm it chose
+typedef struct {
+    SortAlgorithm algorithm;
+    const char *items;          // "int", "float", "object", or an item type
+    Py_ssize_t size;
+    Py_ssize_t pairs;           // Adjacent pairs compared...
+    Py_ssize_t descents;        // ... of which this many were out of order
+    Py_ssize_t sampled;         // Items sampled to estimate duplicates...
+    Py_ssize_t distinct;        // ... of which this many were distinct
+    int threads;
+} SortPlan;
+
+// Probe the list items `a[first,last)` and choose how to sort them, stably if
+// `stable` is nonzero. Both functions return 0 and set an exception if a
+// comparison or memory allocation failed. The items may change between the
+// two calls (e.g., in the decision hook), which only affects performance
+int PlanSort(PyObject **, const Py_ssize_t, const Py_ssize_t, int, SortPlan *);
+int RunSortPlan(PyObject **, const Py_ssize_t, const Py_ssize_t,
+                const SortPlan *);
+
+// Probe the typed array `a[first,last)` and choose how to sort it, with up to
+// `threads` threads (all cores if not positive). Neither function touches
+// Python objects, and running the plan fails only if memory allocation does
+void PlanTypedSort(const void *, ItemType, const Py_ssize_t, const Py_ssize_t,
+                   int, SortPlan *);
+int RunTypedSortPlan(void *, ItemType, const Py_ssize_t, const Py_ssize_t,
+                     const SortPlan *);
+
+// Describe a plan as a dict, e.g., for the sort() decision hook
+PyObject *SortPlanToDict(const SortPlan *);
+
+#endif
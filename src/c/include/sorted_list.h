@@ -0,0 +1,84 @@
+#ifndef __ALGORITHMS_SORTED_LIST_H
+#define __ALGORITHMS_SORTED_LIST_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdint.h>
+
+// Most items in a chunk of a sorted list. Inserting into a chunk moves at most
+// this many pointers, instead of all the items after the insertion point
+#define SORTED_LIST_CHUNK 256
+
+// A contiguous run of the items of a sorted list. While every item is an int
+// that fits in 64 bits, or every item is a float, the items' radix keys (see
+// radix.h) are kept alongside them, so searches compare integers instead of
+// calling the items' comparison methods
+typedef struct {
+    Py_ssize_t size;
+    uint64_t keys[SORTED_LIST_CHUNK];
+    PyObject *items[SORTED_LIST_CHUNK];
+} Chunk;
+
+// Kinds of items in a sorted list, deciding how they're compared
+typedef enum {
+    KEYS_NONE,                  // The list is empty
+    KEYS_INT,                   // Ints that fit in 64 bits, compared by key
+    KEYS_FLOAT,                 // Floats, compared by key
+    KEYS_OBJECT,                // Anything else, compared by <
+} KeyKind;
+
+// Sorted list of Python objects, stored as a sequence of nonempty sorted
+// chunks. The chunk holding an item is found by binary search over the last
+// items of the chunks, and positions are translated to chunks by a Fenwick
+// tree of the chunk sizes, so adding, removing, searching, and indexing take
+// O(log n) comparisons and at most O(SORTED_LIST_CHUNK) moves, except when a
+// chunk is split or merged with a neighbor, which also moves the O(n /
+// SORTED_LIST_CHUNK) chunk pointers
+typedef struct {
+    Chunk **chunks;
+    Py_ssize_t *index;          // Fenwick tree of chunk sizes, 1-based
+    Py_ssize_t num_chunks;
+    Py_ssize_t allocated;       // Capacity of `chunks` (and `index`, plus one)
+    Py_ssize_t size;
+    KeyKind kind;
+    int busy;                   // Nonzero while comparing Python objects
+    size_t version;             // Incremented by every modification
+} SortedList;
+
+// Functions returning int return 1 on success and 0 with an exception set on
+// failure, which leaves the list unchanged. The list can't be modified while
+// it's comparing items, e.g., from the items' __lt__ methods: modifications
+// then raise RuntimeError
+
+// Free the items of a list, leaving it empty
+int SortedListClear(SortedList *);
+
+// Add an item, after any items equal to it
+int SortedListAdd(SortedList *, PyObject *);
+
+// Add every item of an iterable. Large batches are sorted and merged with the
+// items of the list, and small ones are added one at a time (so if adding a
+// small batch fails, some of its items may have been added)
+int SortedListUpdate(SortedList *, PyObject *);
+
+// Number of items less than (or if `right` is nonzero, less than or equal to)
+// an item, or -1 if a comparison failed
+Py_ssize_t SortedListBisect(SortedList *, PyObject *, int);
+
+// Position of the first item equal to an item, -1 if there's none, or -2 if a
+// comparison failed
+Py_ssize_t SortedListFind(SortedList *, PyObject *);
+
+// Item at a position in `[0,size)` (a borrowed reference)
+PyObject *SortedListGet(const SortedList *, Py_ssize_t);
+
+// Chunk and offset within the chunk of a position in `[0,size]`
+void SortedListLocate(const SortedList *, Py_ssize_t, Py_ssize_t *,
+                      Py_ssize_t *);
+
+// Remove the item at a position in `[0,size)`, returning a new reference to
+// it, or NULL if the list is busy comparing items
+PyObject *SortedListPop(SortedList *, Py_ssize_t);
+
+#endif
@@ -0,0 +1,761 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "args.h"
+#include "debug.h"
+#include "module.h"
+#include "sorted_list.h"
+
+// Sorted list
+
+typedef struct {
+    PyObject_HEAD
+    SortedList list;
+} SortedListObject;
+
+// Iterator over the items of a sorted list between two positions, which fails
+// if the list is modified. It keeps its list until it's freed, so that it can
+// lock it along with itself
+typedef struct {
+    PyObject_HEAD
+    SortedListObject *owner;
+    Py_ssize_t chunk;                   // Position of the next item...
+    Py_ssize_t offset;
+    Py_ssize_t remaining;               // ... and number of items left (-1
+                                        // once exhausted)
+    size_t version;
+} SortedListIterObject;
+
+// Module state: the types, which are created for every module object
+typedef struct {
+    PyTypeObject *sorted_list_type;
+    PyTypeObject *sorted_list_iter_type;
+} ContainersState;
+
+static PyModuleDef containersmodule;
+
+// State of the module that defined the type of `self`, or NULL on failure
+static ContainersState *
+GetState(PyObject *self)
+{
+    PyObject *module = GetModuleOfType(Py_TYPE(self), &containersmodule);
+    return module ? (ContainersState *) PyModule_GetState(module) : NULL;
+}
+
+// Iterator over the items of a sorted list in the positions `[start,stop)`.
+// The list must be locked
+static PyObject *
+SortedList_NewIter(SortedListObject *self, Py_ssize_t start, Py_ssize_t stop)
+{
+    ContainersState *state = GetState((PyObject *) self);
+    SortedListIterObject *it;
+
+    if (!state) return NULL;
+    it = PyObject_GC_New(SortedListIterObject, state->sorted_list_iter_type);
+    if (!it) return NULL;
+    Py_INCREF(self);
+    it->owner = self;
+    SortedListLocate(&self->list, start, &it->chunk, &it->offset);
+    it->remaining = stop > start ? stop - start : 0;
+    it->version = self->list.version;
+    PyObject_GC_Track(it);
+    return (PyObject *) it;
+}
+
+static PyObject *
+SortedList_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *iterable = NULL;
+    SortedListObject *self;
+
+    // Parse arguments
+    static const char *format = "|O:SortedList";
+    static const char *keywords[] = {"iterable", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &iterable))
+        return NULL;
+
+    if (!(self = (SortedListObject *) type->tp_alloc(type, 0))) return NULL;
+    if (iterable && !SortedListUpdate(&self->list, iterable)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *) self;
+}
+
+static int
+SortedList_Traverse(PyObject *self, visitproc visit, void *arg)
+{
+    SortedList *list = &((SortedListObject *) self)->list;
+    Py_VISIT(Py_TYPE(self));
+    for (Py_ssize_t j = 0; j < list->num_chunks; ++j)
+        for (Py_ssize_t k = 0; k < list->chunks[j]->size; ++k)
+            Py_VISIT(list->chunks[j]->items[k]);
+    return 0;
+}
+
+static int
+SortedList_Clear(PyObject *self)
+{
+    SortedListClear(&((SortedListObject *) self)->list);
+    PyErr_Clear();  // In case the list was busy
+    return 0;
+}
+
+static void
+SortedList_Dealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    SortedListClear(&((SortedListObject *) self)->list);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+static PyObject *
+SortedList_Repr(PyObject *self)
+{
+    PyObject *items, *repr = NULL;
+    int status;
+
+    if ((status = Py_ReprEnter(self)) != 0)
+        return status > 0 ? PyUnicode_FromString("SortedList([...])") : NULL;
+    if ((items = PySequence_List(self))) {
+        repr = PyUnicode_FromFormat("SortedList(%R)", items);
+        Py_DECREF(items);
+    }
+    Py_ReprLeave(self);
+    return repr;
+}
+
+static Py_ssize_t
+SortedList_Length(PyObject *self)
+{
+    Py_ssize_t size;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    size = ((SortedListObject *) self)->list.size;
+    Py_END_CRITICAL_SECTION();
+    return size;
+}
+
+static int
+SortedList_Contains(PyObject *self, PyObject *item)
+{
+    Py_ssize_t position;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    position = SortedListFind(&((SortedListObject *) self)->list, item);
+    Py_END_CRITICAL_SECTION();
+    return position == -2 ? -1 : position >= 0;
+}
+
+// New reference to the item at a position of a locked list, or NULL if the
+// position is out of range
+static PyObject *
+SortedList_ItemAt(SortedList *list, Py_ssize_t i)
+{
+    PyObject *item;
+
+    if ((size_t) i >= (size_t) list->size) {
+        PyErr_SetString(PyExc_IndexError, "SortedList index out of range");
+        return NULL;
+    }
+    item = SortedListGet(list, i);
+    Py_INCREF(item);
+    return item;
+}
+
+static PyObject *
+SortedList_Item(PyObject *self, Py_ssize_t i)
+{
+    PyObject *item;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    item = SortedList_ItemAt(&((SortedListObject *) self)->list, i);
+    Py_END_CRITICAL_SECTION();
+    return item;
+}
+
+// New list of the items of a locked list in the positions of a slice
+static PyObject *
+SortedList_Slice(SortedList *list, Py_ssize_t start, Py_ssize_t stop,
+                 Py_ssize_t step)
+{
+    Py_ssize_t length = PySlice_AdjustIndices(list->size, &start, &stop, step);
+    PyObject *items = PyList_New(length), *item;
+
+    if (!items) return NULL;
+    for (Py_ssize_t i = 0; i < length; ++i, start += step) {
+        item = SortedListGet(list, start);
+        Py_INCREF(item);
+        PyList_SET_ITEM(items, i, item);
+    }
+    return items;
+}
+
+static PyObject *
+SortedList_Subscript(PyObject *self, PyObject *key)
+{
+    SortedList *list = &((SortedListObject *) self)->list;
+    Py_ssize_t i, start, stop, step;
+    PyObject *result;
+
+    if (PyIndex_Check(key)) {
+        i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred()) return NULL;
+        Py_BEGIN_CRITICAL_SECTION(self);
+        result = SortedList_ItemAt(list, i < 0 ? i + list->size : i);
+        Py_END_CRITICAL_SECTION();
+        return result;
+    }
+    if (!PySlice_Check(key)) {
+        PyErr_Format(PyExc_TypeError,
+                     "SortedList indices must be integers or slices, not %s",
+                     Py_TYPE(key)->tp_name);
+        return NULL;
+    }
+    if (PySlice_Unpack(key, &start, &stop, &step) < 0) return NULL;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = SortedList_Slice(list, start, stop, step);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+static PyObject *
+SortedList_Iter(PyObject *self)
+{
+    SortedListObject *sorted_list = (SortedListObject *) self;
+    PyObject *it;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    it = SortedList_NewIter(sorted_list, 0, sorted_list->list.size);
+    Py_END_CRITICAL_SECTION();
+    return it;
+}
+
+static PyObject *
+SortedList_Add(PyObject *self, PyObject *item)
+{
+    int status;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = SortedListAdd(&((SortedListObject *) self)->list, item);
+    Py_END_CRITICAL_SECTION();
+    if (!status) return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+SortedList_Update(PyObject *self, PyObject *iterable)
+{
+    int status;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = SortedListUpdate(&((SortedListObject *) self)->list, iterable);
+    Py_END_CRITICAL_SECTION();
+    if (!status) return NULL;
+    Py_RETURN_NONE;
+}
+
+// Remove an item from a locked list, raising ValueError if it's missing and
+// `strict` is nonzero. Returns 0 on failure
+static int
+SortedList_RemoveLocked(SortedList *list, PyObject *item, int strict)
+{
+    Py_ssize_t position = SortedListFind(list, item);
+
+    if (position == -2) return 0;
+    if (position == -1) {
+        if (!strict) return 1;
+        PyErr_Format(PyExc_ValueError, "%R is not in SortedList", item);
+        return 0;
+    }
+    if (!(item = SortedListPop(list, position))) return 0;
+    Py_DECREF(item);
+    return 1;
+}
+
+// Remove an item, raising ValueError if it's missing and `strict` is nonzero
+static PyObject *
+SortedList_RemoveItem(PyObject *self, PyObject *item, int strict)
+{
+    int status;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = SortedList_RemoveLocked(&((SortedListObject *) self)->list, item,
+                                     strict);
+    Py_END_CRITICAL_SECTION();
+    if (!status) return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+SortedList_Remove(PyObject *self, PyObject *item)
+{
+    return SortedList_RemoveItem(self, item, 1);
+}
+
+static PyObject *
+SortedList_Discard(PyObject *self, PyObject *item)
+{
+    return SortedList_RemoveItem(self, item, 0);
+}
+
+static PyObject *
+SortedList_Pop(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+               PyObject *kwnames)
+{
+    static const char *const keywords[] = {"", NULL};
+    static ArgParser parser = {
+        .name = "pop",
+        .keywords = keywords,
+        .required = 0,
+        .positional = 1,
+    };
+    SortedList *list = &((SortedListObject *) self)->list;
+    PyObject *index, *item = NULL;
+    Py_ssize_t i = -1;
+
+    if (!ParseArgs(&parser, args, nargs, kwnames, &index)) return NULL;
+    if (index) {
+        i = PyNumber_AsSsize_t(index, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred()) return NULL;
+    }
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (list->size == 0) {
+        PyErr_SetString(PyExc_IndexError, "pop from empty SortedList");
+    } else {
+        if (i < 0) i += list->size;
+        if ((size_t) i >= (size_t) list->size) {
+            PyErr_SetString(PyExc_IndexError, "pop index out of range");
+        } else {
+            item = SortedListPop(list, i);
+        }
+    }
+    Py_END_CRITICAL_SECTION();
+    return item;
+}
+
+static PyObject *
+SortedList_ClearMethod(PyObject *self, PyObject *args)
+{
+    int status;
+
+    (void) args;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = SortedListClear(&((SortedListObject *) self)->list);
+    Py_END_CRITICAL_SECTION();
+    if (!status) return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+SortedList_BisectLeft(PyObject *self, PyObject *item)
+{
+    Py_ssize_t position;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    position = SortedListBisect(&((SortedListObject *) self)->list, item, 0);
+    Py_END_CRITICAL_SECTION();
+    return position < 0 ? NULL : PyLong_FromSsize_t(position);
+}
+
+static PyObject *
+SortedList_BisectRight(PyObject *self, PyObject *item)
+{
+    Py_ssize_t position;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    position = SortedListBisect(&((SortedListObject *) self)->list, item, 1);
+    Py_END_CRITICAL_SECTION();
+    return position < 0 ? NULL : PyLong_FromSsize_t(position);
+}
+
+static PyObject *
+SortedList_Index(PyObject *self, PyObject *item)
+{
+    Py_ssize_t position;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    position = SortedListFind(&((SortedListObject *) self)->list, item);
+    Py_END_CRITICAL_SECTION();
+    if (position == -2) return NULL;
+    if (position == -1) {
+        PyErr_Format(PyExc_ValueError, "%R is not in SortedList", item);
+        return NULL;
+    }
+    return PyLong_FromSsize_t(position);
+}
+
+static PyObject *
+SortedList_Count(PyObject *self, PyObject *item)
+{
+    SortedList *list = &((SortedListObject *) self)->list;
+    Py_ssize_t first, last = -1;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((first = SortedListBisect(list, item, 0)) >= 0)
+        last = SortedListBisect(list, item, 1);
+    Py_END_CRITICAL_SECTION();
+    if (last < 0) return NULL;
+    return PyLong_FromSsize_t(last - first);
+}
+
+static PyObject *
+SortedList_IRange(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+                  PyObject *kwnames)
+{
+    static const char *const keywords[] = {"minimum", "maximum", "inclusive",
+                                           NULL};
+    static ArgParser parser = {
+        .name = "irange",
+        .keywords = keywords,
+        .required = 0,
+        .positional = 2,
+    };
+    SortedList *list = &((SortedListObject *) self)->list;
+    PyObject *argv[3], *it = NULL;
+    Py_ssize_t start = 0, stop;
+    int include_minimum = 1, include_maximum = 1;
+
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return NULL;
+    if (argv[2] && (!PyTuple_Check(argv[2])
+                    || !PyArg_ParseTuple(argv[2], "pp", &include_minimum,
+                                         &include_maximum))) {
+        PyErr_SetString(PyExc_TypeError,
+                        "irange() inclusive must be a pair of bools");
+        return NULL;
+    }
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    stop = list->size;
+    if (argv[0] && argv[0] != Py_None)
+        start = SortedListBisect(list, argv[0], !include_minimum);
+    if (start >= 0 && argv[1] && argv[1] != Py_None)
+        stop = SortedListBisect(list, argv[1], include_maximum);
+    if (start >= 0 && stop >= 0)
+        it = SortedList_NewIter((SortedListObject *) self, start, stop);
+    Py_END_CRITICAL_SECTION();
+    return it;
+}
+
+// Next item of an iterator whose list is locked along with it
+static PyObject *
+SortedListIter_NextItem(SortedListIterObject *it)
+{
+    SortedList *list = &it->owner->list;
+    PyObject *item;
+
+    if (it->remaining < 0) return NULL;
+    if (it->version != list->version) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "SortedList changed during iteration");
+        it->remaining = -1;
+        return NULL;
+    }
+    if (it->remaining == 0) {
+        it->remaining = -1;
+        return NULL;
+    }
+    item = list->chunks[it->chunk]->items[it->offset];
+    if (++it->offset == list->chunks[it->chunk]->size) {
+        ++it->chunk;
+        it->offset = 0;
+    }
+    --it->remaining;
+    Py_INCREF(item);
+    return item;
+}
+
+static PyObject *
+SortedListIter_Next(PyObject *self)
+{
+    SortedListIterObject *it = (SortedListIterObject *) self;
+    PyObject *item;
+
+    Py_BEGIN_CRITICAL_SECTION2(self, it->owner);
+    item = SortedListIter_NextItem(it);
+    Py_END_CRITICAL_SECTION2();
+    return item;
+}
+
+static PyObject *
+SortedListIter_LengthHint(PyObject *self, PyObject *args)
+{
+    Py_ssize_t remaining;
+
+    (void) args;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    remaining = ((SortedListIterObject *) self)->remaining;
+    Py_END_CRITICAL_SECTION();
+    return PyLong_FromSsize_t(Py_MAX(remaining, 0));
+}
+
+static int
+SortedListIter_Traverse(PyObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(Py_TYPE(self));
+    Py_VISIT(((SortedListIterObject *) self)->owner);
+    return 0;
+}
+
+static void
+SortedListIter_Dealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(((SortedListIterObject *) self)->owner);
+    PyObject_GC_Del(self);
+    Py_DECREF(type);
+}
+
+PyDoc_STRVAR(SortedList_Add_doc,
+"add(item)\n\n"
+"Add an item, after any items equal to it.");
+
+PyDoc_STRVAR(SortedList_Update_doc,
+"update(iterable)\n\n"
+"Add every item of an iterable. Batches that are large compared to the list\n"
+"are sorted and merged with it in linear time.");
+
+PyDoc_STRVAR(SortedList_Remove_doc,
+"remove(item)\n\n"
+"Remove the first item equal to an item (ValueError if there's none).");
+
+PyDoc_STRVAR(SortedList_Discard_doc,
+"discard(item)\n\n"
+"Remove the first item equal to an item, if there's one.");
+
+PyDoc_STRVAR(SortedList_Pop_doc,
+"pop(index=-1, /) -> item\n\n"
+"Remove and return the item at a position (IndexError if out of range).");
+
+PyDoc_STRVAR(SortedList_ClearMethod_doc,
+"clear()\n\n"
+"Remove every item.");
+
+PyDoc_STRVAR(SortedList_BisectLeft_doc,
+"bisect_left(item) -> int\n\n"
+"Number of items less than an item, i.e., the position of the first item\n"
+"greater than or equal to it.");
+
+PyDoc_STRVAR(SortedList_BisectRight_doc,
+"bisect_right(item) -> int\n\n"
+"Number of items less than or equal to an item, i.e., the position of the\n"
+"first item greater than it.");
+
+PyDoc_STRVAR(SortedList_Index_doc,
+"index(item) -> int\n\n"
+"Position of the first item equal to an item (ValueError if there's none).");
+
+PyDoc_STRVAR(SortedList_Count_doc,
+"count(item) -> int\n\n"
+"Number of items equal to an item.");
+
+PyDoc_STRVAR(SortedList_IRange_doc,
+"irange(minimum=None, maximum=None, *, inclusive=(True, True)) -> iterator\n\n"
+"Iterate over the items between `minimum` and `maximum`, in order. Either\n"
+"bound can be None for no bound, and `inclusive` says whether items equal\n"
+"to each bound are included.");
+
+static PyMethodDef SortedList_Methods[] = {
+    {
+        .ml_name = "add",
+        .ml_meth = (PyCFunction) SortedList_Add,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_Add_doc,
+    },
+    {
+        .ml_name = "update",
+        .ml_meth = (PyCFunction) SortedList_Update,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_Update_doc,
+    },
+    {
+        .ml_name = "remove",
+        .ml_meth = (PyCFunction) SortedList_Remove,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_Remove_doc,
+    },
+    {
+        .ml_name = "discard",
+        .ml_meth = (PyCFunction) SortedList_Discard,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_Discard_doc,
+    },
+    {
+        .ml_name = "pop",
+        .ml_meth = (PyCFunction) SortedList_Pop,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = SortedList_Pop_doc,
+    },
+    {
+        .ml_name = "clear",
+        .ml_meth = (PyCFunction) SortedList_ClearMethod,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = SortedList_ClearMethod_doc,
+    },
+    {
+        .ml_name = "bisect_left",
+        .ml_meth = (PyCFunction) SortedList_BisectLeft,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_BisectLeft_doc,
+    },
+    {
+        .ml_name = "bisect_right",
+        .ml_meth = (PyCFunction) SortedList_BisectRight,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_BisectRight_doc,
+    },
+    {
+        .ml_name = "index",
+        .ml_meth = (PyCFunction) SortedList_Index,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_Index_doc,
+    },
+    {
+        .ml_name = "count",
+        .ml_meth = (PyCFunction) SortedList_Count,
+        .ml_flags = METH_O,
+        .ml_doc = SortedList_Count_doc,
+    },
+    {
+        .ml_name = "irange",
+        .ml_meth = (PyCFunction) SortedList_IRange,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = SortedList_IRange_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+PyDoc_STRVAR(SortedList_Type_doc,
+"SortedList(iterable=())\n\n"
+"List that keeps its items sorted as they're added and removed.\n\n"
+"The items are stored in sorted chunks of a few hundred items, with an\n"
+"index of the chunk sizes, so adding, removing, searching for, and indexing\n"
+"items take O(log n) comparisons and only move the items of one chunk,\n"
+"instead of O(n) items like inserting into a sorted list does. Lists of\n"
+"ints that fit in 64 bits or of floats are searched without calling the\n"
+"items' comparison methods. The items can't be changed while the list\n"
+"compares them.\n\n"
+">>> a = SortedList([3, 1, 2])\n"
+">>> a.add(0)\n"
+">>> a\n"
+"SortedList([0, 1, 2, 3])\n"
+">>> a[-1], a.bisect_left(2), list(a.irange(1, 2))\n"
+"(3, 2, [1, 2])");
+
+static PyType_Slot SortedList_Slots[] = {
+    {Py_tp_dealloc, SLOT_FUNCTION(SortedList_Dealloc)},
+    {Py_tp_repr, SLOT_FUNCTION(SortedList_Repr)},
+    {Py_sq_length, SLOT_FUNCTION(SortedList_Length)},
+    {Py_sq_item, SLOT_FUNCTION(SortedList_Item)},
+    {Py_sq_contains, SLOT_FUNCTION(SortedList_Contains)},
+    {Py_mp_length, SLOT_FUNCTION(SortedList_Length)},
+    {Py_mp_subscript, SLOT_FUNCTION(SortedList_Subscript)},
+    {Py_tp_hash, SLOT_FUNCTION(PyObject_HashNotImplemented)},
+    {Py_tp_doc, (void *) SortedList_Type_doc},
+    {Py_tp_traverse, SLOT_FUNCTION(SortedList_Traverse)},
+    {Py_tp_clear, SLOT_FUNCTION(SortedList_Clear)},
+    {Py_tp_iter, SLOT_FUNCTION(SortedList_Iter)},
+    {Py_tp_methods, SortedList_Methods},
+    {Py_tp_new, SLOT_FUNCTION(SortedList_New)},
+    {0, NULL}  // Sentinel
+};
+
+static PyType_Spec SortedList_Spec = {
+    .name = "algorithms.containers.SortedList",
+    .basicsize = sizeof(SortedListObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC
+        | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = SortedList_Slots,
+};
+
+static PyMethodDef SortedListIter_Methods[] = {
+    {
+        .ml_name = "__length_hint__",
+        .ml_meth = (PyCFunction) SortedListIter_LengthHint,
+        .ml_flags = METH_NOARGS,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyType_Slot SortedListIter_Slots[] = {
+    {Py_tp_dealloc, SLOT_FUNCTION(SortedListIter_Dealloc)},
+    {Py_tp_traverse, SLOT_FUNCTION(SortedListIter_Traverse)},
+    {Py_tp_iter, SLOT_FUNCTION(PyObject_SelfIter)},
+    {Py_tp_iternext, SLOT_FUNCTION(SortedListIter_Next)},
+    {Py_tp_methods, SortedListIter_Methods},
+    {0, NULL}  // Sentinel
+};
+
+static PyType_Spec SortedListIter_Spec = {
+    .name = "algorithms.containers.SortedListIterator",
+    .basicsize = sizeof(SortedListIterObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC
+        | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = SortedListIter_Slots,
+};
+
+// Module
+
+static int
+Containers_Exec(PyObject *module)
+{
+    ContainersState *state = PyModule_GetState(module);
+
+    state->sorted_list_iter_type = NewModuleType(module, &SortedListIter_Spec,
+                                                 0);
+    if (!state->sorted_list_iter_type) return -1;
+    state->sorted_list_type = NewModuleType(module, &SortedList_Spec, 1);
+    if (!state->sorted_list_type) return -1;
+    return 0;
+}
+
+static int
+Containers_Traverse(PyObject *module, visitproc visit, void *arg)
+{
+    ContainersState *state = PyModule_GetState(module);
+    Py_VISIT(state->sorted_list_type);
+    Py_VISIT(state->sorted_list_iter_type);
+    return 0;
+}
+
+static int
+Containers_Clear(PyObject *module)
+{
+    ContainersState *state = PyModule_GetState(module);
+    Py_CLEAR(state->sorted_list_type);
+    Py_CLEAR(state->sorted_list_iter_type);
+    return 0;
+}
+
+static void
+Containers_Free(void *module)
+{
+    Containers_Clear((PyObject *) module);
+}
+
+static PyModuleDef_Slot Containers_Slots[] = {
+    {Py_mod_exec, SLOT_FUNCTION(Containers_Exec)},
+    MODULE_THREADING_SLOTS
+    {0, NULL}  // Sentinel
+};
+
+static PyModuleDef containersmodule = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "algorithms.containers",
+    .m_doc = "Container data structures.",
+    .m_size = sizeof(ContainersState),
+    .m_slots = Containers_Slots,
+    .m_traverse = Containers_Traverse,
+    .m_clear = Containers_Clear,
+    .m_free = Containers_Free,
+};
+
+PyMODINIT_FUNC
+PyInit_containers(void)
+{
+    return PyModuleDef_Init(&containersmodule);
+}
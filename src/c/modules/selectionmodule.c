@@ -1,23 +1,49 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include "args.h"
 #include "debug.h"
+#include "instrument.h"
+#include "module.h"
+#include "quantile_sketch.h"
 #include "selection.h"
+#include "utils.h"
 
+#include <stdint.h>
+#include <time.h>
 
+// Find the smallest and largest items of the object `obj`
 static PyObject *
-Selection_MinMax(PyObject *self, PyObject *args)
+min_max_parsed(PyObject *obj)
 {
-    PyObject *obj;
     PyObject **sequence;
     Py_ssize_t size;
     PyObject *min_max = NULL;
+    Py_buffer view;
+    Py_ssize_t min, max;
+    int type;
 
-    (void) self;  // Unused parameter
-
-    // Parse positional arguments
-    if (!PyArg_UnpackTuple(args, "min_max", 1, 1, &obj))
-        return NULL;
+    // Buffers of numbers are scanned without boxing their items or holding the
+    // GIL, while the buffer export keeps their memory alive
+    if (!PyList_Check(obj) && !PyTuple_Check(obj)
+            && (type = GetTypedBuffer(obj, &view, PyBUF_SIMPLE)) >= 0) {
+        size = view.len / view.itemsize;
+        if (size == 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "min_max() arg is empty sequence");
+        } else {
+            Py_BEGIN_ALLOW_THREADS
+            TypedMinMax(view.buf, (ItemType) type, size, &min, &max);
+            Py_END_ALLOW_THREADS
+            PyObject *a = GetTypedItem(view.buf, (ItemType) type, min);
+            PyObject *b = GetTypedItem(view.buf, (ItemType) type, max);
+            if (a && b) min_max = PyTuple_Pack(2, a, b);
+            Py_XDECREF(a);
+            Py_XDECREF(b);
+        }
+        PyBuffer_Release(&view);
+        return min_max;
+    }
 
     // Get the underlying sequence of Python objects
     if (PyList_Check(obj)) {
@@ -31,6 +57,7 @@ Selection_MinMax(PyObject *self, PyObject *args)
     } else {
         obj = PySequence_List(obj);
         if (!obj) return NULL;
+        COUNT(allocations, 1);
         sequence = ((PyListObject *) obj)->ob_item;
         size = PyList_GET_SIZE(obj);
     }
@@ -40,31 +67,1181 @@ Selection_MinMax(PyObject *self, PyObject *args)
     return min_max;  // Could be NULL
 }
 
+static PyObject *
+Selection_MinMax(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+                 PyObject *kwnames)
+{
+    static const char *const keywords[] = {"", NULL};
+    static ArgParser parser = {
+        .name = "min_max",
+        .keywords = keywords,
+        .required = 1,
+        .positional = 1,
+    };
+    PyObject *obj;
+    PyObject *result;
+    InstrumentedCall call;
+
+    (void) self;  // Unused parameter
+
+    // Parse positional arguments
+    if (!ParseArgs(&parser, args, nargs, kwnames, &obj)) return NULL;
+
+    if (!Instrumenting) return min_max_parsed(obj);
+    InstrumentBegin(&call);
+    result = min_max_parsed(obj);
+    InstrumentEnd(&call, parser.name);
+    return result;
+}
+
 PyDoc_STRVAR(Selection_MinMax_doc,
 "min_max(seq) -> tuple\n\n"
-"Return the smallest and largest items in a sequence");
+"Return the smallest and largest items in a sequence.\n\n"
+"Buffers of integers or floating point numbers (e.g., array.array) are\n"
+"scanned without holding the GIL.");
+
+// Find the sliding window minima and maxima of the object `obj`
+static PyObject *
+rolling_min_max_parsed(PyObject *obj, Py_ssize_t window)
+{
+    PyObject **sequence;
+    Py_ssize_t size;
+    PyObject *mins, *maxs, *result = NULL;
+    Py_buffer view, mins_view, maxs_view;
+    int type, status = 0;
+
+    // Buffers of numbers give arrays of the same type, filled without boxing
+    // any items or holding the GIL
+    if (!PyList_Check(obj) && !PyTuple_Check(obj)
+            && (type = GetTypedBuffer(obj, &view, PyBUF_SIMPLE)) >= 0) {
+        size = view.len / view.itemsize;
+        mins = NewTypedArray((ItemType) type, Py_MAX(size - window + 1, 0),
+                             &mins_view);
+        maxs = mins ? NewTypedArray((ItemType) type,
+                                    Py_MAX(size - window + 1, 0), &maxs_view)
+                    : NULL;
+        if (maxs) {
+            Py_BEGIN_ALLOW_THREADS
+            status = TypedRollingMinMax(view.buf, (ItemType) type, size,
+                                        window, mins_view.buf, maxs_view.buf);
+            Py_END_ALLOW_THREADS
+            PyBuffer_Release(&maxs_view);
+            if (status) {
+                result = PyTuple_Pack(2, mins, maxs);
+            } else {
+                PyErr_NoMemory();
+            }
+        }
+        if (mins) PyBuffer_Release(&mins_view);
+        Py_XDECREF(mins);
+        Py_XDECREF(maxs);
+        PyBuffer_Release(&view);
+        return result;
+    }
+
+    // Get the underlying sequence of Python objects
+    if (PyList_Check(obj)) {
+        Py_INCREF(obj);
+        sequence = ((PyListObject *) obj)->ob_item;
+        size = PyList_GET_SIZE(obj);
+    } else if (PyTuple_Check(obj)) {
+        Py_INCREF(obj);
+        sequence = ((PyTupleObject *) obj)->ob_item;
+        size = PyTuple_GET_SIZE(obj);
+    } else {
+        obj = PySequence_List(obj);
+        if (!obj) return NULL;
+        COUNT(allocations, 1);
+        sequence = ((PyListObject *) obj)->ob_item;
+        size = PyList_GET_SIZE(obj);
+    }
+
+    result = RollingMinMax(sequence, size, window);
+    Py_DECREF(obj);
+    return result;  // Could be NULL
+}
+
+static PyObject *
+Selection_RollingMinMax(PyObject *self, PyObject *const *args,
+                        Py_ssize_t nargs, PyObject *kwnames)
+{
+    static const char *const keywords[] = {"", "window", NULL};
+    static ArgParser parser = {
+        .name = "rolling_min_max",
+        .keywords = keywords,
+        .required = 2,
+        .positional = 2,
+    };
+    PyObject *argv[2];
+    Py_ssize_t window;
+    PyObject *result;
+    InstrumentedCall call;
+
+    (void) self;  // Unused parameter
+
+    // Parse arguments
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return NULL;
+    window = PyNumber_AsSsize_t(argv[1], PyExc_OverflowError);
+    if (window == -1 && PyErr_Occurred()) return NULL;
+    if (window < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "rolling_min_max() window must be positive");
+        return NULL;
+    }
+
+    if (!Instrumenting) return rolling_min_max_parsed(argv[0], window);
+    InstrumentBegin(&call);
+    result = rolling_min_max_parsed(argv[0], window);
+    InstrumentEnd(&call, parser.name);
+    return result;
+}
+
+PyDoc_STRVAR(Selection_RollingMinMax_doc,
+"rolling_min_max(seq, window) -> tuple\n\n"
+"Return the smallest and largest items of every window of consecutive items\n"
+"of a sequence, as two sequences whose i-th items are min(seq[i:i+window])\n"
+"and max(seq[i:i+window]), in O(len(seq)) time.\n\n"
+"Buffers of integers or floating point numbers (e.g., array.array) give\n"
+"array.arrays of the same type of items, computed without holding the GIL.\n"
+"Other sequences give lists.");
+
+// Streaming quantile sketch
+
+typedef struct {
+    PyObject_HEAD
+    QuantileSketch sketch;
+    int busy;       // Nonzero while being updated (e.g., without the GIL)
+} QuantileSketchObject;
+
+// Module state: the types, which are created for every module object
+typedef struct {
+    PyTypeObject *quantile_sketch_type;
+    PyTypeObject *windowed_min_max_type;
+} SelectionState;
+
+static PyModuleDef selectionmodule;
+
+// State of the module that defined the type `type`, or NULL on failure
+static SelectionState *
+GetState(PyTypeObject *type)
+{
+    PyObject *module = GetModuleOfType(type, &selectionmodule);
+    return module ? (SelectionState *) PyModule_GetState(module) : NULL;
+}
+
+#define QuantileSketch_Check(state, op)                                        \
+    PyObject_TypeCheck(op, (state)->quantile_sketch_type)
+
+// Numbers gathered from an iterable before adding them to a sketch
+#define SKETCH_BATCH 256
+
+static int
+QuantileSketch_Available(QuantileSketchObject *self)
+{
+    if (!self->busy) return 1;
+    PyErr_SetString(PyExc_RuntimeError,
+                    "QuantileSketch is being updated");
+    return 0;
+}
+
+static PyObject *
+QuantileSketch_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *k_arg = NULL, *error_arg = Py_None, *seed_arg = Py_None;
+    QuantileSketchObject *self;
+    long k = SKETCH_DEFAULT_K;
+    double error;
+    uint64_t seed;
+
+    // Parse arguments
+    static const char *format = "|O$OO:QuantileSketch";
+    static const char *keywords[] = {"k", "error", "seed", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &k_arg, &error_arg, &seed_arg))
+        return NULL;
+
+    if (k_arg && error_arg != Py_None) {
+        PyErr_SetString(PyExc_TypeError,
+                        "QuantileSketch() takes k or error, not both");
+        return NULL;
+    }
+    if (k_arg) {
+        k = PyLong_AsLong(k_arg);
+        if (k == -1 && PyErr_Occurred()) return NULL;
+        if (k < SKETCH_MIN_K || k > SKETCH_MAX_K) {
+            PyErr_Format(PyExc_ValueError,
+                         "QuantileSketch() k must be between %d and %d",
+                         SKETCH_MIN_K, SKETCH_MAX_K);
+            return NULL;
+        }
+    } else if (error_arg != Py_None) {
+        error = PyFloat_AsDouble(error_arg);
+        if (error == -1.0 && PyErr_Occurred()) return NULL;
+        if (!(error > 0.0 && error < 1.0)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "QuantileSketch() error must be between 0 and 1");
+            return NULL;
+        }
+        k = SketchAccuracy(error);
+    }
+
+    if (!(self = (QuantileSketchObject *) type->tp_alloc(type, 0)))
+        return NULL;
+    if (seed_arg == Py_None) {
+        seed = (uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) self;
+    } else {
+        seed = PyLong_AsUnsignedLongLongMask(seed_arg);
+        if (seed == (uint64_t) -1 && PyErr_Occurred()) {
+            Py_DECREF(self);
+            return NULL;
+        }
+    }
+    SketchInit(&self->sketch, (int) k, seed);
+    return (PyObject *) self;
+}
+
+static void
+QuantileSketch_Dealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+    SketchFree(&((QuantileSketchObject *) self)->sketch);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+static PyObject *
+QuantileSketch_Repr(PyObject *self)
+{
+    QuantileSketch *sketch = &((QuantileSketchObject *) self)->sketch;
+    unsigned long long count;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    count = sketch->count;
+    Py_END_CRITICAL_SECTION();
+    return PyUnicode_FromFormat("<%s with k=%d summarizing %llu numbers>",
+                                Py_TYPE(self)->tp_name, sketch->k, count);
+}
+
+// Convert the items `a[first,last)` of a typed buffer to doubles
+static void
+ToDoubles(const void *a, ItemType type, Py_ssize_t first, Py_ssize_t last,
+          double *out)
+{
+#define CONVERT(T)                                                             \
+    for (Py_ssize_t i = first; i < last; ++i)                                  \
+        out[i - first] = (double) ((const T *) a)[i];                          \
+    break
+
+    switch (type) {
+        case ITEM_INT8: CONVERT(int8_t);
+        case ITEM_INT16: CONVERT(int16_t);
+        case ITEM_INT32: CONVERT(int32_t);
+        case ITEM_INT64: CONVERT(int64_t);
+        case ITEM_UINT8: CONVERT(uint8_t);
+        case ITEM_UINT16: CONVERT(uint16_t);
+        case ITEM_UINT32: CONVERT(uint32_t);
+        case ITEM_UINT64: CONVERT(uint64_t);
+        case ITEM_FLOAT: CONVERT(float);
+        case ITEM_DOUBLE: CONVERT(double);
+    }
+#undef CONVERT
+}
+
+// Add the numbers of a typed buffer to a sketch without holding the GIL.
+// Doubles are added straight from the buffer, and other numbers are converted
+// a batch at a time
+static int
+QuantileSketch_UpdateTyped(QuantileSketch *sketch, const void *a,
+                           ItemType type, Py_ssize_t n)
+{
+    double batch[SKETCH_BATCH];
+    Py_ssize_t i, m;
+
+    if (type == ITEM_DOUBLE) return SketchUpdate(sketch, a, n);
+    for (i = 0; i < n; i += m) {
+        m = Py_MIN(n - i, SKETCH_BATCH);
+        ToDoubles(a, type, i, i + m, batch);
+        if (!SketchUpdate(sketch, batch, m)) return 0;
+    }
+    return 1;
+}
+
+static PyObject *
+QuantileSketch_UpdateLocked(QuantileSketchObject *object, PyObject *data)
+{
+    QuantileSketch *sketch = &object->sketch;
+    double batch[SKETCH_BATCH];
+    PyObject *it, *item;
+    Py_ssize_t m = 0;
+    Py_buffer view;
+    int type, status = 1;
+
+    if (!QuantileSketch_Available(object)) return NULL;
+
+    // Buffers of numbers are added without boxing them or holding the GIL
+    if (!PyList_Check(data) && !PyTuple_Check(data)
+            && (type = GetTypedBuffer(data, &view, PyBUF_SIMPLE)) >= 0) {
+        object->busy = 1;
+        Py_BEGIN_ALLOW_THREADS
+        status = QuantileSketch_UpdateTyped(sketch, view.buf, (ItemType) type,
+                                            view.len / view.itemsize);
+        Py_END_ALLOW_THREADS
+        object->busy = 0;
+        PyBuffer_Release(&view);
+        if (!status) return PyErr_NoMemory();
+        Py_RETURN_NONE;
+    }
+
+    // Consuming the iterable runs Python code, which could start another update
+    // (e.g., by switching to another thread) in between batches, so the sketch
+    // is busy until all of them are added
+    if (!(it = PyObject_GetIter(data))) return NULL;
+    object->busy = 1;
+    while (status && (item = PyIter_Next(it))) {
+        batch[m] = PyFloat_AsDouble(item);
+        Py_DECREF(item);
+        if (batch[m] == -1.0 && PyErr_Occurred()) break;
+        if (++m == SKETCH_BATCH) {
+            status = SketchUpdate(sketch, batch, m);
+            m = 0;
+        }
+    }
+    Py_DECREF(it);
+    if (!PyErr_Occurred() && status) status = SketchUpdate(sketch, batch, m);
+    object->busy = 0;
+    if (PyErr_Occurred()) return NULL;
+    if (!status) return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+QuantileSketch_Update(PyObject *self, PyObject *data)
+{
+    PyObject *result;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    result = QuantileSketch_UpdateLocked((QuantileSketchObject *) self, data);
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+// Get a locked sketch ready for queries, raising ValueError if it's empty
+static QuantileSketch *
+QuantileSketch_Prepare(PyObject *self, const char *query)
+{
+    QuantileSketchObject *object = (QuantileSketchObject *) self;
+
+    if (!QuantileSketch_Available(object)) return NULL;
+    if (object->sketch.count == 0) {
+        PyErr_Format(PyExc_ValueError, "%s() of an empty QuantileSketch",
+                     query);
+        return NULL;
+    }
+    if (!SketchPrepare(&object->sketch)) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return &object->sketch;
+}
+
+static PyObject *
+QuantileSketch_Quantile(PyObject *self, PyObject *arg)
+{
+    QuantileSketch *sketch;
+    PyObject *result = NULL;
+    double q = PyFloat_AsDouble(arg);
+
+    if (q == -1.0 && PyErr_Occurred()) return NULL;
+    if (!(q >= 0.0 && q <= 1.0)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "quantile() arg must be between 0 and 1");
+        return NULL;
+    }
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((sketch = QuantileSketch_Prepare(self, "quantile")))
+        result = PyFloat_FromDouble(SketchQuantile(sketch, q));
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+static PyObject *
+QuantileSketch_Rank(PyObject *self, PyObject *arg)
+{
+    QuantileSketch *sketch;
+    PyObject *result = NULL;
+    double x = PyFloat_AsDouble(arg);
+
+    if (x == -1.0 && PyErr_Occurred()) return NULL;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((sketch = QuantileSketch_Prepare(self, "rank")))
+        result = PyFloat_FromDouble(SketchRank(sketch, x));
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+// Merge a sketch into another, both of which are locked
+static PyObject *
+QuantileSketch_MergeLocked(QuantileSketchObject *object, PyObject *other)
+{
+    QuantileSketch copy;
+    char *data;
+    int status;
+
+    if (!QuantileSketch_Available(object)
+            || !QuantileSketch_Available((QuantileSketchObject *) other))
+        return NULL;
+
+    if (other != (PyObject *) object) {
+        status = SketchMerge(&object->sketch,
+                             &((QuantileSketchObject *) other)->sketch);
+    } else {
+        // Merging a sketch with itself needs a copy of it
+        if (!(data = PyMem_Malloc(SketchSerializedSize(&object->sketch))))
+            return PyErr_NoMemory();
+        SketchSerialize(&object->sketch, data);
+        SketchInit(&copy, object->sketch.k, 0);
+        status = SketchDeserialize(&copy, data,
+                                   SketchSerializedSize(&object->sketch)) > 0
+                 && SketchMerge(&object->sketch, &copy);
+        SketchFree(&copy);
+        PyMem_Free(data);
+    }
+    if (!status) return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+QuantileSketch_Merge(PyObject *self, PyObject *other)
+{
+    SelectionState *state = GetState(Py_TYPE(self));
+    PyObject *result;
+
+    if (!state) return NULL;
+    if (!QuantileSketch_Check(state, other)) {
+        PyErr_Format(PyExc_TypeError,
+                     "merge() arg must be a QuantileSketch, not %s",
+                     Py_TYPE(other)->tp_name);
+        return NULL;
+    }
+    Py_BEGIN_CRITICAL_SECTION2(self, other);
+    result = QuantileSketch_MergeLocked((QuantileSketchObject *) self, other);
+    Py_END_CRITICAL_SECTION2();
+    return result;
+}
+
+static PyObject *
+QuantileSketch_ToBytes(PyObject *self, PyObject *args)
+{
+    QuantileSketchObject *object = (QuantileSketchObject *) self;
+    PyObject *bytes = NULL;
+
+    (void) args;  // Unused parameter
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (QuantileSketch_Available(object)) {
+        bytes = PyBytes_FromStringAndSize(
+            NULL, (Py_ssize_t) SketchSerializedSize(&object->sketch));
+        if (bytes) SketchSerialize(&object->sketch, PyBytes_AS_STRING(bytes));
+    }
+    Py_END_CRITICAL_SECTION();
+    return bytes;
+}
+
+static PyObject *
+QuantileSketch_FromBytes(PyObject *cls, PyObject *data)
+{
+    SelectionState *state = GetState((PyTypeObject *) cls);
+    QuantileSketchObject *self;
+    Py_buffer view;
+    int status;
+
+    if (!state) return NULL;
+    if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0) return NULL;
+    self = (QuantileSketchObject *) PyObject_CallNoArgs(cls);
+    if (self && !QuantileSketch_Check(state, self)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "from_bytes() class must create QuantileSketches");
+        Py_CLEAR(self);
+    }
+    if (self) {
+        Py_BEGIN_CRITICAL_SECTION(self);
+        status = SketchDeserialize(&self->sketch, view.buf, (size_t) view.len);
+        Py_END_CRITICAL_SECTION();
+        if (status <= 0) {
+            if (status < 0) {
+                PyErr_SetString(PyExc_ValueError,
+                                "invalid serialized QuantileSketch");
+            } else {
+                PyErr_NoMemory();
+            }
+            Py_CLEAR(self);
+        }
+    }
+    PyBuffer_Release(&view);
+    return (PyObject *) self;
+}
+
+static PyObject *
+QuantileSketch_GetK(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return PyLong_FromLong(((QuantileSketchObject *) self)->sketch.k);
+}
+
+static PyObject *
+QuantileSketch_GetCount(PyObject *self, void *closure)
+{
+    unsigned long long count;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    count = ((QuantileSketchObject *) self)->sketch.count;
+    Py_END_CRITICAL_SECTION();
+    return PyLong_FromUnsignedLongLong(count);
+}
+
+// Smallest number added to a sketch if `high` is 0, or else the largest one,
+// or None if there are none
+static PyObject *
+QuantileSketch_Extreme(PyObject *self, int high)
+{
+    QuantileSketch *sketch = &((QuantileSketchObject *) self)->sketch;
+    int empty;
+    double x;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    empty = !sketch->count;
+    x = high ? sketch->max : sketch->min;
+    Py_END_CRITICAL_SECTION();
+    if (empty) Py_RETURN_NONE;
+    return PyFloat_FromDouble(x);
+}
+
+static PyObject *
+QuantileSketch_GetMin(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return QuantileSketch_Extreme(self, 0);
+}
+
+static PyObject *
+QuantileSketch_GetMax(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return QuantileSketch_Extreme(self, 1);
+}
+
+static PyObject *
+QuantileSketch_GetError(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return PyFloat_FromDouble(
+        SketchError(((QuantileSketchObject *) self)->sketch.k));
+}
+
+static PyObject *
+QuantileSketch_GetRetained(PyObject *self, void *closure)
+{
+    Py_ssize_t size;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    size = ((QuantileSketchObject *) self)->sketch.size;
+    Py_END_CRITICAL_SECTION();
+    return PyLong_FromSsize_t(size);
+}
+
+PyDoc_STRVAR(QuantileSketch_Update_doc,
+"update(data)\n\n"
+"Add the numbers of an iterable or a buffer of numbers, skipping NaNs.\n"
+"Buffers (e.g., array.array) are added without holding the GIL, and buffers\n"
+"of doubles without copying them.");
+
+PyDoc_STRVAR(QuantileSketch_Quantile_doc,
+"quantile(q) -> float\n\n"
+"Approximate q-quantile of the numbers added so far, for q between 0 and 1:\n"
+"a number whose rank is within `error` of q. quantile(0) and quantile(1)\n"
+"are the exact smallest and largest numbers.");
+
+PyDoc_STRVAR(QuantileSketch_Rank_doc,
+"rank(x) -> float\n\n"
+"Approximate fraction of the numbers added so far that are less than or\n"
+"equal to x, within `error`.");
+
+PyDoc_STRVAR(QuantileSketch_Merge_doc,
+"merge(other)\n\n"
+"Add the numbers summarized by another sketch, e.g., of another shard of\n"
+"the stream. The result has the smaller k of the two sketches.");
+
+PyDoc_STRVAR(QuantileSketch_ToBytes_doc,
+"to_bytes() -> bytes\n\n"
+"Serialize the sketch, in the machine's byte order.");
+
+PyDoc_STRVAR(QuantileSketch_FromBytes_doc,
+"from_bytes(data) -> QuantileSketch\n\n"
+"Deserialize a sketch serialized by to_bytes().");
+
+static PyMethodDef QuantileSketch_Methods[] = {
+    {
+        .ml_name = "update",
+        .ml_meth = (PyCFunction) QuantileSketch_Update,
+        .ml_flags = METH_O,
+        .ml_doc = QuantileSketch_Update_doc,
+    },
+    {
+        .ml_name = "quantile",
+        .ml_meth = (PyCFunction) QuantileSketch_Quantile,
+        .ml_flags = METH_O,
+        .ml_doc = QuantileSketch_Quantile_doc,
+    },
+    {
+        .ml_name = "rank",
+        .ml_meth = (PyCFunction) QuantileSketch_Rank,
+        .ml_flags = METH_O,
+        .ml_doc = QuantileSketch_Rank_doc,
+    },
+    {
+        .ml_name = "merge",
+        .ml_meth = (PyCFunction) QuantileSketch_Merge,
+        .ml_flags = METH_O,
+        .ml_doc = QuantileSketch_Merge_doc,
+    },
+    {
+        .ml_name = "to_bytes",
+        .ml_meth = (PyCFunction) QuantileSketch_ToBytes,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = QuantileSketch_ToBytes_doc,
+    },
+    {
+        .ml_name = "from_bytes",
+        .ml_meth = (PyCFunction) QuantileSketch_FromBytes,
+        .ml_flags = METH_O | METH_CLASS,
+        .ml_doc = QuantileSketch_FromBytes_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyGetSetDef QuantileSketch_GetSet[] = {
+    {
+        .name = "k",
+        .get = QuantileSketch_GetK,
+        .doc = "Accuracy parameter: the sketch keeps about 3k numbers.",
+    },
+    {
+        .name = "count",
+        .get = QuantileSketch_GetCount,
+        .doc = "Number of numbers added so far.",
+    },
+    {
+        .name = "min",
+        .get = QuantileSketch_GetMin,
+        .doc = "Smallest number added so far (None if there are none).",
+    },
+    {
+        .name = "max",
+        .get = QuantileSketch_GetMax,
+        .doc = "Largest number added so far (None if there are none).",
+    },
+    {
+        .name = "error",
+        .get = QuantileSketch_GetError,
+        .doc = "Approximate rank error of queries, with 99% confidence.",
+    },
+    {
+        .name = "retained",
+        .get = QuantileSketch_GetRetained,
+        .doc = "Number of numbers the sketch keeps.",
+    },
+    {NULL, NULL, NULL, NULL, NULL}  // Sentinel
+};
+
+PyDoc_STRVAR(QuantileSketch_Type_doc,
+"QuantileSketch(k=200, *, error=None, seed=None)\n\n"
+"Summary of a stream of numbers in bounded memory (a KLL sketch), which\n"
+"estimates quantiles and ranks to within a fraction `error` of the length\n"
+"of the stream. Larger values of k give smaller errors (about 1.3% for the\n"
+"default) for about 3k numbers of memory. Alternatively, the largest\n"
+"acceptable error can be given. The sketch is randomized, with a random\n"
+"seed unless one is given.\n\n"
+">>> sketch = QuantileSketch()\n"
+">>> sketch.update(range(1, 100001))\n"
+">>> abs(sketch.quantile(0.5) - 50000) <= sketch.error * 100000\n"
+"True");
+
+static PyType_Slot QuantileSketch_Slots[] = {
+    {Py_tp_dealloc, SLOT_FUNCTION(QuantileSketch_Dealloc)},
+    {Py_tp_repr, SLOT_FUNCTION(QuantileSketch_Repr)},
+    {Py_tp_doc, (void *) QuantileSketch_Type_doc},
+    {Py_tp_methods, QuantileSketch_Methods},
+    {Py_tp_getset, QuantileSketch_GetSet},
+    {Py_tp_new, SLOT_FUNCTION(QuantileSketch_New)},
+    {0, NULL}  // Sentinel
+};
+
+static PyType_Spec QuantileSketch_Spec = {
+    .name = "algorithms.selection.QuantileSketch",
+    .basicsize = sizeof(QuantileSketchObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE
+        | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = QuantileSketch_Slots,
+};
+
+// Streaming sliding window minimum and maximum
+
+// Item of a monotonic deque of a WindowedMinMax, with its position in the
+// stream
+typedef struct {
+    PyObject *item;
+    Py_ssize_t index;
+} WindowEntry;
+
+// Monotonic deque, stored in a ring buffer whose capacity is a power of two.
+// Its positions `[head,tail)` grow without bound and are wrapped with `mask`
+typedef struct {
+    WindowEntry *entries;
+    Py_ssize_t mask;
+    Py_ssize_t head;
+    Py_ssize_t tail;
+} WindowDeque;
+
+typedef struct {
+    PyObject_HEAD
+    Py_ssize_t window;
+    Py_ssize_t count;       // Number of items pushed so far
+    WindowDeque lows;       // Candidates for the minimum, in increasing order
+    WindowDeque highs;      // Candidates for the maximum, in decreasing order
+    int busy;               // Nonzero while comparing items
+} WindowedMinMaxObject;
+
+// Initial capacity of the deques, which only grow as large as the window if
+// the stream is monotonic
+#define WINDOW_DEQUE_MIN_CAPACITY 8
+
+#define DEQUE_ENTRY(deque, i) ((deque)->entries[(i) & (deque)->mask])
+
+// Make room for one more entry in a deque. Returns 0 on failure
+static int
+WindowDequeReserve(WindowDeque *deque)
+{
+    Py_ssize_t capacity = deque->mask + 1, i;
+    WindowEntry *entries;
+
+    if (deque->entries && deque->tail - deque->head < capacity) return 1;
+    if (deque->entries) capacity *= 2;
+    if (!(entries = PyMem_Malloc(capacity * sizeof(WindowEntry)))) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    for (i = deque->head; i < deque->tail; ++i)
+        entries[i & (capacity - 1)] = DEQUE_ENTRY(deque, i);
+    PyMem_Free(deque->entries);
+    deque->entries = entries;
+    deque->mask = capacity - 1;
+    return 1;
+}
+
+// Position that the tail of a deque will have after dropping the entries that
+// `x` is at least as good as (smaller or equal for the minimum if `high` is 0,
+// larger or equal for the maximum otherwise), without dropping them yet, so
+// that a failed comparison leaves the deque unchanged. Returns -1 on failure
+static Py_ssize_t
+WindowDequeScan(WindowDeque *deque, Py_ssize_t head, PyObject *x, int high)
+{
+    Py_ssize_t tail = deque->tail;
+    int status;
+
+    while (tail > head) {
+        PyObject *y = DEQUE_ENTRY(deque, tail - 1).item;
+        if ((status = high ? LT(x, y) : LT(y, x)) < 0) return -1;
+        if (status) break;
+        --tail;
+    }
+    return tail;
+}
+
+// Drop the entries of a deque outside `[head,tail)` and append `x`. The deque
+// is consistent whenever a dropped item is released, in case that runs code
+static void
+WindowDequePush(WindowDeque *deque, Py_ssize_t head, Py_ssize_t tail,
+                PyObject *x, Py_ssize_t index)
+{
+    PyObject *y;
+
+    while (deque->head < head) {
+        y = DEQUE_ENTRY(deque, deque->head).item;
+        ++deque->head;
+        Py_DECREF(y);
+    }
+    while (deque->tail > tail) {
+        --deque->tail;
+        y = DEQUE_ENTRY(deque, deque->tail).item;
+        Py_DECREF(y);
+    }
+    Py_INCREF(x);
+    DEQUE_ENTRY(deque, deque->tail).item = x;
+    DEQUE_ENTRY(deque, deque->tail).index = index;
+    ++deque->tail;
+}
+
+static void
+WindowDequeClear(WindowDeque *deque)
+{
+    while (deque->tail > deque->head) {
+        --deque->tail;
+        Py_CLEAR(DEQUE_ENTRY(deque, deque->tail).item);
+    }
+}
+
+static PyObject *
+WindowedMinMax_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    WindowedMinMaxObject *self;
+    Py_ssize_t window;
+
+    // Parse arguments
+    static const char *format = "n:WindowedMinMax";
+    static const char *keywords[] = {"window", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &window))
+        return NULL;
+    if (window < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "WindowedMinMax() window must be positive");
+        return NULL;
+    }
+
+    if (!(self = (WindowedMinMaxObject *) type->tp_alloc(type, 0)))
+        return NULL;
+    self->window = window;
+    self->lows.mask = self->highs.mask = WINDOW_DEQUE_MIN_CAPACITY - 1;
+    return (PyObject *) self;
+}
+
+static int
+WindowedMinMax_Traverse(PyObject *self, visitproc visit, void *arg)
+{
+    WindowedMinMaxObject *object = (WindowedMinMaxObject *) self;
+    Py_VISIT(Py_TYPE(self));
+    for (Py_ssize_t i = object->lows.head; i < object->lows.tail; ++i)
+        Py_VISIT(DEQUE_ENTRY(&object->lows, i).item);
+    for (Py_ssize_t i = object->highs.head; i < object->highs.tail; ++i)
+        Py_VISIT(DEQUE_ENTRY(&object->highs, i).item);
+    return 0;
+}
+
+static int
+WindowedMinMax_Clear(PyObject *self)
+{
+    WindowedMinMaxObject *object = (WindowedMinMaxObject *) self;
+    WindowDequeClear(&object->lows);
+    WindowDequeClear(&object->highs);
+    return 0;
+}
+
+static void
+WindowedMinMax_Dealloc(PyObject *self)
+{
+    WindowedMinMaxObject *object = (WindowedMinMaxObject *) self;
+    PyTypeObject *type = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    WindowedMinMax_Clear(self);
+    PyMem_Free(object->lows.entries);
+    PyMem_Free(object->highs.entries);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+// Push an item. Returns 0 on failure, leaving the window unchanged
+static int
+WindowedMinMax_PushItem(WindowedMinMaxObject *self, PyObject *x)
+{
+    const Py_ssize_t expired = self->count - self->window;
+    Py_ssize_t lo_head = self->lows.head, hi_head = self->highs.head;
+    Py_ssize_t lo_tail, hi_tail;
+
+    if (self->busy) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "WindowedMinMax can't be modified while comparing "
+                        "items");
+        return 0;
+    }
+    if (!WindowDequeReserve(&self->lows) || !WindowDequeReserve(&self->highs))
+        return 0;
+
+    // The oldest item leaves the window, and so the deques if it's there
+    if (lo_head < self->lows.tail
+            && DEQUE_ENTRY(&self->lows, lo_head).index <= expired)
+        ++lo_head;
+    if (hi_head < self->highs.tail
+            && DEQUE_ENTRY(&self->highs, hi_head).index <= expired)
+        ++hi_head;
+
+    self->busy = 1;
+    lo_tail = WindowDequeScan(&self->lows, lo_head, x, 0);
+    hi_tail = lo_tail < 0 ? -1 : WindowDequeScan(&self->highs, hi_head, x, 1);
+    if (hi_tail >= 0) {
+        WindowDequePush(&self->lows, lo_head, lo_tail, x, self->count);
+        WindowDequePush(&self->highs, hi_head, hi_tail, x, self->count);
+        ++self->count;
+    }
+    self->busy = 0;
+    return hi_tail >= 0;
+}
+
+// Push an item while holding the lock of the window. Returns 0 on failure
+static int
+WindowedMinMax_LockAndPush(PyObject *self, PyObject *x)
+{
+    int status;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = WindowedMinMax_PushItem((WindowedMinMaxObject *) self, x);
+    Py_END_CRITICAL_SECTION();
+    return status;
+}
+
+static PyObject *
+WindowedMinMax_Push(PyObject *self, PyObject *x)
+{
+    if (!WindowedMinMax_LockAndPush(self, x)) return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+WindowedMinMax_Extend(PyObject *self, PyObject *iterable)
+{
+    PyObject *it, *x;
+    int status = 1;
+
+    if (!(it = PyObject_GetIter(iterable))) return NULL;
+    while (status && (x = PyIter_Next(it))) {
+        status = WindowedMinMax_LockAndPush(self, x);
+        Py_DECREF(x);
+    }
+    Py_DECREF(it);
+    if (PyErr_Occurred()) return NULL;
+    Py_RETURN_NONE;
+}
+
+static Py_ssize_t
+WindowedMinMax_Len(PyObject *self)
+{
+    WindowedMinMaxObject *object = (WindowedMinMaxObject *) self;
+    Py_ssize_t count;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    count = object->count;
+    Py_END_CRITICAL_SECTION();
+    return Py_MIN(count, object->window);
+}
+
+// Front item of a deque, or None if nothing was pushed
+static PyObject *
+WindowedMinMax_Front(PyObject *self, int high)
+{
+    WindowedMinMaxObject *object = (WindowedMinMaxObject *) self;
+    WindowDeque *deque = high ? &object->highs : &object->lows;
+    PyObject *item = Py_None;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (deque->head != deque->tail) item = DEQUE_ENTRY(deque, deque->head).item;
+    Py_INCREF(item);
+    Py_END_CRITICAL_SECTION();
+    return item;
+}
+
+static PyObject *
+WindowedMinMax_GetMin(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return WindowedMinMax_Front(self, 0);
+}
+
+static PyObject *
+WindowedMinMax_GetMax(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return WindowedMinMax_Front(self, 1);
+}
+
+static PyObject *
+WindowedMinMax_GetWindow(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return PyLong_FromSsize_t(((WindowedMinMaxObject *) self)->window);
+}
+
+static PyObject *
+WindowedMinMax_GetCount(PyObject *self, void *closure)
+{
+    Py_ssize_t count;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    count = ((WindowedMinMaxObject *) self)->count;
+    Py_END_CRITICAL_SECTION();
+    return PyLong_FromSsize_t(count);
+}
+
+PyDoc_STRVAR(WindowedMinMax_Push_doc,
+"push(x)\n\n"
+"Add an item to the window, dropping the oldest one if it's full.");
+
+PyDoc_STRVAR(WindowedMinMax_Extend_doc,
+"extend(iterable)\n\n"
+"Push every item of an iterable.");
+
+static PyMethodDef WindowedMinMax_Methods[] = {
+    {
+        .ml_name = "push",
+        .ml_meth = (PyCFunction) WindowedMinMax_Push,
+        .ml_flags = METH_O,
+        .ml_doc = WindowedMinMax_Push_doc,
+    },
+    {
+        .ml_name = "extend",
+        .ml_meth = (PyCFunction) WindowedMinMax_Extend,
+        .ml_flags = METH_O,
+        .ml_doc = WindowedMinMax_Extend_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyGetSetDef WindowedMinMax_GetSet[] = {
+    {
+        .name = "min",
+        .get = WindowedMinMax_GetMin,
+        .doc = "Smallest item in the window (None if it's empty).",
+    },
+    {
+        .name = "max",
+        .get = WindowedMinMax_GetMax,
+        .doc = "Largest item in the window (None if it's empty).",
+    },
+    {
+        .name = "window",
+        .get = WindowedMinMax_GetWindow,
+        .doc = "Largest number of items in the window.",
+    },
+    {
+        .name = "count",
+        .get = WindowedMinMax_GetCount,
+        .doc = "Number of items pushed so far.",
+    },
+    {NULL, NULL, NULL, NULL, NULL}  // Sentinel
+};
+
+PyDoc_STRVAR(WindowedMinMax_Type_doc,
+"WindowedMinMax(window)\n\n"
+"Smallest and largest of the last `window` items pushed onto a stream, in\n"
+"amortized O(1) time per item and O(window) memory (much less unless the\n"
+"stream is monotonic). len() is the number of items in the window.\n\n"
+">>> w = WindowedMinMax(3)\n"
+">>> w.extend([4, 1, 5, 9])\n"
+">>> w.min, w.max\n"
+"(1, 9)\n"
+">>> w.push(2)\n"
+">>> w.min, w.max\n"
+"(2, 9)");
+
+static PyType_Slot WindowedMinMax_Slots[] = {
+    {Py_tp_dealloc, SLOT_FUNCTION(WindowedMinMax_Dealloc)},
+    {Py_sq_length, SLOT_FUNCTION(WindowedMinMax_Len)},
+    {Py_tp_doc, (void *) WindowedMinMax_Type_doc},
+    {Py_tp_traverse, SLOT_FUNCTION(WindowedMinMax_Traverse)},
+    {Py_tp_clear, SLOT_FUNCTION(WindowedMinMax_Clear)},
+    {Py_tp_methods, WindowedMinMax_Methods},
+    {Py_tp_getset, WindowedMinMax_GetSet},
+    {Py_tp_new, SLOT_FUNCTION(WindowedMinMax_New)},
+    {0, NULL}  // Sentinel
+};
+
+static PyType_Spec WindowedMinMax_Spec = {
+    .name = "algorithms.selection.WindowedMinMax",
+    .basicsize = sizeof(WindowedMinMaxObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC
+        | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = WindowedMinMax_Slots,
+};
 
 // List of functions exposed by the module
 static PyMethodDef SelectionMethods[] = {
     {
         .ml_name = "min_max",
-        .ml_meth = Selection_MinMax,
-        .ml_flags = METH_VARARGS,
+        .ml_meth = (PyCFunction) Selection_MinMax,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Selection_MinMax_doc,
     },
+    {
+        .ml_name = "rolling_min_max",
+        .ml_meth = (PyCFunction) Selection_RollingMinMax,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = Selection_RollingMinMax_doc,
+    },
+    INSTRUMENT_METHODDEF,
     {NULL, NULL, 0, NULL}  // Sentinel
 };
 
+// Module
+
+static int
+Selection_Exec(PyObject *module)
+{
+    SelectionState *state = PyModule_GetState(module);
+
+    state->quantile_sketch_type = NewModuleType(module, &QuantileSketch_Spec,
+                                                1);
+    if (!state->quantile_sketch_type) return -1;
+    state->windowed_min_max_type = NewModuleType(module, &WindowedMinMax_Spec,
+                                                 1);
+    if (!state->windowed_min_max_type) return -1;
+    return 0;
+}
+
+static int
+Selection_Traverse(PyObject *module, visitproc visit, void *arg)
+{
+    SelectionState *state = PyModule_GetState(module);
+    Py_VISIT(state->quantile_sketch_type);
+    Py_VISIT(state->windowed_min_max_type);
+    return 0;
+}
+
+static int
+Selection_Clear(PyObject *module)
+{
+    SelectionState *state = PyModule_GetState(module);
+    Py_CLEAR(state->quantile_sketch_type);
+    Py_CLEAR(state->windowed_min_max_type);
+    return 0;
+}
+
+static void
+Selection_Free(void *module)
+{
+    Selection_Clear((PyObject *) module);
+}
+
+static PyModuleDef_Slot Selection_Slots[] = {
+    {Py_mod_exec, SLOT_FUNCTION(Selection_Exec)},
+    MODULE_THREADING_SLOTS
+    {0, NULL}  // Sentinel
+};
+
 static PyModuleDef selectionmodule = {
     PyModuleDef_HEAD_INIT,
     .m_name = "algorithms.selection",
     .m_doc = "Selection algorithms.",
-    .m_size = -1,
+    .m_size = sizeof(SelectionState),
     .m_methods = SelectionMethods,
+    .m_slots = Selection_Slots,
+    .m_traverse = Selection_Traverse,
+    .m_clear = Selection_Clear,
+    .m_free = Selection_Free,
 };
 
 PyMODINIT_FUNC
 PyInit_selection(void)
 {
-    return PyModule_Create(&selectionmodule);
+    return PyModuleDef_Init(&selectionmodule);
 }
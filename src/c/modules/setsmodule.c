@@ -0,0 +1,394 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "debug.h"
+#include "instrument.h"
+#include "module.h"
+#include "sets.h"
+
+typedef enum {
+    SET_UNIQUE,
+    SET_INTERSECT,
+    SET_UNION,
+    SET_DIFFERENCE,
+} SetOperation;
+
+// Sorted operand of a set operation: a typed buffer, or a tuple of the items of
+// a sequence of Python objects (a copy of a list, so that comparisons calling
+// back into Python can't resize it)
+typedef struct {
+    Py_buffer view;
+    PyObject *tuple;
+    Py_ssize_t size;
+} Operand;
+
+// Export typed buffers of numbers of the same type from every argument.
+// Returns their type, or -1 (without an exception) if some argument isn't such
+// a buffer, in which case no buffer is held
+static int
+GetTypedOperands(PyObject *const *args, Py_ssize_t n, Operand *operands)
+{
+    int type = -1, item_type;
+    Py_ssize_t i;
+
+    for (i = 0; i < n; ++i) {
+        item_type = -1;
+        if (!PyList_Check(args[i]) && !PyTuple_Check(args[i]))
+            item_type = GetTypedBuffer(args[i], &operands[i].view,
+                                       PyBUF_SIMPLE);
+        if (item_type >= 0 && i > 0 && item_type != type) {
+            PyBuffer_Release(&operands[i].view);
+            item_type = -1;
+        }
+        if (item_type < 0) break;
+        type = item_type;
+        operands[i].size = operands[i].view.len / operands[i].view.itemsize;
+    }
+    if (i == n) return type;
+    while (i--) PyBuffer_Release(&operands[i].view);
+    return -1;
+}
+
+// Get the items of every argument as a tuple
+static int
+GetObjectOperands(PyObject *const *args, Py_ssize_t n, Operand *operands)
+{
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        operands[i].tuple = PySequence_Tuple(args[i]);
+        if (!operands[i].tuple) {
+            while (i--) Py_DECREF(operands[i].tuple);
+            return 0;
+        }
+        if (operands[i].tuple != args[i]) COUNT(allocations, 1);
+        operands[i].size = PyTuple_GET_SIZE(operands[i].tuple);
+    }
+    return 1;
+}
+
+// Order of the operands of a multi-way intersection or union: shortest first,
+// so that intersections shrink as early as possible (and gallop through the
+// longer operands), and unions merge the longest operands the fewest times
+static void
+SortOperands(Operand *operands, Py_ssize_t n)
+{
+    for (Py_ssize_t i = 1; i < n; ++i) {
+        Operand operand = operands[i];
+        Py_ssize_t j = i;
+        for (; j > 0 && operand.size < operands[j - 1].size; --j)
+            operands[j] = operands[j - 1];
+        operands[j] = operand;
+    }
+}
+
+// Largest possible size of the result of a set operation
+static Py_ssize_t
+ResultBound(SetOperation operation, const Operand *operands, Py_ssize_t n)
+{
+    Py_ssize_t bound = operands[0].size;
+    for (Py_ssize_t i = 1; i < n && operation == SET_UNION; ++i)
+        bound += operands[i].size;
+    return bound;
+}
+
+// Apply a set operation to the typed operands `operands[0,n)` without the GIL,
+// folding it over them from left to right. Intersections and differences are
+// updated in-place in `bufs[0]`, while unions alternate between `bufs[0]` and
+// `bufs[1]`. Returns the size of the result, and points `result` to it
+static Py_ssize_t
+TypedSetOperation(SetOperation operation, ItemType type,
+                  const Operand *operands, Py_ssize_t n, void **bufs,
+                  void **result)
+{
+    const void *a = operands[0].view.buf;
+    Py_ssize_t k = operands[0].size;
+    void *out = bufs[0];
+
+    if (n == 1) {
+        k = TypedUnique(a, type, k, out);
+        a = out;
+    }
+    for (Py_ssize_t i = 1; i < n; ++i) {
+        const void *b = operands[i].view.buf;
+        const Py_ssize_t m = operands[i].size;
+        switch (operation) {
+            case SET_INTERSECT:
+                k = TypedIntersect(a, k, b, m, type, out);
+                break;
+            case SET_UNION:
+                k = TypedUnion(a, k, b, m, type, out);
+                break;
+            default:
+                k = TypedDifference(a, k, b, m, type, out);
+                break;
+        }
+        a = out;
+        if (operation == SET_UNION) out = (out == bufs[0]) ? bufs[1] : bufs[0];
+        if (operation == SET_INTERSECT && k == 0) break;
+    }
+    *result = (void *) a;
+    return k;
+}
+
+// Same as TypedSetOperation for operands of Python objects, with the GIL.
+// Returns -1 if a comparison failed
+static Py_ssize_t
+ObjectSetOperation(SetOperation operation, const Operand *operands,
+                   Py_ssize_t n, PyObject ***bufs, PyObject ***result)
+{
+    PyObject **a = ((PyTupleObject *) operands[0].tuple)->ob_item;
+    Py_ssize_t k = operands[0].size;
+    PyObject **out = bufs[0];
+
+    if (n == 1) {
+        k = Unique(a, k, out);
+        a = out;
+    }
+    for (Py_ssize_t i = 1; i < n && k >= 0; ++i) {
+        PyObject **b = ((PyTupleObject *) operands[i].tuple)->ob_item;
+        const Py_ssize_t m = operands[i].size;
+        switch (operation) {
+            case SET_INTERSECT:
+                k = Intersect(a, k, b, m, out);
+                break;
+            case SET_UNION:
+                k = Union(a, k, b, m, out);
+                break;
+            default:
+                k = Difference(a, k, b, m, out);
+                break;
+        }
+        a = out;
+        if (operation == SET_UNION) out = (out == bufs[0]) ? bufs[1] : bufs[0];
+        if (operation == SET_INTERSECT && k == 0) break;
+    }
+    *result = a;
+    return k;
+}
+
+// Result of a set operation on typed buffers of numbers, as an array.array
+static PyObject *
+typed_set_operation(SetOperation operation, ItemType type,
+                    const Operand *operands, Py_ssize_t n)
+{
+    const size_t size = (size_t) operands[0].view.itemsize;
+    const size_t bound = (size_t) ResultBound(operation, operands, n) * size;
+    void *bufs[2] = {NULL, NULL}, *buf;
+    PyObject *array = NULL;
+    Py_buffer view;
+    Py_ssize_t k;
+
+    // One extra byte, since the result could be empty
+    bufs[0] = PyMem_Malloc(bound + 1);
+    if (operation == SET_UNION && n > 2) bufs[1] = PyMem_Malloc(bound + 1);
+    if (!bufs[0] || (operation == SET_UNION && n > 2 && !bufs[1])) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    k = TypedSetOperation(operation, type, operands, n, bufs, &buf);
+    Py_END_ALLOW_THREADS
+
+    // Copy the result into a new array.array of the same type
+    if ((array = NewTypedArray(type, k, &view))) {
+        memcpy(view.buf, buf, k * size);
+        PyBuffer_Release(&view);
+    }
+
+done:
+    PyMem_Free(bufs[0]);
+    PyMem_Free(bufs[1]);
+    return array;
+}
+
+// Result of a set operation on sequences of Python objects, as a list
+static PyObject *
+object_set_operation(SetOperation operation, const Operand *operands,
+                     Py_ssize_t n)
+{
+    const size_t bound = (size_t) ResultBound(operation, operands, n);
+    PyObject **bufs[2] = {NULL, NULL}, **buf;
+    PyObject *list = NULL;
+    Py_ssize_t k;
+
+    bufs[0] = PyMem_Malloc(bound * sizeof(PyObject *) + 1);
+    if (operation == SET_UNION && n > 2)
+        bufs[1] = PyMem_Malloc(bound * sizeof(PyObject *) + 1);
+    if (!bufs[0] || (operation == SET_UNION && n > 2 && !bufs[1])) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    COUNT(allocations, 1 + (bufs[1] != NULL));
+
+    if ((k = ObjectSetOperation(operation, operands, n, bufs, &buf)) < 0)
+        goto done;
+    if (!(list = PyList_New(k))) goto done;
+    for (Py_ssize_t i = 0; i < k; ++i) {
+        Py_INCREF(buf[i]);
+        PyList_SET_ITEM(list, i, buf[i]);
+    }
+
+done:
+    PyMem_Free(bufs[0]);
+    PyMem_Free(bufs[1]);
+    return list;
+}
+
+// Apply a set operation to the sorted arguments `args[0,n)`
+static PyObject *
+set_operation(SetOperation operation, PyObject *const *args, Py_ssize_t n)
+{
+    PyObject *result = NULL;
+    Operand *operands;
+    int type;
+
+    if (!(operands = PyMem_Malloc(n * sizeof(Operand))))
+        return PyErr_NoMemory();
+
+    // Buffers of numbers of the same type are combined without boxing their
+    // items or holding the GIL, while the buffer exports keep their memory
+    // alive. The order of the operands of differences matters
+    if ((type = GetTypedOperands(args, n, operands)) >= 0) {
+        if (operation != SET_DIFFERENCE) SortOperands(operands, n);
+        result = typed_set_operation(operation, (ItemType) type, operands, n);
+        for (Py_ssize_t i = 0; i < n; ++i)
+            PyBuffer_Release(&operands[i].view);
+    } else if (GetObjectOperands(args, n, operands)) {
+        if (operation != SET_DIFFERENCE) SortOperands(operands, n);
+        result = object_set_operation(operation, operands, n);
+        for (Py_ssize_t i = 0; i < n; ++i)
+            Py_DECREF(operands[i].tuple);
+    }
+
+    PyMem_Free(operands);
+    return result;  // Could be NULL
+}
+
+// Apply a set operation with instrumentation, if it's enabled
+static PyObject *
+instrumented_set_operation(SetOperation operation, const char *name,
+                           PyObject *const *args, Py_ssize_t n)
+{
+    PyObject *result;
+    InstrumentedCall call;
+
+    if (n < 1) {
+        PyErr_Format(PyExc_TypeError, "%s() expected at least 1 argument",
+                     name);
+        return NULL;
+    }
+    if (!Instrumenting) return set_operation(operation, args, n);
+    InstrumentBegin(&call);
+    result = set_operation(operation, args, n);
+    InstrumentEnd(&call, name);
+    return result;
+}
+
+static PyObject *
+Sets_Unique(PyObject *self, PyObject *seq)
+{
+    (void) self;  // Unused parameter
+    return instrumented_set_operation(SET_UNIQUE, "unique", &seq, 1);
+}
+
+static PyObject *
+Sets_Intersect(PyObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    (void) self;  // Unused parameter
+    return instrumented_set_operation(SET_INTERSECT, "intersect", args, nargs);
+}
+
+static PyObject *
+Sets_Union(PyObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    (void) self;  // Unused parameter
+    return instrumented_set_operation(SET_UNION, "union", args, nargs);
+}
+
+static PyObject *
+Sets_Difference(PyObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    (void) self;  // Unused parameter
+    return instrumented_set_operation(SET_DIFFERENCE, "difference", args,
+                                      nargs);
+}
+
+#define SETS_DOC_FOOTER                                                        \
+"\n\n"                                                                         \
+"The arguments must be sorted (duplicates are allowed), and the result is\n"   \
+"sorted without duplicates. Buffers of integers or floating point numbers of\n"\
+"the same type (e.g., array.array) are combined without holding the GIL,\n"    \
+"into an array.array. Other arguments give a list."
+
+PyDoc_STRVAR(Sets_Unique_doc,
+"unique(seq) -> list or array\n\n"
+"Return the distinct items of a sorted sequence."
+SETS_DOC_FOOTER);
+
+PyDoc_STRVAR(Sets_Intersect_doc,
+"intersect(seq, *others) -> list or array\n\n"
+"Return the items in every one of several sorted sequences.\n\n"
+"The sequences are intersected shortest first, and each item of a much\n"
+"shorter sequence is looked up in a longer one by galloping (exponential\n"
+"search) instead of merging them."
+SETS_DOC_FOOTER);
+
+PyDoc_STRVAR(Sets_Union_doc,
+"union(seq, *others) -> list or array\n\n"
+"Return the items in any of several sorted sequences."
+SETS_DOC_FOOTER);
+
+PyDoc_STRVAR(Sets_Difference_doc,
+"difference(seq, *others) -> list or array\n\n"
+"Return the items of a sorted sequence that aren't in any of several others."
+SETS_DOC_FOOTER);
+
+// List of functions exposed by the module
+static PyMethodDef SetsMethods[] = {
+    {
+        .ml_name = "unique",
+        .ml_meth = (PyCFunction) Sets_Unique,
+        .ml_flags = METH_O,
+        .ml_doc = Sets_Unique_doc,
+    },
+    {
+        .ml_name = "intersect",
+        .ml_meth = (PyCFunction) Sets_Intersect,
+        .ml_flags = METH_FASTCALL,
+        .ml_doc = Sets_Intersect_doc,
+    },
+    {
+        .ml_name = "union",
+        .ml_meth = (PyCFunction) Sets_Union,
+        .ml_flags = METH_FASTCALL,
+        .ml_doc = Sets_Union_doc,
+    },
+    {
+        .ml_name = "difference",
+        .ml_meth = (PyCFunction) Sets_Difference,
+        .ml_flags = METH_FASTCALL,
+        .ml_doc = Sets_Difference_doc,
+    },
+    INSTRUMENT_METHODDEF,
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyModuleDef_Slot Sets_Slots[] = {
+    MODULE_THREADING_SLOTS
+    {0, NULL}  // Sentinel
+};
+
+static PyModuleDef setsmodule = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "algorithms.sets",
+    .m_doc = "Set operations on sorted sequences.",
+    .m_size = 0,
+    .m_methods = SetsMethods,
+    .m_slots = Sets_Slots,
+};
+
+PyMODINIT_FUNC
+PyInit_sets(void)
+{
+    return PyModuleDef_Init(&setsmodule);
+}
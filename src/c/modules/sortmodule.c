@@ -1,8 +1,42 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include "args.h"
 #include "debug.h"
+#include "incremental_sort.h"
+#include "instrument.h"
+#include "lexsort.h"
+#include "module.h"
+#include "scratch.h"
 #include "sort.h"
+#include "sort_plan.h"
+
+// Python function names
+#define BINARY_INSERTION_SORT "binary_insertion_sort"
+#define INSERTION_SORT "insertion_sort"
+#define HEAP_SORT "heap_sort"
+#define MERGE_SORT "merge_sort"
+#define QUICK_SORT "quick_sort"
+#define QUICK_SORT_RANDOM "quick_sort_random"
+#define SORT "sort"
+#define LEXSORT "lexsort"
+#define SORT_RECORDS "sort_records"
+#define SET_DECISION_HOOK "set_decision_hook"
+#define RELEASE_BUFFERS "release_buffers"
+#define BUFFER_INFO "buffer_info"
+#define SET_BUFFER_CAP "set_buffer_cap"
+
+// Parameters shared by every sorting function:
+// sort(seq, /, first, last, *, inplace)
+static const char *const sort_keywords[] = {"", "first", "last", "inplace",
+                                            NULL};
+#define SORT_ARG_PARSER(function_name)                                         \
+    {                                                                          \
+        .name = function_name,                                                 \
+        .keywords = sort_keywords,                                             \
+        .required = 1,                                                         \
+        .positional = 3,                                                       \
+    }
 
 // Helper function used by sort_boilerplate to parse `first` and `last`
 static inline void
@@ -15,36 +49,114 @@ parse_index(PyObject *op, Py_ssize_t *index, Py_ssize_t default_,
         // PyLong_AsSsize_t returns -1 on failure, so an error check is needed
         if (PyErr_Occurred())
             return;
-        if ((size_t) index > (size_t) max) {
+        if ((size_t) *index > (size_t) max) {
             PyErr_SetString(PyExc_IndexError, "Index out of range.");
             return;
         }
     }
 }
 
-// Wrapper around sorting implementations that handles things like argument
-// parsing and initial error checking
+// Items of a typed buffer to sort: the memory of the buffer if sorting it
+// in-place, and otherwise a copy, which is sorted instead and must be freed.
+// Returns NULL on failure
+static void *
+typed_items(const Py_buffer *view, int inplace)
+{
+    void *items;
+
+    if (inplace) return view->buf;
+    if (!(items = PyMem_Malloc((size_t) view->len))) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    COUNT(allocations, 1);
+    memcpy(items, view->buf, (size_t) view->len);
+    return items;
+}
+
+// Result of sorting the items of the typed buffer `obj`, given the `status`
+// of the sort: `obj` itself if its memory was sorted, and otherwise a new list
+// of the sorted copy `items`, which is freed. Releases the buffer
+static PyObject *
+typed_result(PyObject *obj, Py_buffer *view, ItemType type, void *items,
+             int status)
+{
+    PyObject *result = NULL, *item;
+    const Py_ssize_t size = view->len / view->itemsize;
+    Py_ssize_t i;
+
+    if (!status) {
+        PyErr_NoMemory();
+    } else if (items == view->buf) {
+        Py_INCREF(obj);
+        result = obj;
+    } else if ((result = PyList_New(size))) {
+        for (i = 0; i < size; ++i) {
+            if (!(item = GetTypedItem(items, type, i))) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, i, item);
+        }
+    }
+    if (items != view->buf) PyMem_Free(items);
+    PyBuffer_Release(view);
+    return result;
+}
+
+// Get a typed buffer of `obj` to sort, which has to be writable if sorting it
+// in-place. Returns the type of its items, or -1 if it isn't sorted as a typed
+// buffer, in which case an exception is set if it can't be sorted at all
+static int
+get_sort_buffer(PyObject *obj, Py_buffer *view, int inplace)
+{
+    int type;
+
+    if (PyList_CheckExact(obj)) return -1;
+    type = GetTypedBuffer(obj, view, inplace ? PyBUF_WRITABLE : PyBUF_SIMPLE);
+    if (type < 0 && inplace)
+        PyErr_SetString(PyExc_TypeError, "only lists and writable buffers of "
+                                         "numbers can be sorted in-place");
+    return type;
+}
+
+// Sort the object `argv[0]` between the indices `argv[1]` and `argv[2]`
 static inline PyObject *
-sort_boilerplate(PyObject *self, PyObject *args, PyObject *kwargs,
-                 int (*sort)(PyObject **, const Py_ssize_t, const Py_ssize_t))
+sort_parsed(PyObject **argv, int inplace,
+            int (*sort)(PyObject **, const Py_ssize_t, const Py_ssize_t),
+            int (*typed_sort)(void *, ItemType, const Py_ssize_t,
+                              const Py_ssize_t))
 {
     // PyObjects are guilty until proven innocent
-    PyObject *obj = NULL;
-    PyObject *first = NULL;
-    PyObject *last = NULL;
+    PyObject *obj = argv[0];
 
     Py_ssize_t size;
     Py_ssize_t _first;
     Py_ssize_t _last;
 
-    (void) self;  // Unused parameter
+    Py_buffer view;
+    void *items;
+    int type;
+    int status;
 
-    // Parse positional and keyword arguments
-    static const char *format = "O|OO";
-    static char *keywords[] = {"", "first", "last", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, keywords, &obj,
-                                     &first, &last))
-        return NULL;
+    // Buffers of numbers (e.g., array.array) are sorted without boxing their
+    // items. This doesn't touch any Python objects, so other threads can run
+    // in the meantime; holding on to the buffer keeps its memory from being
+    // resized or freed until we're done
+    if ((type = get_sort_buffer(obj, &view, inplace)) >= 0) {
+        size = view.len / view.itemsize;
+        parse_index(argv[1], &_first, 0, size - 1);
+        parse_index(argv[2], &_last, size, size);
+        if (PyErr_Occurred() || !(items = typed_items(&view, inplace))) {
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        status = typed_sort(items, (ItemType) type, _first, _last);
+        Py_END_ALLOW_THREADS
+        return typed_result(obj, &view, (ItemType) type, items, status);
+    }
+    if (PyErr_Occurred()) return NULL;
 
     // If `obj` is a list, sort it in-place. In every other case, interpret
     // `obj` as a sequence, and sort the list of its values
@@ -53,12 +165,13 @@ sort_boilerplate(PyObject *self, PyObject *args, PyObject *kwargs,
     } else {
         obj = PySequence_List(obj);
         if (obj == NULL) return NULL;
+        COUNT(allocations, 1);
     }
 
     // Figure out sorting bounds, defaulting to the entire list
     size = PyList_GET_SIZE(obj);
-    parse_index(first, &_first, 0, size - 1);
-    parse_index(last, &_last, size, size);
+    parse_index(argv[1], &_first, 0, size - 1);
+    parse_index(argv[2], &_last, size, size);
     if (PyErr_Occurred()) {
         Py_DECREF(obj);
         return NULL;
@@ -74,54 +187,578 @@ sort_boilerplate(PyObject *self, PyObject *args, PyObject *kwargs,
     return obj;
 }
 
-#define SORT_SIGNATURE(name) name "(seq) -> list\n\n"
+// Wrapper around sorting implementations that handles things like argument
+// parsing and initial error checking
+static inline PyObject *
+sort_boilerplate(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+                 PyObject *kwnames, ArgParser *parser,
+                 int (*sort)(PyObject **, const Py_ssize_t, const Py_ssize_t),
+                 int (*typed_sort)(void *, ItemType, const Py_ssize_t,
+                                   const Py_ssize_t))
+{
+    PyObject *argv[4];
+    PyObject *result;
+    InstrumentedCall call;
+    int inplace = 0;
+
+    (void) self;  // Unused parameter
+
+    // Parse positional and keyword arguments
+    if (!ParseArgs(parser, args, nargs, kwnames, argv)) return NULL;
+    if (argv[3] && (inplace = PyObject_IsTrue(argv[3])) < 0) return NULL;
+
+    if (!Instrumenting) return sort_parsed(argv, inplace, sort, typed_sort);
+    InstrumentBegin(&call);
+    result = sort_parsed(argv, inplace, sort, typed_sort);
+    InstrumentEnd(&call, parser->name);
+    return result;
+}
+
+// Module state: the callable passed the decisions of sort() (or NULL), which
+// is swapped while holding the module's lock, and the IncrementalSorter type
+typedef struct {
+    PyObject *decision_hook;
+    PyTypeObject *incremental_sorter_type;
+} SortState;
+
+// Pass a plan to the decision hook of the module, if there is one. Returns 0
+// if it raised
+static int
+report_plan(PyObject *module, const SortPlan *plan)
+{
+    SortState *state = PyModule_GetState(module);
+    PyObject *hook, *decision, *result = NULL;
+
+    // Another thread could replace the hook while it's being called
+    Py_BEGIN_CRITICAL_SECTION(module);
+    hook = state->decision_hook;
+    Py_XINCREF(hook);
+    Py_END_CRITICAL_SECTION();
+    if (!hook) return 1;
+    if ((decision = SortPlanToDict(plan))) {
+        result = PyObject_CallOneArg(hook, decision);
+        Py_DECREF(decision);
+    }
+    Py_DECREF(hook);
+    Py_XDECREF(result);
+    return result != NULL;
+}
+
+// Sort the object `argv[0]` between the indices `argv[1]` and `argv[2]` with
+// an algorithm chosen by probing it
+static PyObject *
+sort_dispatch(PyObject *module, PyObject **argv, int inplace, int stable,
+              int threads)
+{
+    PyObject *obj = argv[0];
+    Py_ssize_t size;
+    Py_ssize_t _first;
+    Py_ssize_t _last;
+    SortPlan plan;
+    Py_buffer view;
+    void *items;
+    int type;
+    int status;
+
+    // Typed buffers are probed and sorted without the GIL, which is only taken
+    // in between to report the plan
+    if ((type = get_sort_buffer(obj, &view, inplace)) >= 0) {
+        size = view.len / view.itemsize;
+        parse_index(argv[1], &_first, 0, size - 1);
+        parse_index(argv[2], &_last, size, size);
+        if (PyErr_Occurred() || !(items = typed_items(&view, inplace))) {
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        PlanTypedSort(items, (ItemType) type, _first, _last, threads, &plan);
+        Py_END_ALLOW_THREADS
+        if (!report_plan(module, &plan)) {
+            if (items != view.buf) PyMem_Free(items);
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        status = RunTypedSortPlan(items, (ItemType) type, _first, _last,
+                                  &plan);
+        Py_END_ALLOW_THREADS
+        return typed_result(obj, &view, (ItemType) type, items, status);
+    }
+    if (PyErr_Occurred()) return NULL;
+
+    if (PyList_CheckExact(obj)) {
+        Py_INCREF(obj);
+    } else {
+        obj = PySequence_List(obj);
+        if (obj == NULL) return NULL;
+        COUNT(allocations, 1);
+    }
+
+    size = PyList_GET_SIZE(obj);
+    parse_index(argv[1], &_first, 0, size - 1);
+    parse_index(argv[2], &_last, size, size);
+    if (PyErr_Occurred()) goto fail;
+
+    if (!PlanSort(((PyListObject *) obj)->ob_item, _first, _last, stable,
+                  &plan))
+        goto fail;
+    if (!report_plan(module, &plan)) goto fail;
+    // The hook could have changed the list, which mustn't be sorted past its
+    // end (the plan's algorithm still works for any items)
+    if (PyList_GET_SIZE(obj) != size) {
+        PyErr_SetString(PyExc_ValueError, "list modified during sort");
+        goto fail;
+    }
+    if (!RunSortPlan(((PyListObject *) obj)->ob_item, _first, _last, &plan))
+        goto fail;
+    return obj;
+
+fail:
+    Py_DECREF(obj);
+    return NULL;
+}
+
+// Sizes of the items of every type, indexed by ItemType
+static const Py_ssize_t item_sizes[] = {1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
+
+// A column of lexsort(): a typed buffer, or a tuple of Python objects
+typedef struct {
+    Py_buffer view;
+    PyObject *items;
+} LexColumn;
+
+// Permutation sorting the rows of the columns `argv[0]` lexicographically, in
+// decreasing order for the columns flagged by `argv[1]`
+static PyObject *
+lexsort_parsed(PyObject **argv)
+{
+    PyObject *columns, *flags = NULL, *result = NULL, *index;
+    LexColumn *lex = NULL;
+    TypedColumn *typed = NULL;
+    Py_ssize_t *perm = NULL;
+    Py_buffer perm_view;
+    Py_ssize_t k, n = 0, size, i, j, first;
+    int type, descending = 0, all_typed = 1, status = 1;
+
+    if (!(columns = PySequence_Fast(argv[0], "columns must be a sequence")))
+        return NULL;
+    if ((k = PySequence_Fast_GET_SIZE(columns)) == 0) {
+        PyErr_SetString(PyExc_ValueError, "need at least one column");
+        goto done;
+    }
+
+    // `descending` is either one flag for every column or a flag per column
+    if (argv[1] && PySequence_Check(argv[1])) {
+        if (!(flags = PySequence_Fast(argv[1], "descending must be a bool "
+                                               "or a sequence")))
+            goto done;
+        if (PySequence_Fast_GET_SIZE(flags) != k) {
+            PyErr_SetString(PyExc_ValueError,
+                            "descending must have a flag for every column");
+            goto done;
+        }
+    } else if (argv[1] && (descending = PyObject_IsTrue(argv[1])) < 0) {
+        goto done;
+    }
+
+    if (!(lex = PyMem_Calloc((size_t) k, sizeof(LexColumn)))
+            || !(typed = PyMem_Calloc((size_t) k, sizeof(TypedColumn)))) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < k; ++i) {
+        PyObject *column = PySequence_Fast_GET_ITEM(columns, i);
+        if (flags && (descending = PyObject_IsTrue(
+                          PySequence_Fast_GET_ITEM(flags, i))) < 0)
+            goto done;
+        typed[i].descending = descending;
+
+        // Buffers of numbers are sorted by their radix keys without the GIL,
+        // while their exports keep their memory alive
+        if (!PyList_Check(column) && !PyTuple_Check(column)
+                && (type = GetTypedBuffer(column, &lex[i].view,
+                                          PyBUF_SIMPLE)) >= 0) {
+            size = lex[i].view.len / lex[i].view.itemsize;
+            typed[i].base = lex[i].view.buf;
+            typed[i].stride = lex[i].view.itemsize;
+            typed[i].type = (ItemType) type;
+        } else {
+            if (!(lex[i].items = PySequence_Tuple(column))) goto done;
+            size = PyTuple_GET_SIZE(lex[i].items);
+            all_typed = 0;
+        }
+        if (i > 0 && size != n) {
+            PyErr_SetString(PyExc_ValueError,
+                            "columns must have the same length");
+            goto done;
+        }
+        n = size;
+    }
+
+    // The permutation of typed columns is written straight into its array
+    if (all_typed) {
+        result = NewTypedArray(sizeof(Py_ssize_t) == 8 ? ITEM_INT64
+                                                       : ITEM_INT32,
+                               n, &perm_view);
+        if (!result) goto done;
+        perm = perm_view.buf;
+    } else if (!(perm = PyMem_Malloc((size_t) n * sizeof(Py_ssize_t)))) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < n; ++i) perm[i] = i;
+
+    // Stably sort the rows by one column at a time, from the last column to
+    // the first, taking adjacent typed columns together
+    for (j = k; j > 0 && status; j = first) {
+        first = j - 1;
+        if (lex[first].items) {
+            status = ArgSort(((PyTupleObject *) lex[first].items)->ob_item,
+                             typed[first].descending, perm, n);
+            continue;
+        }
+        while (first > 0 && !lex[first - 1].items) --first;
+        Py_BEGIN_ALLOW_THREADS
+        status = TypedLexSort(typed + first, j - first, perm, n);
+        Py_END_ALLOW_THREADS
+        if (!status) PyErr_NoMemory();
+    }
+    if (!status) {
+        Py_CLEAR(result);
+    } else if (!all_typed && (result = PyList_New(n))) {
+        for (i = 0; i < n; ++i) {
+            if (!(index = PyLong_FromSsize_t(perm[i]))) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, i, index);
+        }
+    }
+
+done:
+    if (all_typed && perm) {
+        PyBuffer_Release(&perm_view);
+    } else {
+        PyMem_Free(perm);
+    }
+    for (i = 0; lex && i < k; ++i) {
+        if (lex[i].items) {
+            Py_DECREF(lex[i].items);
+        } else if (lex[i].view.obj) {
+            PyBuffer_Release(&lex[i].view);
+        }
+    }
+    PyMem_Free(lex);
+    PyMem_Free(typed);
+    Py_XDECREF(flags);
+    Py_DECREF(columns);
+    return result;
+}
+
+// Sort the records of `argv[1]` bytes of the buffer `argv[0]` in-place by the
+// fields described by `argv[2]`
+static PyObject *
+sort_records_parsed(PyObject **argv)
+{
+    PyObject *records = argv[0], *fields = NULL, *field, *result = NULL;
+    TypedColumn *typed = NULL;
+    Py_ssize_t *perm = NULL;
+    Py_ssize_t size, k, n, i, offset;
+    Py_buffer view;
+    const char *code;
+    int type, descending, status;
+
+    size = PyLong_AsSsize_t(argv[1]);
+    if (size == -1 && PyErr_Occurred()) return NULL;
+    if (size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "record_size must be positive");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(records, &view, PyBUF_WRITABLE) < 0) return NULL;
+    if (view.len % size) {
+        PyErr_SetString(PyExc_ValueError,
+                        "buffer size must be a multiple of record_size");
+        goto done;
+    }
+    n = view.len / size;
+
+    fields = PySequence_Fast(argv[2], "key_fields must be a sequence");
+    if (!fields) goto done;
+    if ((k = PySequence_Fast_GET_SIZE(fields)) == 0) {
+        PyErr_SetString(PyExc_ValueError, "need at least one key field");
+        goto done;
+    }
+    if (!(typed = PyMem_Calloc((size_t) k, sizeof(TypedColumn)))) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < k; ++i) {
+        field = PySequence_Fast_GET_ITEM(fields, i);
+        descending = 0;
+        if (!PyTuple_Check(field)) {
+            PyErr_SetString(PyExc_TypeError, "key fields must be (offset, "
+                                             "typecode[, descending]) tuples");
+            goto done;
+        }
+        if (!PyArg_ParseTuple(field, "ns|p:key field", &offset, &code,
+                              &descending))
+            goto done;
+        if ((type = GetFormatItemType(code)) < 0) {
+            PyErr_Format(PyExc_ValueError, "unsupported typecode '%s'", code);
+            goto done;
+        }
+        if (offset < 0 || offset > size - item_sizes[type]) {
+            PyErr_Format(PyExc_ValueError,
+                         "key field at offset %zd doesn't fit in a record",
+                         offset);
+            goto done;
+        }
+        typed[i].base = (const char *) view.buf + offset;
+        typed[i].stride = size;
+        typed[i].type = (ItemType) type;
+        typed[i].descending = descending;
+    }
+
+    if (!(perm = PyMem_Malloc((size_t) n * sizeof(Py_ssize_t)))) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < n; ++i) perm[i] = i;
+
+    // Keys are read and records moved with memcpy, so the fields and records
+    // don't have to be aligned
+    Py_BEGIN_ALLOW_THREADS
+    status = TypedLexSort(typed, k, perm, n)
+        && PermuteRecords(view.buf, size, perm, n);
+    Py_END_ALLOW_THREADS
+    if (!status) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    Py_INCREF(records);
+    result = records;
+
+done:
+    PyMem_Free(perm);
+    PyMem_Free(typed);
+    Py_XDECREF(fields);
+    PyBuffer_Release(&view);
+    return result;
+}
+
+#define SORT_SIGNATURE(name) name "(seq, *, inplace=False) -> list\n\n"
 #define COMMON_SORT_DOC \
 "If the input is a list, then it is sorted in-place and returned. Otherwise\n" \
-"a new list containing the items of the input in sorted order is returned."
+"a new list containing the items of the input in sorted order is returned.\n" \
+"\n" \
+"Buffers of integers or floating point numbers (e.g., array.array) are\n" \
+"sorted without holding the GIL. If `inplace` is true, then the input must\n" \
+"be a list or a writable buffer of numbers, which is sorted in-place and\n" \
+"returned."
 
 static PyObject *
-Sort_BinaryInsertionSort(PyObject *self, PyObject *args, PyObject *kwargs)
+Sort_BinaryInsertionSort(PyObject *self, PyObject *const *args,
+                         Py_ssize_t nargs, PyObject *kwnames)
 {
-    return sort_boilerplate(self, args, kwargs, &BinaryInsertionSort);
+    static ArgParser parser = SORT_ARG_PARSER(BINARY_INSERTION_SORT);
+    return sort_boilerplate(self, args, nargs, kwnames, &parser,
+                            &BinaryInsertionSort, &TypedBinaryInsertionSort);
 }
 
 static PyObject *
-Sort_InsertionSort(PyObject *self, PyObject *args, PyObject *kwargs)
+Sort_InsertionSort(PyObject *self, PyObject *const *args,
+                   Py_ssize_t nargs, PyObject *kwnames)
 {
-    return sort_boilerplate(self, args, kwargs, &InsertionSort);
+    static ArgParser parser = SORT_ARG_PARSER(INSERTION_SORT);
+    return sort_boilerplate(self, args, nargs, kwnames, &parser,
+                            &InsertionSort, &TypedInsertionSort);
 }
 
 static PyObject *
-Sort_HeapSort(PyObject *self, PyObject *args, PyObject *kwargs)
+Sort_HeapSort(PyObject *self, PyObject *const *args,
+              Py_ssize_t nargs, PyObject *kwnames)
 {
-    return sort_boilerplate(self, args, kwargs, &HeapSort);
+    static ArgParser parser = SORT_ARG_PARSER(HEAP_SORT);
+    return sort_boilerplate(self, args, nargs, kwnames, &parser,
+                            &HeapSort, &TypedHeapSort);
 }
 
 static PyObject *
-Sort_MergeSort(PyObject *self, PyObject *args, PyObject *kwargs)
+Sort_MergeSort(PyObject *self, PyObject *const *args,
+               Py_ssize_t nargs, PyObject *kwnames)
 {
-    return sort_boilerplate(self, args, kwargs, &MergeSort);
+    static ArgParser parser = SORT_ARG_PARSER(MERGE_SORT);
+    return sort_boilerplate(self, args, nargs, kwnames, &parser,
+                            &MergeSort, &TypedMergeSort);
 }
 
 static PyObject *
-Sort_QuickSort(PyObject *self, PyObject *args, PyObject *kwargs)
+Sort_QuickSort(PyObject *self, PyObject *const *args,
+               Py_ssize_t nargs, PyObject *kwnames)
 {
-    return sort_boilerplate(self, args, kwargs, &QuickSort);
+    static ArgParser parser = SORT_ARG_PARSER(QUICK_SORT);
+    return sort_boilerplate(self, args, nargs, kwnames, &parser,
+                            &QuickSort, &TypedQuickSort);
 }
 
 static PyObject *
-Sort_QuickSortRandom(PyObject *self, PyObject *args, PyObject *kwargs)
+Sort_QuickSortRandom(PyObject *self, PyObject *const *args,
+                     Py_ssize_t nargs, PyObject *kwnames)
 {
-    return sort_boilerplate(self, args, kwargs, &QuickSortRandom);
+    static ArgParser parser = SORT_ARG_PARSER(QUICK_SORT_RANDOM);
+    return sort_boilerplate(self, args, nargs, kwnames, &parser,
+                            &QuickSortRandom, &TypedQuickSortRandom);
 }
 
-// Python function names
-#define BINARY_INSERTION_SORT "binary_insertion_sort"
-#define INSERTION_SORT "insertion_sort"
-#define HEAP_SORT "heap_sort"
-#define MERGE_SORT "merge_sort"
-#define QUICK_SORT "quick_sort"
-#define QUICK_SORT_RANDOM "quick_sort_random"
+static PyObject *
+Sort_Sort(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+          PyObject *kwnames)
+{
+    static const char *const keywords[] = {"", "first", "last", "inplace",
+                                           "stable", "threads", NULL};
+    static ArgParser parser = {
+        .name = SORT,
+        .keywords = keywords,
+        .required = 1,
+        .positional = 3,
+    };
+    PyObject *argv[6];
+    PyObject *result;
+    InstrumentedCall call;
+    long threads = 0;
+    int inplace = 0;
+    int stable = 0;
+
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return NULL;
+    if (argv[3] && (inplace = PyObject_IsTrue(argv[3])) < 0) return NULL;
+    if (argv[4] && (stable = PyObject_IsTrue(argv[4])) < 0) return NULL;
+    if (argv[5]) {
+        threads = PyLong_AsLong(argv[5]);
+        if (threads == -1 && PyErr_Occurred()) return NULL;
+        if (threads > INT_MAX) threads = INT_MAX;
+    }
+
+    if (!Instrumenting)
+        return sort_dispatch(self, argv, inplace, stable, (int) threads);
+    InstrumentBegin(&call);
+    result = sort_dispatch(self, argv, inplace, stable, (int) threads);
+    InstrumentEnd(&call, parser.name);
+    return result;
+}
+
+static PyObject *
+Sort_Lexsort(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+             PyObject *kwnames)
+{
+    static const char *const keywords[] = {"", "descending", NULL};
+    static ArgParser parser = {
+        .name = LEXSORT,
+        .keywords = keywords,
+        .required = 1,
+        .positional = 1,
+    };
+    PyObject *argv[2];
+    PyObject *result;
+    InstrumentedCall call;
+
+    (void) self;  // Unused parameter
+
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return NULL;
+
+    if (!Instrumenting) return lexsort_parsed(argv);
+    InstrumentBegin(&call);
+    result = lexsort_parsed(argv);
+    InstrumentEnd(&call, parser.name);
+    return result;
+}
+
+static PyObject *
+Sort_SortRecords(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+                 PyObject *kwnames)
+{
+    static const char *const keywords[] = {"", "record_size", "key_fields",
+                                           NULL};
+    static ArgParser parser = {
+        .name = SORT_RECORDS,
+        .keywords = keywords,
+        .required = 3,
+        .positional = 3,
+    };
+    PyObject *argv[3];
+    PyObject *result;
+    InstrumentedCall call;
+
+    (void) self;  // Unused parameter
+
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return NULL;
+
+    if (!Instrumenting) return sort_records_parsed(argv);
+    InstrumentBegin(&call);
+    result = sort_records_parsed(argv);
+    InstrumentEnd(&call, parser.name);
+    return result;
+}
+
+static PyObject *
+Sort_SetDecisionHook(PyObject *self, PyObject *hook)
+{
+    SortState *state = PyModule_GetState(self);
+    PyObject *previous;
+
+    if (hook != Py_None && !PyCallable_Check(hook)) {
+        PyErr_SetString(PyExc_TypeError, "hook must be callable or None");
+        return NULL;
+    }
+    if (hook == Py_None) {
+        hook = NULL;
+    } else {
+        Py_INCREF(hook);
+    }
+    Py_BEGIN_CRITICAL_SECTION(self);
+    previous = state->decision_hook;
+    state->decision_hook = hook;
+    Py_END_CRITICAL_SECTION();
+    if (!previous) Py_RETURN_NONE;
+    return previous;
+}
+
+static PyObject *
+Sort_ReleaseBuffers(PyObject *self, PyObject *args)
+{
+    (void) self;  // Unused parameters
+    (void) args;
+    return PyLong_FromSize_t(ReleaseScratchBuffers());
+}
+
+static PyObject *
+Sort_BufferInfo(PyObject *self, PyObject *args)
+{
+    ScratchInfo info;
+
+    (void) self;  // Unused parameters
+    (void) args;
+
+    GetScratchInfo(&info);
+    return Py_BuildValue("{snsnsnsnsnsn}",
+                         "cached", (Py_ssize_t) info.cached,
+                         "buffers", (Py_ssize_t) info.buffers,
+                         "high_water", (Py_ssize_t) info.high_water,
+                         "cap", (Py_ssize_t) info.cap,
+                         "hits", (Py_ssize_t) info.hits,
+                         "misses", (Py_ssize_t) info.misses);
+}
+
+static PyObject *
+Sort_SetBufferCap(PyObject *self, PyObject *arg)
+{
+    size_t cap;
+
+    (void) self;  // Unused parameter
+
+    cap = PyLong_AsSize_t(arg);
+    if (cap == (size_t) -1 && PyErr_Occurred()) return NULL;
+    return PyLong_FromSize_t(SetScratchCap(cap));
+}
 
 // Docstrings
 
@@ -155,57 +792,537 @@ SORT_SIGNATURE(QUICK_SORT_RANDOM)
 "Randomized quick sort.\n"
 COMMON_SORT_DOC);
 
+PyDoc_STRVAR(Sort_Sort_doc,
+SORT "(seq, first=None, last=None, *, inplace=False, stable=False, "
+"threads=0) -> list\n\n"
+"Sort with an algorithm chosen by probing the input.\n"
+COMMON_SORT_DOC "\n"
+"\n"
+"Short inputs are sorted by binary insertion sort. Lists of ints that fit\n"
+"in 64 bits or of floats are radix sorted. Other lists are sorted by an\n"
+"adaptive merge sort, which is linear on sorted and reversed inputs, unless\n"
+"`stable` is false and a sample has many duplicates, in which case a\n"
+"three-way quick sort is used. Typed buffers are checked for being sorted\n"
+"or reversed, and radix sorted otherwise, with `threads` threads (all cores\n"
+"if not positive) if they're large. The chosen algorithm is reported to the\n"
+"hook set by " SET_DECISION_HOOK "().");
+
+PyDoc_STRVAR(Sort_Lexsort_doc,
+LEXSORT "(columns, *, descending=False) -> permutation\n\n"
+"Indices of the rows of a table, given as a sequence of columns of the same\n"
+"length, in lexicographic order: by the first column, then by the second\n"
+"for rows with equal first items, and so on. Rows with equal items in every\n"
+"column keep their order. `descending` is a bool for every column, or a\n"
+"sequence of one bool per column.\n"
+"\n"
+"Rows are stably sorted by one column at a time, from the last to the\n"
+"first. Typed buffers (e.g., array.array) are radix sorted without the GIL,\n"
+"several at once if their keys fit in 64 bits, and other columns are merge\n"
+"sorted with <. The permutation is an array.array of ints if every column\n"
+"is a typed buffer, and a list otherwise.");
+
+PyDoc_STRVAR(Sort_SortRecords_doc,
+SORT_RECORDS "(records, record_size, key_fields) -> records\n\n"
+"Sort a writable buffer of fixed-width records (e.g., a bytearray of packed\n"
+"structs) in-place by some of their fields, stably and lexicographically,\n"
+"and return it. `key_fields` is a sequence of (offset, typecode) or\n"
+"(offset, typecode, descending) tuples, most significant first, where\n"
+"`offset` is the offset of a field in a record in bytes and `typecode` is a\n"
+"struct module format code of a number (e.g., 'i', or '<d'). Fields don't\n"
+"have to be aligned. The records are radix sorted without the GIL.");
+
+PyDoc_STRVAR(Sort_SetDecisionHook_doc,
+SET_DECISION_HOOK "(hook) -> previous hook\n\n"
+"Call `hook(decision)` every time " SORT "() chooses an algorithm, before\n"
+"sorting, or stop if `hook` is None. `decision` is a dict with the keys\n"
+"'algorithm', 'items' (the item type), 'size', 'pairs' and 'descents' (the\n"
+"adjacent pairs compared, and how many were out of order), 'sampled' and\n"
+"'distinct' (the items sampled to find duplicates, and how many were\n"
+"distinct), 'stable', and 'threads'. Exceptions raised by the hook\n"
+"propagate out of " SORT "(), leaving the input unsorted.");
+
+PyDoc_STRVAR(Sort_ReleaseBuffers_doc,
+RELEASE_BUFFERS "() -> int\n\n"
+"Free the idle scratch buffers kept for reuse by the merge and radix sorts,\n"
+"returning the number of bytes freed.");
+
+PyDoc_STRVAR(Sort_BufferInfo_doc,
+BUFFER_INFO "() -> dict\n\n"
+"Statistics of the pool of scratch buffers: the bytes and number of idle\n"
+"buffers ('cached' and 'buffers'), the largest buffer requested in bytes\n"
+"('high_water'), the most bytes of idle buffers to keep ('cap'), and the\n"
+"numbers of requests served by idle buffers ('hits') and by allocating new\n"
+"ones ('misses').");
+
+PyDoc_STRVAR(Sort_SetBufferCap_doc,
+SET_BUFFER_CAP "(nbytes) -> int\n\n"
+"Keep at most `nbytes` bytes of idle scratch buffers, freeing any excess,\n"
+"and return the previous cap. A cap of 0 turns off pooling.");
+
+// Incremental sorter
+
+typedef struct {
+    PyObject_HEAD
+    IncrementalSort sort;
+    Py_ssize_t budget;          // Comparisons per step when awaited
+    int busy;                   // Nonzero while comparing items
+} IncrementalSorterObject;
+
+// Comparisons per step by default
+#define INCREMENTAL_SORTER_BUDGET 4096
+
+static int
+IncrementalSorter_Available(IncrementalSorterObject *self)
+{
+    if (!self->busy) return 1;
+    PyErr_SetString(PyExc_RuntimeError, "IncrementalSorter is already sorting");
+    return 0;
+}
+
+static PyObject *
+IncrementalSorter_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    IncrementalSorterObject *self;
+    PyObject *iterable;
+    Py_ssize_t budget = INCREMENTAL_SORTER_BUDGET;
+
+    // Parse arguments
+    static const char *format = "O|$n:IncrementalSorter";
+    static const char *keywords[] = {"iterable", "budget", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &iterable, &budget))
+        return NULL;
+    if (budget < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "IncrementalSorter() budget must be positive");
+        return NULL;
+    }
+
+    if (!(self = (IncrementalSorterObject *) type->tp_alloc(type, 0)))
+        return NULL;
+    self->budget = budget;
+    if (!IncrementalSortInit(&self->sort, iterable)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *) self;
+}
+
+static int
+IncrementalSorter_Traverse(PyObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(Py_TYPE(self));
+    return IncrementalSortVisit(&((IncrementalSorterObject *) self)->sort,
+                                visit, arg);
+}
+
+static int
+IncrementalSorter_Clear(PyObject *self)
+{
+    IncrementalSortClear(&((IncrementalSorterObject *) self)->sort);
+    return 0;
+}
+
+static void
+IncrementalSorter_Dealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    IncrementalSorter_Clear(self);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+// Sort for at most `budget` comparisons or `seconds` seconds, with the same
+// return values as IncrementalSortStep. The sorter must be locked
+static int
+IncrementalSorter_Run(IncrementalSorterObject *self, Py_ssize_t budget,
+                      double seconds)
+{
+    int status;
+
+    if (!IncrementalSorter_Available(self)) return -1;
+    self->busy = 1;
+    status = IncrementalSortStep(&self->sort, budget, seconds);
+    self->busy = 0;
+    return status;
+}
+
+// New list of the sorted items of a locked sorter
+static PyObject *
+IncrementalSorter_Items(IncrementalSorterObject *self)
+{
+    const IncrementalSort *sort = &self->sort;
+    PyObject *list = PyList_New(sort->n);
+
+    if (!list) return NULL;
+    for (Py_ssize_t i = 0; i < sort->n; ++i) {
+        Py_INCREF(sort->src[i]);
+        PyList_SET_ITEM(list, i, sort->src[i]);
+    }
+    return list;
+}
+
+static PyObject *
+IncrementalSorter_Step(PyObject *self, PyObject *const *args,
+                       Py_ssize_t nargs, PyObject *kwnames)
+{
+    static const char *const keywords[] = {"budget", "seconds", NULL};
+    static ArgParser parser = {
+        .name = "step",
+        .keywords = keywords,
+        .required = 0,
+        .positional = 1,
+    };
+    IncrementalSorterObject *object = (IncrementalSorterObject *) self;
+    Py_ssize_t budget = PY_SSIZE_T_MAX;
+    double seconds = 0.0;
+    PyObject *argv[2];
+    int status;
+
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return NULL;
+    if (argv[0] && argv[0] != Py_None) {
+        budget = PyNumber_AsSsize_t(argv[0], PyExc_OverflowError);
+        if (budget == -1 && PyErr_Occurred()) return NULL;
+    } else if (!argv[1] || argv[1] == Py_None) {
+        budget = object->budget;
+    }
+    if (argv[1] && argv[1] != Py_None) {
+        seconds = PyFloat_AsDouble(argv[1]);
+        if (seconds == -1.0 && PyErr_Occurred()) return NULL;
+        if (!(seconds > 0.0)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "step() seconds must be positive");
+            return NULL;
+        }
+    }
+    if (budget < 1) {
+        PyErr_SetString(PyExc_ValueError, "step() budget must be positive");
+        return NULL;
+    }
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = IncrementalSorter_Run(object, budget, seconds);
+    Py_END_CRITICAL_SECTION();
+    if (status < 0) return NULL;
+    return PyBool_FromLong(status);
+}
+
+static PyObject *
+IncrementalSorter_Result(PyObject *self, PyObject *args)
+{
+    IncrementalSorterObject *object = (IncrementalSorterObject *) self;
+    PyObject *items = NULL;
+
+    (void) args;  // Unused parameter
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (IncrementalSorter_Run(object, PY_SSIZE_T_MAX, 0.0) >= 0)
+        items = IncrementalSorter_Items(object);
+    Py_END_CRITICAL_SECTION();
+    return items;
+}
+
+// Awaiting a sorter iterates over it, and every iteration takes a step of the
+// default budget and yields None, which gives control back to the event loop,
+// until the sort is done and the iteration returns the sorted list
+static PyObject *
+IncrementalSorter_Await(PyObject *self)
+{
+    Py_INCREF(self);
+    return self;
+}
+
+static PyObject *
+IncrementalSorter_Next(PyObject *self)
+{
+    IncrementalSorterObject *object = (IncrementalSorterObject *) self;
+    PyObject *items = NULL, *stop;
+    int status;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = IncrementalSorter_Run(object, object->budget, 0.0);
+    if (status > 0) items = IncrementalSorter_Items(object);
+    Py_END_CRITICAL_SECTION();
+    if (status < 0) return NULL;
+    if (!status) Py_RETURN_NONE;
+
+    if (!items) return NULL;
+    // The list is wrapped in an exception, or else it would be taken for the
+    // arguments of StopIteration if it were a tuple
+    stop = PyObject_CallOneArg(PyExc_StopIteration, items);
+    Py_DECREF(items);
+    if (stop) {
+        PyErr_SetObject(PyExc_StopIteration, stop);
+        Py_DECREF(stop);
+    }
+    return NULL;
+}
+
+static Py_ssize_t
+IncrementalSorter_Len(PyObject *self)
+{
+    return ((IncrementalSorterObject *) self)->sort.n;
+}
+
+static PyObject *
+IncrementalSorter_GetDone(PyObject *self, void *closure)
+{
+    int done;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    done = IncrementalSortDone(&((IncrementalSorterObject *) self)->sort);
+    Py_END_CRITICAL_SECTION();
+    return PyBool_FromLong(done);
+}
+
+static PyObject *
+IncrementalSorter_GetProgress(PyObject *self, void *closure)
+{
+    double progress;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    progress = IncrementalSortProgress(
+        &((IncrementalSorterObject *) self)->sort);
+    Py_END_CRITICAL_SECTION();
+    return PyFloat_FromDouble(progress);
+}
+
+static PyObject *
+IncrementalSorter_GetComparisons(PyObject *self, void *closure)
+{
+    Py_ssize_t comparisons;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    comparisons = ((IncrementalSorterObject *) self)->sort.comparisons;
+    Py_END_CRITICAL_SECTION();
+    return PyLong_FromSsize_t(comparisons);
+}
+
+PyDoc_STRVAR(IncrementalSorter_Step_doc,
+"step(budget=None, *, seconds=None)\n\n"
+"Continue sorting for at most `budget` comparisons (the sorter's budget if\n"
+"neither limit is given), or for about `seconds` seconds. Return whether the\n"
+"items are sorted. A comparison that raises leaves the sort where it was.");
+
+PyDoc_STRVAR(IncrementalSorter_Result_doc,
+"result()\n\n"
+"Finish sorting, and return a new list of the sorted items.");
+
+static PyMethodDef IncrementalSorter_Methods[] = {
+    {
+        .ml_name = "step",
+        .ml_meth = (PyCFunction) IncrementalSorter_Step,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = IncrementalSorter_Step_doc,
+    },
+    {
+        .ml_name = "result",
+        .ml_meth = IncrementalSorter_Result,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = IncrementalSorter_Result_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyGetSetDef IncrementalSorter_GetSet[] = {
+    {
+        .name = "done",
+        .get = IncrementalSorter_GetDone,
+        .doc = "Whether the items are sorted.",
+    },
+    {
+        .name = "progress",
+        .get = IncrementalSorter_GetProgress,
+        .doc = "Fraction of the merge passes that are done, from 0 to 1.",
+    },
+    {
+        .name = "comparisons",
+        .get = IncrementalSorter_GetComparisons,
+        .doc = "Number of comparisons so far.",
+    },
+    {NULL, NULL, NULL, NULL, NULL}  // Sentinel
+};
+
+PyDoc_STRVAR(IncrementalSorter_Type_doc,
+"IncrementalSorter(iterable, *, budget=4096)\n\n"
+"Stable merge sort of the items of an iterable that runs in steps of a\n"
+"bounded number of comparisons (or time) instead of all at once, so that\n"
+"sorting many items doesn't hold the GIL, or block an event loop, for long.\n"
+"Each step() continues where the last one stopped. Awaiting the sorter\n"
+"sorts in steps of `budget` comparisons, yielding to the event loop between\n"
+"them, and returns the sorted list.\n\n"
+">>> sorter = IncrementalSorter([3, 1, 2, 5, 4], budget=2)\n"
+">>> sorter.step(), sorter.done\n"
+"(False, False)\n"
+">>> while not sorter.step(): pass\n"
+">>> sorter.result()\n"
+"[1, 2, 3, 4, 5]");
+
+static PyType_Slot IncrementalSorter_Slots[] = {
+    {Py_tp_dealloc, SLOT_FUNCTION(IncrementalSorter_Dealloc)},
+    {Py_am_await, SLOT_FUNCTION(IncrementalSorter_Await)},
+    {Py_sq_length, SLOT_FUNCTION(IncrementalSorter_Len)},
+    {Py_tp_doc, (void *) IncrementalSorter_Type_doc},
+    {Py_tp_traverse, SLOT_FUNCTION(IncrementalSorter_Traverse)},
+    {Py_tp_clear, SLOT_FUNCTION(IncrementalSorter_Clear)},
+    {Py_tp_iternext, SLOT_FUNCTION(IncrementalSorter_Next)},
+    {Py_tp_methods, IncrementalSorter_Methods},
+    {Py_tp_getset, IncrementalSorter_GetSet},
+    {Py_tp_new, SLOT_FUNCTION(IncrementalSorter_New)},
+    {0, NULL}  // Sentinel
+};
+
+static PyType_Spec IncrementalSorter_Spec = {
+    .name = "algorithms.sort.IncrementalSorter",
+    .basicsize = sizeof(IncrementalSorterObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC
+        | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = IncrementalSorter_Slots,
+};
+
 // List of functions exposed by the module
 static PyMethodDef SortMethods[] = {
     {
         .ml_name = BINARY_INSERTION_SORT,
         .ml_meth = (PyCFunction) Sort_BinaryInsertionSort,
-        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Sort_BinaryInsertionSort_doc,
     },
     {
         .ml_name = INSERTION_SORT,
         .ml_meth = (PyCFunction) Sort_InsertionSort,
-        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Sort_InsertionSort_doc,
     },
     {
         .ml_name = HEAP_SORT,
         .ml_meth = (PyCFunction) Sort_HeapSort,
-        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Sort_HeapSort_doc,
     },
     {
         .ml_name = MERGE_SORT,
         .ml_meth = (PyCFunction) Sort_MergeSort,
-        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Sort_MergeSort_doc,
     },
     {
         .ml_name = QUICK_SORT,
         .ml_meth = (PyCFunction) Sort_QuickSort,
-        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Sort_QuickSort_doc,
     },
     {
         .ml_name = QUICK_SORT_RANDOM,
         .ml_meth = (PyCFunction) Sort_QuickSortRandom,
-        .ml_flags = METH_VARARGS | METH_KEYWORDS,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
         .ml_doc = Sort_QuickSortRandom_doc,
     },
+    {
+        .ml_name = SORT,
+        .ml_meth = (PyCFunction) Sort_Sort,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = Sort_Sort_doc,
+    },
+    {
+        .ml_name = LEXSORT,
+        .ml_meth = (PyCFunction) Sort_Lexsort,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = Sort_Lexsort_doc,
+    },
+    {
+        .ml_name = SORT_RECORDS,
+        .ml_meth = (PyCFunction) Sort_SortRecords,
+        .ml_flags = METH_FASTCALL | METH_KEYWORDS,
+        .ml_doc = Sort_SortRecords_doc,
+    },
+    {
+        .ml_name = SET_DECISION_HOOK,
+        .ml_meth = (PyCFunction) Sort_SetDecisionHook,
+        .ml_flags = METH_O,
+        .ml_doc = Sort_SetDecisionHook_doc,
+    },
+    {
+        .ml_name = RELEASE_BUFFERS,
+        .ml_meth = (PyCFunction) Sort_ReleaseBuffers,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = Sort_ReleaseBuffers_doc,
+    },
+    {
+        .ml_name = BUFFER_INFO,
+        .ml_meth = (PyCFunction) Sort_BufferInfo,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = Sort_BufferInfo_doc,
+    },
+    {
+        .ml_name = SET_BUFFER_CAP,
+        .ml_meth = (PyCFunction) Sort_SetBufferCap,
+        .ml_flags = METH_O,
+        .ml_doc = Sort_SetBufferCap_doc,
+    },
+    INSTRUMENT_METHODDEF,
     {NULL, NULL, 0, NULL}  // Sentinel
 };
 
+static int
+Sort_Exec(PyObject *module)
+{
+    SortState *state = PyModule_GetState(module);
+
+    state->incremental_sorter_type = NewModuleType(module,
+                                                   &IncrementalSorter_Spec, 1);
+    if (!state->incremental_sorter_type) return -1;
+    return 0;
+}
+
+static int
+Sort_Traverse(PyObject *module, visitproc visit, void *arg)
+{
+    SortState *state = PyModule_GetState(module);
+    Py_VISIT(state->decision_hook);
+    Py_VISIT(state->incremental_sorter_type);
+    return 0;
+}
+
+static int
+Sort_Clear(PyObject *module)
+{
+    SortState *state = PyModule_GetState(module);
+    Py_CLEAR(state->decision_hook);
+    Py_CLEAR(state->incremental_sorter_type);
+    return 0;
+}
+
+static void
+Sort_Free(void *module)
+{
+    Sort_Clear((PyObject *) module);
+}
+
+static PyModuleDef_Slot Sort_Slots[] = {
+    {Py_mod_exec, SLOT_FUNCTION(Sort_Exec)},
+    MODULE_THREADING_SLOTS
+    {0, NULL}  // Sentinel
+};
+
 static PyModuleDef sortmodule = {
     PyModuleDef_HEAD_INIT,
     .m_name = "algorithms.sort",
     .m_doc = "Sorting algorithms.",
-    .m_size = -1,
+    .m_size = sizeof(SortState),
     .m_methods = SortMethods,
+    .m_slots = Sort_Slots,
+    .m_traverse = Sort_Traverse,
+    .m_clear = Sort_Clear,
+    .m_free = Sort_Free,
 };
 
 PyMODINIT_FUNC
 PyInit_sort(void)
 {
-    return PyModule_Create(&sortmodule);
+    return PyModuleDef_Init(&sortmodule);
 }
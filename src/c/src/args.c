@@ -0,0 +1,87 @@
+#include "args.h"
+#include "debug.h"
+
+// Number of parameters of a parser
+static Py_ssize_t
+NumParameters(const ArgParser *parser)
+{
+    Py_ssize_t size = 0;
+    while (parser->keywords[size]) ++size;
+    assert(size <= ARG_PARSER_MAX_KEYWORDS);
+    return size;
+}
+
+// Position of the parameter named `key`, or -1 if there's no such parameter.
+// Names are compared as C strings, so that parsers don't hold any Python
+// objects and can be shared by interpreters and threads
+static Py_ssize_t
+FindKeyword(const ArgParser *parser, Py_ssize_t size, PyObject *key)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < size; ++i)
+        if (parser->keywords[i][0]
+                && !PyUnicode_CompareWithASCIIString(key, parser->keywords[i]))
+            return i;
+    return -1;
+}
+
+int
+ParseArgs(const ArgParser *parser, PyObject *const *args, Py_ssize_t nargs,
+          PyObject *kwnames, PyObject **out)
+{
+    Py_ssize_t nkwargs = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    Py_ssize_t size = NumParameters(parser);
+    Py_ssize_t i, j;
+
+
+    if (nargs > parser->positional) {
+        PyErr_Format(PyExc_TypeError,
+                     "%s() takes at most %zd positional argument%s "
+                     "(%zd given)", parser->name, parser->positional,
+                     parser->positional == 1 ? "" : "s", nargs);
+        return 0;
+    }
+    for (i = 0; i < size; ++i)
+        out[i] = i < nargs ? args[i] : NULL;
+
+    // Positional-only parameters can only be missing if too few positional
+    // arguments were given, which takes precedence over bad keywords
+    for (i = nargs; i < parser->required; ++i) {
+        if (!parser->keywords[i][0]) {
+            PyErr_Format(PyExc_TypeError,
+                         "%s() takes at least %zd positional argument%s "
+                         "(%zd given)", parser->name, i + 1,
+                         i ? "s" : "", nargs);
+            return 0;
+        }
+    }
+
+    for (j = 0; j < nkwargs; ++j) {
+        PyObject *key = PyTuple_GET_ITEM(kwnames, j);
+        if ((i = FindKeyword(parser, size, key)) < 0) {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_TypeError,
+                             "'%U' is an invalid keyword argument for %s()",
+                             key, parser->name);
+            return 0;
+        }
+        if (out[i]) {
+            PyErr_Format(PyExc_TypeError,
+                         "argument for %s() given by name ('%U') and "
+                         "position (%zd)", parser->name, key, i + 1);
+            return 0;
+        }
+        out[i] = args[nargs + j];
+    }
+
+    for (i = 0; i < parser->required; ++i) {
+        if (!out[i]) {
+            PyErr_Format(PyExc_TypeError,
+                         "%s() missing required argument '%s' (pos %zd)",
+                         parser->name, parser->keywords[i], i + 1);
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,142 @@
+#include "buffer.h"
+#include "debug.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Type of the items of a given format with native size and alignment, or -1 if
+// the format isn't a single supported numeric code
+static int
+GetItemType(const char *format, Py_ssize_t itemsize)
+{
+    int is_signed;
+
+    // Byte order prefixes are fine as long as they agree with the machine's
+    // byte order (the item size is checked against the native size below)
+    if (*format == '@' || *format == '='
+            || *format == (PY_LITTLE_ENDIAN ? '<' : '>'))
+        ++format;
+    if (!format[0] || format[1]) return -1;
+
+    switch (format[0]) {
+        case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+            is_signed = 1;
+            break;
+        case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N':
+            is_signed = 0;
+            break;
+        case 'f':
+            return itemsize == sizeof(float) ? ITEM_FLOAT : -1;
+        case 'd':
+            return itemsize == sizeof(double) ? ITEM_DOUBLE : -1;
+        default:
+            return -1;
+    }
+    switch (itemsize) {
+        case 1: return is_signed ? ITEM_INT8 : ITEM_UINT8;
+        case 2: return is_signed ? ITEM_INT16 : ITEM_UINT16;
+        case 4: return is_signed ? ITEM_INT32 : ITEM_UINT32;
+        case 8: return is_signed ? ITEM_INT64 : ITEM_UINT64;
+        default: return -1;
+    }
+}
+
+int
+GetFormatItemType(const char *format)
+{
+    // Byte order prefixes other than '@' also mean standard sizes
+    const int standard = *format && strchr("=<>!", *format) != NULL;
+    Py_ssize_t itemsize;
+
+    switch (*format ? format[strlen(format) - 1] : '\0') {
+        case 'b': case 'B': itemsize = 1; break;
+        case 'h': case 'H': itemsize = standard ? 2 : sizeof(short); break;
+        case 'i': case 'I': itemsize = standard ? 4 : sizeof(int); break;
+        case 'l': case 'L': itemsize = standard ? 4 : sizeof(long); break;
+        case 'q': case 'Q': itemsize = 8; break;
+        case 'n': case 'N':
+            if (standard) return -1;
+            itemsize = sizeof(size_t);
+            break;
+        case 'f': itemsize = 4; break;
+        case 'd': itemsize = 8; break;
+        default: return -1;
+    }
+    return GetItemType(format, itemsize);
+}
+
+int
+GetTypedBuffer(PyObject *obj, Py_buffer *view, int flags)
+{
+    int type;
+
+    if (!PyObject_CheckBuffer(obj)) return -1;
+    if (PyObject_GetBuffer(obj, view,
+                           flags | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+        // E.g., a writable buffer was requested from a bytes object
+        PyErr_Clear();
+        return -1;
+    }
+    type = view->ndim == 1
+        ? GetItemType(view->format ? view->format : "B", view->itemsize)
+        : -1;
+    DPRINTF("buffer format=%s type=%d\n", view->format, type);
+    if (type < 0) PyBuffer_Release(view);
+    return type;
+}
+
+PyObject *
+GetTypedItem(const void *buf, ItemType type, Py_ssize_t i)
+{
+    switch (type) {
+        case ITEM_INT8: return PyLong_FromLong(((const int8_t *) buf)[i]);
+        case ITEM_INT16: return PyLong_FromLong(((const int16_t *) buf)[i]);
+        case ITEM_INT32: return PyLong_FromLong(((const int32_t *) buf)[i]);
+        case ITEM_INT64:
+            return PyLong_FromLongLong(((const int64_t *) buf)[i]);
+        case ITEM_UINT8:
+            return PyLong_FromUnsignedLong(((const uint8_t *) buf)[i]);
+        case ITEM_UINT16:
+            return PyLong_FromUnsignedLong(((const uint16_t *) buf)[i]);
+        case ITEM_UINT32:
+            return PyLong_FromUnsignedLong(((const uint32_t *) buf)[i]);
+        case ITEM_UINT64:
+            return PyLong_FromUnsignedLongLong(((const uint64_t *) buf)[i]);
+        case ITEM_FLOAT: return PyFloat_FromDouble(((const float *) buf)[i]);
+        case ITEM_DOUBLE: return PyFloat_FromDouble(((const double *) buf)[i]);
+    }
+    PyErr_BadInternalCall();
+    return NULL;
+}
+
+// array module type codes of the item types
+static const char *const type_codes[] = {
+    [ITEM_INT8] = "b",
+    [ITEM_INT16] = "h",
+    [ITEM_INT32] = "i",
+    [ITEM_INT64] = "q",
+    [ITEM_UINT8] = "B",
+    [ITEM_UINT16] = "H",
+    [ITEM_UINT32] = "I",
+    [ITEM_UINT64] = "Q",
+    [ITEM_FLOAT] = "f",
+    [ITEM_DOUBLE] = "d",
+};
+
+PyObject *
+NewTypedArray(ItemType type, Py_ssize_t n, Py_buffer *view)
+{
+    PyObject *module, *zero, *array;
+
+    if (!(module = PyImport_ImportModule("array"))) return NULL;
+    zero = PyObject_CallMethod(module, "array", "s(i)", type_codes[type], 0);
+    Py_DECREF(module);
+    if (!zero) return NULL;
+
+    // Repeating a one-item array fills the new one with memcpy
+    array = PySequence_Repeat(zero, n);
+    Py_DECREF(zero);
+    if (array && PyObject_GetBuffer(array, view, PyBUF_WRITABLE) < 0)
+        Py_CLEAR(array);
+    return array;
+}
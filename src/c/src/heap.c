@@ -18,11 +18,11 @@ BinaryHeapify(PyObject **a, Py_ssize_t root, Py_ssize_t size, int op) {
         // Get the index of the largest/smallest element among the root node at
         // index `root` and the children at the left and right indices
         i = root;
-        if ((l < size) && (status = PyObject_RichCompareBool(a[l], a[i], op))) {
+        if ((l < size) && (status = COMPARE(a[l], a[i], op))) {
             if (status < 0) return 0;  // PyObject comparison failed
             i = l;
         }
-        if ((r < size) && (status = PyObject_RichCompareBool(a[r], a[i], op))) {
+        if ((r < size) && (status = COMPARE(a[r], a[i], op))) {
             if (status < 0) return 0;  // PyObject comparison failed
             i = r;
         }
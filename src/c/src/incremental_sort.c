@@ -0,0 +1,167 @@
+#include "debug.h"
+#include "incremental_sort.h"
+#include "utils.h"
+
+#include <string.h>
+#include <time.h>
+
+// The clock is read once every this many comparisons of a timed step
+#define CLOCK_INTERVAL 64
+
+// Seconds since the epoch. ISO C has no monotonic clock, but steps only have
+// to be about as long as asked, so the rare adjustment of the clock during a
+// step at worst makes that step too short or too long
+static double
+Now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+// Set up the merge of the runs starting at `lo`
+static void
+StartMerge(IncrementalSort *sort, const Py_ssize_t lo)
+{
+    const Py_ssize_t n = sort->n;
+    sort->i = lo;
+    sort->mid = sort->j = Py_MIN(lo + sort->width, n);
+    sort->hi = Py_MIN(lo + 2 * sort->width, n);
+}
+
+int
+IncrementalSortInit(IncrementalSort *sort, PyObject *iterable)
+{
+    PyObject *seq;
+    Py_ssize_t n, i;
+
+    memset(sort, 0, sizeof(IncrementalSort));
+    sort->width = 1;
+    if (!(seq = PySequence_Fast(iterable, "expected an iterable"))) return 0;
+    n = PySequence_Fast_GET_SIZE(seq);
+    sort->src = PyMem_Malloc((size_t) n * sizeof(PyObject *));
+    sort->dst = PyMem_Malloc((size_t) n * sizeof(PyObject *));
+    if (!sort->src || !sort->dst) {
+        PyMem_Free(sort->src);
+        PyMem_Free(sort->dst);
+        sort->src = sort->dst = NULL;
+        Py_DECREF(seq);
+        PyErr_NoMemory();
+        return 0;
+    }
+    COUNT(allocations, 2);
+    for (i = 0; i < n; ++i) {
+        sort->src[i] = PySequence_Fast_GET_ITEM(seq, i);
+        Py_INCREF(sort->src[i]);
+    }
+    Py_DECREF(seq);
+    sort->n = n;
+    StartMerge(sort, 0);
+    return 1;
+}
+
+int
+IncrementalSortStep(IncrementalSort *sort, const Py_ssize_t budget,
+                    const double seconds)
+{
+    const double deadline = seconds > 0.0 ? Now() + seconds : 0.0;
+    PyObject **src, **dst, **tmp;
+    Py_ssize_t used = 0;
+    int compare;
+
+    while (sort->width < sort->n) {
+        src = sort->src;
+        dst = sort->dst;
+
+        // Merge the current pair of runs until one of them runs out
+        while (sort->i < sort->mid && sort->j < sort->hi) {
+            if (used >= budget) return 0;
+            if (deadline > 0.0 && used > 0 && used % CLOCK_INTERVAL == 0
+                    && Now() >= deadline)
+                return 0;
+            // Ties go to the left run, which keeps the merge stable
+            if ((compare = LT(src[sort->j], src[sort->i])) < 0) return -1;
+            ++used;
+            ++sort->comparisons;
+            dst[sort->k++] = compare ? src[sort->j++] : src[sort->i++];
+        }
+        memcpy(dst + sort->k, src + sort->i,
+               (size_t) (sort->mid - sort->i) * sizeof(PyObject *));
+        sort->k += sort->mid - sort->i;
+        memcpy(dst + sort->k, src + sort->j,
+               (size_t) (sort->hi - sort->j) * sizeof(PyObject *));
+        sort->k += sort->hi - sort->j;
+
+        if (sort->hi < sort->n) {
+            StartMerge(sort, sort->hi);
+        } else {
+            // The pass is over, and its output is the input of the next one
+            COUNT(moves, sort->n);
+            tmp = sort->src;
+            sort->src = sort->dst;
+            sort->dst = tmp;
+            sort->width *= 2;
+            sort->k = 0;
+            ++sort->pass;
+            StartMerge(sort, 0);
+            DPRINTF("pass %zd done after %zd comparisons\n", sort->pass,
+                    sort->comparisons);
+        }
+    }
+    return 1;
+}
+
+int
+IncrementalSortDone(const IncrementalSort *sort)
+{
+    return sort->width >= sort->n;
+}
+
+double
+IncrementalSortProgress(const IncrementalSort *sort)
+{
+    Py_ssize_t passes = 0, width;
+
+    if (IncrementalSortDone(sort)) return 1.0;
+    for (width = 1; width < sort->n; width *= 2) ++passes;
+    return ((double) sort->pass + (double) sort->k / (double) sort->n)
+           / (double) passes;
+}
+
+int
+IncrementalSortVisit(const IncrementalSort *sort, visitproc visit, void *arg)
+{
+    Py_ssize_t i;
+    int status;
+
+    for (i = 0; i < sort->k; ++i)
+        if ((status = visit(sort->dst[i], arg))) return status;
+    for (i = sort->i; i < sort->mid; ++i)
+        if ((status = visit(sort->src[i], arg))) return status;
+    for (i = sort->j; i < sort->n; ++i)
+        if ((status = visit(sort->src[i], arg))) return status;
+    return 0;
+}
+
+// Release a reference, as a visitproc
+static int
+Release(PyObject *item, void *arg)
+{
+    (void) arg;  // Unused parameter
+    Py_DECREF(item);
+    return 0;
+}
+
+void
+IncrementalSortClear(IncrementalSort *sort)
+{
+    // Releasing the items can run arbitrary code, which should find the sort
+    // already empty
+    IncrementalSort copy = *sort;
+
+    memset(sort, 0, sizeof(IncrementalSort));
+    sort->width = 1;
+    IncrementalSortVisit(&copy, Release, NULL);
+    PyMem_Free(copy.src);
+    PyMem_Free(copy.dst);
+}
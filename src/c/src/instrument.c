@@ -0,0 +1,139 @@
+#include "debug.h"
+#include "instrument.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+// Most distinct algorithms whose totals are kept per module; calls to any more
+// are silently left out
+#define MAX_RECORDS 64
+
+_Atomic int Instrumenting = 0;
+_Thread_local Counters Count;
+
+// Totals of every call to one algorithm
+typedef struct {
+    const char *name;
+    unsigned long long calls;
+    Counters total;
+    double seconds;
+} Record;
+
+// Totals of the calls ended so far, guarded by `lock`
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static Record records[MAX_RECORDS];
+static int num_records = 0;
+
+// Wall clock time in seconds
+static double
+Now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+void
+InstrumentBegin(InstrumentedCall *call)
+{
+    call->outer = Count;
+    memset(&Count, 0, sizeof(Count));
+    call->start = Now();
+}
+
+void
+InstrumentEnd(InstrumentedCall *call, const char *name)
+{
+    double seconds = Now() - call->start;
+    Record *record = NULL;
+    int i;
+
+    // Counting may have been stopped by the time the call ends, e.g., by a
+    // comparison function that leaves an instrument() block
+    pthread_mutex_lock(&lock);
+    if (!Instrumenting) goto unlock;
+
+    // Names are string literals, so the same algorithm nearly always has the
+    // same pointer
+    for (i = 0; i < num_records; ++i) {
+        if (records[i].name == name || !strcmp(records[i].name, name)) {
+            record = &records[i];
+            break;
+        }
+    }
+    if (!record) {
+        if (num_records == MAX_RECORDS) goto unlock;
+        record = &records[num_records++];
+        memset(record, 0, sizeof(*record));
+        record->name = name;
+    }
+    ++record->calls;
+    record->total.comparisons += Count.comparisons;
+    record->total.swaps += Count.swaps;
+    record->total.moves += Count.moves;
+    record->total.allocations += Count.allocations;
+    if (Count.max_depth > record->total.max_depth)
+        record->total.max_depth = Count.max_depth;
+    record->seconds += seconds;
+
+unlock:
+    pthread_mutex_unlock(&lock);
+    Count = call->outer;
+}
+
+// Dict of the totals of one algorithm
+static PyObject *
+RecordToDict(const Record *record)
+{
+    return Py_BuildValue("{sKsKsKsKsKsnsd}",
+                         "calls", record->calls,
+                         "comparisons", record->total.comparisons,
+                         "swaps", record->total.swaps,
+                         "moves", record->total.moves,
+                         "allocations", record->total.allocations,
+                         "max_depth", record->total.max_depth,
+                         "seconds", record->seconds);
+}
+
+PyObject *
+Instrument(PyObject *module, PyObject *enable)
+{
+    Record copy[MAX_RECORDS];
+    PyObject *totals = NULL;
+    PyObject *value;
+    int status;
+    int i, n;
+
+    (void) module;  // Unused parameter
+
+    if ((status = PyObject_IsTrue(enable)) < 0) return NULL;
+
+    // The totals are copied out, so that the lock isn't held while calling
+    // into Python
+    pthread_mutex_lock(&lock);
+    Instrumenting = status;
+    n = num_records;
+    memcpy(copy, records, (size_t) n * sizeof(Record));
+    num_records = 0;
+    pthread_mutex_unlock(&lock);
+    if (status) Py_RETURN_NONE;
+
+    if (!(totals = PyDict_New())) return NULL;
+    for (i = 0; i < n; ++i) {
+        if (!(value = RecordToDict(&copy[i]))) goto fail;
+        status = PyDict_SetItemString(totals, copy[i].name, value);
+        Py_DECREF(value);
+        if (status < 0) goto fail;
+    }
+    return totals;
+
+fail:
+    Py_DECREF(totals);
+    return NULL;
+}
+
+const char Instrument_doc[] =
+"_instrument(enable) -> dict or None\n\n"
+"Start counting operations if `enable` is true, or stop counting and return\n"
+"the totals per algorithm otherwise. Use algorithms.instrument() instead.";
@@ -0,0 +1,193 @@
+#include "debug.h"
+#include "lexsort.h"
+#include "radix.h"
+#include "scratch.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Rows are sorted by insertion sort instead of merging up to this many
+#define ARGSORT_CUTOFF 16
+
+// Row index paired with the radix key of its numbers
+typedef struct {
+    uint64_t key;
+    Py_ssize_t index;
+} KeyedIndex;
+
+#define ITEM_T KeyedIndex
+#define NAME(name) name##_keyed
+#define RADIX_KEY(x) ((x).key)
+#define RADIX_BYTES 8
+#include "radix_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+// Sizes of the radix keys of every item type in bytes, indexed by ItemType
+static const int key_widths[] = {1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
+
+// Append the keys of a column's numbers in the rows `pairs[i].index` to the
+// keys `pairs[i].key`, i.e., shift them left by the width of the new keys and
+// add those. Keys of descending columns are complemented. The shift is split
+// in two since shifting a 64-bit integer by 64 bits is undefined (the first
+// column of a pack has zero keys, so it doesn't matter what it shifts out)
+static void
+PackKeys(const TypedColumn *column, KeyedIndex *pairs, const Py_ssize_t n)
+{
+    const char *base = column->base;
+    const Py_ssize_t stride = column->stride;
+    const int bits = 8 * key_widths[column->type];
+    const uint64_t mask = !column->descending ? 0
+        : bits == 64 ? UINT64_MAX : (UINT64_C(1) << bits) - 1;
+    Py_ssize_t i;
+
+#define PACK_KEYS(T, KEY)                                                      \
+    for (i = 0; i < n; ++i) {                                                  \
+        T x;                                                                   \
+        memcpy(&x, base + pairs[i].index * stride, sizeof(x));                 \
+        pairs[i].key = (pairs[i].key << (bits - 1) << 1)                       \
+            | ((uint64_t) (KEY) ^ mask);                                       \
+    }
+
+    switch (column->type) {
+        case ITEM_INT8: PACK_KEYS(int8_t, (uint8_t) x ^ 0x80u); break;
+        case ITEM_INT16: PACK_KEYS(int16_t, (uint16_t) x ^ 0x8000u); break;
+        case ITEM_INT32:
+            PACK_KEYS(int32_t, (uint32_t) x ^ UINT32_C(0x80000000));
+            break;
+        case ITEM_INT64: PACK_KEYS(int64_t, Int64Key(x)); break;
+        case ITEM_UINT8: PACK_KEYS(uint8_t, x); break;
+        case ITEM_UINT16: PACK_KEYS(uint16_t, x); break;
+        case ITEM_UINT32: PACK_KEYS(uint32_t, x); break;
+        case ITEM_UINT64: PACK_KEYS(uint64_t, x); break;
+        case ITEM_FLOAT: PACK_KEYS(float, FloatKey(x)); break;
+        case ITEM_DOUBLE: PACK_KEYS(double, DoubleKey(x)); break;
+    }
+
+#undef PACK_KEYS
+}
+
+int
+TypedLexSort(const TypedColumn *columns, const Py_ssize_t k, Py_ssize_t *perm,
+             const Py_ssize_t n)
+{
+    KeyedIndex *pairs;
+    Py_ssize_t first, last = k, i, j;
+    int width;
+
+    if (n < 2 || k < 1) return 1;
+    if (!(pairs = AcquireScratch(2 * (size_t) n * sizeof(KeyedIndex))))
+        return 0;
+
+    // From the least significant columns to the most, pack the keys of as many
+    // adjacent columns as fit into 64 bits, and radix sort the rows by them
+    while (last > 0) {
+        first = last - 1;
+        width = key_widths[columns[first].type];
+        while (first > 0 && width + key_widths[columns[first - 1].type] <= 8)
+            width += key_widths[columns[--first].type];
+        DPRINTF("packing columns [%zd,%zd) into %d bytes\n", first, last,
+                width);
+
+        for (i = 0; i < n; ++i) {
+            pairs[i].key = 0;
+            pairs[i].index = perm[i];
+        }
+        for (j = first; j < last; ++j) PackKeys(&columns[j], pairs, n);
+        RadixSort_keyed(pairs, pairs + n, n);
+        for (i = 0; i < n; ++i) perm[i] = pairs[i].index;
+        last = first;
+    }
+
+    ReturnScratch(pairs);
+    return 1;
+}
+
+// Whether the row `j` goes before the row `i`, i.e., whether a[j] < a[i] (or
+// a[i] < a[j] if descending), or -1 if the comparison failed. Rows with equal
+// items keep their order either way
+static inline int
+Before(PyObject **a, const int descending, const Py_ssize_t j,
+       const Py_ssize_t i)
+{
+    return descending ? LT(a[i], a[j]) : LT(a[j], a[i]);
+}
+
+// Merge sort `perm[0,n)` by the items of `a`, using `buf` to store n / 2 row
+// indices. Returns 0 if a comparison failed
+static int
+MergeRows(PyObject **a, const int descending, Py_ssize_t *perm,
+          Py_ssize_t *buf, const Py_ssize_t n)
+{
+    const Py_ssize_t half = n / 2;
+    Py_ssize_t i, j, k, row;
+    int status;
+
+    if (n <= ARGSORT_CUTOFF) {
+        for (i = 1; i < n; ++i) {
+            row = perm[i];
+            for (j = i; j > 0; --j) {
+                if ((status = Before(a, descending, row, perm[j - 1])) < 0)
+                    return 0;
+                if (!status) break;
+                perm[j] = perm[j - 1];
+            }
+            perm[j] = row;
+        }
+        return 1;
+    }
+
+    if (!MergeRows(a, descending, perm, buf, half)) return 0;
+    if (!MergeRows(a, descending, perm + half, buf, n - half)) return 0;
+
+    // Halves already in order (e.g., of sorted columns) aren't merged
+    if ((status = Before(a, descending, perm[half], perm[half - 1])) <= 0)
+        return status == 0;
+
+    memcpy(buf, perm, (size_t) half * sizeof(Py_ssize_t));
+    i = 0;
+    j = half;
+    k = 0;
+    while (i < half && j < n) {
+        if ((status = Before(a, descending, perm[j], buf[i])) < 0) return 0;
+        perm[k++] = status ? perm[j++] : buf[i++];
+    }
+    while (i < half) perm[k++] = buf[i++];
+    return 1;
+}
+
+int
+ArgSort(PyObject **a, const int descending, Py_ssize_t *perm,
+        const Py_ssize_t n)
+{
+    Py_ssize_t *buf;
+    int status;
+
+    if (n < 2) return 1;
+    if (!(buf = AcquireScratch((size_t) (n / 2) * sizeof(Py_ssize_t)))) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    status = MergeRows(a, descending, perm, buf, n);
+    ReturnScratch(buf);
+    return status;
+}
+
+int
+PermuteRecords(char *records, const Py_ssize_t size, const Py_ssize_t *perm,
+               const Py_ssize_t n)
+{
+    char *copy;
+    Py_ssize_t i;
+
+    if (n < 2) return 1;
+    if (!(copy = AcquireScratch((size_t) n * (size_t) size))) return 0;
+    for (i = 0; i < n; ++i)
+        memcpy(copy + i * size, records + perm[i] * size, (size_t) size);
+    memcpy(records, copy, (size_t) n * (size_t) size);
+    ReturnScratch(copy);
+    return 1;
+}
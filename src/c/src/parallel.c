@@ -0,0 +1,64 @@
+#include "debug.h"
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int
+NumThreads(int threads)
+{
+    long cores;
+    if (threads > 0) return threads;
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int) cores : 1;
+}
+
+// A chunk of a ParallelFor loop
+typedef struct {
+    void (*body)(void *, Py_ssize_t, Py_ssize_t);
+    void *context;
+    Py_ssize_t begin;
+    Py_ssize_t end;
+    int started;
+    pthread_t thread;
+} Task;
+
+static void *
+RunTask(void *arg)
+{
+    Task *task = arg;
+    task->body(task->context, task->begin, task->end);
+    return NULL;
+}
+
+void
+ParallelFor(int threads, Py_ssize_t n,
+            void (*body)(void *, Py_ssize_t, Py_ssize_t), void *context)
+{
+    Py_ssize_t chunks = threads < n ? threads : n;
+    Py_ssize_t chunk, t;
+    Task *tasks;
+
+    if (chunks <= 1 || !(tasks = malloc((size_t) chunks * sizeof(Task)))) {
+        if (n > 0) body(context, 0, n);
+        return;
+    }
+
+    chunk = (n + chunks - 1) / chunks;
+    for (t = 0; t < chunks; ++t) {
+        tasks[t].body = body;
+        tasks[t].context = context;
+        tasks[t].begin = t * chunk < n ? t * chunk : n;
+        tasks[t].end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+        // Chunks whose threads couldn't be started are run below instead
+        tasks[t].started = t > 0 && tasks[t].begin < tasks[t].end
+            && !pthread_create(&tasks[t].thread, NULL, RunTask, &tasks[t]);
+    }
+    for (t = 0; t < chunks; ++t)
+        if (!tasks[t].started && tasks[t].begin < tasks[t].end)
+            RunTask(&tasks[t]);
+    for (t = 0; t < chunks; ++t)
+        if (tasks[t].started) pthread_join(tasks[t].thread, NULL);
+    free(tasks);
+}
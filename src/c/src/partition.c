@@ -1,11 +1,8 @@
 #include "debug.h"
 #include "partition.h"
+#include "rng.h"
 #include "utils.h"
 
-#include <time.h>
-
-static int _seeded = 0;
-
 // Partitioning an array `a[first,last)` with respect to `x` means to permute
 // the elements of `a[first,last)` such that that every element of
 // `a[first,last)` which is less than or equal to `x` occurs before every
@@ -38,17 +35,55 @@ Partition(PyObject **a, const Py_ssize_t first, const Py_ssize_t last)
     return i;
 }
 
-// Partition the array `a[first,last)` with respect to a random element
+// Partition the array `a[first,last)` with respect to a random element, drawn
+// from the generator with the state `*rng`
 Py_ssize_t
-PartitionRandom(PyObject **a, const Py_ssize_t first, const Py_ssize_t last) {
-    if (!_seeded) {
-        srand(time(NULL));
-        _seeded = 1;
-    }
+PartitionRandom(PyObject **a, const Py_ssize_t first, const Py_ssize_t last,
+                uint64_t *rng)
+{
     if (first < last) {
-        Py_ssize_t r = first + (rand() % (last - first));
+        Py_ssize_t r = first
+            + (Py_ssize_t) (NextRandom(rng) % (uint64_t) (last - first));
         DPRINTF("pivot index=%ld\n", r);
         SWAP(a[first], a[r]);
     }
     return Partition(a, first, last);
 }
+
+// Three-way partition of the nonempty array `a[first,last)` with respect to a
+// random element `x`, drawn from the generator with the state `*rng`
+// (Dijkstra's "Dutch national flag" scheme): afterwards, the values in
+// `a[first,*lt)` are less than `x`, the values in `a[*lt,*gt)` are equal to
+// `x`, and the values in `a[*gt,last)` are greater than `x`. Returns 1 if
+// successful and 0 if a comparison failed
+int
+Partition3Way(PyObject **a, const Py_ssize_t first, const Py_ssize_t last,
+              Py_ssize_t *lt, Py_ssize_t *gt, uint64_t *rng)
+{
+    PyObject *pivot;
+    Py_ssize_t i = first + 1, l = first, g = last;
+    int compare;
+
+    SWAP(a[first],
+         a[first + (Py_ssize_t) (NextRandom(rng) % (uint64_t) (last - first))]);
+    pivot = a[first];
+
+    // Loop invariant: `a[first,l)` is less than `pivot`, `a[l,i)` is equal to
+    // `pivot`, and `a[g,last)` is greater than `pivot`
+    while (i < g) {
+        if ((compare = LT(a[i], pivot))) {  // a[i] < pivot
+            if (compare < 0) return 0;  // Comparison failed
+            SWAP(a[l], a[i]);
+            ++l;
+            ++i;
+        } else if ((compare = LT(pivot, a[i]))) {  // pivot < a[i]
+            if (compare < 0) return 0;  // Comparison failed
+            SWAP(a[i], a[--g]);
+        } else {
+            ++i;
+        }
+    }
+    *lt = l;
+    *gt = g;
+    return 1;
+}
@@ -0,0 +1,453 @@
+#include "debug.h"
+#include "quantile_sketch.h"
+#include "sort.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Level capacities shrink by this factor going down a level, but never below
+// MIN_WIDTH items
+#define SHRINK (2.0 / 3.0)
+#define MIN_WIDTH 8
+
+// Empirical rank error of KLL sketches with 99% confidence, as fit by Apache
+// DataSketches: ERROR_SCALE / k^ERROR_EXPONENT
+#define ERROR_SCALE 2.296
+#define ERROR_EXPONENT 0.9723
+
+// First bytes of serialized sketches
+static const char magic[4] = {'K', 'L', 'L', '1'};
+
+// Next number of a xorshift64* generator
+static uint64_t
+NextRandom(QuantileSketch *sketch)
+{
+    uint64_t x = sketch->random;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    sketch->random = x;
+    return x * UINT64_C(2685821657736338717);
+}
+
+// Capacity of level `h` of a sketch with `num_levels` levels
+static Py_ssize_t
+LevelCapacity(int k, int num_levels, int h)
+{
+    double capacity = k;
+    for (int depth = num_levels - 1 - h; depth > 0 && capacity > MIN_WIDTH;
+         --depth)
+        capacity *= SHRINK;
+    return capacity > MIN_WIDTH ? (Py_ssize_t) capacity : MIN_WIDTH;
+}
+
+static void
+UpdateCapacity(QuantileSketch *sketch)
+{
+    sketch->capacity = 0;
+    for (int h = 0; h < sketch->num_levels; ++h)
+        sketch->capacity += LevelCapacity(sketch->k, sketch->num_levels, h);
+}
+
+void
+SketchInit(QuantileSketch *sketch, int k, uint64_t seed)
+{
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->k = k;
+    sketch->num_levels = 1;
+    sketch->min = HUGE_VAL;
+    sketch->max = -HUGE_VAL;
+    // The generator's state must not be zero
+    sketch->random = seed ^ UINT64_C(0x9E3779B97F4A7C15);
+    if (!sketch->random) sketch->random = 1;
+    UpdateCapacity(sketch);
+}
+
+void
+SketchFree(QuantileSketch *sketch)
+{
+    for (int h = 0; h < SKETCH_MAX_LEVELS; ++h) {
+        free(sketch->levels[h].items);
+        sketch->levels[h].items = NULL;
+        sketch->levels[h].size = sketch->levels[h].allocated = 0;
+    }
+    free(sketch->view);
+    free(sketch->ranks);
+    sketch->view = NULL;
+    sketch->ranks = NULL;
+    sketch->view_valid = 0;
+}
+
+double
+SketchError(int k)
+{
+    return ERROR_SCALE / pow(k, ERROR_EXPONENT);
+}
+
+int
+SketchAccuracy(double error)
+{
+    double k = ceil(pow(ERROR_SCALE / error, 1.0 / ERROR_EXPONENT));
+    if (!(k >= SKETCH_MIN_K)) return SKETCH_MIN_K;
+    if (k >= SKETCH_MAX_K) return SKETCH_MAX_K;
+    return (int) k;
+}
+
+// Make room for at least `n` items in a level
+static int
+Reserve(SketchLevel *level, Py_ssize_t n)
+{
+    Py_ssize_t allocated;
+    double *items;
+
+    if (n <= level->allocated) return 1;
+    allocated = n + n / 2 + MIN_WIDTH;
+    if (!(items = realloc(level->items, (size_t) allocated * sizeof(double))))
+        return 0;
+    level->items = items;
+    level->allocated = allocated;
+    return 1;
+}
+
+// Merge the sorted numbers `a[0,n)` into a sorted level, which must have room
+// for them, from the back so that no other space is needed
+static void
+MergeInto(SketchLevel *level, const double *a, Py_ssize_t n)
+{
+    Py_ssize_t i = level->size - 1, j = n - 1, k = level->size + n - 1;
+
+    while (j >= 0) {
+        if (i >= 0 && level->items[i] > a[j]) {
+            level->items[k--] = level->items[i--];
+        } else {
+            level->items[k--] = a[j--];
+        }
+    }
+    level->size += n;
+}
+
+// Compact the lowest level holding at least its capacity, adding a level on top
+// if that's the top level
+static int
+Compact(QuantileSketch *sketch)
+{
+    SketchLevel *level;
+    Py_ssize_t odd, half;
+    int h, offset;
+
+    for (h = 0; h < sketch->num_levels - 1; ++h) {
+        if (sketch->levels[h].size
+                >= LevelCapacity(sketch->k, sketch->num_levels, h))
+            break;
+    }
+    // Sketches have fewer than SKETCH_MAX_LEVELS levels, which is already more
+    // than any stream whose length fits in 64 bits needs, so the top level
+    // isn't compacted into a level that doesn't exist
+    if (h == sketch->num_levels - 1
+            && sketch->num_levels + 1 >= SKETCH_MAX_LEVELS)
+        return 0;
+    level = &sketch->levels[h];
+    odd = level->size % 2;
+    half = level->size / 2;
+    if (!Reserve(&sketch->levels[h + 1], sketch->levels[h + 1].size + half))
+        return 0;
+    if (h == 0 && !TypedRadixSort(level->items, ITEM_DOUBLE, 0, level->size))
+        return 0;
+
+    // Keep the first item of an odd level where it is, and move up every other
+    // item of the rest, starting from a random one of the first two
+    offset = (int) (NextRandom(sketch) >> 63);
+    for (Py_ssize_t t = 0; t < half; ++t)
+        level->items[odd + t] = level->items[odd + 2 * t + offset];
+    MergeInto(&sketch->levels[h + 1], level->items + odd, half);
+    level->size = odd;
+    sketch->size -= half;
+
+    if (h == sketch->num_levels - 1) {
+        ++sketch->num_levels;
+        UpdateCapacity(sketch);
+    }
+    return 1;
+}
+
+int
+SketchUpdate(QuantileSketch *sketch, const double *a, Py_ssize_t n)
+{
+    SketchLevel *level = &sketch->levels[0];
+    Py_ssize_t i = 0, j, room;
+    double x, min = sketch->min, max = sketch->max;
+    int status = 1;
+
+    sketch->view_valid = 0;
+    while (i < n) {
+        while (sketch->size >= sketch->capacity) {
+            if (!(status = Compact(sketch))) goto done;
+        }
+        room = sketch->capacity - sketch->size;
+        if (!(status = Reserve(level, level->size + room))) goto done;
+
+        // Copy numbers until level 0 holds everything there's room for
+        for (j = level->size; i < n && j < level->size + room; ++i) {
+            x = a[i];
+            if (x != x) continue;  // NaN
+            if (x < min) min = x;
+            if (x > max) max = x;
+            level->items[j++] = x;
+        }
+        sketch->count += (uint64_t) (j - level->size);
+        sketch->size += j - level->size;
+        level->size = j;
+    }
+
+done:
+    sketch->min = min;
+    sketch->max = max;
+    return status;
+}
+
+int
+SketchMerge(QuantileSketch *sketch, const QuantileSketch *other)
+{
+    int h;
+
+    if (other->count == 0) return 1;
+
+    // Make room in every level first, so that failing leaves the sketch as is
+    for (h = 0; h < other->num_levels; ++h) {
+        if (!Reserve(&sketch->levels[h],
+                     sketch->levels[h].size + other->levels[h].size))
+            return 0;
+    }
+
+    sketch->view_valid = 0;
+    memcpy(sketch->levels[0].items + sketch->levels[0].size,
+           other->levels[0].items,
+           (size_t) other->levels[0].size * sizeof(double));
+    sketch->levels[0].size += other->levels[0].size;
+    for (h = 1; h < other->num_levels; ++h)
+        MergeInto(&sketch->levels[h], other->levels[h].items,
+                  other->levels[h].size);
+
+    if (other->num_levels > sketch->num_levels)
+        sketch->num_levels = other->num_levels;
+    if (other->k < sketch->k) sketch->k = other->k;
+    if (other->min < sketch->min) sketch->min = other->min;
+    if (other->max > sketch->max) sketch->max = other->max;
+    sketch->count += other->count;
+    sketch->size += other->size;
+    UpdateCapacity(sketch);
+    while (sketch->size > sketch->capacity)
+        if (!Compact(sketch)) return 0;
+    return 1;
+}
+
+int
+SketchPrepare(QuantileSketch *sketch)
+{
+    Py_ssize_t next[SKETCH_MAX_LEVELS] = {0}, n = sketch->size;
+    SketchLevel *levels = sketch->levels;
+    double *view;
+    uint64_t *ranks, rank = 0;
+    int best;
+
+    if (sketch->view_valid) return 1;
+    if (!(view = realloc(sketch->view, (size_t) n * sizeof(double) + 1)))
+        return 0;
+    sketch->view = view;
+    if (!(ranks = realloc(sketch->ranks, (size_t) n * sizeof(uint64_t) + 1)))
+        return 0;
+    sketch->ranks = ranks;
+    if (!TypedRadixSort(levels[0].items, ITEM_DOUBLE, 0, levels[0].size))
+        return 0;
+
+    // Merge the sorted levels, which are few, by picking the smallest of their
+    // next items every time
+    for (Py_ssize_t m = 0; m < n; ++m) {
+        best = -1;
+        for (int h = 0; h < sketch->num_levels; ++h) {
+            if (next[h] < levels[h].size
+                    && (best < 0 || levels[h].items[next[h]]
+                                    < levels[best].items[next[best]]))
+                best = h;
+        }
+        view[m] = levels[best].items[next[best]++];
+        rank += (uint64_t) 1 << best;
+        ranks[m] = rank;
+    }
+    sketch->view_valid = 1;
+    return 1;
+}
+
+double
+SketchQuantile(const QuantileSketch *sketch, double q)
+{
+    Py_ssize_t first = 0, last = sketch->size - 1, midpoint;
+    double target = q * (double) sketch->count;
+
+    if (q <= 0.0) return sketch->min;
+    if (q >= 1.0) return sketch->max;
+
+    // Find the first item whose cumulative weight reaches the target
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        if ((double) sketch->ranks[midpoint] >= target) {
+            last = midpoint;
+        } else {
+            first = midpoint + 1;
+        }
+    }
+    return sketch->view[first];
+}
+
+double
+SketchRank(const QuantileSketch *sketch, double x)
+{
+    Py_ssize_t first = 0, last = sketch->size, midpoint;
+
+    if (x < sketch->min) return 0.0;
+    if (x >= sketch->max) return 1.0;
+
+    // Find the first item greater than x
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        if (x < sketch->view[midpoint]) {
+            last = midpoint;
+        } else {
+            first = midpoint + 1;
+        }
+    }
+    if (first == 0) return 0.0;
+    return (double) sketch->ranks[first - 1] / (double) sketch->count;
+}
+
+// Serialization: the magic bytes, the accuracy parameter and number of levels
+// (as int32), the count (uint64), the smallest and largest numbers (double),
+// the sizes of the levels (uint32), and the items of the levels (double)
+
+#define HEADER_SIZE (sizeof(magic) + 2 * sizeof(int32_t) + sizeof(uint64_t)   \
+                     + 2 * sizeof(double))
+
+size_t
+SketchSerializedSize(const QuantileSketch *sketch)
+{
+    return HEADER_SIZE + (size_t) sketch->num_levels * sizeof(uint32_t)
+        + (size_t) sketch->size * sizeof(double);
+}
+
+#define WRITE(p, x)                                                            \
+    do {                                                                       \
+        memcpy((p), &(x), sizeof(x));                                          \
+        (p) += sizeof(x);                                                      \
+    } while (0)
+
+#define READ(p, x)                                                             \
+    do {                                                                       \
+        memcpy(&(x), (p), sizeof(x));                                          \
+        (p) += sizeof(x);                                                      \
+    } while (0)
+
+void
+SketchSerialize(const QuantileSketch *sketch, char *p)
+{
+    int32_t k = sketch->k, num_levels = sketch->num_levels;
+    uint32_t size;
+    int h;
+
+    memcpy(p, magic, sizeof(magic));
+    p += sizeof(magic);
+    WRITE(p, k);
+    WRITE(p, num_levels);
+    WRITE(p, sketch->count);
+    WRITE(p, sketch->min);
+    WRITE(p, sketch->max);
+    for (h = 0; h < num_levels; ++h) {
+        size = (uint32_t) sketch->levels[h].size;
+        WRITE(p, size);
+    }
+    for (h = 0; h < num_levels; ++h) {
+        memcpy(p, sketch->levels[h].items,
+               (size_t) sketch->levels[h].size * sizeof(double));
+        p += sketch->levels[h].size * sizeof(double);
+    }
+}
+
+int
+SketchDeserialize(QuantileSketch *sketch, const char *p, size_t length)
+{
+    QuantileSketch result;
+    int32_t k, num_levels;
+    uint32_t sizes[SKETCH_MAX_LEVELS];
+    uint64_t count, weight = 0;
+    size_t expected;
+    double min, max;
+    int h;
+
+    if (length < HEADER_SIZE || memcmp(p, magic, sizeof(magic))) return -1;
+    p += sizeof(magic);
+    READ(p, k);
+    READ(p, num_levels);
+    READ(p, count);
+    READ(p, min);
+    READ(p, max);
+    // Compacting the top level adds a level above it, so a sketch never has
+    // SKETCH_MAX_LEVELS levels (see Compact)
+    if (k < SKETCH_MIN_K || k > SKETCH_MAX_K || num_levels < 1
+            || num_levels >= SKETCH_MAX_LEVELS
+            || length < HEADER_SIZE + (size_t) num_levels * sizeof(uint32_t))
+        return -1;
+    SketchInit(&result, k, sketch->random);
+    result.num_levels = num_levels;
+    UpdateCapacity(&result);
+
+    // The items of a sketch never take more than its capacity (so each level
+    // fits in it too), and their weights must add up to the count without
+    // wrapping around
+    expected = HEADER_SIZE + (size_t) num_levels * sizeof(uint32_t);
+    for (h = 0; h < num_levels; ++h) {
+        READ(p, sizes[h]);
+        if (sizes[h] > (uint64_t) result.capacity
+                || ((uint64_t) sizes[h] << h) >> h != sizes[h]
+                || weight + ((uint64_t) sizes[h] << h) < weight)
+            return -1;
+        expected += sizes[h] * sizeof(double);
+        weight += (uint64_t) sizes[h] << h;
+        result.size += sizes[h];
+    }
+    if (length != expected || weight != count || (count && !(min <= max))
+            || result.size > result.capacity)
+        return -1;
+
+    result.size = 0;
+    result.count = count;
+    if (count) {
+        result.min = min;
+        result.max = max;
+    }
+    for (h = 0; h < num_levels; ++h) {
+        SketchLevel *level = &result.levels[h];
+        if (!Reserve(level, sizes[h])) {
+            SketchFree(&result);
+            return 0;
+        }
+        memcpy(level->items, p, sizes[h] * sizeof(double));
+        p += sizes[h] * sizeof(double);
+        level->size = sizes[h];
+        result.size += sizes[h];
+
+        // Items must be numbers between the smallest and largest ones, and
+        // sorted above level 0
+        for (Py_ssize_t i = 0; i < level->size; ++i) {
+            if (!(min <= level->items[i] && level->items[i] <= max)
+                    || (h > 0 && i > 0
+                        && level->items[i - 1] > level->items[i])) {
+                SketchFree(&result);
+                return -1;
+            }
+        }
+    }
+
+    SketchFree(sketch);
+    *sketch = result;
+    return 1;
+}
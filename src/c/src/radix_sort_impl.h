@@ -0,0 +1,47 @@
+// Least significant digit radix sort, written once for every item type: this
+// file is included once per type, with `ITEM_T` defined as the C type of the
+// items, `NAME(name)` defined to append a suffix naming that type to `name`,
+// `RADIX_KEY(x)` defined as an unsigned integer whose order is the order of
+// the items (see radix.h), and `RADIX_BYTES` defined as the size of the keys
+
+// Stably sort the array `a[0,n)` by the keys of its items, one byte at a time,
+// using `buf` to store `n` items. Counts for every byte are taken in a single
+// pass, and bytes shared by every key (e.g., the high bytes of small integers)
+// are skipped, so sorting takes at most RADIX_BYTES + 1 passes over the items
+static void
+NAME(RadixSort)(ITEM_T *a, ITEM_T *buf, const Py_ssize_t n)
+{
+    Py_ssize_t counts[RADIX_BYTES][256];
+    ITEM_T *from = a, *to = buf, *temp;
+    Py_ssize_t i, offset, count;
+    int byte, digit, shift;
+
+    if (n < 2) return;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < n; ++i) {
+        uint64_t key = RADIX_KEY(a[i]);
+        for (byte = 0; byte < RADIX_BYTES; ++byte)
+            ++counts[byte][(key >> (8 * byte)) & 0xFF];
+    }
+
+    for (byte = 0; byte < RADIX_BYTES; ++byte) {
+        shift = 8 * byte;
+        if (counts[byte][(RADIX_KEY(from[0]) >> shift) & 0xFF] == n) continue;
+
+        // Turn the counts into the position of the first item with each digit
+        for (digit = 0, offset = 0; digit < 256; ++digit) {
+            count = counts[byte][digit];
+            counts[byte][digit] = offset;
+            offset += count;
+        }
+        for (i = 0; i < n; ++i) {
+            digit = (int) ((RADIX_KEY(from[i]) >> shift) & 0xFF);
+            to[counts[byte][digit]++] = from[i];
+        }
+        temp = from;
+        from = to;
+        to = temp;
+    }
+    if (from != a) memcpy(a, from, (size_t) n * sizeof(ITEM_T));
+}
@@ -0,0 +1,129 @@
+#include "debug.h"
+#include "scratch.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Most idle buffers to keep, e.g., one for each of a few threads sorting
+// concurrently
+#define SCRATCH_SLOTS 8
+
+// Default cap on the bytes of idle buffers
+#define SCRATCH_CAP ((size_t) 64 << 20)
+
+// Every buffer starts with its size, padded to keep the rest aligned
+typedef union {
+    size_t size;
+    max_align_t align;
+} Header;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static Header *idle[SCRATCH_SLOTS];
+static int num_idle = 0;
+static ScratchInfo info = {.cap = SCRATCH_CAP};
+
+void *
+AcquireScratch(size_t size)
+{
+    Header *header = NULL, *discard = NULL;
+    int fit = -1, largest = -1, best, i;
+
+    pthread_mutex_lock(&lock);
+    if (size > info.high_water) info.high_water = size;
+
+    // Take the smallest idle buffer that's big enough. If there's none, the
+    // largest idle buffer is freed to make room for a bigger one, since the
+    // sizes being requested are probably growing
+    for (i = 0; i < num_idle; ++i) {
+        if (idle[i]->size >= size) {
+            if (fit < 0 || idle[i]->size < idle[fit]->size) fit = i;
+        } else if (largest < 0 || idle[i]->size > idle[largest]->size) {
+            largest = i;
+        }
+    }
+    best = fit >= 0 ? fit : largest;
+    if (best >= 0) {
+        if (idle[best]->size >= size) {
+            header = idle[best];
+            ++info.hits;
+        } else {
+            discard = idle[best];
+        }
+        info.cached -= idle[best]->size;
+        --info.buffers;
+        idle[best] = idle[--num_idle];
+    }
+    if (!header) ++info.misses;
+    pthread_mutex_unlock(&lock);
+
+    free(discard);
+    if (!header) {
+        if (!(header = malloc(sizeof(Header) + size))) return NULL;
+        header->size = size;
+    }
+    return header + 1;
+}
+
+void
+ReturnScratch(void *buf)
+{
+    Header *header;
+
+    if (!buf) return;
+    header = (Header *) buf - 1;
+    pthread_mutex_lock(&lock);
+    if (num_idle < SCRATCH_SLOTS && info.cached + header->size <= info.cap) {
+        idle[num_idle++] = header;
+        info.cached += header->size;
+        ++info.buffers;
+        header = NULL;
+    }
+    pthread_mutex_unlock(&lock);
+    free(header);
+}
+
+// Free idle buffers until at most `cap` bytes are left. The lock must be held
+static size_t
+Trim(size_t cap)
+{
+    size_t freed = 0;
+    while (num_idle && info.cached > cap) {
+        Header *header = idle[--num_idle];
+        info.cached -= header->size;
+        --info.buffers;
+        freed += header->size;
+        free(header);
+    }
+    return freed;
+}
+
+size_t
+ReleaseScratchBuffers(void)
+{
+    size_t freed;
+    pthread_mutex_lock(&lock);
+    freed = Trim(0);
+    pthread_mutex_unlock(&lock);
+    return freed;
+}
+
+size_t
+SetScratchCap(size_t cap)
+{
+    size_t previous;
+    pthread_mutex_lock(&lock);
+    previous = info.cap;
+    info.cap = cap;
+    Trim(cap);
+    pthread_mutex_unlock(&lock);
+    return previous;
+}
+
+void
+GetScratchInfo(ScratchInfo *out)
+{
+    pthread_mutex_lock(&lock);
+    *out = info;
+    pthread_mutex_unlock(&lock);
+}
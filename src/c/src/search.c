@@ -43,3 +43,39 @@ BinarySearch(PyObject **a, PyObject *value, Py_ssize_t first, Py_ssize_t last)
         }
     }
 }
+
+Py_ssize_t
+BisectLeft(PyObject **a, PyObject *value, Py_ssize_t first, Py_ssize_t last)
+{
+    Py_ssize_t midpoint;
+    int status;
+
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        if ((status = LT(a[midpoint], value)) < 0) return -1;
+        if (status) {
+            first = midpoint + 1;
+        } else {
+            last = midpoint;
+        }
+    }
+    return first;
+}
+
+Py_ssize_t
+BisectRight(PyObject **a, PyObject *value, Py_ssize_t first, Py_ssize_t last)
+{
+    Py_ssize_t midpoint;
+    int status;
+
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        if ((status = LT(value, a[midpoint])) < 0) return -1;
+        if (status) {
+            last = midpoint;
+        } else {
+            first = midpoint + 1;
+        }
+    }
+    return first;
+}
@@ -2,6 +2,9 @@
 #include "selection.h"
 #include "utils.h"
 
+#include <stdint.h>
+#include <stdlib.h>
+
 // Simultaneously find the minimum and maximum of an array `a` of length `n`
 // using `(3/2)n + O(1)` comparisons by iterative over the sequence in pairs:
 // first the items in the pair are compared against each other, then the larger
@@ -60,3 +63,193 @@ MinMax(PyObject **a, Py_ssize_t n) {
 
     return PyTuple_Pack(2, min, max);
 }
+
+// Same pairwise algorithm as MinMax, for arrays of items of type `T`, tracking
+// the positions of the running minimum and maximum
+#define DEFINE_TYPED_MIN_MAX(T, suffix)                                        \
+    static void                                                                \
+    MinMax_##suffix(const T *a, Py_ssize_t n, Py_ssize_t *min,                 \
+                    Py_ssize_t *max)                                           \
+    {                                                                          \
+        Py_ssize_t i, lo, hi;                                                  \
+        if (n % 2) {                                                           \
+            lo = hi = 0;                                                       \
+            i = 1;                                                             \
+        } else {                                                               \
+            lo = a[1] < a[0];                                                  \
+            hi = 1 - lo;                                                       \
+            i = 2;                                                             \
+        }                                                                      \
+        for (; i < n; i += 2) {                                                \
+            Py_ssize_t x = i, y = i + 1;                                       \
+            if (!(a[x] < a[y])) {                                              \
+                x = i + 1;                                                     \
+                y = i;                                                         \
+            }                                                                  \
+            if (a[x] < a[lo]) lo = x;                                          \
+            if (a[y] > a[hi]) hi = y;                                          \
+        }                                                                      \
+        *min = lo;                                                             \
+        *max = hi;                                                             \
+    }
+
+DEFINE_TYPED_MIN_MAX(int8_t, int8)
+DEFINE_TYPED_MIN_MAX(int16_t, int16)
+DEFINE_TYPED_MIN_MAX(int32_t, int32)
+DEFINE_TYPED_MIN_MAX(int64_t, int64)
+DEFINE_TYPED_MIN_MAX(uint8_t, uint8)
+DEFINE_TYPED_MIN_MAX(uint16_t, uint16)
+DEFINE_TYPED_MIN_MAX(uint32_t, uint32)
+DEFINE_TYPED_MIN_MAX(uint64_t, uint64)
+DEFINE_TYPED_MIN_MAX(float, float)
+DEFINE_TYPED_MIN_MAX(double, double)
+
+void
+TypedMinMax(const void *a, ItemType type, const Py_ssize_t n, Py_ssize_t *min,
+            Py_ssize_t *max)
+{
+    switch (type) {
+        case ITEM_INT8: MinMax_int8(a, n, min, max); break;
+        case ITEM_INT16: MinMax_int16(a, n, min, max); break;
+        case ITEM_INT32: MinMax_int32(a, n, min, max); break;
+        case ITEM_INT64: MinMax_int64(a, n, min, max); break;
+        case ITEM_UINT8: MinMax_uint8(a, n, min, max); break;
+        case ITEM_UINT16: MinMax_uint16(a, n, min, max); break;
+        case ITEM_UINT32: MinMax_uint32(a, n, min, max); break;
+        case ITEM_UINT64: MinMax_uint64(a, n, min, max); break;
+        case ITEM_FLOAT: MinMax_float(a, n, min, max); break;
+        case ITEM_DOUBLE: MinMax_double(a, n, min, max); break;
+    }
+}
+
+// Capacity of the ring buffers of the monotonic deques of a window of `size`
+// items (at most the length of an array in memory): a power of two, so that
+// positions wrap around with a mask, holding every index of the window
+static Py_ssize_t
+DequeCapacity(Py_ssize_t size)
+{
+    Py_ssize_t capacity = 1;
+    while (capacity < size) capacity *= 2;
+    return capacity;
+}
+
+PyObject *
+RollingMinMax(PyObject **a, const Py_ssize_t n, const Py_ssize_t window)
+{
+    // The deques hold the indices of the items of the current window that are
+    // smaller (larger) than every later item, in increasing order of index, so
+    // their front items are the window's minimum (maximum). Their positions
+    // `[head,tail)` grow without bound and are wrapped with `mask`
+    const Py_ssize_t capacity = DequeCapacity(Py_MIN(window, n));
+    const Py_ssize_t mask = capacity - 1, size = Py_MAX(n - window + 1, 0);
+    Py_ssize_t *lows = NULL, *highs = NULL;
+    Py_ssize_t lo_head = 0, lo_tail = 0, hi_head = 0, hi_tail = 0;
+    PyObject *mins = NULL, *maxs = NULL, *result = NULL;
+    int status;
+
+    lows = PyMem_Malloc(capacity * sizeof(Py_ssize_t));
+    highs = PyMem_Malloc(capacity * sizeof(Py_ssize_t));
+    if (!lows || !highs) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    COUNT(allocations, 2);
+    if (!(mins = PyList_New(size)) || !(maxs = PyList_New(size))) goto done;
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        // Drop the items leaving the window
+        if (lo_head < lo_tail && lows[lo_head & mask] <= i - window) ++lo_head;
+        if (hi_head < hi_tail && highs[hi_head & mask] <= i - window)
+            ++hi_head;
+
+        // Drop the candidates that a[i] outlives and is at least as good as
+        while (lo_head < lo_tail) {
+            status = LT(a[lows[(lo_tail - 1) & mask]], a[i]);
+            if (status < 0) goto done;
+            if (status) break;
+            --lo_tail;
+        }
+        lows[lo_tail++ & mask] = i;
+        while (hi_head < hi_tail) {
+            status = LT(a[i], a[highs[(hi_tail - 1) & mask]]);
+            if (status < 0) goto done;
+            if (status) break;
+            --hi_tail;
+        }
+        highs[hi_tail++ & mask] = i;
+
+        if (i >= window - 1) {
+            PyObject *min = a[lows[lo_head & mask]];
+            PyObject *max = a[highs[hi_head & mask]];
+            Py_INCREF(min);
+            Py_INCREF(max);
+            PyList_SET_ITEM(mins, i - window + 1, min);
+            PyList_SET_ITEM(maxs, i - window + 1, max);
+        }
+    }
+    result = PyTuple_Pack(2, mins, maxs);
+
+done:
+    Py_XDECREF(mins);
+    Py_XDECREF(maxs);
+    PyMem_Free(lows);
+    PyMem_Free(highs);
+    return result;
+}
+
+// Same algorithm as RollingMinMax, for arrays of items of type `T`
+#define DEFINE_TYPED_ROLLING_MIN_MAX(T, suffix)                                \
+    static void                                                                \
+    RollingMinMax_##suffix(const T *a, Py_ssize_t n, Py_ssize_t window,        \
+                           Py_ssize_t mask, Py_ssize_t *lows,                  \
+                           Py_ssize_t *highs, T *mins, T *maxs)                \
+    {                                                                          \
+        Py_ssize_t lo_head = 0, lo_tail = 0, hi_head = 0, hi_tail = 0;         \
+        for (Py_ssize_t i = 0; i < n; ++i) {                                   \
+            const T x = a[i];                                                  \
+            if (lo_head < lo_tail && lows[lo_head & mask] <= i - window)       \
+                ++lo_head;                                                     \
+            if (hi_head < hi_tail && highs[hi_head & mask] <= i - window)      \
+                ++hi_head;                                                     \
+            while (lo_head < lo_tail && !(a[lows[(lo_tail - 1) & mask]] < x))  \
+                --lo_tail;                                                     \
+            lows[lo_tail++ & mask] = i;                                        \
+            while (hi_head < hi_tail && !(x < a[highs[(hi_tail - 1) & mask]])) \
+                --hi_tail;                                                     \
+            highs[hi_tail++ & mask] = i;                                       \
+            if (i >= window - 1) {                                             \
+                mins[i - window + 1] = a[lows[lo_head & mask]];                \
+                maxs[i - window + 1] = a[highs[hi_head & mask]];               \
+            }                                                                  \
+        }                                                                      \
+    }
+
+DEFINE_TYPED_ROLLING_MIN_MAX(int8_t, int8)
+DEFINE_TYPED_ROLLING_MIN_MAX(int16_t, int16)
+DEFINE_TYPED_ROLLING_MIN_MAX(int32_t, int32)
+DEFINE_TYPED_ROLLING_MIN_MAX(int64_t, int64)
+DEFINE_TYPED_ROLLING_MIN_MAX(uint8_t, uint8)
+DEFINE_TYPED_ROLLING_MIN_MAX(uint16_t, uint16)
+DEFINE_TYPED_ROLLING_MIN_MAX(uint32_t, uint32)
+DEFINE_TYPED_ROLLING_MIN_MAX(uint64_t, uint64)
+DEFINE_TYPED_ROLLING_MIN_MAX(float, float)
+DEFINE_TYPED_ROLLING_MIN_MAX(double, double)
+
+int
+TypedRollingMinMax(const void *a, ItemType type, const Py_ssize_t n,
+                   const Py_ssize_t window, void *mins, void *maxs)
+{
+    const Py_ssize_t capacity = DequeCapacity(Py_MIN(window, n));
+    Py_ssize_t *lows = malloc(capacity * sizeof(Py_ssize_t));
+    Py_ssize_t *highs = malloc(capacity * sizeof(Py_ssize_t));
+    int status = 0;
+
+    if (lows && highs) {
+        DISPATCH_VOID(type, RollingMinMax, a, n, window, capacity - 1, lows,
+                      highs, mins, maxs);
+        status = 1;
+    }
+    free(lows);
+    free(highs);
+    return status;
+}
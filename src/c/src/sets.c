@@ -0,0 +1,304 @@
+#include "debug.h"
+#include "search.h"
+#include "sets.h"
+#include "utils.h"
+
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Intersections and differences gallop through the longer array when it's at
+// least this many times longer than the shorter one. Galloping costs about
+// 2 log2(ratio) comparisons per item of the shorter array instead of (ratio + 1)
+// for a merge, but merging unboxed numbers is so cheap (and vectorized) that it
+// wins for longer
+#define GALLOP_RATIO 8
+#define TYPED_GALLOP_RATIO 32
+
+// Append `x` to `out[0,*k)` unless it's equal to the last item there, which
+// (since the items are appended in increasing order) removes duplicates.
+// Returns -1 if a comparison failed, and 0 otherwise
+static inline int
+Append(PyObject **out, Py_ssize_t *k, PyObject *x)
+{
+    int status;
+
+    if (*k && (status = LT(out[*k - 1], x)) <= 0) return status;
+    out[(*k)++] = x;
+    return 0;
+}
+
+// First index in `a[first,n)` whose item isn't less than `x` (or n), or -1 if a
+// comparison failed: probe the items at offsets 0, 2, 5, 10, ... (doubling
+// gaps) from `first` until one isn't less than `x`, then bisect the last gap
+static Py_ssize_t
+Gallop(PyObject **a, Py_ssize_t first, const Py_ssize_t n, PyObject *x)
+{
+    Py_ssize_t last = first, step = 1;
+    int status;
+
+    while (last < n) {
+        if ((status = LT(a[last], x)) < 0) return -1;
+        if (!status) break;
+        first = last + 1;
+        last = first + step;
+        step *= 2;
+    }
+    if (last > n) last = n;
+    return BisectLeft(a, x, first, last);
+}
+
+Py_ssize_t
+Unique(PyObject **a, const Py_ssize_t n, PyObject **out)
+{
+    Py_ssize_t k = 0;
+
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (Append(out, &k, a[i]) < 0) return -1;
+    }
+    return k;
+}
+
+Py_ssize_t
+Intersect(PyObject **a, const Py_ssize_t n, PyObject **b, const Py_ssize_t m,
+          PyObject **out)
+{
+    Py_ssize_t i = 0, j = 0, k = 0;
+    int status;
+
+    if (n > GALLOP_RATIO * m || m > GALLOP_RATIO * n) {
+        // Look up each item of the shorter array in the rest of the longer one
+        PyObject **s = (n < m) ? a : b, **l = (n < m) ? b : a;
+        const Py_ssize_t ns = Py_MIN(n, m), nl = Py_MAX(n, m);
+        for (; i < ns; ++i) {
+            if ((j = Gallop(l, j, nl, s[i])) < 0) return -1;
+            if (j == nl) break;
+            if ((status = LT(s[i], l[j])) < 0) return -1;
+            if (!status && Append(out, &k, s[i]) < 0) return -1;
+        }
+        return k;
+    }
+
+    while (i < n && j < m) {
+        if ((status = LT(a[i], b[j])) < 0) return -1;
+        if (status) {
+            ++i;
+        } else if ((status = LT(b[j], a[i])) < 0) {
+            return -1;
+        } else if (status) {
+            ++j;
+        } else {
+            if (Append(out, &k, a[i]) < 0) return -1;
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+Py_ssize_t
+Union(PyObject **a, const Py_ssize_t n, PyObject **b, const Py_ssize_t m,
+      PyObject **out)
+{
+    Py_ssize_t i = 0, j = 0, k = 0;
+    int status;
+
+    // Items of `b` equal to items of `a` are dropped by Append
+    while (i < n && j < m) {
+        if ((status = LT(b[j], a[i])) < 0) return -1;
+        if (Append(out, &k, status ? b[j++] : a[i++]) < 0) return -1;
+    }
+    for (; i < n; ++i) {
+        if (Append(out, &k, a[i]) < 0) return -1;
+    }
+    for (; j < m; ++j) {
+        if (Append(out, &k, b[j]) < 0) return -1;
+    }
+    return k;
+}
+
+Py_ssize_t
+Difference(PyObject **a, const Py_ssize_t n, PyObject **b, const Py_ssize_t m,
+           PyObject **out)
+{
+    Py_ssize_t i = 0, j = 0, k = 0;
+    int status;
+
+    if (m > GALLOP_RATIO * n) {
+        for (; i < n; ++i) {
+            if ((j = Gallop(b, j, m, a[i])) < 0) return -1;
+            status = 1;
+            if (j < m && (status = LT(a[i], b[j])) < 0) return -1;
+            if (status && Append(out, &k, a[i]) < 0) return -1;
+        }
+        return k;
+    }
+
+    while (i < n) {
+        status = 0;
+        if (j < m && (status = LT(b[j], a[i])) < 0) return -1;
+        if (status) {
+            ++j;
+            continue;
+        }
+        status = 1;
+        if (j < m && (status = LT(a[i], b[j])) < 0) return -1;
+        if (status && Append(out, &k, a[i]) < 0) return -1;
+        ++i;
+    }
+    return k;
+}
+
+#ifdef __SSE2__
+// Bit i of the result is set if the i-th of the four 32-bit lanes of `a` is
+// equal to any lane of `b`, comparing `a` with every rotation of `b`
+static inline int
+Match32(__m128i a, __m128i b)
+{
+    __m128i m = _mm_cmpeq_epi32(a, b);
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(
+        a, _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1))));
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(
+        a, _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2))));
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(
+        a, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3))));
+    return _mm_movemask_ps(_mm_castsi128_ps(m));
+}
+
+// Same as Match32 for two 64-bit lanes. SSE2 has no 64-bit comparison, so
+// lanes are equal if both of their 32-bit halves are
+static inline int
+Match64(__m128i a, __m128i b)
+{
+    __m128i same = _mm_cmpeq_epi32(a, b);
+    __m128i swapped = _mm_cmpeq_epi32(
+        a, _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)));
+    same = _mm_and_si128(same,
+                         _mm_shuffle_epi32(same, _MM_SHUFFLE(2, 3, 0, 1)));
+    swapped = _mm_and_si128(
+        swapped, _mm_shuffle_epi32(swapped, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_movemask_pd(_mm_castsi128_pd(_mm_or_si128(same, swapped)));
+}
+#endif
+
+// Typed counterpart of Append, for the instantiations of sets_impl.h
+#define APPEND(x)                                                              \
+    do {                                                                       \
+        const ITEM_T item_ = (x);                                              \
+        if (!k || out[k - 1] < item_) out[k++] = item_;                        \
+    } while (0)  // To force a semicolon
+
+// Instantiate the algorithms in sets_impl.h for every item type. Floating point
+// numbers are never intersected with SIMD, since they can be equal without
+// having the same bits (e.g., -0.0 and 0.0)
+
+#define ITEM_T int8_t
+#define NAME(name) name##_int8
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#define ITEM_T int16_t
+#define NAME(name) name##_int16
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#ifdef __SSE2__
+#define SIMD_LANES 4
+#define SIMD_MATCH Match32
+#endif
+#define ITEM_T int32_t
+#define NAME(name) name##_int32
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#define ITEM_T uint32_t
+#define NAME(name) name##_uint32
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef SIMD_LANES
+#undef SIMD_MATCH
+
+#ifdef __SSE2__
+#define SIMD_LANES 2
+#define SIMD_MATCH Match64
+#endif
+#define ITEM_T int64_t
+#define NAME(name) name##_int64
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#define ITEM_T uint64_t
+#define NAME(name) name##_uint64
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef SIMD_LANES
+#undef SIMD_MATCH
+
+#define ITEM_T uint8_t
+#define NAME(name) name##_uint8
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#define ITEM_T uint16_t
+#define NAME(name) name##_uint16
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#define ITEM_T float
+#define NAME(name) name##_float
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#define ITEM_T double
+#define NAME(name) name##_double
+#include "sets_impl.h"
+#undef ITEM_T
+#undef NAME
+
+#undef APPEND
+
+Py_ssize_t
+TypedUnique(const void *a, ItemType type, const Py_ssize_t n, void *out)
+{
+    Py_ssize_t k = 0;
+    DISPATCH(k, type, Unique, a, n, out);
+    return k;
+}
+
+Py_ssize_t
+TypedIntersect(const void *a, const Py_ssize_t n, const void *b,
+               const Py_ssize_t m, ItemType type, void *out)
+{
+    Py_ssize_t k = 0;
+    DISPATCH(k, type, Intersect, a, n, b, m, out);
+    return k;
+}
+
+Py_ssize_t
+TypedUnion(const void *a, const Py_ssize_t n, const void *b,
+           const Py_ssize_t m, ItemType type, void *out)
+{
+    Py_ssize_t k = 0;
+    DISPATCH(k, type, Union, a, n, b, m, out);
+    return k;
+}
+
+Py_ssize_t
+TypedDifference(const void *a, const Py_ssize_t n, const void *b,
+                const Py_ssize_t m, ItemType type, void *out)
+{
+    Py_ssize_t k = 0;
+    DISPATCH(k, type, Difference, a, n, b, m, out);
+    return k;
+}
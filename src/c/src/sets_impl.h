@@ -0,0 +1,139 @@
+// Set operations on sorted arrays of unboxed numbers, written once for every
+// item type: this file is included by sets.c once per type, with `ITEM_T`
+// defined as the C type of the items and `NAME(name)` defined to append a
+// suffix naming that type to `name`. For integer types, `SIMD_LANES` and
+// `SIMD_MATCH` may also be defined to intersect blocks of items with SIMD
+// instructions. The algorithms mirror their counterparts on Python objects in
+// sets.c, comparing items with the < operator instead of
+// PyObject_RichCompareBool
+
+// First index in `a[first,n)` whose item isn't less than `x` (or n): probe the
+// items at offsets 0, 2, 5, 10, ... (doubling gaps) from `first` until one
+// isn't less than `x`, then bisect the last gap
+static inline Py_ssize_t
+NAME(Gallop)(const ITEM_T *a, Py_ssize_t first, const Py_ssize_t n,
+             const ITEM_T x)
+{
+    Py_ssize_t last = first, step = 1, midpoint;
+
+    while (last < n && a[last] < x) {
+        first = last + 1;
+        last = first + step;
+        step *= 2;
+    }
+    if (last > n) last = n;
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        if (a[midpoint] < x) {
+            first = midpoint + 1;
+        } else {
+            last = midpoint;
+        }
+    }
+    return first;
+}
+
+static Py_ssize_t
+NAME(Unique)(const ITEM_T *a, const Py_ssize_t n, ITEM_T *out)
+{
+    Py_ssize_t k = 0;
+    for (Py_ssize_t i = 0; i < n; ++i)
+        APPEND(a[i]);
+    return k;
+}
+
+static Py_ssize_t
+NAME(Intersect)(const ITEM_T *a, const Py_ssize_t n, const ITEM_T *b,
+                const Py_ssize_t m, ITEM_T *out)
+{
+    Py_ssize_t i = 0, j = 0, k = 0;
+
+    if (n > TYPED_GALLOP_RATIO * m || m > TYPED_GALLOP_RATIO * n) {
+        // Look up each item of the shorter array in the rest of the longer one
+        const ITEM_T *s = (n < m) ? a : b, *l = (n < m) ? b : a;
+        const Py_ssize_t ns = Py_MIN(n, m), nl = Py_MAX(n, m);
+        for (; i < ns; ++i) {
+            if ((j = NAME(Gallop)(l, j, nl, s[i])) == nl) break;
+            if (!(s[i] < l[j])) APPEND(s[i]);
+        }
+        return k;
+    }
+
+#ifdef SIMD_MATCH
+    // Compare blocks of SIMD_LANES items of each array, every pair at once,
+    // then move on from the block (or both) with the smaller last item
+    while (i + SIMD_LANES <= n && j + SIMD_LANES <= m) {
+        const ITEM_T a_last = a[i + SIMD_LANES - 1];
+        const ITEM_T b_last = b[j + SIMD_LANES - 1];
+        const int mask = SIMD_MATCH(
+            _mm_loadu_si128((const __m128i *) (a + i)),
+            _mm_loadu_si128((const __m128i *) (b + j)));
+        for (int lane = 0; mask >> lane; ++lane) {
+            if (mask >> lane & 1) APPEND(a[i + lane]);
+        }
+        if (!(b_last < a_last)) i += SIMD_LANES;
+        if (!(a_last < b_last)) j += SIMD_LANES;
+    }
+#endif
+
+    while (i < n && j < m) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            APPEND(a[i]);
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+static Py_ssize_t
+NAME(Union)(const ITEM_T *a, const Py_ssize_t n, const ITEM_T *b,
+            const Py_ssize_t m, ITEM_T *out)
+{
+    Py_ssize_t i = 0, j = 0, k = 0;
+
+    // Items of `b` equal to items of `a` are dropped by APPEND
+    while (i < n && j < m) {
+        if (b[j] < a[i]) {
+            APPEND(b[j]);
+            ++j;
+        } else {
+            APPEND(a[i]);
+            ++i;
+        }
+    }
+    for (; i < n; ++i) APPEND(a[i]);
+    for (; j < m; ++j) APPEND(b[j]);
+    return k;
+}
+
+static Py_ssize_t
+NAME(Difference)(const ITEM_T *a, const Py_ssize_t n, const ITEM_T *b,
+                 const Py_ssize_t m, ITEM_T *out)
+{
+    Py_ssize_t i = 0, j = 0, k = 0;
+
+    if (m > TYPED_GALLOP_RATIO * n) {
+        for (; i < n; ++i) {
+            j = NAME(Gallop)(b, j, m, a[i]);
+            if (j == m || a[i] < b[j]) APPEND(a[i]);
+        }
+        return k;
+    }
+
+    while (i < n) {
+        if (j < m && b[j] < a[i]) {
+            ++j;
+        } else if (j < m && !(a[i] < b[j])) {
+            ++i;
+        } else {
+            APPEND(a[i]);
+            ++i;
+        }
+    }
+    return k;
+}
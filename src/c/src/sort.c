@@ -1,6 +1,8 @@
 #include "debug.h"
 #include "heap.h"
 #include "partition.h"
+#include "rng.h"
+#include "scratch.h"
 #include "search.h"
 #include "sort.h"
 #include "utils.h"
@@ -50,6 +52,7 @@ BinaryInsertionSort(PyObject **a, const Py_ssize_t first,
         }
         if (k < i) {
             Py_ssize_t j = i - 1;
+            COUNT(moves, i - k + 1);
             a[i] = a[j];
             for (; k < j; --j)
                 a[j] = a[j - 1];
@@ -84,7 +87,7 @@ HeapSort(PyObject **a, const Py_ssize_t first, const Py_ssize_t last)
 
 // Merge sort
 // Time complexity: O(n*log(n)) worst case
-// Space complexity: O(n)
+// Space complexity: O(n/2)
 // Paradigm: divide-and-conquer
 
 static int MSort(PyObject **, PyObject **, Py_ssize_t, Py_ssize_t);
@@ -97,11 +100,13 @@ MergeSort(PyObject **a, const Py_ssize_t first, const Py_ssize_t last)
     if (first < last) {
         size_t n = (size_t) (last - first);
         // We're not creating any new Python objects, so using the C allocator
-        // should be safe
-        PyObject **buf = malloc(n * sizeof(PyObject *));
+        // should be safe. Merges only copy the shorter run, which is at most
+        // half of the array
+        PyObject **buf = AcquireScratch((n + 1) / 2 * sizeof(PyObject *));
         if (buf) {
+            COUNT(allocations, 1);
             status = MSort(a, buf, first, last);
-            free(buf);
+            ReturnScratch(buf);
             return status;
         } else {
             PyErr_NoMemory();
@@ -116,17 +121,21 @@ MergeSort(PyObject **a, const Py_ssize_t first, const Py_ssize_t last)
 static int
 MSort(PyObject **a, PyObject **buf, Py_ssize_t first, Py_ssize_t last)
 {
+    int status = 1;
+    COUNT_ENTER();
     if (first < last - 1) {
         Py_ssize_t mid = first + (last - first) / 2;
-        if (!MSort(a, buf, first, mid)) return 0;
-        if (!MSort(a, buf, mid, last)) return 0;
-        if (!Merge(a, buf, first, mid, last)) return 0;
+        status = MSort(a, buf, first, mid) && MSort(a, buf, mid, last)
+                 && Merge(a, buf, first, mid, last);
     }
-    return 1;
+    COUNT_LEAVE();
+    return status;
 }
 
 // Combine the sorted arrays `a[first,mid)` and `a[mid,last)` into a sorted
-// array `a[first,last)`, using `b` to store a copy of these values
+// array `a[first,last)`, using `b` to store a copy of the shorter of the two.
+// If a comparison fails, the items that weren't merged yet are put back, so
+// that `a[first,last)` is still a permutation of its original items
 static int
 Merge(PyObject **a, PyObject **b, Py_ssize_t first, Py_ssize_t mid,
        Py_ssize_t last)
@@ -136,44 +145,184 @@ Merge(PyObject **a, PyObject **b, Py_ssize_t first, Py_ssize_t mid,
     Py_ssize_t n = last - mid;
     int compare;
 
-    // `b` will store `a[first,mid)`, and `c` will store `a[mid,last)`
-    PyObject **c = b + m;
-    memcpy(b, a + first, (last - first) * sizeof(PyObject *));
-
-    for (i = 0, j = 0, k = first; (i < m) && (j < n); ++k) {
-        if ((compare = LE(b[i], c[j]))) {
-            if (compare < 0) return 0;
-            a[k] = b[i++];
-        } else {
-            a[k] = c[j++];
+    if (m <= n) {
+        // Merge from the front, with `b` storing `a[first,mid)`. The merged
+        // items never overwrite the unmerged ones in `a[mid,last)`
+        memcpy(b, a + first, m * sizeof(PyObject *));
+        for (i = 0, j = mid, k = first; (i < m) && (j < last); ++k) {
+            if ((compare = LE(b[i], a[j]))) {
+                if (compare < 0) {
+                    memcpy(a + k, b + i, (m - i) * sizeof(PyObject *));
+                    return 0;
+                }
+                a[k] = b[i++];
+            } else {
+                a[k] = a[j++];
+            }
         }
+        while (i < m) a[k++] = b[i++];
+        COUNT(moves, m + (k - first));
+    } else {
+        // Merge from the back, with `b` storing `a[mid,last)`. Ties go to the
+        // right run, which keeps the merge stable
+        memcpy(b, a + mid, n * sizeof(PyObject *));
+        for (i = mid - 1, j = n - 1, k = last - 1; (i >= first) && (j >= 0);
+                --k) {
+            if ((compare = LE(a[i], b[j]))) {
+                if (compare < 0) {
+                    memcpy(a + i + 1, b, (j + 1) * sizeof(PyObject *));
+                    return 0;
+                }
+                a[k] = b[j--];
+            } else {
+                a[k] = a[i--];
+            }
+        }
+        while (j >= 0) a[k--] = b[j--];
+        COUNT(moves, n + (last - 1 - k));
     }
-
-    while (i < m) a[k++] = b[i++];
     return 1;
 }
 
 // Quick sorts
 
+// Pivots are the first items of the subarrays, or random items drawn from the
+// generator with the state `*rng` if `rng` isn't NULL
 static inline int
-QSort(PyObject **a, Py_ssize_t first, Py_ssize_t last,
-       Py_ssize_t (*partition)(PyObject **, Py_ssize_t, Py_ssize_t))
+QSort(PyObject **a, Py_ssize_t first, Py_ssize_t last, uint64_t *rng)
 {
+    int status = 1;
+    COUNT_ENTER();
     if (first < last) {
-        Py_ssize_t pivot_idx = (*partition)(a, first, last);
+        Py_ssize_t pivot_idx = rng ? PartitionRandom(a, first, last, rng)
+                                   : Partition(a, first, last);
         // Partitioning can fail if the elements aren't comparable
-        if (PyErr_Occurred()) return 0;
-        if (!QSort(a, first, pivot_idx, partition)) return 0;
-        if (!QSort(a, pivot_idx + 1, last, partition)) return 0;
+        status = !PyErr_Occurred()
+                 && QSort(a, first, pivot_idx, rng)
+                 && QSort(a, pivot_idx + 1, last, rng);
     }
-    return 1;
+    COUNT_LEAVE();
+    return status;
 }
 
 int QuickSort(PyObject **a, Py_ssize_t first, Py_ssize_t last) {
-    return QSort(a, first, last, &Partition);
+    return QSort(a, first, last, NULL);
 }
 
 int QuickSortRandom(PyObject **a, Py_ssize_t first, Py_ssize_t last) {
-    return QSort(a, first, last, &PartitionRandom);
+    return QSort(a, first, last, ThreadRandomState());
+}
+
+// Three-way quick sort
+// Time complexity: O(n*log(n)) expected, O(n*k) expected with k distinct items
+// Space complexity: O(log(n))
+
+static int
+QSort3Way(PyObject **a, Py_ssize_t first, Py_ssize_t last, uint64_t *rng)
+{
+    Py_ssize_t lt, gt;
+    int status = 1;
+    COUNT_ENTER();
+    // Items equal to the pivot are left out of both sides. Recursing into the
+    // smaller side and looping over the larger one bounds the stack depth
+    while (status && last - first > 1) {
+        if (!(status = Partition3Way(a, first, last, &lt, &gt, rng))) break;
+        if (lt - first < last - gt) {
+            status = QSort3Way(a, first, lt, rng);
+            first = gt;
+        } else {
+            status = QSort3Way(a, gt, last, rng);
+            last = lt;
+        }
+    }
+    COUNT_LEAVE();
+    return status;
+}
+
+int
+QuickSort3Way(PyObject **a, Py_ssize_t first, Py_ssize_t last)
+{
+    return QSort3Way(a, first, last, ThreadRandomState());
 }
 
+// Adaptive (natural) merge sort
+// Time complexity: O(n*log(r)) worst case for an array made of r sorted runs
+// Space complexity: O(n)
+
+// Runs shorter than this are extended by binary insertion sort before merging
+#define MIN_RUN 32
+
+// End of the run starting at `a[first]`: the longest non-decreasing or strictly
+// decreasing sequence, which is reversed. Decreasing runs must be strict to
+// keep the sort stable. Returns -1 if a comparison failed
+static Py_ssize_t
+FindRun(PyObject **a, Py_ssize_t first, Py_ssize_t last)
+{
+    Py_ssize_t i = first + 1, j;
+    int descending, compare;
+
+    if (i == last) return last;
+    if ((descending = LT(a[i], a[first])) < 0) return -1;
+    for (++i; i < last; ++i) {
+        if ((compare = LT(a[i], a[i - 1])) < 0) return -1;
+        if (compare != descending) break;
+    }
+    if (descending) {
+        for (j = i - 1; first < j; ++first, --j) SWAP(a[first], a[j]);
+    }
+    return i;
+}
+
+int
+AdaptiveMergeSort(PyObject **a, const Py_ssize_t first, const Py_ssize_t last)
+{
+    Py_ssize_t n = last - first;
+    size_t half = (size_t) (n + 1) / 2;
+    Py_ssize_t *runs;
+    PyObject **buf;
+    Py_ssize_t num_runs = 0, i, end, r, k;
+    int status = 0, compare;
+
+    if (n < 2) return 1;
+
+    // Merges need room for half of the items, and every run but the last has
+    // at least MIN_RUN items
+    buf = AcquireScratch(half * sizeof(PyObject *)
+                         + (size_t) (n / MIN_RUN + 2) * sizeof(Py_ssize_t));
+    if (!buf) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    runs = (Py_ssize_t *) (buf + half);
+    COUNT(allocations, 1);
+
+    for (i = first; i < last; i = end) {
+        runs[num_runs++] = i;
+        if ((end = FindRun(a, i, last)) < 0) goto done;
+        if (end - i < MIN_RUN && end < last) {
+            end = Py_MIN(last, i + MIN_RUN);
+            if (!BinaryInsertionSort(a, i, end)) goto done;
+        }
+    }
+    runs[num_runs] = last;
+
+    // Merge adjacent pairs of runs until there's only one, skipping pairs that
+    // are already in order
+    while (num_runs > 1) {
+        for (r = 0, k = 0; r + 1 < num_runs; r += 2, ++k) {
+            if ((compare = LE(a[runs[r + 1] - 1], a[runs[r + 1]])) < 0)
+                goto done;
+            if (!compare && !Merge(a, buf, runs[r], runs[r + 1], runs[r + 2]))
+                goto done;
+            runs[k] = runs[r];
+        }
+        if (r < num_runs) runs[k++] = runs[r];
+        runs[k] = last;
+        num_runs = k;
+    }
+    status = 1;
+
+done:
+    ReturnScratch(buf);
+    return status;
+}
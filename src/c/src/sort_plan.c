@@ -0,0 +1,268 @@
+#include "debug.h"
+#include "parallel.h"
+#include "radix.h"
+#include "scratch.h"
+#include "sort.h"
+#include "sort_plan.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Inputs up to this size are sorted by binary insertion sort
+#define SMALL_SORT 16
+
+// Adjacent pairs compared to estimate how sorted a list is, and items sampled
+// to estimate how many duplicates it has
+#define PROBE_PAIRS 32
+#define PROBE_ITEMS 32
+
+// Typed arrays at least this long are sorted by several threads, since sorting
+// shorter ones takes about as long as starting the threads
+#define PARALLEL_SORT ((Py_ssize_t) 1 << 18)
+
+static const char *const algorithm_names[] = {
+    "none",
+    "reverse",
+    "binary_insertion_sort",
+    "adaptive_merge_sort",
+    "quick_sort_3way",
+    "radix_sort",
+    "parallel_radix_sort",
+};
+
+// Names of item types, indexed by ItemType
+static const char *const item_type_names[] = {
+    "int8", "int16", "int32", "int64",
+    "uint8", "uint16", "uint32", "uint64",
+    "float", "double",
+};
+
+// Item of a list of ints or floats being radix sorted, with the radix key of
+// the number
+typedef struct {
+    uint64_t key;
+    PyObject *value;
+} KeyedItem;
+
+#define ITEM_T KeyedItem
+#define NAME(name) name##_keyed
+#define RADIX_KEY(x) ((x).key)
+#define RADIX_BYTES 8
+#include "radix_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+// Store the radix keys of `a[first,last)` in `keys` if the items are all ints
+// that fit in 64 bits or all floats. Returns the kind of items ("int" or
+// "float"), or NULL if they can't be radix sorted. `keys` may be NULL, to only
+// check the items
+static const char *
+GetKeys(PyObject **a, const Py_ssize_t first, const Py_ssize_t last,
+        KeyedItem *keys)
+{
+    PyTypeObject *type = Py_TYPE(a[first]);
+    long long value;
+    int overflow;
+
+    if (type == &PyFloat_Type) {
+        for (Py_ssize_t i = first; i < last; ++i) {
+            if (Py_TYPE(a[i]) != type) return NULL;
+            if (keys) {
+                keys[i - first].key = DoubleKey(PyFloat_AS_DOUBLE(a[i]));
+                keys[i - first].value = a[i];
+            }
+        }
+        return "float";
+    }
+    if (type == &PyLong_Type) {
+        for (Py_ssize_t i = first; i < last; ++i) {
+            if (Py_TYPE(a[i]) != type) return NULL;
+            value = PyLong_AsLongLongAndOverflow(a[i], &overflow);
+            if (overflow) return NULL;
+            if (keys) {
+                keys[i - first].key = Int64Key((int64_t) value);
+                keys[i - first].value = a[i];
+            }
+        }
+        return "int";
+    }
+    return NULL;
+}
+
+int
+PlanSort(PyObject **a, const Py_ssize_t first, const Py_ssize_t last,
+         int stable, SortPlan *plan)
+{
+    PyObject *sample[PROBE_ITEMS];
+    Py_ssize_t n = last - first, step, k;
+    const char *items;
+    int compare, status = 0;
+
+    memset(plan, 0, sizeof(*plan));
+    plan->items = "object";
+    plan->size = n;
+    plan->threads = 1;
+
+    if (n <= SMALL_SORT) {
+        plan->algorithm = SORT_BINARY_INSERTION;
+        return 1;
+    }
+
+    // Numbers are sorted by their values without any comparisons
+    if ((items = GetKeys(a, first, last, NULL))) {
+        plan->items = items;
+        plan->algorithm = SORT_RADIX;
+        return 1;
+    }
+
+    // Count descents among evenly spaced adjacent pairs. Mostly ascending or
+    // descending lists are made of long runs, which merge sort takes advantage
+    // of, and merge sort makes the fewest comparisons in general
+    plan->pairs = Py_MIN(n - 1, PROBE_PAIRS);
+    step = (n - 1) / plan->pairs;
+    for (k = 0; k < plan->pairs; ++k) {
+        Py_ssize_t i = first + k * step;
+        if ((compare = LT(a[i + 1], a[i])) < 0) return 0;
+        plan->descents += compare;
+    }
+    plan->algorithm = SORT_ADAPTIVE_MERGE;
+    if (stable || 8 * plan->descents <= plan->pairs
+            || 8 * plan->descents >= 7 * plan->pairs)
+        return 1;
+
+    // Count the distinct items of a sorted sample. If at least half of them are
+    // duplicates, three-way partitioning sets aside many items at a time. The
+    // sample holds references in case comparisons change the list
+    plan->sampled = Py_MIN(n, PROBE_ITEMS);
+    step = n / plan->sampled;
+    for (k = 0; k < plan->sampled; ++k) {
+        sample[k] = a[first + k * step];
+        Py_INCREF(sample[k]);
+    }
+    if (!BinaryInsertionSort(sample, 0, plan->sampled)) goto done;
+    plan->distinct = 1;
+    for (k = 1; k < plan->sampled; ++k) {
+        if ((compare = LT(sample[k - 1], sample[k])) < 0) goto done;
+        plan->distinct += compare;
+    }
+    if (2 * plan->distinct <= plan->sampled) plan->algorithm = SORT_QUICK_3WAY;
+    status = 1;
+
+done:
+    for (k = 0; k < plan->sampled; ++k) Py_DECREF(sample[k]);
+    return status;
+}
+
+// Radix sort a list of numbers, or return -1 if the items changed since
+// planning and aren't all ints or all floats any more
+static int
+KeyedRadixSort(PyObject **a, const Py_ssize_t first, const Py_ssize_t last)
+{
+    Py_ssize_t n = last - first;
+    KeyedItem *keys = AcquireScratch(2 * (size_t) n * sizeof(KeyedItem));
+
+    if (!keys) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    COUNT(allocations, 1);
+    if (!GetKeys(a, first, last, keys)) {
+        ReturnScratch(keys);
+        return -1;
+    }
+    RadixSort_keyed(keys, keys + n, n);
+    for (Py_ssize_t i = 0; i < n; ++i) a[first + i] = keys[i].value;
+    COUNT(moves, n);
+    ReturnScratch(keys);
+    return 1;
+}
+
+int
+RunSortPlan(PyObject **a, const Py_ssize_t first, const Py_ssize_t last,
+            const SortPlan *plan)
+{
+    int status;
+
+    switch (plan->algorithm) {
+        case SORT_BINARY_INSERTION:
+            return BinaryInsertionSort(a, first, last);
+        case SORT_QUICK_3WAY:
+            return QuickSort3Way(a, first, last);
+        case SORT_RADIX:
+            if ((status = KeyedRadixSort(a, first, last)) >= 0) return status;
+            break;
+        default:
+            break;
+    }
+    return AdaptiveMergeSort(a, first, last);
+}
+
+void
+PlanTypedSort(const void *a, ItemType type, const Py_ssize_t first,
+              const Py_ssize_t last, int threads, SortPlan *plan)
+{
+    Py_ssize_t n = last - first;
+
+    memset(plan, 0, sizeof(*plan));
+    plan->items = item_type_names[type];
+    plan->size = n;
+    plan->threads = 1;
+
+    if (n <= SMALL_SORT) {
+        plan->algorithm = SORT_BINARY_INSERTION;
+        return;
+    }
+
+    // Counting every descent is much cheaper than sorting, and finds inputs
+    // that are already sorted or only need reversing
+    plan->pairs = n - 1;
+    plan->descents = TypedCountDescents(a, type, first, last);
+    if (plan->descents == 0) {
+        plan->algorithm = SORT_NONE;
+    } else if (plan->descents == n - 1) {
+        plan->algorithm = SORT_REVERSE;
+    } else if (n >= PARALLEL_SORT && (threads = NumThreads(threads)) > 1) {
+        plan->algorithm = SORT_PARALLEL_RADIX;
+        plan->threads = threads;
+    } else {
+        plan->algorithm = SORT_RADIX;
+    }
+}
+
+int
+RunTypedSortPlan(void *a, ItemType type, const Py_ssize_t first,
+                 const Py_ssize_t last, const SortPlan *plan)
+{
+    switch (plan->algorithm) {
+        case SORT_NONE:
+            return 1;
+        case SORT_REVERSE:
+            TypedReverse(a, type, first, last);
+            return 1;
+        case SORT_BINARY_INSERTION:
+            return TypedBinaryInsertionSort(a, type, first, last);
+        case SORT_PARALLEL_RADIX:
+            return TypedParallelSort(a, type, first, last, plan->threads);
+        default:
+            return TypedRadixSort(a, type, first, last);
+    }
+}
+
+PyObject *
+SortPlanToDict(const SortPlan *plan)
+{
+    return Py_BuildValue("{sssssnsnsnsnsnsOsi}",
+                         "algorithm", algorithm_names[plan->algorithm],
+                         "items", plan->items,
+                         "size", plan->size,
+                         "pairs", plan->pairs,
+                         "descents", plan->descents,
+                         "sampled", plan->sampled,
+                         "distinct", plan->distinct,
+                         "stable", plan->algorithm == SORT_QUICK_3WAY
+                                   ? Py_False : Py_True,
+                         "threads", plan->threads);
+}
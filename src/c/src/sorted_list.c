@@ -0,0 +1,581 @@
+#include "debug.h"
+#include "radix.h"
+#include "search.h"
+#include "sort_plan.h"
+#include "sorted_list.h"
+#include "utils.h"
+
+#include <string.h>
+
+// Chunks built from sorted batches are half full, so that items can be added
+// to them for a while before they have to be split
+#define HALF_CHUNK (SORTED_LIST_CHUNK / 2)
+
+// Chunks left with fewer items than this by a removal are merged with (or
+// take items from) a neighbor, so that there are O(n / SORTED_LIST_CHUNK)
+// chunks however the items were removed
+#define MIN_CHUNK (SORTED_LIST_CHUNK / 4)
+
+// Batches at least this fraction of the size of the list are merged with it
+#define MERGE_FRACTION 4
+
+// Kind of an item, and its radix key if it's an int or a float
+static KeyKind
+GetKey(PyObject *item, uint64_t *key)
+{
+    long long value;
+    int overflow;
+
+    if (PyFloat_CheckExact(item)) {
+        *key = DoubleKey(PyFloat_AS_DOUBLE(item));
+        return KEYS_FLOAT;
+    }
+    if (PyLong_CheckExact(item)) {
+        value = PyLong_AsLongLongAndOverflow(item, &overflow);
+        if (!overflow) {
+            *key = Int64Key((int64_t) value);
+            return KEYS_INT;
+        }
+    }
+    *key = 0;
+    return KEYS_OBJECT;
+}
+
+// Kind of a list with items of two kinds
+static KeyKind
+CombineKinds(KeyKind a, KeyKind b)
+{
+    if (a == KEYS_NONE || a == b) return b;
+    if (b == KEYS_NONE) return a;
+    return KEYS_OBJECT;
+}
+
+static int
+Modifiable(const SortedList *list)
+{
+    if (!list->busy) return 1;
+    PyErr_SetString(PyExc_RuntimeError,
+                    "SortedList can't be modified while comparing items");
+    return 0;
+}
+
+// Positional index
+
+// Recompute the Fenwick tree of chunk sizes after chunks were added, removed,
+// or resized
+static void
+BuildIndex(SortedList *list)
+{
+    Py_ssize_t i, parent, n = list->num_chunks;
+
+    for (i = 1; i <= n; ++i) list->index[i] = list->chunks[i - 1]->size;
+    for (i = 1; i <= n; ++i) {
+        parent = i + (i & -i);
+        if (parent <= n) list->index[parent] += list->index[i];
+    }
+}
+
+// Add `delta` to the size of chunk `j` in the Fenwick tree
+static void
+UpdateIndex(SortedList *list, Py_ssize_t j, Py_ssize_t delta)
+{
+    for (Py_ssize_t i = j + 1; i <= list->num_chunks; i += i & -i)
+        list->index[i] += delta;
+}
+
+// Number of items in the chunks before chunk `j`
+static Py_ssize_t
+Prefix(const SortedList *list, Py_ssize_t j)
+{
+    Py_ssize_t sum = 0;
+    for (Py_ssize_t i = j; i > 0; i -= i & -i) sum += list->index[i];
+    return sum;
+}
+
+void
+SortedListLocate(const SortedList *list, Py_ssize_t position,
+                 Py_ssize_t *chunk, Py_ssize_t *offset)
+{
+    Py_ssize_t i = 0, step = 1;
+
+    // Descend the Fenwick tree to the most chunks whose total size is at most
+    // `position`, which are the chunks before the one holding it
+    while (2 * step <= list->num_chunks) step *= 2;
+    for (; step > 0; step /= 2) {
+        if (i + step <= list->num_chunks && list->index[i + step] <= position) {
+            i += step;
+            position -= list->index[i];
+        }
+    }
+    *chunk = i;
+    *offset = position;
+}
+
+PyObject *
+SortedListGet(const SortedList *list, Py_ssize_t position)
+{
+    Py_ssize_t j, k;
+    SortedListLocate(list, position, &j, &k);
+    return list->chunks[j]->items[k];
+}
+
+// Chunk management
+
+// Make room for at least `n` chunks
+static int
+Reserve(SortedList *list, Py_ssize_t n)
+{
+    size_t allocated;
+    Chunk **chunks;
+    Py_ssize_t *index;
+
+    if (n <= list->allocated) return 1;
+    allocated = (size_t) (n + n / 2 + 4);
+    if (!(chunks = PyMem_Realloc(list->chunks, allocated * sizeof(*chunks)))) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    list->chunks = chunks;
+    if (!(index = PyMem_Realloc(list->index,
+                                (allocated + 1) * sizeof(*index)))) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    list->index = index;
+    list->allocated = (Py_ssize_t) allocated;
+    return 1;
+}
+
+// Insert a chunk before chunk `j`, which must have been reserved room for
+static void
+InsertChunk(SortedList *list, Py_ssize_t j, Chunk *chunk)
+{
+    memmove(list->chunks + j + 1, list->chunks + j,
+            (size_t) (list->num_chunks - j) * sizeof(Chunk *));
+    list->chunks[j] = chunk;
+    ++list->num_chunks;
+}
+
+// Remove and free chunk `j`
+static void
+DeleteChunk(SortedList *list, Py_ssize_t j)
+{
+    PyMem_Free(list->chunks[j]);
+    --list->num_chunks;
+    memmove(list->chunks + j, list->chunks + j + 1,
+            (size_t) (list->num_chunks - j) * sizeof(Chunk *));
+}
+
+// Move `n` items from the front of chunk `j + 1` to the back of chunk `j`, or
+// from the back of chunk `j` to the front of chunk `j + 1` if `n` is negative
+static void
+ShiftItems(SortedList *list, Py_ssize_t j, Py_ssize_t n)
+{
+    Chunk *left = list->chunks[j], *right = list->chunks[j + 1];
+
+    if (n > 0) {
+        memcpy(left->items + left->size, right->items,
+               (size_t) n * sizeof(PyObject *));
+        memcpy(left->keys + left->size, right->keys,
+               (size_t) n * sizeof(uint64_t));
+        memmove(right->items, right->items + n,
+                (size_t) (right->size - n) * sizeof(PyObject *));
+        memmove(right->keys, right->keys + n,
+                (size_t) (right->size - n) * sizeof(uint64_t));
+    } else {
+        n = -n;
+        memmove(right->items + n, right->items,
+                (size_t) right->size * sizeof(PyObject *));
+        memmove(right->keys + n, right->keys,
+                (size_t) right->size * sizeof(uint64_t));
+        memcpy(right->items, left->items + left->size - n,
+               (size_t) n * sizeof(PyObject *));
+        memcpy(right->keys, left->keys + left->size - n,
+               (size_t) n * sizeof(uint64_t));
+        n = -n;
+    }
+    left->size += n;
+    right->size -= n;
+}
+
+// Merge chunks `j` and `j + 1` if their items fit in one chunk, and otherwise
+// split their items evenly between them
+static void
+Rebalance(SortedList *list, Py_ssize_t j)
+{
+    Chunk *left = list->chunks[j], *right = list->chunks[j + 1];
+    Py_ssize_t total = left->size + right->size;
+
+    if (total <= SORTED_LIST_CHUNK) {
+        ShiftItems(list, j, right->size);
+        DeleteChunk(list, j + 1);
+    } else {
+        ShiftItems(list, j, total / 2 - left->size);
+    }
+}
+
+// Searching
+
+// Bisection of the keys `keys[0,n)`, like BisectLeft or BisectRight
+static Py_ssize_t
+BisectKeys(const uint64_t *keys, uint64_t key, Py_ssize_t n, int right)
+{
+    Py_ssize_t first = 0, last = n, midpoint;
+
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        if (right ? key < keys[midpoint] : key <= keys[midpoint]) {
+            last = midpoint;
+        } else {
+            first = midpoint + 1;
+        }
+    }
+    return first;
+}
+
+// Like FindChunk below, but comparing keys
+static Py_ssize_t
+FindChunkByKey(const SortedList *list, uint64_t key, int right)
+{
+    Py_ssize_t first = 0, last = list->num_chunks, midpoint;
+    uint64_t max;
+
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        max = list->chunks[midpoint]->keys[list->chunks[midpoint]->size - 1];
+        if (right ? key < max : key <= max) {
+            last = midpoint;
+        } else {
+            first = midpoint + 1;
+        }
+    }
+    return first;
+}
+
+// Index of the first chunk whose last item is greater than or equal to (or if
+// `right` is nonzero, greater than) `item`, the number of chunks if there's
+// none, or -1 if a comparison failed
+static Py_ssize_t
+FindChunk(const SortedList *list, PyObject *item, int right)
+{
+    Py_ssize_t first = 0, last = list->num_chunks, midpoint;
+    Chunk *chunk;
+    int status;
+
+    while (first < last) {
+        midpoint = first + (last - first) / 2;
+        chunk = list->chunks[midpoint];
+        if (right) {
+            status = LT(item, chunk->items[chunk->size - 1]);
+        } else if ((status = LT(chunk->items[chunk->size - 1], item)) >= 0) {
+            status = !status;
+        }
+        if (status < 0) return -1;
+        if (status) {
+            last = midpoint;
+        } else {
+            first = midpoint + 1;
+        }
+    }
+    return first;
+}
+
+// Find the chunk and offset of the first item greater than or equal to (or if
+// `right` is nonzero, greater than) `item`. If there's none, the chunk is the
+// number of chunks. Items are compared by key if `item` has the same kind as
+// the items of the list, and by < otherwise
+static int
+Search(SortedList *list, PyObject *item, int right, Py_ssize_t *chunk,
+       Py_ssize_t *offset)
+{
+    Py_ssize_t j, k = 0;
+    uint64_t key;
+    Chunk *last;
+
+    if (list->kind != KEYS_OBJECT && GetKey(item, &key) == list->kind) {
+        j = FindChunkByKey(list, key, right);
+        if (j < list->num_chunks) {
+            last = list->chunks[j];
+            k = BisectKeys(last->keys, key, last->size, right);
+        }
+    } else {
+        ++list->busy;
+        j = FindChunk(list, item, right);
+        if (j >= 0 && j < list->num_chunks) {
+            last = list->chunks[j];
+            k = right ? BisectRight(last->items, item, 0, last->size)
+                      : BisectLeft(last->items, item, 0, last->size);
+        }
+        --list->busy;
+        if (j < 0 || k < 0) return 0;
+    }
+    *chunk = j;
+    *offset = k;
+    return 1;
+}
+
+Py_ssize_t
+SortedListBisect(SortedList *list, PyObject *item, int right)
+{
+    Py_ssize_t j, k;
+    if (!Search(list, item, right, &j, &k)) return -1;
+    return Prefix(list, j) + k;
+}
+
+Py_ssize_t
+SortedListFind(SortedList *list, PyObject *item)
+{
+    Py_ssize_t j, k;
+    uint64_t key;
+    Chunk *chunk;
+    int status;
+
+    if (!Search(list, item, 0, &j, &k)) return -2;
+    if (j == list->num_chunks) return -1;
+    chunk = list->chunks[j];
+    if (list->kind != KEYS_OBJECT && GetKey(item, &key) == list->kind) {
+        status = chunk->keys[k] == key;
+    } else {
+        ++list->busy;
+        status = EQ(chunk->items[k], item);
+        --list->busy;
+        if (status < 0) return -2;
+    }
+    return status ? Prefix(list, j) + k : -1;
+}
+
+// Modification
+
+int
+SortedListAdd(SortedList *list, PyObject *item)
+{
+    Py_ssize_t j, k;
+    uint64_t key;
+    KeyKind kind = GetKey(item, &key);
+    Chunk *chunk, *half;
+
+    if (!Modifiable(list)) return 0;
+    if (!Search(list, item, 1, &j, &k)) return 0;
+
+    if (list->num_chunks == 0) {
+        if (!Reserve(list, 1)) return 0;
+        if (!(chunk = PyMem_Malloc(sizeof(Chunk)))) {
+            PyErr_NoMemory();
+            return 0;
+        }
+        chunk->size = 0;
+        InsertChunk(list, 0, chunk);
+        BuildIndex(list);
+        j = k = 0;
+    } else if (j == list->num_chunks) {
+        // Items greater than every item go at the end of the last chunk
+        --j;
+        k = list->chunks[j]->size;
+    }
+
+    // Split a full chunk in half before inserting into it
+    chunk = list->chunks[j];
+    if (chunk->size == SORTED_LIST_CHUNK) {
+        if (!Reserve(list, list->num_chunks + 1)) return 0;
+        if (!(half = PyMem_Malloc(sizeof(Chunk)))) {
+            PyErr_NoMemory();
+            return 0;
+        }
+        half->size = 0;
+        InsertChunk(list, j + 1, half);
+        ShiftItems(list, j, -HALF_CHUNK);
+        BuildIndex(list);
+        if (k > chunk->size) {
+            k -= chunk->size;
+            chunk = list->chunks[++j];
+        }
+    }
+
+    memmove(chunk->items + k + 1, chunk->items + k,
+            (size_t) (chunk->size - k) * sizeof(PyObject *));
+    memmove(chunk->keys + k + 1, chunk->keys + k,
+            (size_t) (chunk->size - k) * sizeof(uint64_t));
+    Py_INCREF(item);
+    chunk->items[k] = item;
+    chunk->keys[k] = key;
+    ++chunk->size;
+    UpdateIndex(list, j, 1);
+    ++list->size;
+    ++list->version;
+    list->kind = CombineKinds(list->kind, kind);
+    return 1;
+}
+
+PyObject *
+SortedListPop(SortedList *list, Py_ssize_t position)
+{
+    Py_ssize_t j, k;
+    Chunk *chunk;
+    PyObject *item;
+
+    if (!Modifiable(list)) return NULL;
+    SortedListLocate(list, position, &j, &k);
+    chunk = list->chunks[j];
+    item = chunk->items[k];
+    --chunk->size;
+    memmove(chunk->items + k, chunk->items + k + 1,
+            (size_t) (chunk->size - k) * sizeof(PyObject *));
+    memmove(chunk->keys + k, chunk->keys + k + 1,
+            (size_t) (chunk->size - k) * sizeof(uint64_t));
+    --list->size;
+    ++list->version;
+
+    if (chunk->size == 0) {
+        DeleteChunk(list, j);
+        BuildIndex(list);
+    } else if (chunk->size < MIN_CHUNK && list->num_chunks > 1) {
+        Rebalance(list, j + 1 < list->num_chunks ? j : j - 1);
+        BuildIndex(list);
+    } else {
+        UpdateIndex(list, j, -1);
+    }
+    if (list->size == 0) list->kind = KEYS_NONE;
+    return item;  // The reference held by the list
+}
+
+// Replace the items of a list with the `n` sorted items `a`, whose references
+// are stolen on success, in chunks of at most HALF_CHUNK items
+static int
+Rebuild(SortedList *list, PyObject **a, Py_ssize_t n, KeyKind kind)
+{
+    Py_ssize_t num_chunks = (n + HALF_CHUNK - 1) / HALF_CHUNK, i, j, k;
+    Chunk **chunks;
+    Chunk *chunk;
+
+    if (!Reserve(list, num_chunks)) return 0;
+    if (!(chunks = PyMem_Malloc((size_t) num_chunks * sizeof(*chunks)))) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    for (j = 0; j < num_chunks; ++j) {
+        if (!(chunks[j] = PyMem_Malloc(sizeof(Chunk)))) {
+            while (j--) PyMem_Free(chunks[j]);
+            PyMem_Free(chunks);
+            PyErr_NoMemory();
+            return 0;
+        }
+    }
+
+    // The old chunks' references are in `a` too, so they're freed as is
+    for (j = 0; j < list->num_chunks; ++j) PyMem_Free(list->chunks[j]);
+    for (j = 0, i = 0; j < num_chunks; ++j) {
+        chunk = list->chunks[j] = chunks[j];
+        chunk->size = (j + 1) * n / num_chunks - i;
+        for (k = 0; k < chunk->size; ++k, ++i) {
+            chunk->items[k] = a[i];
+            GetKey(a[i], &chunk->keys[k]);
+        }
+    }
+    PyMem_Free(chunks);
+    list->num_chunks = num_chunks;
+    BuildIndex(list);
+    list->size = n;
+    list->kind = kind;
+    ++list->version;
+    return 1;
+}
+
+int
+SortedListUpdate(SortedList *list, PyObject *iterable)
+{
+    PyObject *batch, **items, **merged = NULL;
+    Py_ssize_t n, i, j, k, m = 0;
+    KeyKind kind;
+    SortPlan plan;
+    uint64_t key;
+    Chunk *chunk;
+    int less, typed, status = 0;
+
+    if (!Modifiable(list)) return 0;
+    if (!(batch = PySequence_List(iterable))) return 0;
+    n = PyList_GET_SIZE(batch);
+    items = ((PyListObject *) batch)->ob_item;
+    if (n == 0) {
+        status = 1;
+        goto done;
+    }
+
+    // Adding a few items is cheaper than moving every item of the list
+    if (MERGE_FRACTION * n < list->size) {
+        for (i = 0; i < n; ++i)
+            if (!SortedListAdd(list, items[i])) goto done;
+        status = 1;
+        goto done;
+    }
+
+    // Sort the batch stably, so that equal items stay in the order given, and
+    // (if they're all ints or floats) by radix sort
+    if (!PlanSort(items, 0, n, 1, &plan) || !RunSortPlan(items, 0, n, &plan))
+        goto done;
+    kind = list->kind;
+    for (i = 0; i < n; ++i) kind = CombineKinds(kind, GetKey(items[i], &key));
+    typed = kind != KEYS_OBJECT;
+
+    // Merge the batch into the items of the list, putting items of the list
+    // before equal items of the batch
+    merged = PyMem_Malloc((size_t) (list->size + n) * sizeof(*merged));
+    if (!merged) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    ++list->busy;
+    for (i = 0, j = 0; j < list->num_chunks; ++j) {
+        chunk = list->chunks[j];
+        for (k = 0; k < chunk->size; ++k) {
+            while (i < n) {
+                if (typed) {
+                    GetKey(items[i], &key);
+                    less = key < chunk->keys[k];
+                } else if ((less = LT(items[i], chunk->items[k])) < 0) {
+                    --list->busy;
+                    goto done;
+                }
+                if (!less) break;
+                merged[m++] = items[i++];
+            }
+            merged[m++] = chunk->items[k];
+        }
+    }
+    --list->busy;
+    while (i < n) merged[m++] = items[i++];
+
+    if (!Rebuild(list, merged, m, kind)) goto done;
+    for (i = 0; i < n; ++i) Py_INCREF(items[i]);
+    status = 1;
+
+done:
+    PyMem_Free(merged);
+    Py_DECREF(batch);
+    return status;
+}
+
+int
+SortedListClear(SortedList *list)
+{
+    Chunk **chunks = list->chunks;
+    Py_ssize_t num_chunks = list->num_chunks;
+
+    if (!Modifiable(list)) return 0;
+
+    // Empty the list before releasing the items, whose finalizers could look
+    // at it
+    list->chunks = NULL;
+    PyMem_Free(list->index);
+    list->index = NULL;
+    list->num_chunks = list->allocated = list->size = 0;
+    list->kind = KEYS_NONE;
+    ++list->version;
+
+    for (Py_ssize_t j = 0; j < num_chunks; ++j) {
+        for (Py_ssize_t k = 0; k < chunks[j]->size; ++k)
+            Py_DECREF(chunks[j]->items[k]);
+        PyMem_Free(chunks[j]);
+    }
+    PyMem_Free(chunks);
+    return 1;
+}
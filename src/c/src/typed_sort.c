@@ -0,0 +1,287 @@
+#include "debug.h"
+#include "heap.h"
+#include "parallel.h"
+#include "radix.h"
+#include "rng.h"
+#include "scratch.h"
+#include "sort.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The typed sorting algorithms have signatures `(a, type, first, last) ->
+// status`, like the ones in sort.c, except that `a` is an array of unboxed
+// items of the given type. They run without the GIL, so they can't raise
+// exceptions: `status` is 0 only if memory allocation failed.
+
+// Instantiate the algorithms in radix_sort_impl.h and typed_sort_impl.h for
+// every item type, with the radix keys of radix.h
+
+#define ITEM_T int8_t
+#define NAME(name) name##_int8
+#define RADIX_KEY(x) ((uint8_t) (x) ^ 0x80u)
+#define RADIX_BYTES 1
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T int16_t
+#define NAME(name) name##_int16
+#define RADIX_KEY(x) ((uint16_t) (x) ^ 0x8000u)
+#define RADIX_BYTES 2
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T int32_t
+#define NAME(name) name##_int32
+#define RADIX_KEY(x) ((uint32_t) (x) ^ UINT32_C(0x80000000))
+#define RADIX_BYTES 4
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T int64_t
+#define NAME(name) name##_int64
+#define RADIX_KEY(x) Int64Key(x)
+#define RADIX_BYTES 8
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T uint8_t
+#define NAME(name) name##_uint8
+#define RADIX_KEY(x) (x)
+#define RADIX_BYTES 1
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T uint16_t
+#define NAME(name) name##_uint16
+#define RADIX_KEY(x) (x)
+#define RADIX_BYTES 2
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T uint32_t
+#define NAME(name) name##_uint32
+#define RADIX_KEY(x) (x)
+#define RADIX_BYTES 4
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T uint64_t
+#define NAME(name) name##_uint64
+#define RADIX_KEY(x) (x)
+#define RADIX_BYTES 8
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T float
+#define NAME(name) name##_float
+#define RADIX_KEY(x) FloatKey(x)
+#define RADIX_BYTES 4
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+#define ITEM_T double
+#define NAME(name) name##_double
+#define RADIX_KEY(x) DoubleKey(x)
+#define RADIX_BYTES 8
+#include "radix_sort_impl.h"
+#include "typed_sort_impl.h"
+#undef ITEM_T
+#undef NAME
+#undef RADIX_KEY
+#undef RADIX_BYTES
+
+int
+TypedInsertionSort(void *a, ItemType type, const Py_ssize_t first,
+                   const Py_ssize_t last)
+{
+    DISPATCH_VOID(type, InsertionSort, a, first, last);
+    return 1;
+}
+
+int
+TypedBinaryInsertionSort(void *a, ItemType type, const Py_ssize_t first,
+                         const Py_ssize_t last)
+{
+    DISPATCH_VOID(type, BinaryInsertionSort, a, first, last);
+    return 1;
+}
+
+int
+TypedHeapSort(void *a, ItemType type, const Py_ssize_t first,
+              const Py_ssize_t last)
+{
+    DISPATCH_VOID(type, HeapSort, a, first, last);
+    return 1;
+}
+
+int
+TypedMergeSort(void *a, ItemType type, const Py_ssize_t first,
+               const Py_ssize_t last)
+{
+    int status = 0;
+    DISPATCH(status, type, MergeSort, a, first, last);
+    return status;
+}
+
+int
+TypedQuickSort(void *a, ItemType type, const Py_ssize_t first,
+               const Py_ssize_t last)
+{
+    DISPATCH_VOID(type, QSort, a, first, last, NULL);
+    return 1;
+}
+
+int
+TypedQuickSortRandom(void *a, ItemType type, const Py_ssize_t first,
+                     const Py_ssize_t last)
+{
+    uint64_t *rng = ThreadRandomState();
+    DPRINTF("state=%llu\n", (unsigned long long) *rng);
+    DISPATCH_VOID(type, QSort, a, first, last, rng);
+    return 1;
+}
+
+// Sizes of the items of every type, indexed by ItemType
+static const size_t item_sizes[] = {1, 2, 4, 8, 1, 2, 4, 8, 4, 8};
+
+int
+TypedRadixSort(void *a, ItemType type, const Py_ssize_t first,
+               const Py_ssize_t last)
+{
+    size_t size = item_sizes[type];
+    void *items = (char *) a + first * size;
+    void *buf;
+    if (last - first > 1) {
+        if (!(buf = AcquireScratch((size_t) (last - first) * size))) return 0;
+        DISPATCH_VOID(type, RadixSort, items, buf, last - first);
+        ReturnScratch(buf);
+    }
+    return 1;
+}
+
+Py_ssize_t
+TypedCountDescents(const void *a, ItemType type, const Py_ssize_t first,
+                   const Py_ssize_t last)
+{
+    Py_ssize_t descents = 0;
+    DISPATCH(descents, type, CountDescents, a, first, last);
+    return descents;
+}
+
+void
+TypedReverse(void *a, ItemType type, const Py_ssize_t first,
+             const Py_ssize_t last)
+{
+    DISPATCH_VOID(type, Reverse, a, first, last);
+}
+
+// Shared state of the threads of a parallel sort of `a[first,last)`, which
+// first sort chunks of `width` items each, and then repeatedly merge adjacent
+// pairs of sorted runs of `width` items, doubling `width` every round
+typedef struct {
+    char *a;
+    char *buf;
+    ItemType type;
+    Py_ssize_t first;
+    Py_ssize_t last;
+    Py_ssize_t width;
+} ParallelSortState;
+
+static void
+SortChunks(void *context, Py_ssize_t begin, Py_ssize_t end)
+{
+    ParallelSortState *state = context;
+    size_t size = item_sizes[state->type];
+    for (Py_ssize_t c = begin; c < end; ++c) {
+        Py_ssize_t lo = state->first + c * state->width;
+        Py_ssize_t hi = Py_MIN(state->last, lo + state->width);
+        void *a = state->a + lo * size;
+        void *buf = state->buf + (lo - state->first) * size;
+        if (lo < hi) DISPATCH_VOID(state->type, RadixSort, a, buf, hi - lo);
+    }
+}
+
+static void
+MergeChunks(void *context, Py_ssize_t begin, Py_ssize_t end)
+{
+    ParallelSortState *state = context;
+    size_t size = item_sizes[state->type];
+    for (Py_ssize_t p = begin; p < end; ++p) {
+        Py_ssize_t lo = state->first + 2 * p * state->width;
+        Py_ssize_t mid = lo + state->width;
+        Py_ssize_t hi = Py_MIN(state->last, mid + state->width);
+        void *buf = state->buf + (lo - state->first) * size;
+        if (mid < hi)
+            DISPATCH_VOID(state->type, Merge, (void *) state->a, buf, lo, mid,
+                          hi);
+    }
+}
+
+int
+TypedParallelSort(void *a, ItemType type, const Py_ssize_t first,
+                  const Py_ssize_t last, int threads)
+{
+    Py_ssize_t n = last - first;
+    ParallelSortState state = {
+        .a = a,
+        .type = type,
+        .first = first,
+        .last = last,
+    };
+
+    threads = NumThreads(threads);
+    if (threads < 2 || n < 2 * threads)
+        return TypedRadixSort(a, type, first, last);
+    state.buf = AcquireScratch((size_t) n * item_sizes[type]);
+    if (!state.buf) return 0;
+
+    // Radix sort one chunk per thread, then merge pairs of runs in parallel
+    // until there's only one left, so the last merge is done by one thread
+    state.width = (n + threads - 1) / threads;
+    ParallelFor(threads, (n + state.width - 1) / state.width, SortChunks,
+                &state);
+    for (; state.width < n; state.width *= 2) {
+        ParallelFor(threads, (n + 2 * state.width - 1) / (2 * state.width),
+                    MergeChunks, &state);
+    }
+    ReturnScratch(state.buf);
+    return 1;
+}
@@ -0,0 +1,205 @@
+// Sorting algorithms on arrays of unboxed numbers, written once for every item
+// type: this file is included by typed_sort.c once per type, with `ITEM_T`
+// defined as the C type of the items and `NAME(name)` defined to append a
+// suffix naming that type to `name`. The algorithms mirror their counterparts
+// on Python objects in sort.c, comparing items with the < operator instead of
+// PyObject_RichCompareBool (so NaNs end up in unspecified positions)
+
+static void
+NAME(InsertionSort)(ITEM_T *a, const Py_ssize_t first, const Py_ssize_t last)
+{
+    for (Py_ssize_t i = first + 1; i < last; ++i) {
+        // Loop invariant: the sub-array `a[first, i)` is sorted. Rather than
+        // swapping `a[i]` into place, shift the larger items to the right
+        ITEM_T value = a[i];
+        Py_ssize_t j = i;
+        for (; j > first && value < a[j - 1]; --j)
+            a[j] = a[j - 1];
+        a[j] = value;
+    }
+}
+
+static void
+NAME(BinaryInsertionSort)(ITEM_T *a, const Py_ssize_t first,
+                          const Py_ssize_t last)
+{
+    for (Py_ssize_t i = first + 1; i < last; ++i) {
+        ITEM_T value = a[i];
+
+        // Find the first position in `a[first,i)` whose item is greater than
+        // `value`, which keeps the sort stable
+        Py_ssize_t lo = first, hi = i;
+        while (lo < hi) {
+            Py_ssize_t mid = lo + (hi - lo) / 2;
+            if (value < a[mid]) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        if (lo < i) {
+            memmove(a + lo + 1, a + lo, (i - lo) * sizeof(ITEM_T));
+            a[lo] = value;
+        }
+    }
+}
+
+// Sift `a[root]` down the binary max-heap `a[0,size)`
+static inline void
+NAME(MaxHeapify)(ITEM_T *a, Py_ssize_t root, const Py_ssize_t size)
+{
+    ITEM_T value = a[root];
+    while (1) {
+        Py_ssize_t i = BINARY_HEAP_LCHILD(root);
+        if (i >= size) break;
+        if (i + 1 < size && a[i] < a[i + 1]) ++i;
+        if (!(value < a[i])) break;
+        a[root] = a[i];
+        root = i;
+    }
+    a[root] = value;
+}
+
+static void
+NAME(HeapSort)(ITEM_T *a, const Py_ssize_t first, const Py_ssize_t last)
+{
+    if (last - first > 1) {
+        ITEM_T *heap = a + first;
+        Py_ssize_t size = last - first;
+        for (Py_ssize_t i = BINARY_HEAP_PARENT(size - 1); i >= 0; --i)
+            NAME(MaxHeapify)(heap, i, size);
+        for (Py_ssize_t heap_end = size - 1; heap_end; --heap_end) {
+            ITEM_T top = heap[0];
+            heap[0] = heap[heap_end];
+            heap[heap_end] = top;
+            NAME(MaxHeapify)(heap, 0, heap_end);
+        }
+    }
+}
+
+// Combine the sorted arrays `a[first,mid)` and `a[mid,last)` into a sorted
+// array `a[first,last)`, using `b` to store a copy of the shorter of the two
+static void
+NAME(Merge)(ITEM_T *a, ITEM_T *b, Py_ssize_t first, Py_ssize_t mid,
+            Py_ssize_t last)
+{
+    Py_ssize_t i, j, k;
+    Py_ssize_t m = mid - first;
+    Py_ssize_t n = last - mid;
+
+    if (m <= n) {
+        // Merge from the front, with `b` storing `a[first,mid)`
+        memcpy(b, a + first, m * sizeof(ITEM_T));
+        for (i = 0, j = mid, k = first; (i < m) && (j < last); ++k) {
+            if (a[j] < b[i]) {
+                a[k] = a[j++];
+            } else {
+                a[k] = b[i++];
+            }
+        }
+        while (i < m) a[k++] = b[i++];
+    } else {
+        // Merge from the back, with `b` storing `a[mid,last)`
+        memcpy(b, a + mid, n * sizeof(ITEM_T));
+        for (i = mid - 1, j = n - 1, k = last - 1; (i >= first) && (j >= 0);
+                --k) {
+            if (b[j] < a[i]) {
+                a[k] = a[i--];
+            } else {
+                a[k] = b[j--];
+            }
+        }
+        while (j >= 0) a[k--] = b[j--];
+    }
+}
+
+static void
+NAME(MSort)(ITEM_T *a, ITEM_T *buf, Py_ssize_t first, Py_ssize_t last)
+{
+    if (first < last - 1) {
+        Py_ssize_t mid = first + (last - first) / 2;
+        NAME(MSort)(a, buf, first, mid);
+        NAME(MSort)(a, buf, mid, last);
+        NAME(Merge)(a, buf, first, mid, last);
+    }
+}
+
+static int
+NAME(MergeSort)(ITEM_T *a, const Py_ssize_t first, const Py_ssize_t last)
+{
+    if (first < last) {
+        size_t half = (size_t) (last - first + 1) / 2;
+        ITEM_T *buf = AcquireScratch(half * sizeof(ITEM_T));
+        if (!buf) return 0;
+        NAME(MSort)(a, buf, first, last);
+        ReturnScratch(buf);
+    }
+    return 1;
+}
+
+// Lomuto partition of `a[first,last)` with respect to `a[first]`, as in
+// partition.c, returning the final position of the pivot
+static inline Py_ssize_t
+NAME(Partition)(ITEM_T *a, const Py_ssize_t first, const Py_ssize_t last)
+{
+    ITEM_T pivot = a[first], temp;
+    Py_ssize_t i = last;
+    for (Py_ssize_t j = last - 1; j > first; --j) {
+        if (pivot < a[j]) {
+            temp = a[--i];
+            a[i] = a[j];
+            a[j] = temp;
+        }
+    }
+    a[first] = a[--i];
+    a[i] = pivot;
+    return i;
+}
+
+// Quick sort with either the first item of each sub-array as the pivot, or a
+// random item if `rng` isn't NULL. Recursing into the smaller side and looping
+// over the larger one bounds the stack depth by O(log(n)), even when the pivots
+// are bad
+static void
+NAME(QSort)(ITEM_T *a, Py_ssize_t first, Py_ssize_t last, uint64_t *rng)
+{
+    while (last - first > 1) {
+        Py_ssize_t p;
+        if (rng) {
+            Py_ssize_t r = first + (Py_ssize_t) (NextRandom(rng)
+                                                 % (uint64_t) (last - first));
+            ITEM_T temp = a[first];
+            a[first] = a[r];
+            a[r] = temp;
+        }
+        p = NAME(Partition)(a, first, last);
+        if (p - first < last - p) {
+            NAME(QSort)(a, first, p, rng);
+            first = p + 1;
+        } else {
+            NAME(QSort)(a, p + 1, last, rng);
+            last = p;
+        }
+    }
+}
+
+// Number of positions `i` in `(first,last)` with `a[i] < a[i - 1]`
+static Py_ssize_t
+NAME(CountDescents)(const ITEM_T *a, const Py_ssize_t first,
+                    const Py_ssize_t last)
+{
+    Py_ssize_t descents = 0;
+    for (Py_ssize_t i = first + 1; i < last; ++i)
+        descents += a[i] < a[i - 1];
+    return descents;
+}
+
+static void
+NAME(Reverse)(ITEM_T *a, Py_ssize_t first, Py_ssize_t last)
+{
+    for (--last; first < last; ++first, --last) {
+        ITEM_T temp = a[first];
+        a[first] = a[last];
+        a[last] = temp;
+    }
+}
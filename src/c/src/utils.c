@@ -3,6 +3,7 @@
 
 void Swap(PyObject **a, PyObject **b) {
     PyObject *temp = *a;
+    COUNT(swaps, 1);
     *a = *b;
     *b = temp;
 }
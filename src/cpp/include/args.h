@@ -0,0 +1,38 @@
+#ifndef __ALGORITHMS_ARGS_H
+#define __ALGORITHMS_ARGS_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define ARG_PARSER_MAX_KEYWORDS 8
+
+// Argument parser for METH_FASTCALL | METH_KEYWORDS functions and vectorcall
+// constructors, which receive their positional arguments as a C array followed
+// by the values of their keyword arguments, whose names are in a tuple,
+// instead of in a new tuple and dict on every call. Parsers are read-only and
+// hold no Python objects, so they're meant to be static variables shared by
+// every interpreter and thread, initialized like
+//
+//     static const char *const keywords[] = {"", "size", "seed", nullptr};
+//     static ArgParser parser = {"sample", keywords, 1, 3};
+//
+// where the empty names of the first parameters mark them as positional-only,
+// and the parameters after the positional ones are keyword-only
+struct ArgParser {
+    const char *name;                   // Function name for error messages
+    const char *const *keywords;        // NULL-terminated parameter names
+    Py_ssize_t required;                // Number of required parameters
+    Py_ssize_t positional;              // Number of positional parameters
+};
+
+// Match the arguments of a call to the parameters of a parser, storing a
+// borrowed reference to the i-th parameter's argument in `out[i]`, or NULL if
+// it wasn't given. Returns false and sets an exception on failure
+bool ParseArgs(const ArgParser *, PyObject *const *, Py_ssize_t, PyObject *,
+               PyObject **);
+
+// Same as ParseArgs, for arguments given as a tuple and a dict (or NULL), as
+// in tp_new and METH_VARARGS | METH_KEYWORDS functions
+bool ParseTupleArgs(const ArgParser *, PyObject *, PyObject *, PyObject **);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __ALGORITHMS_BFS_H
+#define __ALGORITHMS_BFS_H
+
+#include "graph.h"
+
+void BFSLevels(const CSRGraph &, const CSRGraph &, const vertex_t *, size_t,
+               int, vertex_t *, vertex_t *);
+bool ShortestPath(const CSRGraph &, const CSRGraph &, vertex_t, vertex_t,
+                  std::vector<vertex_t> &);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef __ALGORITHMS_BUFFER_H
+#define __ALGORITHMS_BUFFER_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstdint>
+
+// Helpers for reading one-dimensional numeric buffers (e.g., array.array or
+// NumPy arrays) exported through the buffer protocol
+
+// Get a contiguous one-dimensional buffer whose items are integers (or
+// floating point numbers, if `floating` is true). On success, the returned
+// format character is one of the struct module codes "bBhHiIlLqQnN" (or
+// "fd"), and the buffer must eventually be released with PyBuffer_Release. On
+// failure, returns 0 and sets an exception
+char GetNumericBuffer(PyObject *, Py_buffer *, bool floating = false);
+
+// Create a one-dimensional memoryview of `count` items of the given format,
+// backed by a new bytearray, and return a pointer to its uninitialized items
+PyObject *NewNumericArray(char, Py_ssize_t, void **);
+
+// Create a Python int or float from the i-th item of a buffer of the given
+// numeric format
+PyObject *GetNumericItem(const void *, char, Py_ssize_t);
+
+// Read the i-th item of a buffer of the given integer format
+static inline int64_t
+ReadInteger(const void *buf, char format, Py_ssize_t i)
+{
+    switch (format) {
+        case 'b': return ((const signed char *) buf)[i];
+        case 'B': return ((const unsigned char *) buf)[i];
+        case 'h': return ((const short *) buf)[i];
+        case 'H': return ((const unsigned short *) buf)[i];
+        case 'i': return ((const int *) buf)[i];
+        case 'I': return ((const unsigned int *) buf)[i];
+        case 'l': return ((const long *) buf)[i];
+        case 'L': return (int64_t) ((const unsigned long *) buf)[i];
+        case 'q': return ((const long long *) buf)[i];
+        case 'Q': return (int64_t) ((const unsigned long long *) buf)[i];
+        case 'n': return ((const Py_ssize_t *) buf)[i];
+        case 'N': return (int64_t) ((const size_t *) buf)[i];
+        default: return 0;
+    }
+}
+
+// Read the i-th item of a buffer of any numeric format as a double
+static inline double
+ReadDouble(const void *buf, char format, Py_ssize_t i)
+{
+    switch (format) {
+        case 'f': return ((const float *) buf)[i];
+        case 'd': return ((const double *) buf)[i];
+        default: return (double) ReadInteger(buf, format, i);
+    }
+}
+
+#endif
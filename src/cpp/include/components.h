@@ -0,0 +1,55 @@
+#ifndef __ALGORITHMS_COMPONENTS_H
+#define __ALGORITHMS_COMPONENTS_H
+
+#include "graph.h"
+#include "parallel.h"
+
+#include <atomic>
+
+// Concurrent union-find over the vertices 0, 1, ..., n - 1, in which every
+// vertex's parent has a smaller id than the vertex itself, so the root of a
+// tree is the smallest vertex in it. Threads may link vertices concurrently;
+// once they have all finished, compressing the forest makes every vertex
+// point directly at its root
+class ConcurrentForest {
+public:
+    explicit ConcurrentForest(vertex_t n) : parent((size_t) n)
+    {
+        for (vertex_t v = 0; v < n; ++v)
+            parent[v].store(v, std::memory_order_relaxed);
+    }
+
+    void link(vertex_t, vertex_t);
+    void compress(int);
+
+    vertex_t operator[](vertex_t v) const
+    {
+        return parent[v].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<std::atomic<vertex_t>> parent;
+};
+
+void ConnectedComponents(const CSRGraph &, int, vertex_t *);
+
+// Connected components of the undirected graph on the vertices 0, 1, ..., n - 1
+// with the m edges `(source(i), target(i))`: `component[v]` is set to the
+// smallest vertex connected to `v`. The edges must be valid vertices
+template <typename Source, typename Target>
+void
+ConnectedComponents(vertex_t n, edge_t m, Source source, Target target,
+                    int threads, vertex_t *component)
+{
+    ConcurrentForest forest(n);
+
+    threads = NumThreads(threads);
+    ParallelFor(threads, (size_t) m, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i)
+            forest.link(source((edge_t) i), target((edge_t) i));
+    });
+    forest.compress(threads);
+    for (vertex_t v = 0; v < n; ++v) component[v] = forest[v];
+}
+
+#endif
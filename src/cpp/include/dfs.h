@@ -0,0 +1,9 @@
+#ifndef __ALGORITHMS_DFS_H
+#define __ALGORITHMS_DFS_H
+
+#include "graph.h"
+
+bool TopologicalSort(const CSRGraph &, std::vector<vertex_t> &);
+vertex_t StronglyConnectedComponents(const CSRGraph &, vertex_t *);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef __ALGORITHMS_GRAPH_H
+#define __ALGORITHMS_GRAPH_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertices are the integers 0, 1, ..., n - 1, and edges are numbered 0, 1,
+// ..., m - 1 in the order in which they appear in the CSR arrays below
+typedef int32_t vertex_t;
+typedef int64_t edge_t;
+
+#define VERTEX_FORMAT "i"  // struct module format of vertex_t
+#define EDGE_FORMAT "q"    // struct module format of edge_t
+#define WEIGHT_FORMAT "d"  // struct module format of edge weights
+#define MAX_VERTICES INT32_MAX
+
+// Compressed sparse row (CSR) representation of a directed graph: the
+// out-neighbors of vertex `v` are `targets[offsets[v], offsets[v + 1])`, and the
+// weight of the edge `e` to `targets[e]` is `weights[e]`. The arrays are not
+// owned by this struct
+struct CSRGraph {
+    vertex_t n;                         // Number of vertices
+    edge_t m;                           // Number of edges
+    const edge_t *offsets;              // Length n + 1
+    const vertex_t *targets;            // Length m
+    const double *weights;              // Length m, or NULL if unweighted
+};
+
+// Byte offsets of the CSR arrays within a single contiguous block of memory
+struct CSRLayout {
+    size_t offsets;
+    size_t targets;
+    size_t weights;                     // Only meaningful if weighted
+    size_t size;                        // Total size of the block in bytes
+};
+
+CSRLayout GetCSRLayout(vertex_t, edge_t, bool);
+
+// Round a byte offset up to a multiple of 8, so that any array can start there
+static inline size_t
+Align(size_t offset)
+{
+    return (offset + 7) & ~(size_t) 7;
+}
+
+// Python object wrapping a CSR graph. The CSR arrays live in a single block of
+// memory owned by `storage` (an object supporting the buffer protocol), and the
+// vertices are mapped to and from the original node labels by `labels` (a list
+// whose i-th item is the label of vertex i) and `index` (a dict mapping labels
+// to vertices). If both are NULL, then every vertex is its own label. The
+// reverse graph (with every edge flipped) is only built when an algorithm needs
+// the in-neighbors of vertices, and is owned by `reverse_storage`, which is
+// set once, while holding the object's lock (on free-threaded builds)
+typedef struct {
+    PyObject_HEAD
+    CSRGraph csr;
+    PyObject *storage;
+    PyObject *labels;
+    PyObject *index;
+    CSRGraph reverse;
+    PyObject *reverse_storage;
+} GraphObject;
+
+int BuildGraphFromMapping(GraphObject *, PyObject *, PyObject *);
+int BuildGraphFromEdges(GraphObject *, PyObject *, PyObject *, PyObject *,
+                        Py_ssize_t);
+int GetEdgeWeight(PyObject *, PyObject *, double *);
+const CSRGraph *GraphReverse(GraphObject *);
+PyObject *GraphLabel(GraphObject *, vertex_t);
+vertex_t GraphVertex(GraphObject *, PyObject *);
+
+// Fixed-size set of vertices represented as an array of bits
+class Bitset {
+public:
+    explicit Bitset(size_t n) : words((n + 63) / 64, 0) {}
+
+    bool test(size_t i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i)
+    {
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    // Set bit `i`, returning whether it was already set
+    bool test_and_set(size_t i)
+    {
+        uint64_t mask = uint64_t(1) << (i % 64);
+        bool was_set = words[i / 64] & mask;
+        words[i / 64] |= mask;
+        return was_set;
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+#endif
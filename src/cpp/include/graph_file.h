@@ -0,0 +1,38 @@
+#ifndef __ALGORITHMS_GRAPH_FILE_H
+#define __ALGORITHMS_GRAPH_FILE_H
+
+#include "graph.h"
+
+// On-disk format of a Graph, in which every integer is in native byte order:
+//   1. a 64-byte GraphFileHeader;
+//   2. the CSR block, laid out exactly as in memory (see GetCSRLayout);
+//   3. if the nodes have labels, the pickled list of labels.
+// Every section starts at a multiple of 8 bytes, so the CSR arrays can be used
+// in place once the file is memory-mapped. Readers reject files whose version
+// they don't know, so any change to the layout must bump the version
+
+#define GRAPH_FILE_MAGIC "ALGGRAPH"
+#define GRAPH_FILE_VERSION 1
+#define GRAPH_FILE_BYTE_ORDER 0x01020304
+
+// Header flags
+#define GRAPH_FILE_WEIGHTED 1
+#define GRAPH_FILE_LABELED 2
+
+struct GraphFileHeader {
+    char magic[8];                      // GRAPH_FILE_MAGIC
+    uint32_t version;                   // GRAPH_FILE_VERSION
+    uint32_t byte_order;                // GRAPH_FILE_BYTE_ORDER, as written
+    uint64_t flags;
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    uint64_t csr_offset;                // Byte offset of the CSR block
+    uint64_t labels_offset;             // Byte offset of the pickled labels
+    uint64_t labels_size;
+};
+
+int SaveGraph(GraphObject *, PyObject *);
+int LoadGraph(GraphObject *, PyObject *, bool);
+int ConvertEdgeList(PyObject *, PyObject *, char, bool, Py_ssize_t);
+
+#endif
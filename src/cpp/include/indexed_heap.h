@@ -0,0 +1,104 @@
+#ifndef __ALGORITHMS_INDEXED_HEAP_H
+#define __ALGORITHMS_INDEXED_HEAP_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Indexed d-ary min-heap of items identified by the integers 0, 1, 2, ...,
+// each with a key. Keeping track of the position of every item in the heap
+// makes it possible to decrease the key of an item in place (in O(log_d n)
+// steps), instead of pushing duplicate items and skipping stale ones later.
+// Wider heaps are shallower, which favors the decrease-key-heavy workloads of
+// shortest path algorithms; see, e.g., Cormen et al, Problem 6-2
+template <typename Key, size_t D = 4>
+class IndexedHeap {
+public:
+    explicit IndexedHeap(size_t n = 0) : position(n, NONE) {}
+
+    bool empty() const { return heap.empty(); }
+
+    bool contains(size_t id) const
+    {
+        return id < position.size() && position[id] != NONE;
+    }
+
+    // Insert an item, or decrease its key if it's already in the heap with a
+    // larger key
+    void push(size_t id, Key key)
+    {
+        if (id >= position.size()) position.resize(id + 1, NONE);
+        size_t i = position[id];
+        if (i == NONE) {
+            i = heap.size();
+            heap.push_back(std::make_pair(key, id));
+            position[id] = i;
+        } else if (key < heap[i].first) {
+            heap[i].first = key;
+        } else {
+            return;
+        }
+        sift_up(i);
+    }
+
+    // Remove an item with the smallest key, returning its id and key
+    std::pair<size_t, Key> pop()
+    {
+        std::pair<Key, size_t> top = heap.front();
+        position[top.second] = NONE;
+        if (heap.size() > 1) {
+            heap.front() = heap.back();
+            position[heap.front().second] = 0;
+            heap.pop_back();
+            sift_down(0);
+        } else {
+            heap.pop_back();
+        }
+        return std::make_pair(top.second, top.first);
+    }
+
+private:
+    static const size_t NONE = (size_t) -1;
+
+    std::vector<std::pair<Key, size_t>> heap;   // (key, id) pairs
+    std::vector<size_t> position;               // Position of each id in heap
+
+    void move(size_t i, std::pair<Key, size_t> item)
+    {
+        heap[i] = item;
+        position[item.second] = i;
+    }
+
+    void sift_up(size_t i)
+    {
+        std::pair<Key, size_t> item = heap[i];
+        while (i > 0) {
+            size_t parent = (i - 1) / D;
+            if (!(item.first < heap[parent].first)) break;
+            move(i, heap[parent]);
+            i = parent;
+        }
+        move(i, item);
+    }
+
+    void sift_down(size_t i)
+    {
+        std::pair<Key, size_t> item = heap[i];
+        const size_t n = heap.size();
+        while (true) {
+            size_t first = D * i + 1, best = first;
+            if (first >= n) break;
+            for (size_t c = first + 1; c < first + D && c < n; ++c)
+                if (heap[c].first < heap[best].first) best = c;
+            if (!(heap[best].first < item.first)) break;
+            move(i, heap[best]);
+            i = best;
+        }
+        move(i, item);
+    }
+};
+
+template <typename Key, size_t D>
+const size_t IndexedHeap<Key, D>::NONE;
+
+#endif
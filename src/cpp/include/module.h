@@ -0,0 +1,75 @@
+#ifndef __ALGORITHMS_MODULE_H
+#define __ALGORITHMS_MODULE_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+
+// Helpers for extension modules with multi-phase initialization (PEP 489).
+// Their state (e.g., their types, which are heap types) lives in the module
+// object instead of in static variables, so every interpreter that imports a
+// module gets its own copy.
+
+// Slots at the end of the m_slots of every module, declaring that it supports
+// subinterpreters with their own GILs (Python 3.12+), whose objects are never
+// shared, and running without the GIL on free-threaded builds (Python 3.13+),
+// where their mutable objects (e.g., sorted lists, traversals, and the reverse
+// graphs cached by Graph objects) are locked by critical sections
+#ifdef Py_mod_multiple_interpreters
+#define MODULE_INTERPRETERS_SLOT                                               \
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#else
+#define MODULE_INTERPRETERS_SLOT
+#endif
+#ifdef Py_mod_gil
+#define MODULE_GIL_SLOT {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#else
+#define MODULE_GIL_SLOT
+#endif
+#define MODULE_THREADING_SLOTS MODULE_INTERPRETERS_SLOT MODULE_GIL_SLOT
+
+// Critical sections (Python 3.13+), which lock an object, or two, on
+// free-threaded builds and do nothing otherwise. A thread suspends its
+// critical sections while it waits (e.g., after releasing the GIL, or for
+// another lock), so objects that release the GIL or run Python code while
+// they're being modified still need to mark themselves busy. Older versions
+// don't have them, and need no locks
+#ifndef Py_BEGIN_CRITICAL_SECTION
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
+
+// Flags of heap types added in Python 3.10, which older versions do without
+#ifndef Py_TPFLAGS_IMMUTABLETYPE
+#define Py_TPFLAGS_IMMUTABLETYPE 0
+#endif
+#ifndef Py_TPFLAGS_DISALLOW_INSTANTIATION
+#define Py_TPFLAGS_DISALLOW_INSTANTIATION 0
+#endif
+
+// A function as the value of a module or type slot
+#define SLOT_FUNCTION(f) ((void *) (f))
+
+// Create a heap type from `spec` for a module, and add it to the module under
+// the last component of its name. Returns a new reference to the type, or
+// NULL on failure
+static inline PyTypeObject *
+NewModuleType(PyObject *module, PyType_Spec *spec)
+{
+    PyObject *type = PyType_FromModuleAndSpec(module, spec, nullptr);
+    const char *name = std::strrchr(spec->name, '.');
+
+    if (!type) return nullptr;
+    Py_INCREF(type);
+    if (PyModule_AddObject(module, name ? name + 1 : spec->name, type) < 0) {
+        Py_DECREF(type);
+        Py_DECREF(type);
+        return nullptr;
+    }
+    return (PyTypeObject *) type;
+}
+
+#endif
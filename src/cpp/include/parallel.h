@@ -0,0 +1,67 @@
+#ifndef __ALGORITHMS_PARALLEL_H
+#define __ALGORITHMS_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Resolve a user-supplied thread count: non-positive means "use every core"
+static inline int
+NumThreads(int threads)
+{
+    if (threads > 0) return threads;
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores ? (int) cores : 1;
+}
+
+// Call `body(begin, end, thread)` on `threads` contiguous chunks of the range
+// `[0, n)`, each in its own thread (the calling thread takes the first chunk).
+// Chunk boundaries are multiples of `grain`, which lets callers give each
+// thread exclusive ownership of, e.g., whole words of a bitset. Small ranges
+// are handled entirely by the calling thread, since starting a thread costs
+// far more than a few thousand iterations of a typical loop body. If a chunk
+// throws (e.g., std::bad_alloc), the first exception is rethrown in the
+// calling thread once every chunk is done
+template <typename Body>
+void
+ParallelFor(int threads, size_t n, Body body, size_t grain = 1)
+{
+    const size_t min_chunk = 4096;
+    size_t chunks = std::min((size_t) threads, n / min_chunk);
+    if (chunks <= 1) {
+        body((size_t) 0, n, 0);
+        return;
+    }
+
+    size_t chunk = (n + chunks - 1) / chunks;
+    chunk = (chunk + grain - 1) / grain * grain;
+
+    // An exception can't leave a thread without terminating the program, so
+    // each chunk keeps its own until the threads are joined
+    std::vector<std::exception_ptr> errors(chunks);
+    auto run = [&](size_t t) {
+        try {
+            body(t * chunk, std::min(n, (t + 1) * chunk), (int) t);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t t = 1;
+    try {
+        workers.reserve(chunks - 1);
+        for (; t < chunks && t * chunk < n; ++t) workers.emplace_back(run, t);
+    } catch (const std::exception &) {
+        // Chunks whose threads couldn't be started are run below instead
+    }
+    run(0);
+    for (; t < chunks && t * chunk < n; ++t) run(t);
+    for (std::thread &worker : workers) worker.join();
+    for (const std::exception_ptr &error : errors)
+        if (error) std::rethrow_exception(error);
+}
+
+#endif
@@ -5,5 +5,6 @@
 #include <Python.h>
 
 PyObject *Sample(PyObject *, Py_ssize_t, PyObject *);
+PyObject *SampleBuffer(const Py_buffer *, char, Py_ssize_t, PyObject *);
 
 #endif
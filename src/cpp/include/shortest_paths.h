@@ -0,0 +1,84 @@
+#ifndef __ALGORITHMS_SHORTEST_PATHS_H
+#define __ALGORITHMS_SHORTEST_PATHS_H
+
+#include "graph.h"
+#include "indexed_heap.h"
+
+#include <limits>
+
+// Status codes of the shortest path searches
+#define SEARCH_OK 1
+#define SEARCH_FAILED 0             // A Python exception was raised
+#define SEARCH_NEGATIVE_WEIGHT -1   // Dijkstra's algorithm needs weights >= 0
+
+// Heuristic for a best-first search which turns it into Dijkstra's algorithm
+struct NoHeuristic {
+    bool operator()(vertex_t, double &estimate) const
+    {
+        estimate = 0.0;
+        return true;
+    }
+};
+
+// Best-first search of a CSR graph from `source`: Dijkstra's algorithm if
+// `heuristic` always estimates 0, and A* search otherwise. The heuristic is
+// called as `heuristic(v, estimate)`, storing a lower bound on the distance
+// from `v` to the target in `estimate`, and returns false on failure.
+//
+// On success, `distance[v]` is the length of a shortest path from the source
+// to `v` and `parent[v]` is the vertex before `v` on such a path, for every
+// vertex `v` whose distance was settled (every reachable vertex, unless the
+// search stopped at `target`). Other vertices have distance infinity and
+// parent -1. Edges have weight 1 if `weights` is NULL
+template <typename Heuristic>
+int
+BestFirstSearch(const CSRGraph &graph, const double *weights, vertex_t source,
+                vertex_t target, Heuristic heuristic, double *distance,
+                vertex_t *parent)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    std::vector<char> settled((size_t) graph.n, 0);
+    IndexedHeap<double> heap((size_t) graph.n);
+    double estimate;
+
+    for (vertex_t v = 0; v < graph.n; ++v) {
+        distance[v] = infinity;
+        parent[v] = -1;
+    }
+    distance[source] = 0.0;
+    if (!heuristic(source, estimate)) return SEARCH_FAILED;
+    heap.push((size_t) source, estimate);
+
+    while (!heap.empty()) {
+        vertex_t u = (vertex_t) heap.pop().first;
+        settled[u] = 1;
+        if (u == target) break;
+
+        for (edge_t e = graph.offsets[u]; e < graph.offsets[u + 1]; ++e) {
+            vertex_t v = graph.targets[e];
+            double w = weights ? weights[e] : 1.0;
+            if (!(w >= 0.0)) return SEARCH_NEGATIVE_WEIGHT;  // Also catches NaN
+            if (distance[u] + w < distance[v]) {
+                distance[v] = distance[u] + w;
+                parent[v] = u;
+                if (!heuristic(v, estimate)) return SEARCH_FAILED;
+                heap.push((size_t) v, distance[v] + estimate);
+            }
+        }
+    }
+
+    // Forget about the tentative distances of unsettled vertices
+    for (vertex_t v = 0; v < graph.n; ++v) {
+        if (!settled[v]) {
+            distance[v] = infinity;
+            parent[v] = -1;
+        }
+    }
+    return SEARCH_OK;
+}
+
+PyObject *DijkstraMapping(PyObject *, PyObject *, PyObject *, PyObject *);
+PyObject *AStarMapping(PyObject *, PyObject *, PyObject *, PyObject *,
+                       PyObject *);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef __ALGORITHMS_SPMV_H
+#define __ALGORITHMS_SPMV_H
+
+#include "graph.h"
+
+// Iterative graph kernels built on sparse matrix-vector products over CSR
+// graphs, for rank vectors of floats or doubles
+
+template <typename T>
+int PageRank(const CSRGraph &, const CSRGraph &, double, double, size_t,
+             const double *, int, T *);
+template <typename T>
+void Propagate(const CSRGraph &, const double *, const T *, int, T *);
+
+#endif
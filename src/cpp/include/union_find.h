@@ -0,0 +1,61 @@
+#ifndef __ALGORITHMS_UNION_FIND_H
+#define __ALGORITHMS_UNION_FIND_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Disjoint-set forest over the integers 0, 1, 2, ..., with union by size and
+// path halving, so that any sequence of operations takes nearly linear time.
+// See Robert Tarjan and Jan van Leeuwen, "Worst-case analysis of set union
+// algorithms". Journal of the ACM 31(2) (1984).
+// DOI: https://doi.org/10.1145/62.2160
+class UnionFind {
+public:
+    size_t size() const { return parent.size(); }
+
+    // Number of disjoint sets
+    size_t count() const { return sets; }
+
+    // Add a new singleton set, returning its element
+    size_t add()
+    {
+        parent.push_back(parent.size());
+        sizes.push_back(1);
+        ++sets;
+        return parent.size() - 1;
+    }
+
+    // Representative element of the set containing x
+    size_t find(size_t x)
+    {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    // Merge the sets containing x and y, returning false if they're the same
+    bool unite(size_t x, size_t y)
+    {
+        x = find(x);
+        y = find(y);
+        if (x == y) return false;
+        if (sizes[x] < sizes[y]) std::swap(x, y);
+        parent[y] = x;
+        sizes[x] += sizes[y];
+        --sets;
+        return true;
+    }
+
+    // Number of elements in the set containing x
+    size_t set_size(size_t x) { return sizes[find(x)]; }
+
+private:
+    std::vector<size_t> parent;
+    std::vector<size_t> sizes;          // Only meaningful for representatives
+    size_t sets = 0;
+};
+
+#endif
@@ -3,230 +3,2941 @@
 
 // Graph algorithms
 
-#include <queue>
+#include "args.h"
+#include "bfs.h"
+#include "buffer.h"
+#include "components.h"
+#include "dfs.h"
+#include "graph.h"
+#include "graph_file.h"
+#include "module.h"
+#include "parallel.h"
+#include "shortest_paths.h"
+#include "spmv.h"
+#include "union_find.h"
 
-// Breath-first search traversal of a directed graph, represented as an
-// adjacency list
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Module state: the types, which are created for every module object, and
+// the events yielded by depth-first traversals
+struct GraphState {
+    PyTypeObject *graph_type;
+    PyTypeObject *bfs_type;
+    PyTypeObject *dfs_type;
+    PyTypeObject *disjoint_set_type;
+    PyObject *dfs_pre;
+    PyObject *dfs_post;
+};
+
+// State of the module
+static inline GraphState *
+GetState(PyObject *module)
+{
+    return (GraphState *) PyModule_GetState(module);
+}
+
+// State of the module that defined a type, or NULL on failure. The types
+// aren't subclassable, so they're the types of the module themselves
+static inline GraphState *
+GetTypeState(PyTypeObject *type)
+{
+    return (GraphState *) PyType_GetModuleState(type);
+}
+
+#define Graph_Check(state, op) PyObject_TypeCheck(op, (state)->graph_type)
+
+// Compressed sparse row graph
+
+// Instantiate a new GraphObject from an adjacency list
+static PyObject *
+Graph_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *adjacency;
+    PyObject *weight = Py_None;
+    GraphObject *graph;
+
+    // Parse arguments
+    static const char *format = "O|O";
+    static const char *keywords[] = {"adjacency", "weight", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &adjacency, &weight))
+        return nullptr;
+
+    if (!PyMapping_Check(adjacency)) {
+        PyErr_SetString(PyExc_TypeError, "Graph() expects a mapping type");
+        return nullptr;
+    }
+
+    if (!(graph = (GraphObject *) type->tp_alloc(type, 0))) return nullptr;
+    if (!BuildGraphFromMapping(graph, adjacency, weight)) {
+        Py_DECREF(graph);
+        return nullptr;
+    }
+    return (PyObject *) graph;
+}
+
+// Instantiate a new GraphObject from parallel buffers of sources and targets
+static PyObject *
+Graph_FromEdges(PyObject *cls, PyObject *args, PyObject *kwargs)
+{
+    PyObject *sources;
+    PyObject *targets;
+    PyObject *num_nodes = Py_None;
+    PyObject *weights = Py_None;
+    Py_ssize_t n = -1;
+    GraphObject *graph;
+
+    // Parse arguments
+    static const char *format = "OO|OO";
+    static const char *keywords[] = {"sources", "targets", "num_nodes",
+                                     "weights", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &sources, &targets, &num_nodes, &weights))
+        return nullptr;
+
+    if (num_nodes != Py_None) {
+        n = PyLong_AsSsize_t(num_nodes);
+        if (n == -1 && PyErr_Occurred()) return nullptr;
+        if (n < 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "number of nodes must be non-negative");
+            return nullptr;
+        }
+    }
+
+    PyTypeObject *type = (PyTypeObject *) cls;
+    if (!(graph = (GraphObject *) type->tp_alloc(type, 0))) return nullptr;
+    if (!BuildGraphFromEdges(graph, sources, targets, weights, n)) {
+        Py_DECREF(graph);
+        return nullptr;
+    }
+    return (PyObject *) graph;
+}
+
+// Instantiate a new GraphObject by memory-mapping a graph file
+static PyObject *
+Graph_Load(PyObject *cls, PyObject *args, PyObject *kwargs)
+{
+    PyObject *path;
+    int validate = 1;
+    GraphObject *graph;
+
+    // Parse arguments
+    static const char *format = "O|p";
+    static const char *keywords[] = {"path", "validate", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &path, &validate))
+        return nullptr;
+
+    PyTypeObject *type = (PyTypeObject *) cls;
+    if (!(graph = (GraphObject *) type->tp_alloc(type, 0))) return nullptr;
+    if (!LoadGraph(graph, path, validate)) {
+        Py_DECREF(graph);
+        return nullptr;
+    }
+    return (PyObject *) graph;
+}
+
+static PyObject *
+Graph_Save(PyObject *self, PyObject *path)
+{
+    if (!SaveGraph((GraphObject *) self, path)) return nullptr;
+    Py_RETURN_NONE;
+}
+
+static void
+Graph_Dealloc(PyObject *self)
+{
+    GraphObject *graph = (GraphObject *) self;
+    PyTypeObject *type = Py_TYPE(self);
+    Py_XDECREF(graph->storage);
+    Py_XDECREF(graph->labels);
+    Py_XDECREF(graph->index);
+    Py_XDECREF(graph->reverse_storage);
+    type->tp_free(graph);
+    Py_DECREF(type);
+}
+
+static PyObject *
+Graph_Repr(PyObject *self)
+{
+    GraphObject *graph = (GraphObject *) self;
+    return PyUnicode_FromFormat("<%s with %ld nodes and %lld edges>",
+                                Py_TYPE(self)->tp_name, (long) graph->csr.n,
+                                (long long) graph->csr.m);
+}
+
+static Py_ssize_t
+Graph_Length(PyObject *self)
+{
+    return ((GraphObject *) self)->csr.n;
+}
+
+static int
+Graph_Contains(PyObject *self, PyObject *label)
+{
+    if (GraphVertex((GraphObject *) self, label) >= 0) return 1;
+    if (PyErr_ExceptionMatches(PyExc_KeyError)
+            || PyErr_ExceptionMatches(PyExc_TypeError)) {
+        PyErr_Clear();
+        return 0;
+    }
+    return -1;
+}
+
+// Read-only typed memoryview of `count` items of one of the CSR arrays,
+// starting `offset` bytes into the graph's storage block
+static PyObject *
+Graph_Array(GraphObject *graph, size_t offset, size_t count, size_t itemsize,
+            const char *format)
+{
+    PyObject *view, *slice, *array;
+
+    if (!(view = PyMemoryView_FromObject(graph->storage))) return nullptr;
+    slice = PySequence_GetSlice(view, (Py_ssize_t) offset,
+                                (Py_ssize_t) (offset + count * itemsize));
+    Py_DECREF(view);
+    if (!slice) return nullptr;
+    array = PyObject_CallMethod(slice, "cast", "s", format);
+    Py_DECREF(slice);
+    if (!array) return nullptr;
+    Py_SETREF(array, PyObject_CallMethod(array, "toreadonly", nullptr));
+    return array;
+}
+
+static PyObject *
+Graph_GetNumNodes(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return PyLong_FromLong(((GraphObject *) self)->csr.n);
+}
+
+static PyObject *
+Graph_GetNumEdges(PyObject *self, void *closure)
+{
+    (void) closure;  // Unused parameter
+    return PyLong_FromLongLong(((GraphObject *) self)->csr.m);
+}
+
+static PyObject *
+Graph_GetNodes(PyObject *self, void *closure)
+{
+    GraphObject *graph = (GraphObject *) self;
+    PyObject *nodes;
+
+    (void) closure;  // Unused parameter
+
+    if (!(nodes = PyList_New(graph->csr.n))) return nullptr;
+    for (vertex_t v = 0; v < graph->csr.n; ++v) {
+        PyObject *label = GraphLabel(graph, v);
+        if (!label) {
+            Py_DECREF(nodes);
+            return nullptr;
+        }
+        PyList_SET_ITEM(nodes, v, label);
+    }
+    return nodes;
+}
+
+static PyObject *
+Graph_GetOffsets(PyObject *self, void *closure)
+{
+    GraphObject *graph = (GraphObject *) self;
+    CSRLayout layout = GetCSRLayout(graph->csr.n, graph->csr.m, false);
+    (void) closure;  // Unused parameter
+    return Graph_Array(graph, layout.offsets, (size_t) graph->csr.n + 1,
+                       sizeof(edge_t), EDGE_FORMAT);
+}
+
+static PyObject *
+Graph_GetTargets(PyObject *self, void *closure)
+{
+    GraphObject *graph = (GraphObject *) self;
+    CSRLayout layout = GetCSRLayout(graph->csr.n, graph->csr.m, false);
+    (void) closure;  // Unused parameter
+    return Graph_Array(graph, layout.targets, (size_t) graph->csr.m,
+                       sizeof(vertex_t), VERTEX_FORMAT);
+}
+
+static PyObject *
+Graph_GetWeights(PyObject *self, void *closure)
+{
+    GraphObject *graph = (GraphObject *) self;
+    CSRLayout layout = GetCSRLayout(graph->csr.n, graph->csr.m, true);
+    (void) closure;  // Unused parameter
+    if (!graph->csr.weights) Py_RETURN_NONE;
+    return Graph_Array(graph, layout.weights, (size_t) graph->csr.m,
+                       sizeof(double), WEIGHT_FORMAT);
+}
+
+PyDoc_STRVAR(Graph_FromEdges_doc,
+"from_edges(sources, targets, num_nodes=None, weights=None) -> Graph\n\n"
+"Build a graph from parallel buffers of integers (e.g., array.array objects),\n"
+"with an edge from sources[i] to targets[i] for each i, of weight weights[i]\n"
+"if a buffer of weights is given. The nodes are the integers 0, 1, ...,\n"
+"num_nodes - 1, and num_nodes defaults to one more than the largest node in\n"
+"either buffer.");
+
+PyDoc_STRVAR(Graph_Load_doc,
+"load(path, validate=True) -> Graph\n\n"
+"Load a graph written by save() or convert_edge_list(). The file is\n"
+"memory-mapped read-only and the graph's arrays are used in place, so\n"
+"processes loading the same file share its pages in the page cache.\n\n"
+"The arrays are checked for consistency in time linear in the size of the\n"
+"graph, which is still far faster than parsing an edge list. Pass\n"
+"validate=False to skip the check and load in constant time (apart from\n"
+"unpickling node labels, if any), but only for trusted files: a corrupt\n"
+"file can then crash the interpreter. The labels are unpickled either way.");
+
+PyDoc_STRVAR(Graph_Save_doc,
+"save(path)\n\n"
+"Write the graph to a file in a versioned binary format: a header, the CSR\n"
+"arrays exactly as they're laid out in memory, and the pickled node labels\n"
+"(unless the nodes are just 0, 1, ..., num_nodes - 1).");
+
+static PyMethodDef Graph_Methods[] = {
+    {
+        "from_edges",                               // ml_name
+        (PyCFunction) Graph_FromEdges,              // ml_meth
+        METH_VARARGS | METH_KEYWORDS | METH_CLASS,  // ml_flags
+        Graph_FromEdges_doc,                        // ml_doc
+    },
+    {
+        "load",
+        (PyCFunction) Graph_Load,
+        METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+        Graph_Load_doc,
+    },
+    {
+        "save",
+        Graph_Save,
+        METH_O,
+        Graph_Save_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyGetSetDef Graph_GetSet[] = {
+    {
+        (char *) "num_nodes",                       // name
+        Graph_GetNumNodes,                          // get
+        nullptr,                                    // set
+        (char *) "Number of nodes in the graph.",   // doc
+        nullptr,                                    // closure
+    },
+    {
+        (char *) "num_edges",
+        Graph_GetNumEdges,
+        nullptr,
+        (char *) "Number of edges in the graph.",
+        nullptr,
+    },
+    {
+        (char *) "nodes",
+        Graph_GetNodes,
+        nullptr,
+        (char *) "List of node labels, ordered by their internal ids.",
+        nullptr,
+    },
+    {
+        (char *) "offsets",
+        Graph_GetOffsets,
+        nullptr,
+        (char *) "CSR offsets array: the neighbors of node id i are\n"
+                 "targets[offsets[i]:offsets[i + 1]].",
+        nullptr,
+    },
+    {
+        (char *) "targets",
+        Graph_GetTargets,
+        nullptr,
+        (char *) "CSR targets array (node ids).",
+        nullptr,
+    },
+    {
+        (char *) "weights",
+        Graph_GetWeights,
+        nullptr,
+        (char *) "Edge weights, parallel to targets (None if unweighted).",
+        nullptr,
+    },
+    {nullptr, nullptr, nullptr, nullptr, nullptr}  // Sentinel
+};
+
+PyDoc_STRVAR(Graph_Type_doc,
+"Graph(adjacency, weight=None)\n\n"
+"Directed graph stored in compressed sparse row (CSR) form.\n\n"
+"The adjacency list (e.g., {0: [1, 2], 1: [2]}) is converted once into flat\n"
+"arrays of node ids, so traversals don't have to touch Python objects for\n"
+"every edge. Nodes keep their original labels, which are returned by the\n"
+"traversals. If the adjacency lists are mappings (e.g., {0: {1: 0.5}}), the\n"
+"graph is weighted, with edge weights given by the values of the mappings\n"
+"(or by value[weight], if weight is given).\n\n"
+">>> graph = Graph({'a': ['b', 'c'], 'b': ['c']})\n"
+">>> graph.num_nodes, graph.num_edges\n"
+"(3, 3)\n"
+">>> list(bfs(graph, 'a'))\n"
+"['a', 'b', 'c']");
+
+static PyType_Slot Graph_Slots[] = {
+    {Py_tp_dealloc, (void *) Graph_Dealloc},
+    {Py_tp_repr, (void *) Graph_Repr},
+    {Py_sq_length, (void *) Graph_Length},
+    {Py_sq_contains, (void *) Graph_Contains},
+    {Py_tp_doc, (void *) Graph_Type_doc},
+    {Py_tp_methods, Graph_Methods},
+    {Py_tp_getset, Graph_GetSet},
+    {Py_tp_new, (void *) Graph_New},
+    {0, nullptr}  // Sentinel
+};
+
+static PyType_Spec Graph_Spec = {
+    "algorithms.graph.Graph",           /* name */
+    sizeof(GraphObject),                /* basicsize */
+    0,                                  /* itemsize */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,  /* flags */
+    Graph_Slots,                        /* slots */
+};
+
+// Convert an iterable of node labels into a vector of vertices of a graph
+static int
+GetVertices(GraphObject *graph, PyObject *labels, std::vector<vertex_t> &out)
+{
+    PyObject *it, *label;
+    vertex_t v;
+
+    if (!(it = PyObject_GetIter(labels))) return 0;
+    while ((label = PyIter_Next(it))) {
+        v = GraphVertex(graph, label);
+        Py_DECREF(label);
+        if (v < 0) break;
+        try {
+            out.push_back(v);
+        } catch (const std::bad_alloc &) {
+            PyErr_NoMemory();
+            break;
+        }
+    }
+    Py_DECREF(it);
+    return !PyErr_Occurred();
+}
+
+// Breath-first search traversal of a directed graph, represented either as an
+// adjacency list or as a Graph object
+
+// Level-synchronous BFS frontier: `current` holds the nodes at the depth being
+// visited (the ones before position `head` have already been visited), and
+// `next` collects the nodes at the following depth. If parents are requested,
+// the parents of the nodes are kept in parallel vectors
+template <typename Node>
+struct Frontier {
+    std::vector<Node> current, next;
+    std::vector<Node> current_parents, next_parents;
+    size_t head = 0;
+
+    // Move on to the next level once the current one has been visited,
+    // returning false if there is no next level
+    bool advance()
+    {
+        if (head < current.size()) return true;
+        if (next.empty()) return false;
+        current.swap(next);
+        current_parents.swap(next_parents);
+        next.clear();
+        next_parents.clear();
+        head = 0;
+        return true;
+    }
+};
 
 typedef struct {
     PyObject_HEAD
     PyObject *graph;
+    Py_ssize_t depth;                   // Depth of the current level
+    Py_ssize_t max_depth;               // Negative if unlimited
+    int with_depth;
+    int with_parent;
+    // Number of targets which haven't been visited yet, or -1 if the traversal
+    // has no targets (in which case it visits every reachable node)
+    Py_ssize_t remaining;
+    // Traversal state when the graph is an adjacency list: all the nodes in
+    // the frontier are strong references
     PyObject *visited;
-    std::queue<PyObject *> *queue;
+    PyObject *targets_set;
+    Frontier<PyObject *> *objects;
+    // Traversal state when the graph is a Graph object
+    Bitset *seen;
+    Bitset *targets;
+    Frontier<vertex_t> *vertices;
 } BFSObject;
 
-// Instantiate a new BFSObject from a graph and a distinguished root node
+// Instantiate a new BFSObject traversing a Graph object
+static int
+BFS_InitCSR(BFSObject *bfs, GraphObject *graph, PyObject *roots,
+            PyObject *targets)
+{
+    std::vector<vertex_t> vertices;
+
+    if (!GetVertices(graph, roots, vertices)) return 0;
+    try {
+        bfs->seen = new Bitset((size_t) graph->csr.n);
+        bfs->vertices = new Frontier<vertex_t>();
+        for (vertex_t v : vertices) {
+            if (bfs->seen->test_and_set((size_t) v)) continue;  // Duplicate
+            bfs->vertices->current.push_back(v);
+            if (bfs->with_parent) bfs->vertices->current_parents.push_back(-1);
+        }
+        if (targets) {
+            vertices.clear();
+            if (!GetVertices(graph, targets, vertices)) return 0;
+            bfs->targets = new Bitset((size_t) graph->csr.n);
+            bfs->remaining = 0;
+            for (vertex_t v : vertices)
+                if (!bfs->targets->test_and_set((size_t) v)) ++bfs->remaining;
+        }
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    return 1;
+}
+
+// Instantiate a new BFSObject traversing an adjacency list
+static int
+BFS_InitMapping(BFSObject *bfs, PyObject *roots, PyObject *targets)
+{
+    PyObject *it, *root;
+    int status;
+
+    if (!(bfs->visited = PySet_New(nullptr))) return 0;
+    if (!(bfs->objects = new(std::nothrow) Frontier<PyObject *>())) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    if (targets) {
+        if (!(bfs->targets_set = PySet_New(targets))) return 0;
+        bfs->remaining = PySet_GET_SIZE(bfs->targets_set);
+    }
+
+    // Mark the root nodes as visited and put them in the frontier
+    // We mark nodes as visited while they're still in the frontier to avoid
+    // putting duplicate nodes in the frontier. This way we don't have to check
+    // if a node has been visited when we visit it, and we save on some memory
+    if (!(it = PyObject_GetIter(roots))) return 0;
+    while ((root = PyIter_Next(it))) {
+        if ((status = PySet_Contains(bfs->visited, root))
+                || PySet_Add(bfs->visited, root) < 0) {
+            Py_DECREF(root);
+            if (status > 0) continue;  // Duplicate root
+            break;
+        }
+        try {
+            if (bfs->with_parent) {
+                bfs->objects->current_parents.push_back(Py_None);
+                Py_INCREF(Py_None);
+            }
+            bfs->objects->current.push_back(root);  // Steals the reference
+        } catch (const std::bad_alloc &) {
+            Py_DECREF(root);
+            PyErr_NoMemory();
+            break;
+        }
+    }
+    Py_DECREF(it);
+    return !PyErr_Occurred();
+}
+
+// Parameters of bfs(graph, root=None, *, roots=None, targets=None,
+// with_depth=False, with_parent=False, max_depth=None)
+static const char *const BFS_Keywords[] = {"graph", "root", "roots", "targets",
+                                           "with_depth", "with_parent",
+                                           "max_depth", nullptr};
+static ArgParser BFS_Parser = {"bfs", BFS_Keywords, 1, 2};
+
+// Instantiate a new BFSObject from a graph and distinguished root node(s),
+// given the arguments matched to the parameters of BFS_Parser
 static PyObject *
-BFS_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+BFS_Create(PyTypeObject *type, PyObject **argv)
 {
-    PyObject *graph;
-    PyObject *root;
-    PyObject *visited = nullptr;
-    std::queue<PyObject *> *queue = nullptr;
-    BFSObject *bfs = nullptr;
+    GraphState *state = GetTypeState(type);
+    PyObject *graph = argv[0];
+    PyObject *root = argv[1];
+    PyObject *roots = argv[2];
+    PyObject *targets = argv[3];
+    PyObject *max_depth = argv[6] ? argv[6] : Py_None;
+    int with_depth = argv[4] ? PyObject_IsTrue(argv[4]) : 0;
+    int with_parent = argv[5] ? PyObject_IsTrue(argv[5]) : 0;
+    BFSObject *bfs;
+    int status;
 
-    // Parse arguments
-    static const char *format = "OO";
-    static const char *keywords[] = {"graph", "root", nullptr};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
-                                     &graph, &root))
-        return nullptr;
+    if (!state || with_depth < 0 || with_parent < 0) return nullptr;
 
     // The graph must support the mapping protocol (it should be the adjacency
-    // list representation of a graph)
-    if (!PyMapping_Check(graph)) {
-        PyErr_SetString(PyExc_TypeError, "bfs() expects a mapping type");
+    // list representation of a graph) or be a Graph object
+    if (!Graph_Check(state, graph) && !PyMapping_Check(graph)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "bfs() expects a mapping type or a Graph");
         return nullptr;
     }
+    if (!root == !roots) {
+        PyErr_SetString(PyExc_TypeError,
+                        "bfs() expects exactly one of root and roots");
+        return nullptr;
+    }
+    if (targets == Py_None) targets = nullptr;
 
-    // Allocate memory needed for the traversal
-    if (!(queue = new(std::nothrow) std::queue<PyObject *>())) goto fail;
-    if (!(visited = PySet_New(nullptr))) goto fail;
-    if (!(bfs = (BFSObject *) type->tp_alloc(type, 0))) goto fail;
-
-    // Finalize the creation of the new BFS object
+    if (!(bfs = (BFSObject *) type->tp_alloc(type, 0))) return nullptr;
     Py_INCREF(graph);
     bfs->graph = graph;
-    bfs->visited = visited;
-    bfs->queue = queue;
-
-    // Mark the root node as visited and put it in the queue
-    // We mark nodes as visited while they're still in the queue to avoid
-    // putting duplicate nodes in the queue. This way we don't have to check if
-    // a node has been visited when we pop from the queue, and we save on some
-    // queue memory
-    Py_INCREF(root);
-    if (PySet_Add(bfs->visited, root) < 0) {
-        Py_DECREF(root);
+    bfs->with_depth = with_depth;
+    bfs->with_parent = with_parent;
+    bfs->max_depth = -1;
+    bfs->remaining = -1;
+    if (max_depth != Py_None) {
+        bfs->max_depth = PyLong_AsSsize_t(max_depth);
+        if (bfs->max_depth == -1 && PyErr_Occurred()) goto fail;
+        if (bfs->max_depth < 0) {
+            PyErr_SetString(PyExc_ValueError, "max_depth must be non-negative");
+            goto fail;
+        }
+    }
+
+    if (root && !(roots = PyTuple_Pack(1, root))) goto fail;
+    else if (!root) Py_INCREF(roots);
+    if (Graph_Check(state, graph))
+        status = BFS_InitCSR(bfs, (GraphObject *) graph, roots, targets);
+    else
+        status = BFS_InitMapping(bfs, roots, targets);
+    Py_DECREF(roots);
+    if (!status) goto fail;
+    // Without targets to find, the traversal would be over before visiting
+    // even the roots, which is more likely a mistake than what was meant
+    if (targets && !bfs->remaining) {
+        PyErr_SetString(PyExc_ValueError, "bfs() expects at least one target");
         goto fail;
     }
-    Py_INCREF(root);
-    bfs->queue->push(root);
 
     return (PyObject *) bfs;
 
 fail:
     // Avoid memory leaks on failure
-    if (visited) Py_DECREF(visited);
-    if (queue) delete queue;
+    Py_DECREF(bfs);
     return nullptr;
 }
 
+static PyObject *
+BFS_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *argv[7];
+    if (!ParseTupleArgs(&BFS_Parser, args, kwargs, argv)) return nullptr;
+    return BFS_Create(type, argv);
+}
+
+// Calling the bfs type goes through here instead of BFS_New, which skips
+// packing the arguments into a tuple and a dict only to unpack them again.
+// Traversals are often created in loops over many roots, so this matters
+static PyObject *
+BFS_Vectorcall(PyObject *type, PyObject *const *args, size_t nargsf,
+               PyObject *kwnames)
+{
+    PyObject *argv[7];
+    if (!ParseArgs(&BFS_Parser, args, PyVectorcall_NARGS(nargsf), kwnames,
+                   argv))
+        return nullptr;
+    return BFS_Create((PyTypeObject *) type, argv);
+}
+
 // Deallocate all memory and destroy all references associated with a BFSObject
 static void
 BFS_Dealloc(PyObject *self)
 {
     BFSObject *bfs = (BFSObject *) self;
+    PyTypeObject *type = Py_TYPE(self);
     Py_DECREF(bfs->graph);
-    Py_DECREF(bfs->visited);
-    while (!(bfs->queue->empty())) {
-        PyObject *node = bfs->queue->front();
-        Py_DECREF(node);
-        bfs->queue->pop();
+    Py_XDECREF(bfs->visited);
+    Py_XDECREF(bfs->targets_set);
+    if (Frontier<PyObject *> *objects = bfs->objects) {
+        // Only the nodes which haven't been visited yet are still owned by the
+        // frontier
+        for (size_t i = objects->head; i < objects->current.size(); ++i)
+            Py_DECREF(objects->current[i]);
+        for (size_t i = objects->head; i < objects->current_parents.size(); ++i)
+            Py_DECREF(objects->current_parents[i]);
+        for (PyObject *node : objects->next) Py_DECREF(node);
+        for (PyObject *node : objects->next_parents) Py_DECREF(node);
+        delete objects;
     }
-    delete bfs->queue;
-    Py_TYPE(bfs)->tp_free(bfs);
+    delete bfs->seen;
+    delete bfs->targets;
+    delete bfs->vertices;
+    type->tp_free(bfs);
+    Py_DECREF(type);
 }
 
-// Get the next node in the traversal, or NULL if there are no more nodes
+// Build the item yielded for a visited node, stealing the references to `node`
+// and `parent` (either of which may be NULL on failure). The item is the node
+// itself, or a tuple (node, depth), (node, parent), or (node, depth, parent)
 static PyObject *
-BFS_Next(PyObject *self)
+BFS_Item(BFSObject *bfs, PyObject *node, PyObject *parent)
 {
-    BFSObject *bfs = (BFSObject *) self;
-    PyObject *node, *neighbors, *neighbors_it;
-    int status;
+    PyObject *item, *depth = nullptr;
+
+    if (!node || (bfs->with_parent && !parent)) goto fail;
+    if (!bfs->with_depth && !bfs->with_parent) return node;
+    if (bfs->with_depth && !(depth = PyLong_FromSsize_t(bfs->depth))) goto fail;
+
+    if (!(item = PyTuple_New(1 + bfs->with_depth + bfs->with_parent)))
+        goto fail;
+    PyTuple_SET_ITEM(item, 0, node);
+    if (depth) PyTuple_SET_ITEM(item, 1, depth);
+    if (parent) PyTuple_SET_ITEM(item, 1 + bfs->with_depth, parent);
+    return item;
+
+fail:
+    Py_XDECREF(node);
+    Py_XDECREF(parent);
+    Py_XDECREF(depth);
+    return nullptr;
+}
+
+// Move on to the next level of the traversal if the current one has been
+// visited, returning 0 if there are no more nodes
+template <typename Node>
+static int
+BFS_Advance(BFSObject *bfs, Frontier<Node> *frontier)
+{
+    if (bfs->remaining == 0) return 0;  // Every target has been visited
+    if (frontier->head == frontier->current.size()) {
+        if (!frontier->advance()) return 0;
+        ++bfs->depth;
+    }
+    return 1;
+}
+
+// Whether the neighbors of nodes at the current level should be explored
+static inline int
+BFS_Expanding(BFSObject *bfs)
+{
+    return bfs->remaining != 0
+        && (bfs->max_depth < 0 || bfs->depth < bfs->max_depth);
+}
+
+// Get the next node in the traversal of a Graph object, or NULL if there are no
+// more nodes. Only the visited nodes' labels are ever turned into Python objects
+static PyObject *
+BFS_NextCSR(BFSObject *bfs)
+{
+    GraphObject *graph = (GraphObject *) bfs->graph;
+    const CSRGraph &csr = graph->csr;
+    Frontier<vertex_t> *frontier = bfs->vertices;
+    PyObject *parent = nullptr;
+    vertex_t u, p;
+
+    if (!BFS_Advance(bfs, frontier)) return nullptr;  // Traversal has finished
+    u = frontier->current[frontier->head];
+    p = bfs->with_parent ? frontier->current_parents[frontier->head] : -1;
+    ++frontier->head;
+    if (bfs->targets && bfs->targets->test((size_t) u)) --bfs->remaining;
+
+    if (BFS_Expanding(bfs)) {
+        try {
+            for (edge_t e = csr.offsets[u]; e < csr.offsets[u + 1]; ++e) {
+                vertex_t v = csr.targets[e];
+                if (!bfs->seen->test_and_set((size_t) v)) {
+                    frontier->next.push_back(v);
+                    if (bfs->with_parent) frontier->next_parents.push_back(u);
+                }
+            }
+        } catch (const std::bad_alloc &) {
+            return PyErr_NoMemory();
+        }
+    }
 
-    if (bfs->queue->empty()) return nullptr;  // Traversal has finished
+    if (bfs->with_parent) {
+        if (p < 0) {
+            Py_INCREF(Py_None);
+            parent = Py_None;
+        } else {
+            parent = GraphLabel(graph, p);
+        }
+    }
+    return BFS_Item(bfs, GraphLabel(graph, u), parent);
+}
 
-    // Nodes in the queue are guaranteed to be visited exactly once
-    node = bfs->queue->front();
-    bfs->queue->pop();
+// Add the unvisited neighbors of a node in an adjacency list to the next level
+// of the traversal. Returns 0 on failure
+static int
+BFS_ExpandMapping(BFSObject *bfs, PyObject *node)
+{
+    Frontier<PyObject *> *frontier = bfs->objects;
+    PyObject *neighbors, *neighbors_it;
+    int status;
 
     // Get the neighbors of the current node
     if (!(neighbors = PyObject_GetItem(bfs->graph, node))) {
-        Py_DECREF(node);
         if (PyErr_ExceptionMatches(PyExc_KeyError)) {
             // There is no adjacency list for the given node, which we interpret
             // as the node having zero outgoing edges
             PyErr_Clear();
-            return node;
+            return 1;
         }
-        return nullptr;
+        return 0;
     }
 
     // The neighbors object must be iterable
-    if (!(neighbors_it = PyObject_GetIter(neighbors))) {
-        Py_DECREF(node);
-        Py_DECREF(neighbors);
-        return nullptr;
-    }
+    neighbors_it = PyObject_GetIter(neighbors);
     Py_DECREF(neighbors);
+    if (!neighbors_it) return 0;
 
-    // Add the unvisited neighbors of the current node to the queue
     while (PyObject *neighbor = PyIter_Next(neighbors_it)) {
         if ((status = PySet_Contains(bfs->visited, neighbor))) {
             Py_DECREF(neighbor);
             if (status < 0) {
                 // The containment check failed
-                Py_DECREF(node);
                 Py_DECREF(neighbors_it);
-                return nullptr;
+                return 0;
             }
             // The current neighbor has already been visited
             continue;
         }
 
-        // Mark this neighbor as visited
+        // Mark this neighbor as visited, handing our reference to it over to
+        // the frontier
         if (PySet_Add(bfs->visited, neighbor) < 0) {
-            Py_DECREF(node);
             Py_DECREF(neighbor);
             Py_DECREF(neighbors_it);
+            return 0;
+        }
+        try {
+            frontier->next.push_back(neighbor);
+        } catch (const std::bad_alloc &) {
+            Py_DECREF(neighbor);
+            Py_DECREF(neighbors_it);
+            PyErr_NoMemory();
+            return 0;
+        }
+        if (bfs->with_parent) {
+            try {
+                frontier->next_parents.push_back(node);
+                Py_INCREF(node);
+            } catch (const std::bad_alloc &) {
+                // Keep the frontier vectors parallel
+                frontier->next.pop_back();
+                Py_DECREF(neighbor);
+                Py_DECREF(neighbors_it);
+                PyErr_NoMemory();
+                return 0;
+            }
+        }
+    }
+    Py_DECREF(neighbors_it);
+    return !PyErr_Occurred();
+}
+
+// Get the next node in a locked traversal, or NULL if there are no more nodes
+static PyObject *
+BFS_NextItem(BFSObject *bfs)
+{
+    Frontier<PyObject *> *frontier = bfs->objects;
+    PyObject *node, *parent = nullptr;
+
+    if (bfs->vertices) return BFS_NextCSR(bfs);
+
+    if (!BFS_Advance(bfs, frontier)) return nullptr;  // Traversal has finished
+
+    // Nodes in the frontier are guaranteed to be visited exactly once, and we
+    // take over the frontier's references to them
+    node = frontier->current[frontier->head];
+    if (bfs->with_parent) parent = frontier->current_parents[frontier->head];
+    ++frontier->head;
+    if (bfs->targets_set) {
+        int status = PySet_Discard(bfs->targets_set, node);
+        if (status > 0) --bfs->remaining;
+        if (status < 0) {
+            Py_DECREF(node);
+            Py_XDECREF(parent);
             return nullptr;
         }
-        Py_INCREF(neighbor);
-        bfs->queue->push(neighbor);
     }
-    if (PyErr_Occurred()) {
+
+    if (BFS_Expanding(bfs) && !BFS_ExpandMapping(bfs, node)) {
         Py_DECREF(node);
-        Py_DECREF(neighbors_it);
+        Py_XDECREF(parent);
         return nullptr;
     }
-    Py_DECREF(neighbors_it);
-
-    return node;
+    return BFS_Item(bfs, node, parent);
 }
 
-PyDoc_STRVAR(BFS_Type_doc,
-"bfs(graph, root)\n\n"
-"Breadth-first traversal of a directed graph, starting at root.\n\n"
-"The graph should be represented as an adjacency list (e.g., the graph\n"
-"0 -> 1 -> 2 is represented as the dict {0: [1], 1: [2]}). Note that we don't\n"
-"include 2 as a key in the dictionary; this is interpreted as 2 having no\n"
-"outgoing edges.\n\n"
-">>> graph = {0: [1, 2], 1: [3, 4], 2: [5, 6], 4: [4, 5, 6, 0]}\n"
-">>> b = bfs(graph, 0)\n"
-">>> list(b)\n"
-"[0, 1, 2, 3, 4, 5, 6]");
-
-static PyTypeObject BFS_Type = {
-    PyVarObject_HEAD_INIT(&PyType_Type, 0)
-    "bfs",                              /* tp_name */
-    sizeof(BFSObject),                  /* tp_basicsize */
-    0,                                  /* tp_itemsize */
-    BFS_Dealloc,                        /* tp_dealloc */
-    0,                                  /* tp_print */
-    0,                                  /* tp_getattr */
-    0,                                  /* tp_setattr */
-    0,                                  /* tp_reserved */
-    0,                                  /* tp_repr */
-    0,                                  /* tp_as_number */
-    0,                                  /* tp_as_sequence */
-    0,                                  /* tp_as_mapping */
-    0,                                  /* tp_hash */
-    0,                                  /* tp_call */
-    0,                                  /* tp_str */
-    0,                                  /* tp_getattro */
-    0,                                  /* tp_setattro */
-    0,                                  /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT,                 /* tp_flags */
-    BFS_Type_doc,                       /* tp_doc */
-    0,                                  /* tp_traverse */
-    0,                                  /* tp_clear */
-    0,                                  /* tp_richcompare */
-    0,                                  /* tp_weaklistoffset */
-    PyObject_SelfIter,                  /* tp_iter */
-    BFS_Next,                           /* tp_iternext */
-    0,                                  /* tp_methods */
-    0,                                  /* tp_members */
-    0,                                  /* tp_getset */
-    0,                                  /* tp_base */
-    0,                                  /* tp_dict */
-    0,                                  /* tp_descr_get */
-    0,                                  /* tp_descr_set */
-    0,                                  /* tp_dictoffset */
-    0,                                  /* tp_init */
-    PyType_GenericAlloc,                /* tp_alloc */
-    BFS_New,                            /* tp_new */
-};
+static PyObject *
+BFS_Next(PyObject *self)
+{
+    PyObject *item;
 
-static struct PyModuleDef graphmodule = {
-   PyModuleDef_HEAD_INIT,
-   "algorithms.graph",                  /* m_name */
-   "Graph algorithms.",                 /* m_doc */
-   -1,                                  /* m_size */
-};
+    Py_BEGIN_CRITICAL_SECTION(self);
+    item = BFS_NextItem((BFSObject *) self);
+    Py_END_CRITICAL_SECTION();
+    return item;
+}
 
-PyMODINIT_FUNC
-PyInit_graph(void)
+// Append up to `n` more items of a locked traversal to a list
+static int
+BFS_Extend(BFSObject *bfs, PyObject *list, size_t n)
 {
-    PyObject *module = PyModule_Create(&graphmodule);
-    if (!module)
-        return NULL;
+    for (; n; --n) {
+        PyObject *item = BFS_NextItem(bfs);
+        if (!item) return !PyErr_Occurred();
+        int status = PyList_Append(list, item);
+        Py_DECREF(item);
+        if (status < 0) return 0;
+    }
+    return 1;
+}
 
-    if (PyType_Ready(&BFS_Type) < 0)
-        return NULL;
-    Py_INCREF(&BFS_Type);
-    PyModule_AddObject(module, "bfs", (PyObject *) &BFS_Type);
+static PyObject *
+BFS_NextBatch(PyObject *self, PyObject *arg)
+{
+    Py_ssize_t n = PyLong_AsSsize_t(arg);
+    PyObject *batch;
+    int status;
 
-    return module;
+    if (n == -1 && PyErr_Occurred()) return nullptr;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "batch size must be non-negative");
+        return nullptr;
+    }
+    if (!(batch = PyList_New(0))) return nullptr;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    status = BFS_Extend((BFSObject *) self, batch, (size_t) n);
+    Py_END_CRITICAL_SECTION();
+    if (!status) {
+        Py_DECREF(batch);
+        return nullptr;
+    }
+    return batch;
+}
+
+static PyObject *
+BFS_Level(PyObject *self, PyObject *args)
+{
+    BFSObject *bfs = (BFSObject *) self;
+    PyObject *level;
+    size_t n;
+    int status;
+
+    (void) args;  // Unused parameter
+
+    if (!(level = PyList_New(0))) return nullptr;
+
+    // Visit whatever remains of the current level, which doesn't move on to
+    // the next level until the last node has been visited
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if (bfs->vertices) {
+        n = BFS_Advance(bfs, bfs->vertices)
+            ? bfs->vertices->current.size() - bfs->vertices->head : 0;
+    } else {
+        n = BFS_Advance(bfs, bfs->objects)
+            ? bfs->objects->current.size() - bfs->objects->head : 0;
+    }
+    status = BFS_Extend(bfs, level, n);
+    Py_END_CRITICAL_SECTION();
+    if (!status) {
+        Py_DECREF(level);
+        return nullptr;
+    }
+    return level;
+}
+
+PyDoc_STRVAR(BFS_NextBatch_doc,
+"next_batch(n) -> list\n\n"
+"Return the next n items of the traversal (fewer if the traversal ends).");
+
+PyDoc_STRVAR(BFS_Level_doc,
+"level() -> list\n\n"
+"Return the remaining items at the current depth, or the items at the next\n"
+"depth if the current one is finished (an empty list when the traversal ends).");
+
+static PyMethodDef BFS_Methods[] = {
+    {
+        "next_batch",                   // ml_name
+        BFS_NextBatch,                  // ml_meth
+        METH_O,                         // ml_flags
+        BFS_NextBatch_doc,              // ml_doc
+    },
+    {
+        "level",
+        BFS_Level,
+        METH_NOARGS,
+        BFS_Level_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+PyDoc_STRVAR(BFS_Type_doc,
+"bfs(graph, root, *, with_depth=False, with_parent=False, max_depth=None)\n"
+"bfs(graph, *, roots, targets=None, with_depth=False, with_parent=False,\n"
+"    max_depth=None)\n\n"
+"Breadth-first traversal of a directed graph, starting at root (or at every\n"
+"node in roots at once). If targets is given, the traversal stops as soon as\n"
+"every target has been visited, and it must not be empty.\n\n"
+"The graph should be represented as an adjacency list (e.g., the graph\n"
+"0 -> 1 -> 2 is represented as the dict {0: [1], 1: [2]}). Note that we don't\n"
+"include 2 as a key in the dictionary; this is interpreted as 2 having no\n"
+"outgoing edges. The graph may also be a Graph object, which is much faster\n"
+"to traverse.\n\n"
+">>> graph = {0: [1, 2], 1: [3, 4], 2: [5, 6], 4: [4, 5, 6, 0]}\n"
+">>> b = bfs(graph, 0)\n"
+">>> list(b)\n"
+"[0, 1, 2, 3, 4, 5, 6]\n\n"
+"If with_depth or with_parent is true, the traversal yields tuples (node,\n"
+"depth), (node, parent), or (node, depth, parent) instead, where the root's\n"
+"parent is None. Nodes deeper than max_depth are not visited.\n\n"
+">>> b = bfs(graph, 0, with_depth=True)\n"
+">>> b.level(), b.next_batch(3)\n"
+"([(0, 0)], [(1, 1), (2, 1), (3, 2)])");
+
+static PyType_Slot BFS_Slots[] = {
+    {Py_tp_dealloc, (void *) BFS_Dealloc},
+    {Py_tp_doc, (void *) BFS_Type_doc},
+    {Py_tp_iter, (void *) PyObject_SelfIter},
+    {Py_tp_iternext, (void *) BFS_Next},
+    {Py_tp_methods, BFS_Methods},
+    {Py_tp_new, (void *) BFS_New},
+    {0, nullptr}  // Sentinel
+};
+
+static PyType_Spec BFS_Spec = {
+    "algorithms.graph.bfs",             /* name */
+    sizeof(BFSObject),                  /* basicsize */
+    0,                                  /* itemsize */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,  /* flags */
+    BFS_Slots,                          /* slots */
+};
+
+// Depth-first search traversal of a directed graph, represented either as an
+// adjacency list or as a Graph object. The recursion of the textbook algorithm
+// is replaced by an explicit stack of frames, each holding a node and the
+// traversal's position in its adjacency list, so arbitrarily deep graphs can
+// be traversed
+
+#define DFS_PREORDER 1
+#define DFS_POSTORDER 2
+#define DFS_EVENTS (DFS_PREORDER | DFS_POSTORDER)
+
+// Stack frame of a traversal of an adjacency list: strong references to a node
+// and to an iterator over its neighbors (NULL if it has no adjacency list)
+struct MappingFrame {
+    PyObject *node;
+    PyObject *neighbors;
+};
+
+// Stack frame of a traversal of a Graph object: a vertex and its next out-edge
+struct CSRFrame {
+    vertex_t vertex;
+    edge_t next;
+};
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *graph;
+    int order;                          // Which of DFS_PREORDER/POSTORDER
+    // Events yielded with order="events", from the state of the module
+    PyObject *pre;
+    PyObject *post;
+    // Traversal state when the graph is an adjacency list: an iterator over
+    // the roots (the graph's keys if none were given)
+    PyObject *roots;
+    PyObject *visited;
+    std::vector<MappingFrame> *objects;
+    // Traversal state when the graph is a Graph object: the roots are every
+    // vertex if `root_vertices` is NULL
+    std::vector<vertex_t> *root_vertices;
+    size_t next_root;
+    Bitset *seen;
+    std::vector<CSRFrame> *vertices;
+} DFSObject;
+
+// Instantiate a new DFSObject traversing a Graph object
+static int
+DFS_InitCSR(DFSObject *dfs, GraphObject *graph, PyObject *roots)
+{
+    try {
+        if (roots) {
+            dfs->root_vertices = new std::vector<vertex_t>();
+            if (!GetVertices(graph, roots, *dfs->root_vertices)) return 0;
+        }
+        dfs->seen = new Bitset((size_t) graph->csr.n);
+        dfs->vertices = new std::vector<CSRFrame>();
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    return 1;
+}
+
+// Instantiate a new DFSObject traversing an adjacency list
+static int
+DFS_InitMapping(DFSObject *dfs, PyObject *roots)
+{
+    if (!(dfs->visited = PySet_New(nullptr))) return 0;
+    if (!(dfs->roots = PyObject_GetIter(roots ? roots : dfs->graph))) return 0;
+    if (!(dfs->objects = new(std::nothrow) std::vector<MappingFrame>())) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    return 1;
+}
+
+// Instantiate a new DFSObject from a graph and optional root node(s)
+static PyObject *
+DFS_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *graph;
+    PyObject *root = nullptr;
+    PyObject *roots = nullptr;
+    const char *order = "preorder";
+    GraphState *state = GetTypeState(type);
+    DFSObject *dfs;
+    int status;
+
+    if (!state) return nullptr;
+
+    // Parse arguments
+    static const char *format = "O|O$Os";
+    static const char *keywords[] = {"graph", "root", "roots", "order",
+                                     nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &graph, &root, &roots, &order))
+        return nullptr;
+
+    if (!Graph_Check(state, graph) && !PyMapping_Check(graph)) {
+        PyErr_SetString(PyExc_TypeError,
+                        "dfs() expects a mapping type or a Graph");
+        return nullptr;
+    }
+    if (roots == Py_None) roots = nullptr;
+    if (root && roots) {
+        PyErr_SetString(PyExc_TypeError,
+                        "dfs() expects at most one of root and roots");
+        return nullptr;
+    }
+
+    if (!(dfs = (DFSObject *) type->tp_alloc(type, 0))) return nullptr;
+    Py_INCREF(graph);
+    dfs->graph = graph;
+    Py_INCREF(state->dfs_pre);
+    dfs->pre = state->dfs_pre;
+    Py_INCREF(state->dfs_post);
+    dfs->post = state->dfs_post;
+    if (!strcmp(order, "preorder")) {
+        dfs->order = DFS_PREORDER;
+    } else if (!strcmp(order, "postorder")) {
+        dfs->order = DFS_POSTORDER;
+    } else if (!strcmp(order, "events")) {
+        dfs->order = DFS_EVENTS;
+    } else {
+        PyErr_SetString(PyExc_ValueError,
+                        "order must be 'preorder', 'postorder', or 'events'");
+        goto fail;
+    }
+
+    if (root && !(roots = PyTuple_Pack(1, root))) goto fail;
+    else if (roots) Py_INCREF(roots);
+    if (Graph_Check(state, graph))
+        status = DFS_InitCSR(dfs, (GraphObject *) graph, roots);
+    else
+        status = DFS_InitMapping(dfs, roots);
+    Py_XDECREF(roots);
+    if (!status) goto fail;
+
+    return (PyObject *) dfs;
+
+fail:
+    // Avoid memory leaks on failure
+    Py_DECREF(dfs);
+    return nullptr;
+}
+
+// Deallocate all memory and destroy all references associated with a DFSObject
+static void
+DFS_Dealloc(PyObject *self)
+{
+    DFSObject *dfs = (DFSObject *) self;
+    PyTypeObject *type = Py_TYPE(self);
+    Py_DECREF(dfs->graph);
+    Py_DECREF(dfs->pre);
+    Py_DECREF(dfs->post);
+    Py_XDECREF(dfs->roots);
+    Py_XDECREF(dfs->visited);
+    if (std::vector<MappingFrame> *objects = dfs->objects) {
+        for (MappingFrame &frame : *objects) {
+            Py_DECREF(frame.node);
+            Py_XDECREF(frame.neighbors);
+        }
+        delete objects;
+    }
+    delete dfs->root_vertices;
+    delete dfs->seen;
+    delete dfs->vertices;
+    type->tp_free(dfs);
+    Py_DECREF(type);
+}
+
+// Build the item yielded for a node, stealing the reference to `node` (which
+// may be NULL on failure). The item is the node itself, or a tuple (node,
+// event) if the traversal yields both preorder and postorder events
+static PyObject *
+DFS_Item(DFSObject *dfs, PyObject *node, PyObject *event)
+{
+    PyObject *item;
+
+    if (!node || dfs->order != DFS_EVENTS) return node;
+    item = PyTuple_Pack(2, node, event);
+    Py_DECREF(node);
+    return item;
+}
+
+// Get the next root of a traversal of a Graph object which hasn't been visited
+// yet, returning false if there are none left
+static bool
+DFS_NextRootCSR(DFSObject *dfs, vertex_t *root)
+{
+    const vertex_t n = ((GraphObject *) dfs->graph)->csr.n;
+    std::vector<vertex_t> *roots = dfs->root_vertices;
+
+    while (roots ? dfs->next_root < roots->size()
+                 : dfs->next_root < (size_t) n) {
+        vertex_t v = roots ? (*roots)[dfs->next_root] : (vertex_t) dfs->next_root;
+        ++dfs->next_root;
+        if (!dfs->seen->test((size_t) v)) {
+            *root = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Get the next item of the traversal of a Graph object, or NULL if there are
+// no more items. Only the yielded nodes' labels become Python objects
+static PyObject *
+DFS_NextCSR(DFSObject *dfs)
+{
+    GraphObject *graph = (GraphObject *) dfs->graph;
+    const CSRGraph &csr = graph->csr;
+    std::vector<CSRFrame> &stack = *dfs->vertices;
+    vertex_t v;
+
+    try {
+        while (true) {
+            if (stack.empty()) {
+                // Start a new depth-first tree
+                if (!DFS_NextRootCSR(dfs, &v)) return nullptr;
+            } else {
+                // Descend into the next unvisited neighbor of the top node
+                CSRFrame &top = stack.back();
+                const edge_t end = csr.offsets[top.vertex + 1];
+                while (top.next < end
+                        && dfs->seen->test((size_t) csr.targets[top.next]))
+                    ++top.next;
+                if (top.next == end) {
+                    // Every neighbor has been visited, so leave the node
+                    v = top.vertex;
+                    stack.pop_back();
+                    if (dfs->order & DFS_POSTORDER)
+                        return DFS_Item(dfs, GraphLabel(graph, v), dfs->post);
+                    continue;
+                }
+                v = csr.targets[top.next++];
+            }
+
+            dfs->seen->set((size_t) v);
+            stack.push_back(CSRFrame{v, csr.offsets[v]});
+            if (dfs->order & DFS_PREORDER)
+                return DFS_Item(dfs, GraphLabel(graph, v), dfs->pre);
+        }
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+}
+
+// Get the next node from an iterator which hasn't been visited yet, or NULL if
+// there are none left (or on failure)
+static PyObject *
+DFS_NextUnvisited(DFSObject *dfs, PyObject *it)
+{
+    PyObject *node;
+    int status;
+
+    while ((node = PyIter_Next(it))) {
+        if (!(status = PySet_Contains(dfs->visited, node))) return node;
+        Py_DECREF(node);
+        if (status < 0) return nullptr;
+    }
+    return nullptr;
+}
+
+// Get the next item of a locked traversal, or NULL if there are no more items
+static PyObject *
+DFS_NextItem(DFSObject *dfs)
+{
+    PyObject *node, *neighbors;
+
+    if (dfs->vertices) return DFS_NextCSR(dfs);
+
+    std::vector<MappingFrame> &stack = *dfs->objects;
+    while (true) {
+        if (stack.empty()) {
+            // Start a new depth-first tree
+            if (!(node = DFS_NextUnvisited(dfs, dfs->roots))) return nullptr;
+        } else if (!stack.back().neighbors
+                   || !(node = DFS_NextUnvisited(dfs, stack.back().neighbors))) {
+            if (PyErr_Occurred()) return nullptr;
+
+            // Every neighbor has been visited, so leave the node, taking over
+            // the stack's reference to it
+            node = stack.back().node;
+            Py_XDECREF(stack.back().neighbors);
+            stack.pop_back();
+            if (dfs->order & DFS_POSTORDER)
+                return DFS_Item(dfs, node, dfs->post);
+            Py_DECREF(node);
+            continue;
+        }
+
+        // Visit the node, handing our reference to it over to the stack
+        if (PySet_Add(dfs->visited, node) < 0) {
+            Py_DECREF(node);
+            return nullptr;
+        }
+        if (!(neighbors = PyObject_GetItem(dfs->graph, node))) {
+            // A node without an adjacency list has no outgoing edges
+            if (!PyErr_ExceptionMatches(PyExc_KeyError)) {
+                Py_DECREF(node);
+                return nullptr;
+            }
+            PyErr_Clear();
+        } else {
+            Py_SETREF(neighbors, PyObject_GetIter(neighbors));
+            if (!neighbors) {
+                Py_DECREF(node);
+                return nullptr;
+            }
+        }
+        try {
+            stack.push_back(MappingFrame{node, neighbors});
+        } catch (const std::bad_alloc &) {
+            Py_DECREF(node);
+            Py_XDECREF(neighbors);
+            return PyErr_NoMemory();
+        }
+        if (dfs->order & DFS_PREORDER) {
+            Py_INCREF(node);
+            return DFS_Item(dfs, node, dfs->pre);
+        }
+    }
+}
+
+static PyObject *
+DFS_Next(PyObject *self)
+{
+    PyObject *item;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    item = DFS_NextItem((DFSObject *) self);
+    Py_END_CRITICAL_SECTION();
+    return item;
+}
+
+PyDoc_STRVAR(DFS_Type_doc,
+"dfs(graph, root, *, order='preorder')\n"
+"dfs(graph, *, roots=None, order='preorder')\n\n"
+"Depth-first traversal of a directed graph, starting at root, or at each node\n"
+"in roots in turn (skipping nodes already visited), or at each node of the\n"
+"graph in turn if neither is given. The graph is an adjacency list or a Graph\n"
+"object, as in bfs(). Neighbors are visited in the order of their adjacency\n"
+"lists, as in the usual recursive algorithm, but the traversal keeps its own\n"
+"stack, so it can't hit the recursion limit however deep the graph is.\n\n"
+"The traversal yields each node when it's first visited if order is\n"
+"'preorder', or after all its descendants if order is 'postorder'. If order\n"
+"is 'events', it yields (node, 'pre') and (node, 'post') for both.\n\n"
+">>> graph = {0: [1, 2], 1: [3], 2: [3]}\n"
+">>> list(dfs(graph, 0))\n"
+"[0, 1, 3, 2]\n"
+">>> list(dfs(graph, 0, order='postorder'))\n"
+"[3, 1, 2, 0]");
+
+static PyType_Slot DFS_Slots[] = {
+    {Py_tp_dealloc, (void *) DFS_Dealloc},
+    {Py_tp_doc, (void *) DFS_Type_doc},
+    {Py_tp_iter, (void *) PyObject_SelfIter},
+    {Py_tp_iternext, (void *) DFS_Next},
+    {Py_tp_new, (void *) DFS_New},
+    {0, nullptr}  // Sentinel
+};
+
+static PyType_Spec DFS_Spec = {
+    "algorithms.graph.dfs",             /* name */
+    sizeof(DFSObject),                  /* basicsize */
+    0,                                  /* itemsize */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,  /* flags */
+    DFS_Slots,                          /* slots */
+};
+
+// Disjoint sets of arbitrary hashable elements, backed by a union-find forest
+// over the elements' ids
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *index;                    // Maps elements to their ids
+    PyObject *elements;                 // List of elements, ordered by id
+    UnionFind *forest;
+} DisjointSetObject;
+
+// Get the id of an element of a locked disjoint set, adding it as a singleton
+// if `add` is true and it's new. Returns -1 on failure (raising KeyError for a
+// missing element)
+static Py_ssize_t
+DisjointSet_Id(DisjointSetObject *self, PyObject *element, bool add)
+{
+    PyObject *id = PyDict_GetItemWithError(self->index, element);
+    Py_ssize_t n;
+
+    if (id) return PyLong_AsSsize_t(id);
+    if (PyErr_Occurred()) return -1;
+    if (!add) {
+        // Wrap the element in a tuple, in case it's itself a tuple
+        PyObject *args = PyTuple_Pack(1, element);
+        if (args) {
+            PyErr_SetObject(PyExc_KeyError, args);
+            Py_DECREF(args);
+        }
+        return -1;
+    }
+
+    n = PyList_GET_SIZE(self->elements);
+    if (!(id = PyLong_FromSsize_t(n))) return -1;
+    if (PyDict_SetItem(self->index, element, id) < 0) {
+        Py_DECREF(id);
+        return -1;
+    }
+    Py_DECREF(id);
+    if (PyList_Append(self->elements, element) < 0) {
+        PyDict_DelItem(self->index, element);
+        return -1;
+    }
+    try {
+        self->forest->add();
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        PySequence_DelItem(self->elements, n);
+        PyDict_DelItem(self->index, element);
+        return -1;
+    }
+    return n;
+}
+
+static PyObject *
+DisjointSet_New(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    PyObject *elements = nullptr, *it, *element;
+    DisjointSetObject *self;
+
+    // Parse arguments
+    static const char *format = "|O";
+    static const char *keywords[] = {"elements", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &elements))
+        return nullptr;
+
+    if (!(self = (DisjointSetObject *) type->tp_alloc(type, 0))) return nullptr;
+    if (!(self->index = PyDict_New())) goto fail;
+    if (!(self->elements = PyList_New(0))) goto fail;
+    if (!(self->forest = new(std::nothrow) UnionFind())) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+
+    if (elements) {
+        if (!(it = PyObject_GetIter(elements))) goto fail;
+        while ((element = PyIter_Next(it))) {
+            Py_ssize_t id = DisjointSet_Id(self, element, true);
+            Py_DECREF(element);
+            if (id < 0) break;
+        }
+        Py_DECREF(it);
+        if (PyErr_Occurred()) goto fail;
+    }
+    return (PyObject *) self;
+
+fail:
+    Py_DECREF(self);
+    return nullptr;
+}
+
+static int
+DisjointSet_Traverse(PyObject *self, visitproc visit, void *arg)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+    Py_VISIT(Py_TYPE(self));
+    Py_VISIT(ds->index);
+    Py_VISIT(ds->elements);
+    return 0;
+}
+
+// Empty the sets, which breaks any reference cycles through their elements
+static int
+DisjointSet_Clear(PyObject *self)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+
+    // Nothing else is emptied if the list can't be, which keeps the ids of the
+    // elements consistent
+    if (ds->elements
+            && PyList_SetSlice(ds->elements, 0, PY_SSIZE_T_MAX, nullptr) < 0) {
+        PyErr_Clear();
+        return 0;
+    }
+    if (ds->index) PyDict_Clear(ds->index);
+    if (ds->forest) *ds->forest = UnionFind();
+    return 0;
+}
+
+static void
+DisjointSet_Dealloc(PyObject *self)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+    PyTypeObject *type = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Py_XDECREF(ds->index);
+    Py_XDECREF(ds->elements);
+    delete ds->forest;
+    type->tp_free(ds);
+    Py_DECREF(type);
+}
+
+static Py_ssize_t
+DisjointSet_Length(PyObject *self)
+{
+    return PyList_GET_SIZE(((DisjointSetObject *) self)->elements);
+}
+
+static int
+DisjointSet_Contains(PyObject *self, PyObject *element)
+{
+    return PyDict_Contains(((DisjointSetObject *) self)->index, element);
+}
+
+static PyObject *
+DisjointSet_Add(PyObject *self, PyObject *element)
+{
+    Py_ssize_t id;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    id = DisjointSet_Id((DisjointSetObject *) self, element, true);
+    Py_END_CRITICAL_SECTION();
+    if (id < 0) return nullptr;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+DisjointSet_Find(PyObject *self, PyObject *element)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+    PyObject *root = nullptr;
+    Py_ssize_t id;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((id = DisjointSet_Id(ds, element, false)) >= 0) {
+        root = PyList_GET_ITEM(ds->elements, ds->forest->find(id));
+        Py_INCREF(root);
+    }
+    Py_END_CRITICAL_SECTION();
+    return root;
+}
+
+static PyObject *
+DisjointSet_Union(PyObject *self, PyObject *args)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+    PyObject *x, *y, *result = nullptr;
+    Py_ssize_t i, j;
+
+    if (!PyArg_ParseTuple(args, "OO:union", &x, &y)) return nullptr;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((i = DisjointSet_Id(ds, x, true)) >= 0
+            && (j = DisjointSet_Id(ds, y, true)) >= 0)
+        result = PyBool_FromLong(ds->forest->unite(i, j));
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+static PyObject *
+DisjointSet_Connected(PyObject *self, PyObject *args)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+    PyObject *x, *y, *result = nullptr;
+    Py_ssize_t i, j;
+
+    if (!PyArg_ParseTuple(args, "OO:connected", &x, &y)) return nullptr;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((i = DisjointSet_Id(ds, x, false)) >= 0
+            && (j = DisjointSet_Id(ds, y, false)) >= 0)
+        result = PyBool_FromLong(ds->forest->find(i) == ds->forest->find(j));
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+static PyObject *
+DisjointSet_SetSize(PyObject *self, PyObject *element)
+{
+    DisjointSetObject *ds = (DisjointSetObject *) self;
+    PyObject *result = nullptr;
+    Py_ssize_t id;
+
+    Py_BEGIN_CRITICAL_SECTION(self);
+    if ((id = DisjointSet_Id(ds, element, false)) >= 0)
+        result = PyLong_FromSize_t(ds->forest->set_size(id));
+    Py_END_CRITICAL_SECTION();
+    return result;
+}
+
+// New list of the sets of a locked disjoint set
+static PyObject *
+DisjointSet_SetsLocked(DisjointSetObject *ds)
+{
+    const size_t n = ds->forest->size();
+    PyObject *sets, *set;
+
+    // Sets are listed in the order of their first elements, and map the
+    // representatives' ids to their positions in the list of sets
+    std::vector<Py_ssize_t> position;
+    try {
+        position.assign(n, -1);
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+    if (!(sets = PyList_New(0))) return nullptr;
+    for (size_t i = 0; i < n; ++i) {
+        size_t root = ds->forest->find(i);
+        if (position[root] < 0) {
+            position[root] = PyList_GET_SIZE(sets);
+            if (!(set = PyList_New(0)) || PyList_Append(sets, set) < 0) {
+                Py_XDECREF(set);
+                Py_DECREF(sets);
+                return nullptr;
+            }
+            Py_DECREF(set);
+        }
+        set = PyList_GET_ITEM(sets, position[root]);
+        if (PyList_Append(set, PyList_GET_ITEM(ds->elements, i)) < 0) {
+            Py_DECREF(sets);
+            return nullptr;
+        }
+    }
+    return sets;
+}
+
+static PyObject *
+DisjointSet_Sets(PyObject *self, PyObject *args)
+{
+    PyObject *sets;
+
+    (void) args;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    sets = DisjointSet_SetsLocked((DisjointSetObject *) self);
+    Py_END_CRITICAL_SECTION();
+    return sets;
+}
+
+static PyObject *
+DisjointSet_GetNumSets(PyObject *self, void *closure)
+{
+    size_t count;
+
+    (void) closure;  // Unused parameter
+    Py_BEGIN_CRITICAL_SECTION(self);
+    count = ((DisjointSetObject *) self)->forest->count();
+    Py_END_CRITICAL_SECTION();
+    return PyLong_FromSize_t(count);
+}
+
+PyDoc_STRVAR(DisjointSet_Add_doc,
+"add(x)\n\n"
+"Add x as a new singleton set, unless it's already an element.");
+
+PyDoc_STRVAR(DisjointSet_Find_doc,
+"find(x) -> element\n\n"
+"Representative element of the set containing x (KeyError if x is missing).");
+
+PyDoc_STRVAR(DisjointSet_Union_doc,
+"union(x, y) -> bool\n\n"
+"Merge the sets containing x and y (adding them first if they're missing),\n"
+"returning False if they were already the same set.");
+
+PyDoc_STRVAR(DisjointSet_Connected_doc,
+"connected(x, y) -> bool\n\n"
+"Whether x and y are in the same set (KeyError if either is missing).");
+
+PyDoc_STRVAR(DisjointSet_SetSize_doc,
+"set_size(x) -> int\n\n"
+"Number of elements in the set containing x (KeyError if x is missing).");
+
+PyDoc_STRVAR(DisjointSet_Sets_doc,
+"sets() -> list\n\n"
+"List of the sets, each as a list of elements in the order they were added.");
+
+static PyMethodDef DisjointSet_Methods[] = {
+    {
+        "add",                                      // ml_name
+        DisjointSet_Add,                            // ml_meth
+        METH_O,                                     // ml_flags
+        DisjointSet_Add_doc,                        // ml_doc
+    },
+    {
+        "find",
+        DisjointSet_Find,
+        METH_O,
+        DisjointSet_Find_doc,
+    },
+    {
+        "union",
+        DisjointSet_Union,
+        METH_VARARGS,
+        DisjointSet_Union_doc,
+    },
+    {
+        "connected",
+        DisjointSet_Connected,
+        METH_VARARGS,
+        DisjointSet_Connected_doc,
+    },
+    {
+        "set_size",
+        DisjointSet_SetSize,
+        METH_O,
+        DisjointSet_SetSize_doc,
+    },
+    {
+        "sets",
+        DisjointSet_Sets,
+        METH_NOARGS,
+        DisjointSet_Sets_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static PyGetSetDef DisjointSet_GetSet[] = {
+    {
+        (char *) "num_sets",                        // name
+        DisjointSet_GetNumSets,                     // get
+        nullptr,                                    // set
+        (char *) "Number of disjoint sets.",        // doc
+        nullptr,                                    // closure
+    },
+    {nullptr, nullptr, nullptr, nullptr, nullptr}  // Sentinel
+};
+
+PyDoc_STRVAR(DisjointSet_Type_doc,
+"DisjointSet(elements=())\n\n"
+"Disjoint sets of hashable elements (a union-find structure), starting with\n"
+"each of the given elements in a set of its own. Uses union by size and path\n"
+"halving, so any sequence of operations takes nearly linear time.\n\n"
+">>> ds = DisjointSet('abcd')\n"
+">>> ds.union('a', 'b'), ds.union('c', 'd'), ds.union('b', 'a')\n"
+"(True, True, False)\n"
+">>> ds.connected('a', 'c'), ds.num_sets, ds.sets()\n"
+"(False, 2, [['a', 'b'], ['c', 'd']])");
+
+static PyType_Slot DisjointSet_Slots[] = {
+    {Py_tp_dealloc, (void *) DisjointSet_Dealloc},
+    {Py_tp_traverse, (void *) DisjointSet_Traverse},
+    {Py_tp_clear, (void *) DisjointSet_Clear},
+    {Py_sq_length, (void *) DisjointSet_Length},
+    {Py_sq_contains, (void *) DisjointSet_Contains},
+    {Py_tp_doc, (void *) DisjointSet_Type_doc},
+    {Py_tp_methods, DisjointSet_Methods},
+    {Py_tp_getset, DisjointSet_GetSet},
+    {Py_tp_new, (void *) DisjointSet_New},
+    {0, nullptr}  // Sentinel
+};
+
+static PyType_Spec DisjointSet_Spec = {
+    "algorithms.graph.DisjointSet",     /* name */
+    sizeof(DisjointSetObject),          /* basicsize */
+    0,                                  /* itemsize */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE
+        | Py_TPFLAGS_HAVE_GC,           /* flags */
+    DisjointSet_Slots,                  /* slots */
+};
+
+static PyObject *
+Graph_BFSLevels(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    GraphObject *graph;
+    PyObject *roots_labels;
+    int threads = 0;
+    std::vector<vertex_t> roots;
+    const CSRGraph *reverse;
+    PyObject *depth = nullptr, *parent = nullptr;
+    void *depth_data, *parent_data;
+    bool failed = false;
+
+    // Parse arguments
+    static const char *format = "O!O|i";
+    static const char *keywords[] = {"graph", "roots", "threads", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     state->graph_type, &graph, &roots_labels,
+                                     &threads))
+        return nullptr;
+
+    if (!GetVertices(graph, roots_labels, roots)) return nullptr;
+    if (!(reverse = GraphReverse(graph))) return nullptr;
+    if (!(depth = NewNumericArray(VERTEX_FORMAT[0], graph->csr.n, &depth_data)))
+        goto fail;
+    if (!(parent = NewNumericArray(VERTEX_FORMAT[0], graph->csr.n,
+                                   &parent_data)))
+        goto fail;
+
+    // The graph is immutable and kept alive by our caller, so the traversal
+    // doesn't need the GIL
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        BFSLevels(graph->csr, *reverse, roots.data(), roots.size(), threads,
+                  (vertex_t *) depth_data, (vertex_t *) parent_data);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+
+    return Py_BuildValue("NN", depth, parent);
+
+fail:
+    Py_XDECREF(depth);
+    Py_XDECREF(parent);
+    return nullptr;
+}
+
+PyDoc_STRVAR(Graph_BFSLevels_doc,
+"bfs_levels(graph, roots, threads=0) -> (depth, parent)\n\n"
+"Breadth-first search of a Graph from every node in roots at once.\n\n"
+"Returns two int32 memoryviews indexed by node id (see Graph.nodes): depth[i]\n"
+"is the distance from the nearest root to node i, and parent[i] is the id of\n"
+"its parent in a breadth-first search tree (roots are their own parents).\n"
+"Both are -1 for unreachable nodes. The search runs without the GIL on\n"
+"`threads` threads (all cores by default), and uses the direction-optimizing\n"
+"algorithm in Scott Beamer, Krste Asanovic, and David Patterson,\n"
+"\"Direction-optimizing breadth-first search\". Proceedings of SC '12 (2012).\n"
+"DOI: https://doi.org/10.1109/SC.2012.50");
+
+// Shortest path in an adjacency list by a breadth-first search from the source
+// which stops as soon as it reaches the target
+static PyObject *
+ShortestPathMapping(PyObject *graph, PyObject *source, PyObject *target)
+{
+    PyObject *parents;  // Maps each visited node to its parent
+    PyObject *path = nullptr;
+    std::vector<PyObject *> frontier, next;  // Borrowed from `parents`
+    int status;
+
+    if (!(parents = PyDict_New())) return nullptr;
+    if (PyDict_SetItem(parents, source, source) < 0) goto done;
+    if ((status = PyObject_RichCompareBool(source, target, Py_EQ)) < 0)
+        goto done;
+
+    try {
+        frontier.push_back(source);
+        while (!status && !frontier.empty()) {
+            next.clear();
+            for (size_t i = 0; !status && i < frontier.size(); ++i) {
+                PyObject *node = frontier[i], *neighbors, *neighbor;
+                if (!(neighbors = PyObject_GetItem(graph, node))) {
+                    if (!PyErr_ExceptionMatches(PyExc_KeyError)) goto done;
+                    PyErr_Clear();  // No outgoing edges
+                    continue;
+                }
+                Py_SETREF(neighbors, PyObject_GetIter(neighbors));
+                if (!neighbors) goto done;
+                while (!status && (neighbor = PyIter_Next(neighbors))) {
+                    if (!(status = PyDict_Contains(parents, neighbor))) {
+                        status = PyDict_SetItem(parents, neighbor, node);
+                        if (!status) {
+                            next.push_back(neighbor);
+                            status = PyObject_RichCompareBool(neighbor, target,
+                                                              Py_EQ);
+                        }
+                    } else if (status > 0) {
+                        status = 0;  // Already visited
+                    }
+                    Py_DECREF(neighbor);
+                }
+                Py_DECREF(neighbors);
+                if (status < 0 || PyErr_Occurred()) goto done;
+            }
+            if (!status) frontier.swap(next);
+        }
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    if (!status) {
+        // The target is unreachable
+        Py_INCREF(Py_None);
+        path = Py_None;
+        goto done;
+    }
+
+    // Follow the parents from the node equal to the target back to the source
+    // (which is its own parent)
+    if (!(path = PyList_New(0))) goto done;
+    for (PyObject *node = next.empty() ? source : next.back();;) {
+        PyObject *parent = PyDict_GetItemWithError(parents, node);
+        if (!parent || PyList_Append(path, node) < 0) {
+            Py_CLEAR(path);
+            goto done;
+        }
+        if (parent == node) break;
+        node = parent;
+    }
+    if (PyList_Reverse(path) < 0) Py_CLEAR(path);
+
+done:
+    Py_DECREF(parents);
+    return path;
+}
+
+static PyObject *
+Graph_ShortestPath(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    PyObject *graph, *source, *target, *path;
+    vertex_t s, t;
+    const CSRGraph *reverse;
+    std::vector<vertex_t> vertices;
+    bool found = false, failed = false;
+
+    // Parse arguments
+    static const char *format = "OOO";
+    static const char *keywords[] = {"graph", "source", "target", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &graph, &source, &target))
+        return nullptr;
+
+    if (!Graph_Check(state, graph)) {
+        if (!PyMapping_Check(graph)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "shortest_path() expects a mapping type or a Graph");
+            return nullptr;
+        }
+        return ShortestPathMapping(graph, source, target);
+    }
+
+    GraphObject *g = (GraphObject *) graph;
+    if ((s = GraphVertex(g, source)) < 0) return nullptr;
+    if ((t = GraphVertex(g, target)) < 0) return nullptr;
+    if (!(reverse = GraphReverse(g))) return nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        found = ShortestPath(g->csr, *reverse, s, t, vertices);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) return PyErr_NoMemory();
+    if (!found) Py_RETURN_NONE;
+
+    if (!(path = PyList_New((Py_ssize_t) vertices.size()))) return nullptr;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        PyObject *label = GraphLabel(g, vertices[i]);
+        if (!label) {
+            Py_DECREF(path);
+            return nullptr;
+        }
+        PyList_SET_ITEM(path, (Py_ssize_t) i, label);
+    }
+    return path;
+}
+
+PyDoc_STRVAR(Graph_ShortestPath_doc,
+"shortest_path(graph, source, target) -> list or None\n\n"
+"Return a path from source to target with the fewest edges, as a list of\n"
+"nodes, or None if the target is unreachable.\n\n"
+"If graph is a Graph, the path is found by a bidirectional breadth-first\n"
+"search (without the GIL), which usually explores far fewer nodes than a\n"
+"search from the source alone. Otherwise graph must be an adjacency list,\n"
+"which is searched from the source until the target is found.");
+
+// Get the edge weights of a Graph for a shortest path search: either the
+// graph's own weights (NULL if it's unweighted), or a buffer of weights
+// parallel to the graph's targets, converted to doubles in `storage` if needed
+static int
+GetSearchWeights(GraphObject *graph, PyObject *weight, Py_buffer *view,
+                 std::vector<double> &storage, const double **weights)
+{
+    char format;
+
+    *weights = graph->csr.weights;
+    if (weight == Py_None) return 1;
+
+    if (!(format = GetNumericBuffer(weight, view, true))) return 0;
+    if (view->len / view->itemsize != graph->csr.m) {
+        PyErr_SetString(PyExc_ValueError,
+                        "weights must have one item per edge");
+        PyBuffer_Release(view);
+        return 0;
+    }
+    if (format == WEIGHT_FORMAT[0]) {
+        *weights = (const double *) view->buf;
+        return 1;
+    }
+    try {
+        storage.resize((size_t) graph->csr.m);
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        PyBuffer_Release(view);
+        return 0;
+    }
+    for (edge_t e = 0; e < graph->csr.m; ++e)
+        storage[e] = ReadDouble(view->buf, format, e);
+    *weights = storage.data();
+    return 1;
+}
+
+// Raise the appropriate exception for a failed shortest path search
+static PyObject *
+SearchError(int status)
+{
+    if (status == SEARCH_NEGATIVE_WEIGHT)
+        PyErr_SetString(PyExc_ValueError, "edge weights must be non-negative");
+    else if (!PyErr_Occurred())
+        PyErr_NoMemory();
+    return nullptr;
+}
+
+static PyObject *
+Graph_Dijkstra(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    PyObject *graph, *source, *weight = Py_None, *target = Py_None;
+    PyObject *distance = nullptr, *parent = nullptr;
+    void *distance_data, *parent_data;
+    const double *weights;
+    std::vector<double> converted;
+    Py_buffer view;
+    vertex_t s, t = -1;
+    int status = SEARCH_FAILED;
+
+    // Parse arguments
+    static const char *format = "OO|OO";
+    static const char *keywords[] = {"graph", "source", "weight", "target",
+                                     nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &graph, &source, &weight, &target))
+        return nullptr;
+
+    if (!Graph_Check(state, graph)) {
+        if (!PyMapping_Check(graph)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "dijkstra() expects a mapping type or a Graph");
+            return nullptr;
+        }
+        return DijkstraMapping(graph, source,
+                               target == Py_None ? nullptr : target, weight);
+    }
+
+    GraphObject *g = (GraphObject *) graph;
+    if ((s = GraphVertex(g, source)) < 0) return nullptr;
+    if (target != Py_None && (t = GraphVertex(g, target)) < 0) return nullptr;
+    if (!GetSearchWeights(g, weight, &view, converted, &weights)) return nullptr;
+    if (!(distance = NewNumericArray('d', g->csr.n, &distance_data))) goto done;
+    if (!(parent = NewNumericArray(VERTEX_FORMAT[0], g->csr.n, &parent_data)))
+        goto done;
+
+    // The weights buffer (if any) stays exported until we're done with it
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        status = BestFirstSearch(g->csr, weights, s, t, NoHeuristic(),
+                                 (double *) distance_data,
+                                 (vertex_t *) parent_data);
+    } catch (const std::exception &) {
+        status = SEARCH_FAILED;
+    }
+    Py_END_ALLOW_THREADS
+
+done:
+    if (weight != Py_None) PyBuffer_Release(&view);
+    if (status != SEARCH_OK) {
+        Py_XDECREF(distance);
+        Py_XDECREF(parent);
+        return SearchError(status);
+    }
+    return Py_BuildValue("NN", distance, parent);
+}
+
+static PyObject *
+Graph_AStar(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    PyObject *graph, *source, *target, *heuristic, *weight = Py_None;
+    PyObject *path;
+    const double *weights;
+    std::vector<double> converted, distance;
+    std::vector<vertex_t> parent;
+    Py_buffer view;
+    vertex_t s, t, length = 0;
+    int status;
+
+    // Parse arguments
+    static const char *format = "OOOO|O";
+    static const char *keywords[] = {"graph", "source", "target", "heuristic",
+                                     "weight", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &graph, &source, &target, &heuristic,
+                                     &weight))
+        return nullptr;
+
+    if (!PyCallable_Check(heuristic)) {
+        PyErr_SetString(PyExc_TypeError, "heuristic must be callable");
+        return nullptr;
+    }
+    if (!Graph_Check(state, graph)) {
+        if (!PyMapping_Check(graph)) {
+            PyErr_SetString(PyExc_TypeError,
+                            "astar() expects a mapping type or a Graph");
+            return nullptr;
+        }
+        return AStarMapping(graph, source, target, heuristic, weight);
+    }
+
+    GraphObject *g = (GraphObject *) graph;
+    if ((s = GraphVertex(g, source)) < 0) return nullptr;
+    if ((t = GraphVertex(g, target)) < 0) return nullptr;
+    if (!GetSearchWeights(g, weight, &view, converted, &weights)) return nullptr;
+
+    // The heuristic is Python code, so this search needs the GIL throughout
+    auto estimate = [&](vertex_t v, double &value) {
+        PyObject *label = GraphLabel(g, v), *result;
+        if (!label) return false;
+        result = PyObject_CallFunctionObjArgs(heuristic, label, target,
+                                              nullptr);
+        Py_DECREF(label);
+        if (!result) return false;
+        value = PyFloat_AsDouble(result);
+        Py_DECREF(result);
+        return !(value == -1.0 && PyErr_Occurred());
+    };
+    try {
+        distance.resize((size_t) g->csr.n);
+        parent.resize((size_t) g->csr.n);
+        status = BestFirstSearch(g->csr, weights, s, t, estimate,
+                                 distance.data(), parent.data());
+    } catch (const std::bad_alloc &) {
+        status = SEARCH_FAILED;
+    }
+    if (weight != Py_None) PyBuffer_Release(&view);
+    if (status != SEARCH_OK) return SearchError(status);
+
+    if (parent[t] < 0 && s != t)
+        return Py_BuildValue("dO", distance[t], Py_None);
+    for (vertex_t v = t; v >= 0; v = v == s ? -1 : parent[v]) ++length;
+    if (!(path = PyList_New(length))) return nullptr;
+    for (vertex_t v = t; v >= 0; v = v == s ? -1 : parent[v]) {
+        PyObject *label = GraphLabel(g, v);
+        if (!label) {
+            Py_DECREF(path);
+            return nullptr;
+        }
+        PyList_SET_ITEM(path, --length, label);
+    }
+    return Py_BuildValue("dN", distance[t], path);
+}
+
+PyDoc_STRVAR(Graph_Dijkstra_doc,
+"dijkstra(graph, source, weight=None, target=None) -> (distance, parent)\n\n"
+"Shortest paths from source by Dijkstra's algorithm, using an indexed 4-ary\n"
+"heap with decrease-key. Edge weights must be non-negative. If target is\n"
+"given, the search stops as soon as the target's distance is known.\n\n"
+"If graph is an adjacency list, its adjacency lists map neighbors to edge\n"
+"weights (e.g., {'a': {'b': 1.5}}), or to mappings of edge attributes in\n"
+"which weight is the key of the weight. Plain lists of neighbors have unit\n"
+"weights. The result is a pair of dicts mapping every node whose distance\n"
+"was found to its distance and to its parent on a shortest path (None for\n"
+"the source).\n\n"
+"If graph is a Graph, the edge weights are its own weights (or 1 if it is\n"
+"unweighted), unless weight is a buffer of weights parallel to the graph's\n"
+"targets. The search runs without the GIL, and the result is a pair of\n"
+"memoryviews indexed by node id: float64 distances (inf if unknown) and int32\n"
+"parent ids (-1 if none).");
+
+PyDoc_STRVAR(Graph_AStar_doc,
+"astar(graph, source, target, heuristic, weight=None) -> (distance, path)\n\n"
+"Shortest path from source to target by A* search, where heuristic(node,\n"
+"target) is a lower bound on the distance from node to target. Returns the\n"
+"length of the path and the list of nodes on it, or (inf, None) if the\n"
+"target is unreachable. The graph and weight are as in dijkstra().");
+
+// Get a Graph object for a graph represented either as an adjacency list or as
+// a Graph object, for algorithms which have to look at the whole graph anyway.
+// Returns a new reference
+static GraphObject *
+AsGraph(GraphState *state, PyObject *graph, const char *name)
+{
+    if (Graph_Check(state, graph)) {
+        Py_INCREF(graph);
+        return (GraphObject *) graph;
+    }
+    if (!PyMapping_Check(graph)) {
+        PyErr_Format(PyExc_TypeError, "%s() expects a mapping type or a Graph",
+                     name);
+        return nullptr;
+    }
+    return (GraphObject *) PyObject_CallFunctionObjArgs(
+        (PyObject *) state->graph_type, graph, nullptr);
+}
+
+// List of the labels of a sequence of vertices of a graph
+static PyObject *
+LabelList(GraphObject *graph, const vertex_t *vertices, size_t count)
+{
+    PyObject *list = PyList_New((Py_ssize_t) count);
+    if (!list) return nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        PyObject *label = GraphLabel(graph, vertices[i]);
+        if (!label) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, (Py_ssize_t) i, label);
+    }
+    return list;
+}
+
+static PyObject *
+Graph_TopologicalSort(PyObject *self, PyObject *arg)
+{
+    GraphState *state = GetState(self);
+    GraphObject *graph;
+    std::vector<vertex_t> order;
+    bool acyclic = false, failed = false;
+    PyObject *result = nullptr;
+
+    if (!(graph = AsGraph(state, arg, "topological_sort"))) return nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        acyclic = TopologicalSort(graph->csr, order);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (failed)
+        PyErr_NoMemory();
+    else if (!acyclic)
+        PyErr_SetString(PyExc_ValueError, "graph has a cycle");
+    else
+        result = LabelList(graph, order.data(), order.size());
+    Py_DECREF(graph);
+    return result;
+}
+
+static PyObject *
+Graph_StronglyConnectedComponents(PyObject *self, PyObject *arg)
+{
+    GraphState *state = GetState(self);
+    GraphObject *graph;
+    std::vector<vertex_t> component, members;
+    std::vector<size_t> start;
+    vertex_t count = 0;
+    bool failed = false;
+    PyObject *result = nullptr;
+
+    if (!(graph = AsGraph(state, arg, "strongly_connected_components")))
+        return nullptr;
+
+    // Find the components, and then group the vertices by component (by a
+    // counting sort, which keeps the vertices of each component in order)
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        const vertex_t n = graph->csr.n;
+        component.resize((size_t) n);
+        count = StronglyConnectedComponents(graph->csr, component.data());
+        start.assign((size_t) count + 1, 0);
+        for (vertex_t v = 0; v < n; ++v) ++start[component[v] + 1];
+        for (vertex_t c = 0; c < count; ++c) start[c + 1] += start[c];
+        members.resize((size_t) n);
+        std::vector<size_t> next(start.begin(), start.end() - 1);
+        for (vertex_t v = 0; v < n; ++v) members[next[component[v]]++] = v;
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (failed) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (!(result = PyList_New(count))) goto done;
+    for (vertex_t c = 0; c < count; ++c) {
+        PyObject *list = LabelList(graph, members.data() + start[c],
+                                   start[c + 1] - start[c]);
+        if (!list) {
+            Py_CLEAR(result);
+            goto done;
+        }
+        PyList_SET_ITEM(result, c, list);
+    }
+
+done:
+    Py_DECREF(graph);
+    return result;
+}
+
+PyDoc_STRVAR(Graph_TopologicalSort_doc,
+"topological_sort(graph) -> list\n\n"
+"Nodes of a directed acyclic graph (an adjacency list or a Graph), ordered so\n"
+"that every edge goes from an earlier node to a later one. Uses Kahn's\n"
+"algorithm: nodes without incoming edges come first, in the order of\n"
+"Graph.nodes. Raises ValueError if the graph has a cycle.\n\n"
+">>> topological_sort({'shirt': ['tie'], 'tie': ['jacket'], 'pants': ['shoes']})\n"
+"['shirt', 'pants', 'tie', 'shoes', 'jacket']");
+
+PyDoc_STRVAR(Graph_StronglyConnectedComponents_doc,
+"strongly_connected_components(graph) -> list\n\n"
+"Strongly connected components of a directed graph (an adjacency list or a\n"
+"Graph), as lists of nodes, by an iterative version of Tarjan's algorithm.\n"
+"Components are listed in reverse topological order: every edge between two\n"
+"components goes from a later component to an earlier one.\n\n"
+">>> strongly_connected_components({0: [1], 1: [2, 3], 2: [1]})\n"
+"[[3], [1, 2], [0]]");
+
+// Connected components of the undirected graph with edges given by parallel
+// buffers of integers, as in Graph.from_edges()
+static PyObject *
+EdgeListComponents(PyObject *sources, PyObject *targets, PyObject *num_nodes,
+                   int threads)
+{
+    Py_buffer s, t;
+    char s_format, t_format;
+    Py_ssize_t m, n = -1;
+    int64_t max_vertex = -1;
+    bool negative = false, failed = false;
+    std::atomic<bool> changed(false);
+    PyObject *labels = nullptr;
+    void *data;
+
+    if (num_nodes != Py_None) {
+        n = PyLong_AsSsize_t(num_nodes);
+        if (n == -1 && PyErr_Occurred()) return nullptr;
+        if (n < 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "number of nodes must be non-negative");
+            return nullptr;
+        }
+    }
+    if (!(s_format = GetNumericBuffer(sources, &s))) return nullptr;
+    if (!(t_format = GetNumericBuffer(targets, &t))) {
+        PyBuffer_Release(&s);
+        return nullptr;
+    }
+    m = s.len / s.itemsize;
+    if (m != t.len / t.itemsize) {
+        PyErr_SetString(PyExc_ValueError,
+                        "edge buffers must have the same length");
+        goto done;
+    }
+
+    // Validate the edges (there may be very many of them) without the GIL
+    threads = NumThreads(threads);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        std::vector<int64_t> max((size_t) threads, -1);
+        std::vector<char> below((size_t) threads, 0);
+        ParallelFor(threads, (size_t) m, [&](size_t begin, size_t end, int i) {
+            int64_t local_max = -1;
+            bool local_below = false;
+            for (size_t e = begin; e < end; ++e) {
+                int64_t u = ReadInteger(s.buf, s_format, (Py_ssize_t) e);
+                int64_t v = ReadInteger(t.buf, t_format, (Py_ssize_t) e);
+                local_max = std::max(local_max, std::max(u, v));
+                local_below |= u < 0 || v < 0;
+            }
+            max[i] = local_max;
+            below[i] = local_below;
+        });
+        for (int i = 0; i < threads; ++i) {
+            max_vertex = std::max(max_vertex, max[i]);
+            negative |= below[i] != 0;
+        }
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (failed) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (negative) {
+        PyErr_SetString(PyExc_ValueError, "nodes must be non-negative");
+        goto done;
+    }
+    if (n < 0) {
+        n = (Py_ssize_t) (max_vertex + 1);
+    } else if (max_vertex >= n) {
+        PyErr_SetString(PyExc_ValueError, "node out of range");
+        goto done;
+    }
+    if (n > MAX_VERTICES) {
+        PyErr_SetString(PyExc_OverflowError, "too many nodes in graph");
+        goto done;
+    }
+    if (!(labels = NewNumericArray(VERTEX_FORMAT[0], n, &data))) goto done;
+
+    // Other threads can still assign to the buffers' items, so every id is
+    // checked again as it's read. An id that has become invalid is replaced by
+    // node 0 (there is one, since there are edges), and the call fails
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        auto read = [&](const Py_buffer &b, char format, edge_t i)
+                -> vertex_t {
+            int64_t v = ReadInteger(b.buf, format, i);
+            if (v >= 0 && v < n) return (vertex_t) v;
+            changed.store(true, std::memory_order_relaxed);
+            return (vertex_t) 0;
+        };
+        ConnectedComponents((vertex_t) n, (edge_t) m,
+            [&](edge_t i) { return read(s, s_format, i); },
+            [&](edge_t i) { return read(t, t_format, i); },
+            threads, (vertex_t *) data);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        Py_CLEAR(labels);
+        PyErr_NoMemory();
+    } else if (changed.load(std::memory_order_relaxed)) {
+        Py_CLEAR(labels);
+        PyErr_SetString(PyExc_ValueError,
+                        "edge buffers changed during the call");
+    }
+
+done:
+    PyBuffer_Release(&s);
+    PyBuffer_Release(&t);
+    return labels;
+}
+
+static PyObject *
+Graph_ConnectedComponents(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    PyObject *graph, *targets = Py_None, *num_nodes = Py_None;
+    PyObject *labels;
+    int threads = 0;
+    void *data;
+    bool failed = false;
+
+    // Parse arguments
+    static const char *format = "O|O$Oi";
+    static const char *keywords[] = {"graph", "targets", "num_nodes",
+                                     "threads", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     &graph, &targets, &num_nodes, &threads))
+        return nullptr;
+
+    if (targets != Py_None)
+        return EdgeListComponents(graph, targets, num_nodes, threads);
+    if (!Graph_Check(state, graph)) {
+        PyErr_SetString(PyExc_TypeError,
+            "connected_components() expects a Graph or buffers of edges");
+        return nullptr;
+    }
+
+    GraphObject *g = (GraphObject *) graph;
+    if (!(labels = NewNumericArray(VERTEX_FORMAT[0], g->csr.n, &data)))
+        return nullptr;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        ConnectedComponents(g->csr, threads, (vertex_t *) data);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        Py_DECREF(labels);
+        return PyErr_NoMemory();
+    }
+    return labels;
+}
+
+PyDoc_STRVAR(Graph_ConnectedComponents_doc,
+"connected_components(graph, *, threads=0) -> labels\n"
+"connected_components(sources, targets, *, num_nodes=None, threads=0) -> labels\n\n"
+"Connected components of a graph, ignoring the directions of its edges. The\n"
+"graph is a Graph, or is given by parallel buffers of integer sources and\n"
+"targets of its edges, as in Graph.from_edges().\n\n"
+"Returns an int32 memoryview indexed by node id, whose i-th item is the\n"
+"smallest id of a node in the component of node i. The edges are split among\n"
+"`threads` threads (all cores by default), which merge components without\n"
+"the GIL or locks using a concurrent union-find forest, following Michael\n"
+"Sutton, Tal Ben-Nun, and Amnon Barak, \"Optimizing parallel graph\n"
+"connectivity computation via subgraph sampling\". Proceedings of IPDPS '18\n"
+"(2018). DOI: https://doi.org/10.1109/IPDPS.2018.00012\n\n"
+">>> sources, targets = array('i', [0, 3, 4]), array('i', [1, 2, 3])\n"
+">>> list(connected_components(sources, targets, num_nodes=6))\n"
+"[0, 0, 2, 2, 2, 5]");
+
+static PyObject *
+Graph_ConvertEdgeList(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *source, *destination, *num_nodes = Py_None;
+    const char *format = "text";
+    int weighted = 0;
+    Py_ssize_t n = -1;
+
+    (void) self;  // Unused parameter
+
+    // Parse arguments
+    static const char *parse_format = "OO|s$pO";
+    static const char *keywords[] = {"source", "destination", "format",
+                                     "weighted", "num_nodes", nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, parse_format,
+                                     (char **) keywords, &source, &destination,
+                                     &format, &weighted, &num_nodes))
+        return nullptr;
+
+    if (strcmp(format, "text") && strcmp(format, "i") && strcmp(format, "q")) {
+        PyErr_SetString(PyExc_ValueError,
+                        "format must be 'text', 'i', or 'q'");
+        return nullptr;
+    }
+    if (num_nodes != Py_None) {
+        n = PyLong_AsSsize_t(num_nodes);
+        if (n == -1 && PyErr_Occurred()) return nullptr;
+        if (n < 0 || n > MAX_VERTICES) {
+            PyErr_SetString(PyExc_ValueError,
+                            "number of nodes out of range");
+            return nullptr;
+        }
+    }
+    if (!ConvertEdgeList(source, destination, format[1] ? 't' : format[0],
+                         weighted, n))
+        return nullptr;
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(Graph_ConvertEdgeList_doc,
+"convert_edge_list(source, destination, format='text', *, weighted=False,\n"
+"                  num_nodes=None)\n\n"
+"Convert an edge list file into a graph file for Graph.load(), without ever\n"
+"holding the edges in memory: the source is read twice, first to count the\n"
+"edges of each node and then to write each edge into place in the\n"
+"memory-mapped destination. Edges keep their order, so the result is the\n"
+"same as Graph.from_edges() on the same edges.\n\n"
+"A text edge list has a line \"source target\" (or \"source target weight\"\n"
+"if weighted is true) for each edge, where nodes are non-negative integers.\n"
+"Blank lines, comments starting with '#' or '%', and further columns are\n"
+"ignored. A binary edge list (format 'i' or 'q') is a sequence of pairs of\n"
+"native int32 or int64 nodes, each followed by a native double weight if\n"
+"weighted is true. The nodes are 0, 1, ..., num_nodes - 1, and num_nodes\n"
+"defaults to one more than the largest node.");
+
+// Get the personalization vector of pagerank(), either a mapping from node
+// labels to weights (zero for missing nodes) or a buffer of weights indexed by
+// node id, normalized to sum to 1
+static int
+GetPersonalization(GraphObject *graph, PyObject *weights,
+                   std::vector<double> &out)
+{
+    const vertex_t n = graph->csr.n;
+    double total = 0.0;
+
+    try {
+        out.assign((size_t) n, 0.0);
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    if (PyObject_CheckBuffer(weights)) {
+        Py_buffer view;
+        char format = GetNumericBuffer(weights, &view, true);
+        if (!format) return 0;
+        bool ok = view.len / view.itemsize == n;
+        if (ok) {
+            for (vertex_t v = 0; v < n; ++v)
+                out[v] = ReadDouble(view.buf, format, v);
+        }
+        PyBuffer_Release(&view);
+        if (!ok) {
+            PyErr_SetString(PyExc_ValueError,
+                            "personalization must have one item per node");
+            return 0;
+        }
+    } else {
+        PyObject *items = PyMapping_Items(weights);
+        if (!items) return 0;
+        for (Py_ssize_t i = 0; i < PyList_GET_SIZE(items); ++i) {
+            PyObject *item = PyList_GET_ITEM(items, i);
+            vertex_t v;
+            if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2) {
+                PyErr_SetString(PyExc_TypeError, "items() must return pairs");
+                Py_DECREF(items);
+                return 0;
+            }
+            if ((v = GraphVertex(graph, PyTuple_GET_ITEM(item, 0))) < 0
+                    || ((out[v] = PyFloat_AsDouble(PyTuple_GET_ITEM(item, 1)))
+                        == -1.0 && PyErr_Occurred())) {
+                Py_DECREF(items);
+                return 0;
+            }
+        }
+        Py_DECREF(items);
+    }
+
+    for (double w : out) {
+        if (!(w >= 0.0) || std::isinf(w)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "personalization weights must be non-negative");
+            return 0;
+        }
+        total += w;
+    }
+    if (!(total > 0.0) || std::isinf(total)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "personalization weights must have a positive sum");
+        return 0;
+    }
+    for (double &w : out) w /= total;
+    return 1;
+}
+
+static PyObject *
+Graph_PageRank(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    GraphObject *graph;
+    double damping = 0.85, tol = 1e-6;
+    Py_ssize_t max_iter = 100;
+    PyObject *personalization = Py_None, *ranks;
+    int threads = 0;
+    const char *dtype = "d";
+    std::vector<double> p;
+    const CSRGraph *reverse;
+    void *data;
+    int iterations = 0;
+    bool failed = false;
+
+    // Parse arguments
+    static const char *format = "O!|ddnO$is";
+    static const char *keywords[] = {"graph", "damping", "tol", "max_iter",
+                                     "personalization", "threads", "dtype",
+                                     nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
+                                     state->graph_type, &graph, &damping, &tol,
+                                     &max_iter, &personalization, &threads,
+                                     &dtype))
+        return nullptr;
+
+    if (!(damping >= 0.0 && damping <= 1.0)) {
+        PyErr_SetString(PyExc_ValueError, "damping must be between 0 and 1");
+        return nullptr;
+    }
+    if (!(tol >= 0.0) || max_iter < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "tol and max_iter must be non-negative");
+        return nullptr;
+    }
+    if (strcmp(dtype, "f") && strcmp(dtype, "d")) {
+        PyErr_SetString(PyExc_ValueError, "dtype must be 'f' or 'd'");
+        return nullptr;
+    }
+    if (personalization != Py_None
+            && !GetPersonalization(graph, personalization, p))
+        return nullptr;
+    if (!(reverse = GraphReverse(graph))) return nullptr;
+    if (!(ranks = NewNumericArray(dtype[0], graph->csr.n, &data)))
+        return nullptr;
+
+    // The graph is immutable and kept alive by our caller, so the iteration
+    // doesn't need the GIL
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        const double *weights = p.empty() ? nullptr : p.data();
+        if (dtype[0] == 'f')
+            iterations = PageRank(graph->csr, *reverse, damping, tol,
+                                  (size_t) max_iter, weights, threads,
+                                  (float *) data);
+        else
+            iterations = PageRank(graph->csr, *reverse, damping, tol,
+                                  (size_t) max_iter, weights, threads,
+                                  (double *) data);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (failed) {
+        Py_DECREF(ranks);
+        return PyErr_NoMemory();
+    }
+    if (iterations < 0) {
+        Py_DECREF(ranks);
+        PyErr_Format(PyExc_RuntimeError,
+                     "pagerank() failed to converge in %zd iterations",
+                     max_iter);
+        return nullptr;
+    }
+    return ranks;
+}
+
+static PyObject *
+Graph_Propagate(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    GraphState *state = GetState(self);
+    GraphObject *graph;
+    PyObject *values, *weight = Py_None, *result = nullptr;
+    int threads = 0;
+    Py_buffer x, w;
+    char format;
+    const double *weights;
+    std::vector<double> converted, x_double;
+    void *data;
+    bool failed = false;
+
+    // Parse arguments
+    static const char *parse_format = "O!O|O$i";
+    static const char *keywords[] = {"graph", "values", "weight", "threads",
+                                     nullptr};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, parse_format,
+                                     (char **) keywords, state->graph_type,
+                                     &graph, &values, &weight, &threads))
+        return nullptr;
+
+    if (!(format = GetNumericBuffer(values, &x, true))) return nullptr;
+    if (x.len / x.itemsize != graph->csr.n) {
+        PyErr_SetString(PyExc_ValueError, "values must have one item per node");
+        PyBuffer_Release(&x);
+        return nullptr;
+    }
+    if (!GetSearchWeights(graph, weight, &w, converted, &weights)) {
+        PyBuffer_Release(&x);
+        return nullptr;
+    }
+
+    // Values other than floats are gathered as doubles
+    if (format != 'f' && format != 'd') {
+        try {
+            x_double.resize((size_t) graph->csr.n);
+        } catch (const std::bad_alloc &) {
+            PyErr_NoMemory();
+            goto done;
+        }
+        for (vertex_t v = 0; v < graph->csr.n; ++v)
+            x_double[v] = ReadDouble(x.buf, format, v);
+    }
+    if (!(result = NewNumericArray(format == 'f' ? 'f' : 'd', graph->csr.n,
+                                   &data)))
+        goto done;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        if (format == 'f')
+            Propagate(graph->csr, weights, (const float *) x.buf, threads,
+                      (float *) data);
+        else
+            Propagate(graph->csr, weights,
+                      format == 'd' ? (const double *) x.buf : x_double.data(),
+                      threads, (double *) data);
+    } catch (const std::exception &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        Py_CLEAR(result);
+        PyErr_NoMemory();
+    }
+
+done:
+    PyBuffer_Release(&x);
+    if (weight != Py_None) PyBuffer_Release(&w);
+    return result;
+}
+
+PyDoc_STRVAR(Graph_PageRank_doc,
+"pagerank(graph, damping=0.85, tol=1e-06, max_iter=100, personalization=None,\n"
+"         *, threads=0, dtype='d') -> ranks\n\n"
+"PageRank of the nodes of a Graph by power iteration, as a memoryview of\n"
+"floats (dtype 'f') or doubles (dtype 'd') indexed by node id.\n\n"
+"With probability damping, a random surfer follows a random out-edge of the\n"
+"current node, and otherwise (or if there are none) jumps to a random node,\n"
+"chosen uniformly or in proportion to personalization, which is a mapping\n"
+"from nodes to weights or a buffer of weights indexed by node id. Iteration\n"
+"stops once the ranks change by less than num_nodes * tol in L1 norm, and\n"
+"raises RuntimeError if that takes more than max_iter iterations.\n\n"
+"Each iteration pulls ranks along in-edges (cache-blocked on large graphs)\n"
+"on `threads` threads (all cores by default), without the GIL. Float ranks\n"
+"halve the memory traffic, at the cost of precision.");
+
+PyDoc_STRVAR(Graph_Propagate_doc,
+"propagate(graph, values, weight=None, *, threads=0) -> result\n\n"
+"Sparse matrix-vector product of the adjacency matrix of a Graph with a\n"
+"vector of values indexed by node id: result[u] is the sum of w * values[v]\n"
+"over the edges u -> v, where w is the edge's weight (or 1 if the graph is\n"
+"unweighted), unless weight is a buffer of weights parallel to the graph's\n"
+"targets. The result is a memoryview of floats if values are floats, and of\n"
+"doubles otherwise. Runs on `threads` threads (all cores by default), without\n"
+"the GIL.");
+
+// List of functions exposed by the module
+static PyMethodDef GraphMethods[] = {
+    {
+        "bfs_levels",                               // ml_name
+        (PyCFunction) Graph_BFSLevels,              // ml_meth
+        METH_VARARGS | METH_KEYWORDS,               // ml_flags
+        Graph_BFSLevels_doc,                        // ml_doc
+    },
+    {
+        "shortest_path",
+        (PyCFunction) Graph_ShortestPath,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_ShortestPath_doc,
+    },
+    {
+        "dijkstra",
+        (PyCFunction) Graph_Dijkstra,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_Dijkstra_doc,
+    },
+    {
+        "astar",
+        (PyCFunction) Graph_AStar,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_AStar_doc,
+    },
+    {
+        "topological_sort",
+        Graph_TopologicalSort,
+        METH_O,
+        Graph_TopologicalSort_doc,
+    },
+    {
+        "strongly_connected_components",
+        Graph_StronglyConnectedComponents,
+        METH_O,
+        Graph_StronglyConnectedComponents_doc,
+    },
+    {
+        "connected_components",
+        (PyCFunction) Graph_ConnectedComponents,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_ConnectedComponents_doc,
+    },
+    {
+        "convert_edge_list",
+        (PyCFunction) Graph_ConvertEdgeList,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_ConvertEdgeList_doc,
+    },
+    {
+        "pagerank",
+        (PyCFunction) Graph_PageRank,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_PageRank_doc,
+    },
+    {
+        "propagate",
+        (PyCFunction) Graph_Propagate,
+        METH_VARARGS | METH_KEYWORDS,
+        Graph_Propagate_doc,
+    },
+    {NULL, NULL, 0, NULL}  // Sentinel
+};
+
+static int
+Graph_Exec(PyObject *module)
+{
+    GraphState *state = GetState(module);
+
+    if (!(state->graph_type = NewModuleType(module, &Graph_Spec)))
+        return -1;
+    if (!(state->bfs_type = NewModuleType(module, &BFS_Spec)))
+        return -1;
+    // Calls of types only use vectorcall since Python 3.9
+    state->bfs_type->tp_vectorcall = BFS_Vectorcall;
+    if (!(state->dfs_type = NewModuleType(module, &DFS_Spec)))
+        return -1;
+    if (!(state->disjoint_set_type = NewModuleType(module, &DisjointSet_Spec)))
+        return -1;
+    if (!(state->dfs_pre = PyUnicode_InternFromString("pre")))
+        return -1;
+    if (!(state->dfs_post = PyUnicode_InternFromString("post")))
+        return -1;
+    return 0;
+}
+
+static int
+Graph_Traverse(PyObject *module, visitproc visit, void *arg)
+{
+    GraphState *state = GetState(module);
+    Py_VISIT(state->graph_type);
+    Py_VISIT(state->bfs_type);
+    Py_VISIT(state->dfs_type);
+    Py_VISIT(state->disjoint_set_type);
+    return 0;
+}
+
+static int
+Graph_Clear(PyObject *module)
+{
+    GraphState *state = GetState(module);
+    Py_CLEAR(state->graph_type);
+    Py_CLEAR(state->bfs_type);
+    Py_CLEAR(state->dfs_type);
+    Py_CLEAR(state->disjoint_set_type);
+    Py_CLEAR(state->dfs_pre);
+    Py_CLEAR(state->dfs_post);
+    return 0;
+}
+
+static void
+Graph_Free(void *module)
+{
+    Graph_Clear((PyObject *) module);
+}
+
+static PyModuleDef_Slot Graph_ModuleSlots[] = {
+    {Py_mod_exec, (void *) Graph_Exec},
+    MODULE_THREADING_SLOTS
+    {0, nullptr}  // Sentinel
+};
+
+static struct PyModuleDef graphmodule = {
+   PyModuleDef_HEAD_INIT,
+   "algorithms.graph",                  /* m_name */
+   "Graph algorithms.",                 /* m_doc */
+   sizeof(GraphState),                  /* m_size */
+   GraphMethods,                        /* m_methods */
+   Graph_ModuleSlots,                   /* m_slots */
+   Graph_Traverse,                      /* m_traverse */
+   Graph_Clear,                         /* m_clear */
+   Graph_Free,                          /* m_free */
+};
+
+PyMODINIT_FUNC
+PyInit_graph(void)
+{
+    return PyModuleDef_Init(&graphmodule);
 }
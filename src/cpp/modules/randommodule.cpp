@@ -1,25 +1,34 @@
 #define PY_SSIZE_T_CLEAN  // Make "s#" use Py_ssize_t rather than int
 #include <Python.h>
 
+#include "args.h"
+#include "buffer.h"
+#include "module.h"
 #include "random.h"
 
 static PyObject *
-Random_Sample(PyObject *self, PyObject *args, PyObject *kwargs)
+Random_Sample(PyObject *self, PyObject *const *args, Py_ssize_t nargs,
+              PyObject *kwnames)
 {
+    PyObject *argv[3];
     PyObject *population;
-    PyObject *seed = nullptr;
+    PyObject *seed;
     Py_ssize_t sample_size = 1;
 
     PyObject *sample = nullptr;  // Guilty until proven innocent
 
     (void) self;  // Unused parameter
 
-    // Parse positional arguments
-    static const char *format = "O|nO";
-    static const char *keywords[] = {"", "size", "seed", nullptr};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, (char **) keywords,
-                                     &population, &sample_size, &seed))
-        return nullptr;
+    // Parse positional and keyword arguments
+    static const char *const keywords[] = {"", "size", "seed", nullptr};
+    static ArgParser parser = {"sample", keywords, 1, 3};
+    if (!ParseArgs(&parser, args, nargs, kwnames, argv)) return nullptr;
+    population = argv[0];
+    seed = argv[2];
+    if (argv[1]) {
+        sample_size = PyNumber_AsSsize_t(argv[1], PyExc_OverflowError);
+        if (sample_size == -1 && PyErr_Occurred()) return nullptr;
+    }
 
     // Sample size must be non-negative
     if (sample_size < 0) {
@@ -27,6 +36,19 @@ Random_Sample(PyObject *self, PyObject *args, PyObject *kwargs)
         return nullptr;
     }
 
+    // Buffers of numbers (e.g., array.array) are sampled by position, without
+    // holding the GIL. The buffer export keeps their memory alive meanwhile
+    if (PyObject_CheckBuffer(population)) {
+        Py_buffer view;
+        char format = GetNumericBuffer(population, &view, true);
+        if (format) {
+            sample = SampleBuffer(&view, format, sample_size, seed);
+            PyBuffer_Release(&view);
+            return sample;  // Might be NULL
+        }
+        PyErr_Clear();  // Fall back to iterating over the population
+    }
+
     // Population must be iterable
     if (!(population = PyObject_GetIter(population))) return nullptr;
 
@@ -42,29 +64,37 @@ PyDoc_STRVAR(Random_Sample_doc,
 "in advance since the sampling is done in one pass. The sampling algorithm is\n"
 "Algorithm R in Jeffrey S. Vitter, \"Random sampling with a reservoir\". ACM\n"
 "Transactions on Mathematical Software. Volume 11, Issue 1 (1985), pp. 37--57\n"
-"DOI: https://doi.org/10.1145%2F3147.3165");
+"DOI: https://doi.org/10.1145%2F3147.3165\n\n"
+"If `population` is a buffer of integers or floating point numbers (e.g.,\n"
+"array.array), then it's sampled without holding the GIL.");
 
 // List of functions exposed by the module
 static PyMethodDef RandomMethods[] = {
     {
         "sample",                       // ml_name
         (PyCFunction) Random_Sample,    // ml_meth
-        METH_VARARGS | METH_KEYWORDS,   // ml_flags
+        METH_FASTCALL | METH_KEYWORDS,  // ml_flags
         Random_Sample_doc,              // ml_doc
     },
     {NULL, NULL, 0, NULL}  // Sentinel
 };
 
+static PyModuleDef_Slot RandomSlots[] = {
+    MODULE_THREADING_SLOTS
+    {0, nullptr}  // Sentinel
+};
+
 static PyModuleDef randommodule = {
     PyModuleDef_HEAD_INIT,
     "algorithms.random",                // m_name
     "Randomized algorithms.",           // m_doc
-    -1,                                 // m_size
+    0,                                  // m_size
     RandomMethods,                      // m_methods
+    RandomSlots,                        // m_slots
 };
 
 PyMODINIT_FUNC
 PyInit_random(void)
 {
-    return PyModule_Create(&randommodule);
+    return PyModuleDef_Init(&randommodule);
 }
@@ -0,0 +1,124 @@
+#include "args.h"
+
+#include <cassert>
+
+// Number of parameters of a parser
+static Py_ssize_t
+NumParameters(const ArgParser *parser)
+{
+    Py_ssize_t size = 0;
+    while (parser->keywords[size]) ++size;
+    assert(size <= ARG_PARSER_MAX_KEYWORDS);
+    return size;
+}
+
+// Position of the parameter named `key`, or -1 if there's no such parameter.
+// Names are compared as C strings, so that parsers don't hold any Python
+// objects and can be shared by interpreters and threads
+static Py_ssize_t
+FindKeyword(const ArgParser *parser, Py_ssize_t size, PyObject *key)
+{
+    for (Py_ssize_t i = 0; i < size; ++i)
+        if (parser->keywords[i][0]
+                && !PyUnicode_CompareWithASCIIString(key, parser->keywords[i]))
+            return i;
+    return -1;
+}
+
+bool
+ParseArgs(const ArgParser *parser, PyObject *const *args, Py_ssize_t nargs,
+          PyObject *kwnames, PyObject **out)
+{
+    Py_ssize_t nkwargs = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    Py_ssize_t size = NumParameters(parser);
+
+
+    if (nargs > parser->positional) {
+        PyErr_Format(PyExc_TypeError,
+                     "%s() takes at most %zd positional argument%s "
+                     "(%zd given)", parser->name, parser->positional,
+                     parser->positional == 1 ? "" : "s", nargs);
+        return false;
+    }
+    for (Py_ssize_t i = 0; i < size; ++i)
+        out[i] = i < nargs ? args[i] : nullptr;
+
+    // Positional-only parameters can only be missing if too few positional
+    // arguments were given, which takes precedence over bad keywords
+    for (Py_ssize_t i = nargs; i < parser->required; ++i) {
+        if (!parser->keywords[i][0]) {
+            PyErr_Format(PyExc_TypeError,
+                         "%s() takes at least %zd positional argument%s "
+                         "(%zd given)", parser->name, i + 1,
+                         i ? "s" : "", nargs);
+            return false;
+        }
+    }
+
+    for (Py_ssize_t j = 0; j < nkwargs; ++j) {
+        PyObject *key = PyTuple_GET_ITEM(kwnames, j);
+        Py_ssize_t i = FindKeyword(parser, size, key);
+        if (i < 0) {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_TypeError,
+                             "'%U' is an invalid keyword argument for %s()",
+                             key, parser->name);
+            return false;
+        }
+        if (out[i]) {
+            PyErr_Format(PyExc_TypeError,
+                         "argument for %s() given by name ('%U') and "
+                         "position (%zd)", parser->name, key, i + 1);
+            return false;
+        }
+        out[i] = args[nargs + j];
+    }
+
+    for (Py_ssize_t i = 0; i < parser->required; ++i) {
+        if (!out[i]) {
+            PyErr_Format(PyExc_TypeError,
+                         "%s() missing required argument '%s' (pos %zd)",
+                         parser->name, parser->keywords[i], i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+ParseTupleArgs(const ArgParser *parser, PyObject *args, PyObject *kwargs,
+               PyObject **out)
+{
+    Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    Py_ssize_t nkwargs = kwargs ? PyDict_GET_SIZE(kwargs) : 0;
+    Py_ssize_t size = NumParameters(parser);
+    PyObject *stack[ARG_PARSER_MAX_KEYWORDS + 1];
+    PyObject *kwnames = nullptr;
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    bool ok;
+
+    // Every argument has to match a distinct parameter, so passing on one more
+    // keyword argument than there are parameters left is enough for ParseArgs
+    // to report an error
+    if (nargs > parser->positional)
+        return ParseArgs(parser, &PyTuple_GET_ITEM(args, 0), nargs, nullptr,
+                         out);
+    if (nargs + nkwargs > size) nkwargs = size - nargs + 1;
+
+    // Lay the arguments out as in a vectorcall
+    for (Py_ssize_t i = 0; i < nargs; ++i)
+        stack[i] = PyTuple_GET_ITEM(args, i);
+    if (nkwargs) {
+        if (!(kwnames = PyTuple_New(nkwargs))) return false;
+        for (Py_ssize_t j = 0; j < nkwargs; ++j) {
+            PyDict_Next(kwargs, &pos, &key, &value);
+            Py_INCREF(key);
+            PyTuple_SET_ITEM(kwnames, j, key);
+            stack[nargs + j] = value;
+        }
+    }
+    ok = ParseArgs(parser, stack, nargs, kwnames, out);
+    Py_XDECREF(kwnames);
+    return ok;
+}
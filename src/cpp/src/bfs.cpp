@@ -0,0 +1,263 @@
+#include "bfs.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+// Direction-optimizing breadth-first search, following Scott Beamer, Krste
+// Asanović, and David Patterson, "Direction-optimizing breadth-first search".
+// Proceedings of SC '12 (2012). DOI: https://doi.org/10.1109/SC.2012.50
+//
+// A top-down step scans the out-edges of the frontier, which is cheap while the
+// frontier is small. Once the frontier touches a large fraction of the edges,
+// a bottom-up step is cheaper instead: every unvisited vertex scans its
+// in-edges and stops as soon as it finds a parent in the frontier. The
+// constants below are the switching thresholds suggested in the paper
+
+static const edge_t ALPHA = 15;
+static const vertex_t BETA = 18;
+
+namespace {
+
+// State shared by the top-down and bottom-up steps
+struct BFSState {
+    const CSRGraph &graph;
+    const CSRGraph &reverse;
+    int threads;
+    vertex_t *depth;
+    std::vector<std::atomic<vertex_t>> parent;
+
+    BFSState(const CSRGraph &graph, const CSRGraph &reverse, int threads,
+             vertex_t *depth)
+        : graph(graph), reverse(reverse), threads(threads), depth(depth),
+          parent((size_t) graph.n) {}
+
+    edge_t out_degree(vertex_t v) const
+    {
+        return graph.offsets[v + 1] - graph.offsets[v];
+    }
+};
+
+}  // namespace
+
+// Expand the frontier by following out-edges, returning the number of edges
+// leaving the next frontier
+static edge_t
+TopDownStep(BFSState &state, const std::vector<vertex_t> &frontier,
+            std::vector<vertex_t> &next, vertex_t level)
+{
+    const CSRGraph &graph = state.graph;
+    std::vector<std::vector<vertex_t>> found((size_t) state.threads);
+    std::vector<edge_t> scout((size_t) state.threads, 0);
+
+    ParallelFor(state.threads, frontier.size(),
+                [&](size_t begin, size_t end, int thread) {
+        std::vector<vertex_t> &local = found[(size_t) thread];
+        for (size_t i = begin; i < end; ++i) {
+            vertex_t u = frontier[i];
+            for (edge_t e = graph.offsets[u]; e < graph.offsets[u + 1]; ++e) {
+                vertex_t v = graph.targets[e], unvisited = -1;
+                // Whichever thread claims `v` first becomes its only writer
+                if (state.parent[v].load(std::memory_order_relaxed) == -1
+                        && state.parent[v].compare_exchange_strong(unvisited,
+                                                                   u)) {
+                    state.depth[v] = level + 1;
+                    local.push_back(v);
+                    scout[(size_t) thread] += state.out_degree(v);
+                }
+            }
+        }
+    });
+
+    edge_t total = 0;
+    next.clear();
+    for (int t = 0; t < state.threads; ++t) {
+        next.insert(next.end(), found[t].begin(), found[t].end());
+        total += scout[t];
+    }
+    return total;
+}
+
+// Expand the frontier (given as a bitmap) by searching the in-edges of every
+// unvisited vertex, returning the size of the next frontier. `scout` is set to
+// the number of edges leaving the next frontier
+static vertex_t
+BottomUpStep(BFSState &state, const std::vector<uint64_t> &frontier,
+             std::vector<uint64_t> &next, vertex_t level, edge_t &scout)
+{
+    const CSRGraph &reverse = state.reverse;
+    std::vector<vertex_t> awake((size_t) state.threads, 0);
+    std::vector<edge_t> edges((size_t) state.threads, 0);
+
+    // Chunks are whole words of the bitmaps, so each word of `next` has a
+    // single writer
+    ParallelFor(state.threads, (size_t) reverse.n,
+                [&](size_t begin, size_t end, int thread) {
+        for (size_t w = begin / 64; w < (end + 63) / 64; ++w) next[w] = 0;
+        for (size_t v = begin; v < end; ++v) {
+            if (state.parent[v].load(std::memory_order_relaxed) != -1)
+                continue;
+            for (edge_t e = reverse.offsets[v]; e < reverse.offsets[v + 1];
+                    ++e) {
+                vertex_t u = reverse.targets[e];
+                if ((frontier[u / 64] >> (u % 64)) & 1) {
+                    state.parent[v].store(u, std::memory_order_relaxed);
+                    state.depth[v] = level + 1;
+                    next[v / 64] |= uint64_t(1) << (v % 64);
+                    ++awake[(size_t) thread];
+                    edges[(size_t) thread] += state.out_degree((vertex_t) v);
+                    break;
+                }
+            }
+        }
+    }, 64);
+
+    vertex_t total = 0;
+    scout = 0;
+    for (int t = 0; t < state.threads; ++t) {
+        total += awake[t];
+        scout += edges[t];
+    }
+    return total;
+}
+
+// Compute the depth (distance from the nearest root) and BFS tree parent of
+// every vertex reachable from the roots, with -1 for unreachable vertices.
+// Roots are their own parents. `reverse` must be the reverse graph of `graph`
+void
+BFSLevels(const CSRGraph &graph, const CSRGraph &reverse,
+          const vertex_t *roots, size_t n_roots, int threads,
+          vertex_t *depth, vertex_t *parent)
+{
+    const vertex_t n = graph.n;
+    const size_t words = ((size_t) n + 63) / 64;
+    BFSState state(graph, reverse, NumThreads(threads), depth);
+    std::vector<vertex_t> frontier, next;
+    std::vector<uint64_t> front_bits, next_bits;
+    edge_t scout = 0, edges_to_check = graph.m;
+    vertex_t level = 0;
+
+    for (vertex_t v = 0; v < n; ++v) {
+        state.parent[v].store(-1, std::memory_order_relaxed);
+        depth[v] = -1;
+    }
+    for (size_t i = 0; i < n_roots; ++i) {
+        vertex_t r = roots[i];
+        if (state.parent[r].load(std::memory_order_relaxed) == -1) {
+            state.parent[r].store(r, std::memory_order_relaxed);
+            depth[r] = 0;
+            frontier.push_back(r);
+            scout += state.out_degree(r);
+        }
+    }
+
+    while (!frontier.empty()) {
+        if (scout > edges_to_check / ALPHA) {
+            // Switch to bottom-up steps until the frontier becomes small again
+            // while shrinking
+            vertex_t awake = (vertex_t) frontier.size(), old_awake;
+            front_bits.assign(words, 0);
+            next_bits.resize(words);
+            for (vertex_t v : frontier)
+                front_bits[v / 64] |= uint64_t(1) << (v % 64);
+            // The edges leaving each frontier are checked off as it's
+            // expanded, as in top-down steps, so that the count is current
+            // when deciding to switch again
+            do {
+                edges_to_check -= scout;
+                old_awake = awake;
+                awake = BottomUpStep(state, front_bits, next_bits, level++,
+                                     scout);
+                front_bits.swap(next_bits);
+            } while (awake && (awake >= old_awake || awake > n / BETA));
+
+            // Convert the frontier bitmap back into a queue
+            frontier.clear();
+            for (size_t w = 0; w < words; ++w) {
+                for (uint64_t bits = front_bits[w]; bits; bits &= bits - 1) {
+                    vertex_t v = (vertex_t) (w * 64 + __builtin_ctzll(bits));
+                    frontier.push_back(v);
+                }
+            }
+        } else {
+            edges_to_check -= scout;
+            scout = TopDownStep(state, frontier, next, level++);
+            frontier.swap(next);
+        }
+    }
+
+    for (vertex_t v = 0; v < n; ++v)
+        parent[v] = state.parent[v].load(std::memory_order_relaxed);
+}
+
+// Bidirectional breadth-first search for a shortest path from `source` to
+// `target`: one search goes forward from the source along out-edges, and the
+// other goes backward from the target along in-edges (`reverse` must be the
+// reverse graph of `graph`). Each round expands a whole level of whichever
+// frontier is smaller, until the searches meet. Only the explored vertices are
+// stored, so a query costs time proportional to the explored part of the graph
+// rather than to its size. Returns false if there is no path
+bool
+ShortestPath(const CSRGraph &graph, const CSRGraph &reverse, vertex_t source,
+             vertex_t target, std::vector<vertex_t> &path)
+{
+    // Each explored vertex is mapped to its parent in its search's BFS tree
+    // and its distance from that search's starting vertex
+    typedef std::unordered_map<vertex_t, std::pair<vertex_t, vertex_t>> Tree;
+    Tree forward_tree, backward_tree;
+    std::vector<vertex_t> forward{source}, backward{target}, next;
+    vertex_t forward_depth = 0, backward_depth = 0;
+    vertex_t meet = -1, best = -1;
+
+    path.clear();
+    if (source == target) {
+        path.push_back(source);
+        return true;
+    }
+    forward_tree[source] = std::make_pair(source, 0);
+    backward_tree[target] = std::make_pair(target, 0);
+
+    while (meet < 0 && !forward.empty() && !backward.empty()) {
+        bool is_forward = forward.size() <= backward.size();
+        const CSRGraph &g = is_forward ? graph : reverse;
+        Tree &mine = is_forward ? forward_tree : backward_tree;
+        Tree &theirs = is_forward ? backward_tree : forward_tree;
+        std::vector<vertex_t> &frontier = is_forward ? forward : backward;
+        vertex_t depth = 1 + (is_forward ? forward_depth++ : backward_depth++);
+
+        // Vertices in the other tree can be at different depths, so the first
+        // meeting point found needn't be the best one in this level
+        next.clear();
+        for (vertex_t u : frontier) {
+            for (edge_t e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                vertex_t v = g.targets[e];
+                if (mine.count(v)) continue;
+                mine[v] = std::make_pair(u, depth);
+                Tree::const_iterator it = theirs.find(v);
+                if (it != theirs.end()) {
+                    if (meet < 0 || depth + it->second.second < best) {
+                        meet = v;
+                        best = depth + it->second.second;
+                    }
+                } else {
+                    next.push_back(v);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    if (meet < 0) return false;
+
+    // Walk from the meeting point back to the source, then on to the target
+    for (vertex_t v = meet; v != source; v = forward_tree[v].first)
+        path.push_back(v);
+    path.push_back(source);
+    std::reverse(path.begin(), path.end());
+    for (vertex_t v = meet; v != target;) {
+        v = backward_tree[v].first;
+        path.push_back(v);
+    }
+    return true;
+}
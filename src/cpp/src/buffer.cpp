@@ -0,0 +1,85 @@
+#include "buffer.h"
+
+#include <cstring>
+
+// Size in bytes of an item of a given format with native size and alignment
+static Py_ssize_t
+NativeItemSize(char format)
+{
+    switch (format) {
+        case 'b': case 'B': return sizeof(char);
+        case 'h': case 'H': return sizeof(short);
+        case 'i': case 'I': return sizeof(int);
+        case 'l': case 'L': return sizeof(long);
+        case 'q': case 'Q': return sizeof(long long);
+        case 'n': case 'N': return sizeof(Py_ssize_t);
+        case 'f': return sizeof(float);
+        case 'd': return sizeof(double);
+        default: return 0;
+    }
+}
+
+char
+GetNumericBuffer(PyObject *obj, Py_buffer *view, bool floating)
+{
+    const char *format;
+
+    if (PyObject_GetBuffer(obj, view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+        return 0;
+
+    // Byte order prefixes are fine as long as they agree with the machine's
+    // byte order (the item size is checked against the native size below)
+    format = view->format ? view->format : "B";
+    if (*format == '@' || *format == '='
+            || *format == (PY_LITTLE_ENDIAN ? '<' : '>'))
+        ++format;
+
+    if (view->ndim != 1) {
+        PyErr_SetString(PyExc_ValueError, "expected a one-dimensional buffer");
+    } else if (format[0] && !format[1]
+                    && strchr(floating ? "bBhHiIlLqQnNfd" : "bBhHiIlLqQnN",
+                              format[0])
+                    && view->itemsize == NativeItemSize(format[0])) {
+        return format[0];
+    } else {
+        PyErr_Format(PyExc_TypeError, "unsupported buffer format '%s'",
+                     view->format ? view->format : "B");
+    }
+    PyBuffer_Release(view);
+    return 0;
+}
+
+PyObject *
+GetNumericItem(const void *buf, char format, Py_ssize_t i)
+{
+    switch (format) {
+        case 'L':
+            return PyLong_FromUnsignedLong(((const unsigned long *) buf)[i]);
+        case 'Q':
+            return PyLong_FromUnsignedLongLong(
+                ((const unsigned long long *) buf)[i]);
+        case 'N': return PyLong_FromSize_t(((const size_t *) buf)[i]);
+        case 'f': case 'd':
+            return PyFloat_FromDouble(ReadDouble(buf, format, i));
+        default: return PyLong_FromLongLong(ReadInteger(buf, format, i));
+    }
+}
+
+PyObject *
+NewNumericArray(char format, Py_ssize_t count, void **data)
+{
+    Py_ssize_t itemsize = NativeItemSize(format);
+    PyObject *bytes, *view, *array;
+    char format_string[2] = {format, '\0'};
+
+    if (count > PY_SSIZE_T_MAX / itemsize) return PyErr_NoMemory();
+    if (!(bytes = PyByteArray_FromStringAndSize(nullptr, count * itemsize)))
+        return nullptr;
+    *data = PyByteArray_AS_STRING(bytes);
+    view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (!view) return nullptr;
+    array = PyObject_CallMethod(view, "cast", "s", format_string);
+    Py_DECREF(view);
+    return array;
+}
@@ -0,0 +1,68 @@
+#include "components.h"
+
+#include <algorithm>
+
+// Lock-free linking of the trees of two vertices, following the Link step of
+// Michael Sutton, Tal Ben-Nun, and Amnon Barak, "Optimizing parallel graph
+// connectivity computation via subgraph sampling". Proceedings of IPDPS '18
+// (2018). DOI: https://doi.org/10.1109/IPDPS.2018.00012
+//
+// The larger of two candidate roots is hooked onto the smaller one with a
+// compare-and-swap, which only succeeds if the larger one is still a root. If
+// it fails (another thread hooked it first), both vertices walk up their trees
+// and try again. Parents only ever decrease, so this always terminates
+void
+ConcurrentForest::link(vertex_t u, vertex_t v)
+{
+    vertex_t p1 = parent[u].load(std::memory_order_relaxed);
+    vertex_t p2 = parent[v].load(std::memory_order_relaxed);
+
+    while (p1 != p2) {
+        vertex_t high = std::max(p1, p2), low = std::min(p1, p2);
+        vertex_t p_high = parent[high].load();
+        if (p_high == low) break;       // Already linked
+        if (p_high == high && parent[high].compare_exchange_strong(p_high, low))
+            break;
+        p1 = parent[parent[high].load()].load();
+        p2 = parent[low].load();
+    }
+}
+
+// Point every vertex directly at its root
+void
+ConcurrentForest::compress(int threads)
+{
+    ParallelFor(threads, parent.size(), [&](size_t begin, size_t end, int) {
+        for (size_t v = begin; v < end; ++v) {
+            vertex_t p = parent[v].load(std::memory_order_relaxed);
+            while (p != parent[p].load(std::memory_order_relaxed))
+                p = parent[p].load(std::memory_order_relaxed);
+            parent[v].store(p, std::memory_order_relaxed);
+        }
+    });
+}
+
+// Weakly connected components of a graph: `component[v]` is set to the
+// smallest vertex connected to `v` by a path, ignoring the edges' directions.
+// The edges are split evenly between the threads (rather than the vertices,
+// whose degrees may be very uneven)
+void
+ConnectedComponents(const CSRGraph &graph, int threads, vertex_t *component)
+{
+    ConcurrentForest forest(graph.n);
+
+    threads = NumThreads(threads);
+    ParallelFor(threads, (size_t) graph.m, [&](size_t begin, size_t end, int) {
+        // Find the source of the first edge in this chunk
+        const edge_t *offsets = graph.offsets;
+        vertex_t u = (vertex_t) (std::upper_bound(offsets, offsets + graph.n,
+                                                  (edge_t) begin)
+                                 - offsets - 1);
+        for (size_t e = begin; e < end; ++e) {
+            while (offsets[u + 1] <= (edge_t) e) ++u;
+            forest.link(u, graph.targets[e]);
+        }
+    });
+    forest.compress(threads);
+    for (vertex_t v = 0; v < graph.n; ++v) component[v] = forest[v];
+}
@@ -0,0 +1,92 @@
+#include "dfs.h"
+
+#include <algorithm>
+#include <utility>
+
+// Topological sort by Kahn's algorithm: repeatedly remove a vertex with no
+// incoming edges. The order doubles as the queue of removed vertices whose
+// out-edges haven't been removed yet. Returns false if the graph has a cycle,
+// in which case `order` holds only the vertices which aren't on or after one
+bool
+TopologicalSort(const CSRGraph &graph, std::vector<vertex_t> &order)
+{
+    std::vector<edge_t> in_degree((size_t) graph.n, 0);
+
+    for (edge_t e = 0; e < graph.m; ++e) ++in_degree[graph.targets[e]];
+
+    order.clear();
+    order.reserve((size_t) graph.n);
+    for (vertex_t v = 0; v < graph.n; ++v)
+        if (!in_degree[v]) order.push_back(v);
+
+    for (size_t head = 0; head < order.size(); ++head) {
+        vertex_t u = order[head];
+        for (edge_t e = graph.offsets[u]; e < graph.offsets[u + 1]; ++e) {
+            vertex_t v = graph.targets[e];
+            if (!--in_degree[v]) order.push_back(v);
+        }
+    }
+    return order.size() == (size_t) graph.n;
+}
+
+// Strongly connected components by Tarjan's algorithm, with the recursion
+// replaced by an explicit stack of (vertex, next out-edge) frames so that long
+// paths can't overflow the call stack. See Robert Tarjan, "Depth-first search
+// and linear graph algorithms". SIAM Journal on Computing 1(2) (1972).
+// DOI: https://doi.org/10.1137/0201010
+//
+// Stores the component of every vertex in `component` and returns the number
+// of components. Components are numbered in the order in which they're found,
+// which is a reverse topological order of the condensation: every edge between
+// two components goes from a higher number to a lower one
+vertex_t
+StronglyConnectedComponents(const CSRGraph &graph, vertex_t *component)
+{
+    std::vector<vertex_t> index((size_t) graph.n, -1), low((size_t) graph.n);
+    std::vector<vertex_t> stack;
+    std::vector<std::pair<vertex_t, edge_t>> calls;
+    vertex_t counter = 0, count = 0;
+
+    // A vertex is on Tarjan's stack iff it has an index but no component yet
+    std::fill(component, component + graph.n, -1);
+
+    for (vertex_t root = 0; root < graph.n; ++root) {
+        if (index[root] >= 0) continue;
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        calls.push_back(std::make_pair(root, graph.offsets[root]));
+
+        while (!calls.empty()) {
+            vertex_t v = calls.back().first;
+            edge_t &e = calls.back().second;
+            if (e < graph.offsets[v + 1]) {
+                vertex_t w = graph.targets[e++];
+                if (index[w] < 0) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    calls.push_back(std::make_pair(w, graph.offsets[w]));
+                } else if (component[w] < 0) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            // Every edge out of v has been explored: "return" to its caller
+            calls.pop_back();
+            if (!calls.empty()) {
+                vertex_t u = calls.back().first;
+                low[u] = std::min(low[u], low[v]);
+            }
+            if (low[v] == index[v]) {
+                vertex_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    component[w] = count;
+                } while (w != v);
+                ++count;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,413 @@
+#include "graph.h"
+
+#include "buffer.h"
+#include "module.h"
+
+#include <cstring>
+#include <new>
+
+CSRLayout
+GetCSRLayout(vertex_t n, edge_t m, bool weighted)
+{
+    CSRLayout layout;
+    layout.offsets = 0;
+    layout.targets = layout.offsets + ((size_t) n + 1) * sizeof(edge_t);
+    layout.weights = Align(layout.targets + (size_t) m * sizeof(vertex_t));
+    layout.size = layout.weights;
+    if (weighted) layout.size += (size_t) m * sizeof(double);
+    return layout;
+}
+
+// Allocate the storage block for a CSR graph with `n` vertices and `m` edges,
+// returning a new reference to the object owning it and setting the fields of
+// `csr` to point into it. The arrays are returned through writable pointers,
+// and the graph is weighted if `weights` isn't NULL
+static PyObject *
+AllocateCSR(vertex_t n, edge_t m, CSRGraph *csr, edge_t **offsets,
+            vertex_t **targets, double **weights)
+{
+    CSRLayout layout = GetCSRLayout(n, m, weights != nullptr);
+    PyObject *storage;
+    char *block;
+
+    if (layout.size > (size_t) PY_SSIZE_T_MAX) return PyErr_NoMemory();
+    // We never expose the bytearray itself, so nobody can resize it
+    storage = PyByteArray_FromStringAndSize(nullptr, (Py_ssize_t) layout.size);
+    if (!storage) return nullptr;
+    block = PyByteArray_AS_STRING(storage);
+
+    *offsets = (edge_t *) (block + layout.offsets);
+    *targets = (vertex_t *) (block + layout.targets);
+    if (weights) *weights = (double *) (block + layout.weights);
+    csr->n = n;
+    csr->m = m;
+    csr->offsets = *offsets;
+    csr->targets = *targets;
+    csr->weights = weights ? *weights : nullptr;
+    return storage;
+}
+
+// Fill in the CSR arrays of a graph from a list of `m` edges given by the
+// callables `source(i)` and `target(i)`, which must return valid vertices, and
+// `weight(i)` if the graph is weighted. The relative order of edges with the
+// same source is preserved
+template <typename Source, typename Target, typename Weight>
+static int
+FillCSR(GraphObject *graph, vertex_t n, edge_t m, Source source, Target target,
+        bool weighted, Weight weight)
+{
+    edge_t *offsets;
+    vertex_t *targets;
+    double *weights;
+    PyObject *storage = AllocateCSR(n, m, &graph->csr, &offsets, &targets,
+                                    weighted ? &weights : nullptr);
+
+    if (!storage) return 0;
+    Py_XSETREF(graph->storage, storage);
+
+    // The callables only read edges out of C arrays or buffers held by the
+    // caller, so the sort doesn't need the GIL
+    Py_BEGIN_ALLOW_THREADS
+
+    // Counting sort of the edges by their sources: first count the out-degree
+    // of each vertex, then turn the counts into starting positions
+    memset(offsets, 0, ((size_t) n + 1) * sizeof(edge_t));
+    for (edge_t i = 0; i < m; ++i)
+        ++offsets[source(i) + 1];
+    for (vertex_t v = 0; v < n; ++v)
+        offsets[v + 1] += offsets[v];
+
+    // Scatter the targets into place, using `offsets[v]` as a cursor for the
+    // next free position in the adjacency list of `v`, then shift the offsets
+    // back into place
+    for (edge_t i = 0; i < m; ++i) {
+        edge_t e = offsets[source(i)]++;
+        targets[e] = target(i);
+        if (weighted) weights[e] = weight(i);
+    }
+    for (vertex_t v = n; v > 0; --v)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+
+    Py_END_ALLOW_THREADS
+    return 1;
+}
+
+// Get the vertex corresponding to a node label, assigning it the next
+// available vertex if it hasn't been seen before. Returns -1 on failure
+static vertex_t
+Intern(PyObject *labels, PyObject *index, PyObject *label)
+{
+    PyObject *vertex = PyDict_GetItemWithError(index, label);  // Borrowed
+    Py_ssize_t n;
+
+    if (vertex) return (vertex_t) PyLong_AsLong(vertex);
+    if (PyErr_Occurred()) return -1;
+
+    n = PyList_GET_SIZE(labels);
+    if (n >= MAX_VERTICES) {
+        PyErr_SetString(PyExc_OverflowError, "too many nodes in graph");
+        return -1;
+    }
+    if (!(vertex = PyLong_FromSsize_t(n))) return -1;
+    if (PyDict_SetItem(index, label, vertex) < 0
+            || PyList_Append(labels, label) < 0) {
+        Py_DECREF(vertex);
+        return -1;
+    }
+    Py_DECREF(vertex);
+    return (vertex_t) n;
+}
+
+// Whether the neighbors of a node in an adjacency list are given as a mapping
+// from neighbors to edge weights (or edge attributes), rather than an iterable
+static inline bool
+IsWeightedAdjacency(PyObject *neighbors)
+{
+    return PyDict_Check(neighbors)
+        || (PyMapping_Check(neighbors) && !PySequence_Check(neighbors));
+}
+
+int
+GetEdgeWeight(PyObject *value, PyObject *key, double *weight)
+{
+    if (key && key != Py_None) {
+        if (!(value = PyObject_GetItem(value, key))) return 0;
+        *weight = PyFloat_AsDouble(value);
+        Py_DECREF(value);
+    } else {
+        *weight = PyFloat_AsDouble(value);
+    }
+    return !(*weight == -1.0 && PyErr_Occurred());
+}
+
+int
+BuildGraphFromMapping(GraphObject *graph, PyObject *mapping, PyObject *weight)
+{
+    PyObject *labels = nullptr;
+    PyObject *index = nullptr;
+    PyObject *keys = nullptr;
+    PyObject *neighbors = nullptr;
+    std::vector<vertex_t> sources, targets;
+    std::vector<double> weights;
+    int weighted = -1;  // Unknown until we see the first adjacency list
+    int status = 0;
+
+    if (!(labels = PyList_New(0))) goto done;
+    if (!(index = PyDict_New())) goto done;
+    if (!(keys = PyMapping_Keys(mapping))) goto done;
+
+    // Nodes which are keys of the mapping get the first vertices, in order.
+    // Nodes which only appear as neighbors are numbered as they're found
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(keys); ++i)
+        if (Intern(labels, index, PyList_GET_ITEM(keys, i)) < 0) goto done;
+
+    try {
+        for (Py_ssize_t i = 0; i < PyList_GET_SIZE(keys); ++i) {
+            PyObject *key = PyList_GET_ITEM(keys, i);
+            vertex_t u = Intern(labels, index, key);
+            if (u < 0) goto done;
+
+            if (!(neighbors = PyObject_GetItem(mapping, key))) goto done;
+            if (weighted < 0) {
+                weighted = IsWeightedAdjacency(neighbors);
+            } else if (weighted != IsWeightedAdjacency(neighbors)) {
+                PyErr_SetString(PyExc_TypeError,
+                                "adjacency lists must be all mappings (for "
+                                "weighted graphs) or all non-mappings");
+                goto done;
+            }
+
+            if (weighted) {
+                // The neighbors are mapped to edge weights (or to mappings of
+                // edge attributes, if `weight` is the key of the weight)
+                Py_SETREF(neighbors, PyMapping_Items(neighbors));
+                if (!neighbors) goto done;
+                for (Py_ssize_t j = 0; j < PyList_GET_SIZE(neighbors); ++j) {
+                    PyObject *item = PyList_GET_ITEM(neighbors, j);
+                    double w;
+                    vertex_t v;
+                    if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2) {
+                        PyErr_SetString(PyExc_TypeError,
+                                        "items() must return pairs");
+                        goto done;
+                    }
+                    v = Intern(labels, index, PyTuple_GET_ITEM(item, 0));
+                    if (v < 0) goto done;
+                    if (!GetEdgeWeight(PyTuple_GET_ITEM(item, 1), weight, &w))
+                        goto done;
+                    sources.push_back(u);
+                    targets.push_back(v);
+                    weights.push_back(w);
+                }
+            } else {
+                Py_SETREF(neighbors, PyObject_GetIter(neighbors));
+                if (!neighbors) goto done;
+                while (PyObject *neighbor = PyIter_Next(neighbors)) {
+                    vertex_t v = Intern(labels, index, neighbor);
+                    Py_DECREF(neighbor);
+                    if (v < 0) goto done;
+                    sources.push_back(u);
+                    targets.push_back(v);
+                }
+                if (PyErr_Occurred()) goto done;
+            }
+            Py_CLEAR(neighbors);
+        }
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    if (!FillCSR(graph, (vertex_t) PyList_GET_SIZE(labels),
+                 (edge_t) sources.size(),
+                 [&](edge_t i) { return sources[i]; },
+                 [&](edge_t i) { return targets[i]; },
+                 weighted > 0, [&](edge_t i) { return weights[i]; }))
+        goto done;
+
+    Py_XSETREF(graph->labels, labels);
+    Py_XSETREF(graph->index, index);
+    labels = index = nullptr;
+    status = 1;
+
+done:
+    Py_XDECREF(labels);
+    Py_XDECREF(index);
+    Py_XDECREF(keys);
+    Py_XDECREF(neighbors);
+    return status;
+}
+
+int
+BuildGraphFromEdges(GraphObject *graph, PyObject *sources, PyObject *targets,
+                    PyObject *weights, Py_ssize_t num_nodes)
+{
+    Py_buffer s, t, w;
+    char s_format, t_format, w_format = 0;
+    Py_ssize_t m;
+    int64_t max_vertex = -1;
+    std::vector<vertex_t> ids;          // Sources and targets, interleaved
+    int status = 0;
+
+    if (!(s_format = GetNumericBuffer(sources, &s))) return 0;
+    if (!(t_format = GetNumericBuffer(targets, &t))) {
+        PyBuffer_Release(&s);
+        return 0;
+    }
+    if (weights && weights != Py_None
+            && !(w_format = GetNumericBuffer(weights, &w, true))) {
+        PyBuffer_Release(&s);
+        PyBuffer_Release(&t);
+        return 0;
+    }
+
+    m = s.len / s.itemsize;
+    if (m != t.len / t.itemsize || (w_format && m != w.len / w.itemsize)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "edge buffers must have the same length");
+        goto done;
+    }
+
+    // Validate the edges before touching the CSR arrays. The buffers stay
+    // exported until we're done, so their memory can be read without the GIL.
+    // Their items can still be assigned to by other threads in the meantime,
+    // so the CSR is built from a private copy of the validated ids rather than
+    // by reading the buffers again
+    try {
+        ids.resize(2 * (size_t) m);
+    } catch (const std::bad_alloc &) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < m; ++i) {
+        int64_t u = ReadInteger(s.buf, s_format, i);
+        int64_t v = ReadInteger(t.buf, t_format, i);
+        if (u < 0 || v < 0) {
+            max_vertex = -2;
+            break;
+        }
+        if (u > max_vertex) max_vertex = u;
+        if (v > max_vertex) max_vertex = v;
+        // Ids that don't fit are rejected below, along with their copies
+        ids[2 * (size_t) i] = (vertex_t) u;
+        ids[2 * (size_t) i + 1] = (vertex_t) v;
+    }
+    Py_END_ALLOW_THREADS
+    if (max_vertex == -2) {
+        PyErr_SetString(PyExc_ValueError, "nodes must be non-negative");
+        goto done;
+    }
+    if (num_nodes < 0) {
+        num_nodes = (Py_ssize_t) (max_vertex + 1);
+    } else if (max_vertex >= num_nodes) {
+        PyErr_SetString(PyExc_ValueError, "node out of range");
+        goto done;
+    }
+    if (num_nodes > MAX_VERTICES) {
+        PyErr_SetString(PyExc_OverflowError, "too many nodes in graph");
+        goto done;
+    }
+
+    status = FillCSR(graph, (vertex_t) num_nodes, (edge_t) m,
+        [&](edge_t i) { return ids[2 * (size_t) i]; },
+        [&](edge_t i) { return ids[2 * (size_t) i + 1]; },
+        w_format != 0, [&](edge_t i) { return ReadDouble(w.buf, w_format, i); });
+    if (status) {
+        // Vertices are their own labels
+        Py_CLEAR(graph->labels);
+        Py_CLEAR(graph->index);
+    }
+
+done:
+    PyBuffer_Release(&s);
+    PyBuffer_Release(&t);
+    if (w_format) PyBuffer_Release(&w);
+    return status;
+}
+
+const CSRGraph *
+GraphReverse(GraphObject *graph)
+{
+    const CSRGraph &csr = graph->csr;
+    CSRGraph reverse;
+    edge_t *offsets;
+    vertex_t *targets;
+    PyObject *storage;
+    bool built;
+
+    // The reverse graph is the only part of a Graph object that changes, once,
+    // so it's all that the object's lock guards
+    Py_BEGIN_CRITICAL_SECTION(graph);
+    built = graph->reverse_storage != nullptr;
+    Py_END_CRITICAL_SECTION();
+    if (built) return &graph->reverse;
+
+    storage = AllocateCSR(csr.n, csr.m, &reverse, &offsets, &targets, nullptr);
+    if (!storage) return nullptr;
+
+    // Counting sort of the edges by their targets, as in FillCSR. The reverse
+    // graph is only used for reachability, so its edges are unweighted
+    Py_BEGIN_ALLOW_THREADS
+    memset(offsets, 0, ((size_t) csr.n + 1) * sizeof(edge_t));
+    for (edge_t e = 0; e < csr.m; ++e)
+        ++offsets[csr.targets[e] + 1];
+    for (vertex_t v = 0; v < csr.n; ++v)
+        offsets[v + 1] += offsets[v];
+    for (vertex_t u = 0; u < csr.n; ++u)
+        for (edge_t e = csr.offsets[u]; e < csr.offsets[u + 1]; ++e)
+            targets[offsets[csr.targets[e]]++] = u;
+    for (vertex_t v = csr.n; v > 0; --v)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+    Py_END_ALLOW_THREADS
+
+    // Another thread may have built the reverse graph meanwhile, in which case
+    // the first one wins, since other threads may already be using it
+    Py_BEGIN_CRITICAL_SECTION(graph);
+    if (!graph->reverse_storage) {
+        graph->reverse = reverse;
+        graph->reverse_storage = storage;
+        storage = nullptr;
+    }
+    Py_END_CRITICAL_SECTION();
+    Py_XDECREF(storage);
+    return &graph->reverse;
+}
+
+PyObject *
+GraphLabel(GraphObject *graph, vertex_t v)
+{
+    if (graph->labels) {
+        PyObject *label = PyList_GET_ITEM(graph->labels, v);
+        Py_INCREF(label);
+        return label;
+    }
+    return PyLong_FromLong(v);
+}
+
+vertex_t
+GraphVertex(GraphObject *graph, PyObject *label)
+{
+    if (graph->index) {
+        PyObject *vertex = PyDict_GetItemWithError(graph->index, label);
+        if (vertex) return (vertex_t) PyLong_AsLong(vertex);
+    } else if (PyLong_Check(label)) {
+        long v = PyLong_AsLong(label);
+        if (v >= 0 && v < graph->csr.n) return (vertex_t) v;
+        if (v == -1 && PyErr_Occurred()) {
+            if (!PyErr_ExceptionMatches(PyExc_OverflowError)) return -1;
+            PyErr_Clear();
+        }
+    }
+    if (!PyErr_Occurred()) {
+        // Wrap the label in a tuple, in case the label is itself a tuple
+        PyObject *args = PyTuple_Pack(1, label);
+        if (args) {
+            PyErr_SetObject(PyExc_KeyError, args);
+            Py_DECREF(args);
+        }
+    }
+    return -1;
+}
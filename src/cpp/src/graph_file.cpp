@@ -0,0 +1,619 @@
+#include "graph_file.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+static_assert(sizeof(GraphFileHeader) == 64, "graph file header must be 64 bytes");
+
+// Call a function of a standard library module, returning a new reference
+static PyObject *
+CallModuleFunction(const char *module_name, const char *name, PyObject *args,
+                   PyObject *kwargs)
+{
+    PyObject *module, *function, *result;
+
+    if (!(module = PyImport_ImportModule(module_name))) return nullptr;
+    function = PyObject_GetAttrString(module, name);
+    Py_DECREF(module);
+    if (!function) return nullptr;
+    result = PyObject_Call(function, args, kwargs);
+    Py_DECREF(function);
+    return result;
+}
+
+// Open a file with io.open(), returning a new reference
+static PyObject *
+OpenFile(PyObject *path, const char *mode)
+{
+    PyObject *args = Py_BuildValue("(Os)", path, mode), *file;
+    if (!args) return nullptr;
+    file = CallModuleFunction("io", "open", args, nullptr);
+    Py_DECREF(args);
+    return file;
+}
+
+// Close a file or mmap object (preserving any exception already raised),
+// stealing the reference to it. Returns `status`, or 0 if closing it failed
+static int
+Close(PyObject *file, int status)
+{
+    PyObject *type, *value, *traceback, *result;
+
+    PyErr_Fetch(&type, &value, &traceback);
+    result = PyObject_CallMethod(file, "close", nullptr);
+    Py_DECREF(file);
+    if (type) {
+        Py_XDECREF(result);
+        PyErr_Restore(type, value, traceback);
+        return 0;
+    }
+    if (!result) return 0;
+    Py_DECREF(result);
+    return status;
+}
+
+// Memory-map the whole of an open file, returning a new reference to the
+// mmap.mmap object. The file may be closed afterwards
+static PyObject *
+MapFile(PyObject *file, Py_ssize_t size, bool writable)
+{
+    PyObject *fileno, *mmap, *access, *args, *kwargs, *mapping = nullptr;
+
+    if (!(fileno = PyObject_CallMethod(file, "fileno", nullptr))) return nullptr;
+    if (!(mmap = PyImport_ImportModule("mmap"))) {
+        Py_DECREF(fileno);
+        return nullptr;
+    }
+    access = PyObject_GetAttrString(mmap, writable ? "ACCESS_WRITE"
+                                                   : "ACCESS_READ");
+    args = Py_BuildValue("(On)", fileno, size);
+    kwargs = access ? Py_BuildValue("{sO}", "access", access) : nullptr;
+    if (args && kwargs)
+        mapping = CallModuleFunction("mmap", "mmap", args, kwargs);
+    Py_XDECREF(kwargs);
+    Py_XDECREF(args);
+    Py_XDECREF(access);
+    Py_DECREF(mmap);
+    Py_DECREF(fileno);
+    return mapping;
+}
+
+// Write a block of memory to a file object
+static int
+WriteBytes(PyObject *file, const void *data, size_t size)
+{
+    PyObject *view, *result;
+
+    view = PyMemoryView_FromMemory((char *) data, (Py_ssize_t) size, PyBUF_READ);
+    if (!view) return 0;
+    result = PyObject_CallMethod(file, "write", "O", view);
+    Py_DECREF(view);
+    if (!result) return 0;
+    Py_DECREF(result);
+    return 1;
+}
+
+int
+SaveGraph(GraphObject *graph, PyObject *path)
+{
+    const CSRGraph &csr = graph->csr;
+    CSRLayout layout = GetCSRLayout(csr.n, csr.m, csr.weights != nullptr);
+    GraphFileHeader header;
+    PyObject *labels = nullptr, *file, *args, *result;
+    static const char padding[8] = {0};
+    int status = 0;
+
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof header.magic);
+    header.version = GRAPH_FILE_VERSION;
+    header.byte_order = GRAPH_FILE_BYTE_ORDER;
+    header.flags = csr.weights ? GRAPH_FILE_WEIGHTED : 0;
+    header.num_nodes = (uint64_t) csr.n;
+    header.num_edges = (uint64_t) csr.m;
+    header.csr_offset = sizeof header;
+    if (graph->labels) {
+        if (!(args = PyTuple_Pack(1, graph->labels))) return 0;
+        labels = CallModuleFunction("pickle", "dumps", args, nullptr);
+        Py_DECREF(args);
+        if (!labels) return 0;
+        header.flags |= GRAPH_FILE_LABELED;
+        header.labels_offset = Align(header.csr_offset + layout.size);
+        header.labels_size = (uint64_t) PyBytes_GET_SIZE(labels);
+    }
+
+    if (!(file = OpenFile(path, "wb"))) goto done;
+    if (!WriteBytes(file, &header, sizeof header)) goto close;
+    if (!(result = PyObject_CallMethod(file, "write", "O", graph->storage)))
+        goto close;
+    Py_DECREF(result);
+    if (labels) {
+        size_t gap = header.labels_offset - header.csr_offset - layout.size;
+        if (!WriteBytes(file, padding, gap)
+                || !WriteBytes(file, PyBytes_AS_STRING(labels),
+                               header.labels_size))
+            goto close;
+    }
+    status = 1;
+
+close:
+    status = Close(file, status);
+done:
+    Py_XDECREF(labels);
+    return status;
+}
+
+// Check that the CSR arrays of a graph loaded from a file are well-formed
+static bool
+ValidCSR(const CSRGraph &csr)
+{
+    for (vertex_t v = 0; v < csr.n; ++v)
+        if (csr.offsets[v] > csr.offsets[v + 1]) return false;
+    for (edge_t e = 0; e < csr.m; ++e)
+        if (csr.targets[e] < 0 || csr.targets[e] >= csr.n) return false;
+    return true;
+}
+
+// Unpickle the labels of a graph loaded from a file, and index them
+static int
+LoadLabels(GraphObject *graph, PyObject *view, const GraphFileHeader &header)
+{
+    PyObject *pickled, *args, *labels, *index;
+
+    pickled = PySequence_GetSlice(view, (Py_ssize_t) header.labels_offset,
+                                  (Py_ssize_t) (header.labels_offset
+                                                + header.labels_size));
+    if (!pickled) return 0;
+    args = PyTuple_Pack(1, pickled);
+    Py_DECREF(pickled);
+    if (!args) return 0;
+    labels = CallModuleFunction("pickle", "loads", args, nullptr);
+    Py_DECREF(args);
+    if (!labels) return 0;
+    if (!PyList_CheckExact(labels)
+            || PyList_GET_SIZE(labels) != (Py_ssize_t) header.num_nodes) {
+        PyErr_SetString(PyExc_ValueError, "corrupt graph file");
+        Py_DECREF(labels);
+        return 0;
+    }
+
+    if (!(index = PyDict_New())) {
+        Py_DECREF(labels);
+        return 0;
+    }
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(labels); ++i) {
+        PyObject *vertex = PyLong_FromSsize_t(i);
+        if (!vertex
+                || PyDict_SetItem(index, PyList_GET_ITEM(labels, i), vertex) < 0) {
+            Py_XDECREF(vertex);
+            Py_DECREF(labels);
+            Py_DECREF(index);
+            return 0;
+        }
+        Py_DECREF(vertex);
+    }
+    if (PyDict_GET_SIZE(index) != PyList_GET_SIZE(labels)) {
+        PyErr_SetString(PyExc_ValueError, "corrupt graph file");
+        Py_DECREF(labels);
+        Py_DECREF(index);
+        return 0;
+    }
+    Py_XSETREF(graph->labels, labels);
+    Py_XSETREF(graph->index, index);
+    return 1;
+}
+
+int
+LoadGraph(GraphObject *graph, PyObject *path, bool validate)
+{
+    PyObject *file, *mapping, *view = nullptr, *storage = nullptr;
+    GraphFileHeader header;
+    CSRLayout layout;
+    CSRGraph csr;
+    const char *data, *block;
+    uint64_t size;
+    bool valid = true;
+    int status = 0;
+
+    if (!(file = OpenFile(path, "rb"))) return 0;
+    mapping = MapFile(file, 0, false);
+    if (!Close(file, 1) || !mapping) {
+        Py_XDECREF(mapping);
+        return 0;
+    }
+
+    // The memoryview keeps the mapping open for as long as the graph needs it
+    view = PyMemoryView_FromObject(mapping);
+    Py_DECREF(mapping);
+    if (!view) return 0;
+    data = (const char *) PyMemoryView_GET_BUFFER(view)->buf;
+    size = (uint64_t) PyMemoryView_GET_BUFFER(view)->len;
+
+    if (size < sizeof header) {
+        PyErr_SetString(PyExc_ValueError, "not a graph file");
+        goto done;
+    }
+    memcpy(&header, data, sizeof header);
+    if (memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof header.magic)) {
+        PyErr_SetString(PyExc_ValueError, "not a graph file");
+        goto done;
+    }
+    if (header.byte_order != GRAPH_FILE_BYTE_ORDER) {
+        PyErr_SetString(PyExc_ValueError,
+                        "graph file was written with another byte order");
+        goto done;
+    }
+    if (header.version != GRAPH_FILE_VERSION) {
+        PyErr_Format(PyExc_ValueError, "unsupported graph file version %lu",
+                     (unsigned long) header.version);
+        goto done;
+    }
+
+    // Make sure every section lies within the file before touching it
+    if (header.num_nodes > MAX_VERTICES
+            || header.num_edges > size / sizeof(vertex_t)
+            || header.csr_offset % 8 != 0 || header.csr_offset > size) {
+        PyErr_SetString(PyExc_ValueError, "corrupt graph file");
+        goto done;
+    }
+    layout = GetCSRLayout((vertex_t) header.num_nodes,
+                          (edge_t) header.num_edges,
+                          header.flags & GRAPH_FILE_WEIGHTED);
+    if (layout.size > size - header.csr_offset
+            || ((header.flags & GRAPH_FILE_LABELED)
+                && (header.labels_offset > size
+                    || header.labels_size > size - header.labels_offset))) {
+        PyErr_SetString(PyExc_ValueError, "corrupt graph file");
+        goto done;
+    }
+
+    block = data + header.csr_offset;
+    csr.n = (vertex_t) header.num_nodes;
+    csr.m = (edge_t) header.num_edges;
+    csr.offsets = (const edge_t *) (block + layout.offsets);
+    csr.targets = (const vertex_t *) (block + layout.targets);
+    csr.weights = header.flags & GRAPH_FILE_WEIGHTED
+        ? (const double *) (block + layout.weights) : nullptr;
+    if (csr.offsets[0] != 0 || csr.offsets[csr.n] != csr.m) valid = false;
+    if (valid && validate) {
+        Py_BEGIN_ALLOW_THREADS
+        valid = ValidCSR(csr);
+        Py_END_ALLOW_THREADS
+    }
+    if (!valid) {
+        PyErr_SetString(PyExc_ValueError, "corrupt graph file");
+        goto done;
+    }
+
+    if (header.flags & GRAPH_FILE_LABELED) {
+        if (!LoadLabels(graph, view, header)) goto done;
+    } else {
+        Py_CLEAR(graph->labels);
+        Py_CLEAR(graph->index);
+    }
+    storage = PySequence_GetSlice(view, (Py_ssize_t) header.csr_offset,
+                                  (Py_ssize_t) (header.csr_offset
+                                                + layout.size));
+    if (!storage) goto done;
+    Py_XSETREF(graph->storage, storage);
+    graph->csr = csr;
+    status = 1;
+
+done:
+    Py_DECREF(view);
+    return status;
+}
+
+namespace {
+
+// Sequential reader of the edges of an edge list file, which is either text
+// (one edge "source target" or "source target weight" per line, with blank
+// lines and comments starting with '#' or '%' ignored, as well as any further
+// columns) or binary (packed records of two native integers of the given
+// struct format, followed by a native double if the edges are weighted)
+class EdgeReader {
+public:
+    std::string error;                  // Why the last call to next() failed
+
+    EdgeReader(FILE *file, char format, bool weighted)
+        : file(file), format(format), weighted(weighted),
+          buffer(CHUNK + 1) {}
+
+    // Start reading again from the beginning of the file
+    void rewind()
+    {
+        std::rewind(file);
+        begin = end = 0;
+        line = 0;
+        eof = false;
+    }
+
+    // Read the next edge, returning 1 if there is one, 0 at the end of the
+    // file, and -1 if the file couldn't be read or parsed
+    int next(int64_t &u, int64_t &v, double &w)
+    {
+        int status = format == 't' ? next_line(u, v, w) : next_record(u, v, w);
+        if (status > 0 && (u < 0 || v < 0)) {
+            fail("nodes must be non-negative");
+            return -1;
+        }
+        return status;
+    }
+
+private:
+    static const size_t CHUNK = 1 << 20;
+
+    FILE *file;
+    char format;                        // 't' for text, or "iq" for binary
+    bool weighted;
+    // Data read but not parsed yet is in [begin, end), and the buffer always
+    // has room for a NUL terminator at `end`
+    std::vector<char> buffer;
+    size_t begin = 0, end = 0;
+    size_t line = 0;
+    bool eof = false;
+
+    void fail(const char *message)
+    {
+        error = message;
+        if (format == 't') error += " on line " + std::to_string(line);
+    }
+
+    // Read more of the file into the buffer, keeping the unparsed data and
+    // growing the buffer if it's full of it. Returns false on failure
+    bool fill()
+    {
+        size_t pending = end - begin;
+        memmove(buffer.data(), buffer.data() + begin, pending);
+        begin = 0;
+        end = pending;
+        if (end + 1 == buffer.size()) buffer.resize(2 * buffer.size() - 1);
+        size_t count = fread(buffer.data() + end, 1, buffer.size() - 1 - end,
+                             file);
+        end += count;
+        if (!count) {
+            if (ferror(file)) {
+                error = strerror(errno);
+                return false;
+            }
+            eof = true;
+        }
+        return true;
+    }
+
+    int next_line(int64_t &u, int64_t &v, double &w)
+    {
+        while (true) {
+            char *start = buffer.data() + begin, *stop, *p;
+            stop = (char *) memchr(start, '\n', end - begin);
+            if (!stop) {
+                if (!eof) {
+                    if (!fill()) return -1;
+                    continue;
+                }
+                if (begin == end) return 0;
+                stop = buffer.data() + end;  // Last line without a newline
+            }
+            *stop = '\0';
+            begin = (size_t) (stop - buffer.data()) + (stop < buffer.data() + end);
+            ++line;
+
+            p = start;
+            while (*p == ' ' || *p == '\t' || *p == '\r') ++p;
+            if (!*p || *p == '#' || *p == '%') continue;
+            if (!parse_integer(p, u) || !parse_integer(p, v)) return -1;
+            w = 1.0;
+            if (weighted) {
+                char *q;
+                errno = 0;
+                w = strtod(p, &q);
+                if (q == p || errno == ERANGE) {
+                    fail("expected a weight");
+                    return -1;
+                }
+            }
+            return 1;
+        }
+    }
+
+    bool parse_integer(char *&p, int64_t &value)
+    {
+        char *q;
+        errno = 0;
+        long long parsed = strtoll(p, &q, 10);
+        if (q == p || errno == ERANGE || (*q && !strchr(" \t\r", *q))) {
+            fail("expected a node");
+            return false;
+        }
+        value = (int64_t) parsed;
+        p = q;
+        return true;
+    }
+
+    int next_record(int64_t &u, int64_t &v, double &w)
+    {
+        const size_t itemsize = format == 'i' ? sizeof(int32_t)
+                                              : sizeof(int64_t);
+        const size_t record = 2 * itemsize + (weighted ? sizeof(double) : 0);
+
+        while (end - begin < record) {
+            if (eof) {
+                if (begin == end) return 0;
+                error = "edge list ends with an incomplete record";
+                return -1;
+            }
+            if (!fill()) return -1;
+        }
+        const char *p = buffer.data() + begin;
+        if (format == 'i') {
+            int32_t pair[2];
+            memcpy(pair, p, sizeof pair);
+            u = pair[0];
+            v = pair[1];
+        } else {
+            int64_t pair[2];
+            memcpy(pair, p, sizeof pair);
+            u = pair[0];
+            v = pair[1];
+        }
+        w = 1.0;
+        if (weighted) memcpy(&w, p + 2 * itemsize, sizeof w);
+        begin += record;
+        return 1;
+    }
+};
+
+}  // namespace
+
+// First pass of the conversion of an edge list: count the out-degree of every
+// node, and the number of edges. The vertex count `n` is found (if it's
+// negative) or checked
+static bool
+CountEdges(EdgeReader &reader, std::vector<edge_t> &degree, Py_ssize_t &n,
+           edge_t &m)
+{
+    const int64_t limit = n >= 0 ? (int64_t) n : (int64_t) MAX_VERTICES;
+    int64_t u, v;
+    double w;
+    int status;
+
+    m = 0;
+    if (n >= 0) degree.assign((size_t) n, 0);
+    while ((status = reader.next(u, v, w)) > 0) {
+        if (u >= limit || v >= limit) {
+            reader.error = n >= 0 ? "node out of range" : "too many nodes";
+            return false;
+        }
+        int64_t larger = u > v ? u : v;
+        if ((size_t) larger >= degree.size()) degree.resize((size_t) larger + 1);
+        ++degree[u];
+        ++m;
+    }
+    if (n < 0) n = (Py_ssize_t) degree.size();
+    return status == 0;
+}
+
+// Second pass of the conversion of an edge list: lay out the CSR arrays in the
+// (memory-mapped) block, using the degrees as the next free position of each
+// node's neighbors, which keeps the edges of every node in their input order
+static bool
+FillEdges(EdgeReader &reader, std::vector<edge_t> &degree, vertex_t n,
+          edge_t m, char *block, const CSRLayout &layout)
+{
+    edge_t *offsets = (edge_t *) (block + layout.offsets);
+    vertex_t *targets = (vertex_t *) (block + layout.targets);
+    double *weights = (double *) (block + layout.weights);
+    bool weighted = layout.size > layout.weights;
+    int64_t u, v;
+    double w;
+    int status;
+
+    offsets[0] = 0;
+    for (vertex_t x = 0; x < n; ++x) {
+        offsets[x + 1] = offsets[x] + degree[x];
+        degree[x] = offsets[x];
+    }
+
+    reader.rewind();
+    while ((status = reader.next(u, v, w)) > 0) {
+        if (u >= n || v >= n || degree[u] == offsets[u + 1]) {
+            reader.error = "edge list changed during conversion";
+            return false;
+        }
+        edge_t e = degree[u]++;
+        targets[e] = (vertex_t) v;
+        if (weighted) weights[e] = w;
+    }
+    if (status < 0) return false;
+    for (vertex_t x = 0; x < n; ++x) {
+        if (degree[x] != offsets[x + 1]) {
+            reader.error = "edge list changed during conversion";
+            return false;
+        }
+    }
+    (void) m;  // Only used to size the block
+    return true;
+}
+
+int
+ConvertEdgeList(PyObject *source, PyObject *destination, char format,
+                bool weighted, Py_ssize_t n)
+{
+    PyObject *source_bytes, *file, *mapping = nullptr, *result;
+    GraphFileHeader header;
+    CSRLayout layout;
+    Py_buffer view;
+    std::vector<edge_t> degree;
+    edge_t m = 0;
+    FILE *input;
+    bool ok = false, failed = false;
+    int status = 0;
+
+    if (!PyUnicode_FSConverter(source, &source_bytes)) return 0;
+    input = fopen(PyBytes_AS_STRING(source_bytes), format == 't' ? "r" : "rb");
+    Py_DECREF(source_bytes);
+    if (!input) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, source);
+        return 0;
+    }
+    EdgeReader reader(input, format, weighted);
+
+    // The input is only read here, in chunks, and the degrees are the only
+    // thing kept for every node, so memory use doesn't depend on the edges
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        ok = CountEdges(reader, degree, n, m);
+    } catch (const std::bad_alloc &) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed || !ok) goto fail;
+
+    layout = GetCSRLayout((vertex_t) n, m, weighted);
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof header.magic);
+    header.version = GRAPH_FILE_VERSION;
+    header.byte_order = GRAPH_FILE_BYTE_ORDER;
+    header.flags = weighted ? GRAPH_FILE_WEIGHTED : 0;
+    header.num_nodes = (uint64_t) n;
+    header.num_edges = (uint64_t) m;
+    header.csr_offset = sizeof header;
+
+    // Size the output file and map it, so that the second pass can scatter the
+    // edges into place while the kernel takes care of writing them out
+    if (!(file = OpenFile(destination, "w+b"))) goto done;
+    result = PyObject_CallMethod(file, "truncate", "n",
+                                 (Py_ssize_t) (sizeof header + layout.size));
+    Py_XDECREF(result);
+    if (result) mapping = MapFile(file, 0, true);
+    if (!Close(file, 1) || !mapping) goto done;
+    if (PyObject_GetBuffer(mapping, &view, PyBUF_WRITABLE) < 0) goto done;
+
+    Py_BEGIN_ALLOW_THREADS
+    ok = FillEdges(reader, degree, (vertex_t) n, m,
+                   (char *) view.buf + header.csr_offset, layout);
+    Py_END_ALLOW_THREADS
+    // The header goes in last, so that the file a failed conversion leaves
+    // behind doesn't pass for a graph file when it's loaded
+    if (ok) memcpy(view.buf, &header, sizeof header);
+    PyBuffer_Release(&view);
+    if (!ok) goto fail;
+
+    if (!(result = PyObject_CallMethod(mapping, "flush", nullptr))) goto done;
+    Py_DECREF(result);
+    status = 1;
+    goto done;
+
+fail:
+    if (failed)
+        PyErr_NoMemory();
+    else
+        PyErr_SetString(PyExc_ValueError, reader.error.c_str());
+done:
+    if (mapping) status = Close(mapping, status);
+    fclose(input);
+    return status;
+}
@@ -1,9 +1,29 @@
 #include "random.h"
 
+#include "buffer.h"
+
+#include <new>
+#include <vector>
+
 // The only reason this is C++ and not C is the better random number generators
 // and functions in the C++ standard library
 #include <random>
 
+// Seed a random number generator with a Python int, or with a random device if
+// `seed` is NULL. Returns false on failure
+static bool
+Seed(std::mt19937 &rng, PyObject *seed)
+{
+    if (seed == nullptr) {
+        rng.seed(std::random_device()());
+    } else {
+        unsigned long seed_ = PyLong_AsUnsignedLong(seed);
+        if (PyErr_Occurred()) return false;
+        rng.seed(seed_);
+    }
+    return true;
+}
+
 // Draw a random sample without replacement from the iterable `population` of
 // length `n` in `O(n)` steps (i.e., independent of `sample_size`).
 PyObject *
@@ -30,15 +50,9 @@ Sample(PyObject *population, Py_ssize_t sample_size, PyObject *seed) {
     }
 
     // Seed the random number generator
-    if (seed == nullptr) {
-        rng.seed(std::random_device()());
-    } else {
-        unsigned long seed_ = PyLong_AsUnsignedLong(seed);
-        if (PyErr_Occurred()) {
-            Py_DECREF(reservoir);
-            return nullptr;
-        }
-        rng.seed(seed_);
+    if (!Seed(rng, seed)) {
+        Py_DECREF(reservoir);
+        return nullptr;
     }
 
     // Iterate over the remaining items in the population, randomly replacing
@@ -61,3 +75,50 @@ Sample(PyObject *population, Py_ssize_t sample_size, PyObject *seed) {
 
     return reservoir;
 }
+
+// Same as Sample, for a population given by the items of a buffer of the given
+// numeric format. The reservoir holds positions in the buffer rather than
+// Python objects, so the O(n) pass over the population runs without the GIL.
+// It draws the same random numbers as Sample, so both functions return the
+// same sample of the same population for the same seed
+PyObject *
+SampleBuffer(const Py_buffer *population, char format, Py_ssize_t sample_size,
+             PyObject *seed)
+{
+    Py_ssize_t n = population->len / population->itemsize;
+    std::vector<Py_ssize_t> reservoir;
+    std::mt19937 rng;
+    PyObject *sample;
+
+    if (n < sample_size) {
+        PyErr_SetString(PyExc_ValueError, "population is too small");
+        return nullptr;
+    }
+    if (!Seed(rng, seed)) return nullptr;
+    try {
+        reservoir.resize((size_t) sample_size);
+    } catch (const std::bad_alloc &) {
+        return PyErr_NoMemory();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t i = 0; i < sample_size; ++i)
+        reservoir[i] = i;
+    for (Py_ssize_t i = sample_size; i < n; ++i) {
+        std::uniform_int_distribution<Py_ssize_t> randint(0, i);
+        Py_ssize_t j = randint(rng);
+        if (j < sample_size) reservoir[j] = i;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!(sample = PyList_New(sample_size))) return nullptr;
+    for (Py_ssize_t i = 0; i < sample_size; ++i) {
+        PyObject *item = GetNumericItem(population->buf, format, reservoir[i]);
+        if (!item) {
+            Py_DECREF(sample);
+            return nullptr;
+        }
+        PyList_SET_ITEM(sample, i, item);
+    }
+    return sample;
+}
@@ -0,0 +1,214 @@
+#include "shortest_paths.h"
+
+#include <new>
+
+namespace {
+
+// Best-first search of an adjacency list whose adjacency lists are either
+// mappings from neighbors to edge weights (or to mappings of edge attributes,
+// where `weight` is the key of the weight) or iterables of neighbors (for
+// unweighted graphs). Nodes are numbered as they're discovered, which lets the
+// search use an indexed heap and flat arrays instead of Python containers
+struct MappingSearch {
+    PyObject *graph;
+    PyObject *weight;
+    PyObject *heuristic;                // NULL for Dijkstra's algorithm
+    PyObject *target;                   // NULL to search the whole graph
+    PyObject *index = nullptr;          // Maps nodes to their ids
+    std::vector<PyObject *> nodes;      // Borrowed from the keys of index
+    std::vector<double> distance;
+    std::vector<Py_ssize_t> parent;
+    std::vector<char> settled;
+    Py_ssize_t found = -1;              // Id of the target once it's settled
+
+    MappingSearch(PyObject *graph, PyObject *weight, PyObject *heuristic,
+                  PyObject *target)
+        : graph(graph), weight(weight), heuristic(heuristic), target(target) {}
+
+    ~MappingSearch() { Py_XDECREF(index); }
+
+    // Get the id of a node, numbering it if it's new. Returns -1 on failure
+    Py_ssize_t intern(PyObject *node)
+    {
+        PyObject *id = PyDict_GetItemWithError(index, node);
+        if (id) return PyLong_AsSsize_t(id);
+        if (PyErr_Occurred()) return -1;
+
+        Py_ssize_t n = (Py_ssize_t) nodes.size();
+        if (!(id = PyLong_FromSsize_t(n))) return -1;
+        int status = PyDict_SetItem(index, node, id);
+        Py_DECREF(id);
+        if (status < 0) return -1;
+        nodes.push_back(node);
+        distance.push_back(std::numeric_limits<double>::infinity());
+        parent.push_back(-1);
+        settled.push_back(0);
+        return n;
+    }
+
+    // Lower bound on the distance from a node to the target
+    bool estimate(PyObject *node, double &value)
+    {
+        if (!heuristic) {
+            value = 0.0;
+            return true;
+        }
+        PyObject *result = PyObject_CallFunctionObjArgs(heuristic, node, target,
+                                                        nullptr);
+        if (!result) return false;
+        value = PyFloat_AsDouble(result);
+        Py_DECREF(result);
+        return !(value == -1.0 && PyErr_Occurred());
+    }
+
+    // Relax the edge from node `u` to the node `node` of weight `w`
+    bool relax(IndexedHeap<double> &heap, Py_ssize_t u, PyObject *node,
+               double w)
+    {
+        double h;
+        if (!(w >= 0.0)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "edge weights must be non-negative");
+            return false;
+        }
+        Py_ssize_t v = intern(node);
+        if (v < 0) return false;
+        if (distance[u] + w < distance[v]) {
+            distance[v] = distance[u] + w;
+            parent[v] = u;
+            if (!estimate(node, h)) return false;
+            heap.push((size_t) v, distance[v] + h);
+        }
+        return true;
+    }
+
+    // Relax every edge leaving node `u`
+    bool expand(IndexedHeap<double> &heap, Py_ssize_t u)
+    {
+        PyObject *neighbors = PyObject_GetItem(graph, nodes[u]);
+        bool ok = true;
+        double w;
+
+        if (!neighbors) {
+            // A node without an adjacency list has no outgoing edges
+            if (!PyErr_ExceptionMatches(PyExc_KeyError)) return false;
+            PyErr_Clear();
+            return true;
+        }
+
+        if (PyDict_Check(neighbors)
+                || (PyMapping_Check(neighbors) && !PySequence_Check(neighbors))) {
+            Py_SETREF(neighbors, PyMapping_Items(neighbors));
+            if (!neighbors) return false;
+            for (Py_ssize_t i = 0; ok && i < PyList_GET_SIZE(neighbors); ++i) {
+                PyObject *item = PyList_GET_ITEM(neighbors, i);
+                ok = PyTuple_Check(item) && PyTuple_GET_SIZE(item) == 2;
+                if (!ok) {
+                    PyErr_SetString(PyExc_TypeError,
+                                    "items() must return pairs");
+                    break;
+                }
+                ok = GetEdgeWeight(PyTuple_GET_ITEM(item, 1), weight, &w)
+                    && relax(heap, u, PyTuple_GET_ITEM(item, 0), w);
+            }
+        } else {
+            PyObject *node;
+            Py_SETREF(neighbors, PyObject_GetIter(neighbors));
+            if (!neighbors) return false;
+            while (ok && (node = PyIter_Next(neighbors))) {
+                ok = relax(heap, u, node, 1.0);
+                Py_DECREF(node);
+            }
+            ok = ok && !PyErr_Occurred();
+        }
+        Py_DECREF(neighbors);
+        return ok;
+    }
+
+    bool run(PyObject *source)
+    {
+        IndexedHeap<double> heap;
+        Py_ssize_t s, t = -1;
+        double h;
+
+        try {
+            if (!(index = PyDict_New())) return false;
+            if ((s = intern(source)) < 0) return false;
+            if (target && (t = intern(target)) < 0) return false;
+            distance[s] = 0.0;
+            if (!estimate(source, h)) return false;
+            heap.push((size_t) s, h);
+
+            while (!heap.empty()) {
+                Py_ssize_t u = (Py_ssize_t) heap.pop().first;
+                settled[u] = 1;
+                if (u == t) {
+                    found = t;
+                    break;
+                }
+                if (!expand(heap, u)) return false;
+            }
+        } catch (const std::bad_alloc &) {
+            PyErr_NoMemory();
+            return false;
+        }
+        return true;
+    }
+};
+
+}  // namespace
+
+// Dijkstra's algorithm on an adjacency list, returning a tuple of dicts
+// (distance, parent), where the source's parent is None
+PyObject *
+DijkstraMapping(PyObject *graph, PyObject *source, PyObject *target,
+                PyObject *weight)
+{
+    MappingSearch search(graph, weight, nullptr, target);
+    PyObject *distance = nullptr, *parent = nullptr;
+
+    if (!search.run(source)) return nullptr;
+    if (!(distance = PyDict_New()) || !(parent = PyDict_New())) goto fail;
+    for (size_t v = 0; v < search.nodes.size(); ++v) {
+        if (!search.settled[v]) continue;
+        PyObject *d = PyFloat_FromDouble(search.distance[v]);
+        if (!d) goto fail;
+        int status = PyDict_SetItem(distance, search.nodes[v], d);
+        Py_DECREF(d);
+        if (status < 0) goto fail;
+        Py_ssize_t p = search.parent[v];
+        if (PyDict_SetItem(parent, search.nodes[v],
+                           p < 0 ? Py_None : search.nodes[p]) < 0)
+            goto fail;
+    }
+    return Py_BuildValue("NN", distance, parent);
+
+fail:
+    Py_XDECREF(distance);
+    Py_XDECREF(parent);
+    return nullptr;
+}
+
+// A* search on an adjacency list, returning a tuple (distance, path), or
+// (inf, None) if the target is unreachable
+PyObject *
+AStarMapping(PyObject *graph, PyObject *source, PyObject *target,
+             PyObject *heuristic, PyObject *weight)
+{
+    MappingSearch search(graph, weight, heuristic, target);
+    PyObject *path;
+    Py_ssize_t length = 0;
+
+    if (!search.run(source)) return nullptr;
+    if (search.found < 0)
+        return Py_BuildValue("dO", std::numeric_limits<double>::infinity(),
+                             Py_None);
+
+    for (Py_ssize_t v = search.found; v >= 0; v = search.parent[v]) ++length;
+    if (!(path = PyList_New(length))) return nullptr;
+    for (Py_ssize_t v = search.found; v >= 0; v = search.parent[v]) {
+        Py_INCREF(search.nodes[v]);
+        PyList_SET_ITEM(path, --length, search.nodes[v]);
+    }
+    return Py_BuildValue("dN", search.distance[search.found], path);
+}
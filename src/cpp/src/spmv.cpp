@@ -0,0 +1,165 @@
+#include "spmv.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Target size of the slice of the vector being gathered from during one pass
+// of a cache-blocked product, which should fit comfortably in a core's cache
+static const size_t CACHE_BLOCK_BYTES = 1 << 20;
+
+// Smallest average in-degree at which a product is cache-blocked. Each pass
+// streams through the cursors of every vertex, which costs far less per vertex
+// than the cache miss saved per edge, so a few edges per vertex are enough no
+// matter how many blocks there are
+static const size_t MIN_BLOCKED_DEGREE = 8;
+
+// Pull-based product `sum[v] = sum of x[u] over the edges u -> v` of a graph,
+// given as its reverse graph (whose adjacency lists are the in-neighbors).
+//
+// Gathering x[u] for the in-neighbors of every v in turn reads x at random.
+// Once x is much larger than the cache, nearly every read misses, so the
+// product is cache-blocked instead: x is split into blocks that fit in the
+// cache, and each pass gathers from one block only, resuming every adjacency
+// list where the previous pass stopped. That relies on the in-neighbors being
+// sorted, which they are in reverse graphs (see GraphReverse). Blocking adds a
+// pass over the cursors per block, so it's only worth it when the in-degrees
+// are large enough to make up for that (see MIN_BLOCKED_DEGREE)
+template <typename T>
+static void
+PullSums(const CSRGraph &reverse, const T *x, int threads,
+         std::vector<edge_t> &cursor, double *sum)
+{
+    const size_t n = (size_t) reverse.n;
+    const size_t block = CACHE_BLOCK_BYTES / sizeof(T);
+    const size_t blocks = (n + block - 1) / block;
+    const edge_t *offsets = reverse.offsets;
+    const vertex_t *sources = reverse.targets;
+
+    if (blocks <= 1 || (size_t) reverse.m < MIN_BLOCKED_DEGREE * n) {
+        ParallelFor(threads, n, [&](size_t begin, size_t end, int) {
+            for (size_t v = begin; v < end; ++v) {
+                double total = 0.0;
+                for (edge_t e = offsets[v]; e < offsets[v + 1]; ++e)
+                    total += x[sources[e]];
+                sum[v] = total;
+            }
+        });
+        return;
+    }
+
+    cursor.assign(offsets, offsets + n);
+    std::fill(sum, sum + n, 0.0);
+    for (size_t b = 0; b < blocks; ++b) {
+        const vertex_t stop = (vertex_t) std::min(n, (b + 1) * block);
+        ParallelFor(threads, n, [&](size_t begin, size_t end, int) {
+            for (size_t v = begin; v < end; ++v) {
+                edge_t e = cursor[v];
+                double total = 0.0;
+                for (; e < offsets[v + 1] && sources[e] < stop; ++e)
+                    total += x[sources[e]];
+                cursor[v] = e;
+                sum[v] += total;
+            }
+        });
+    }
+}
+
+// PageRank by power iteration, following Lawrence Page, Sergey Brin, Rajeev
+// Motwani, and Terry Winograd, "The PageRank citation ranking: Bringing order
+// to the web". Stanford InfoLab technical report (1999).
+//
+// Each iteration pulls rank along the in-edges of every vertex (so every
+// vertex is written by a single thread and no atomics are needed). The rank of
+// vertices without out-edges, and the teleportation probability 1 - damping,
+// are redistributed according to `personalization` (uniformly if it's NULL,
+// and otherwise it must sum to 1). Stops once the L1 distance between
+// successive rank vectors is below n * tol, returning the number of
+// iterations, or -1 if that doesn't happen within `max_iter` iterations
+template <typename T>
+int
+PageRank(const CSRGraph &graph, const CSRGraph &reverse, double damping,
+         double tol, size_t max_iter, const double *personalization,
+         int threads, T *rank)
+{
+    const size_t n = (size_t) graph.n;
+    std::vector<T> contribution(n);
+    std::vector<double> sum(n);
+    std::vector<edge_t> cursor;
+    std::vector<double> dangling, error;
+
+    if (!n) return 0;
+    threads = NumThreads(threads);
+    dangling.resize((size_t) threads);
+    error.resize((size_t) threads);
+    std::fill(rank, rank + n, (T) (1.0 / (double) n));
+
+    for (size_t iteration = 1; iteration <= max_iter; ++iteration) {
+        // Spread the rank of every vertex evenly over its out-edges
+        std::fill(dangling.begin(), dangling.end(), 0.0);
+        ParallelFor(threads, n, [&](size_t begin, size_t end, int thread) {
+            double local = 0.0;
+            for (size_t u = begin; u < end; ++u) {
+                edge_t degree = graph.offsets[u + 1] - graph.offsets[u];
+                if (degree) {
+                    contribution[u] = (T) (rank[u] / (double) degree);
+                } else {
+                    contribution[u] = 0;
+                    local += rank[u];
+                }
+            }
+            dangling[thread] = local;
+        });
+        double redistributed = 1.0 - damping;
+        for (double d : dangling) redistributed += damping * d;
+
+        PullSums(reverse, contribution.data(), threads, cursor, sum.data());
+
+        std::fill(error.begin(), error.end(), 0.0);
+        ParallelFor(threads, n, [&](size_t begin, size_t end, int thread) {
+            double local = 0.0;
+            for (size_t v = begin; v < end; ++v) {
+                double p = personalization ? personalization[v]
+                                           : 1.0 / (double) n;
+                double next = damping * sum[v] + redistributed * p;
+                local += std::fabs(next - (double) rank[v]);
+                rank[v] = (T) next;
+            }
+            error[thread] = local;
+        });
+        double total = 0.0;
+        for (double e : error) total += e;
+        if (total < (double) n * tol) return (int) iteration;
+    }
+    return -1;
+}
+
+// Sparse matrix-vector product `y = A x`, where A is the adjacency matrix of a
+// graph (with A[u][v] the weight of the edge u -> v, or 1 if `weights` is
+// NULL). Every vertex gathers from its own out-edges, so the threads never
+// write to the same place
+template <typename T>
+void
+Propagate(const CSRGraph &graph, const double *weights, const T *x,
+          int threads, T *y)
+{
+    ParallelFor(NumThreads(threads), (size_t) graph.n,
+                [&](size_t begin, size_t end, int) {
+        for (size_t u = begin; u < end; ++u) {
+            double total = 0.0;
+            for (edge_t e = graph.offsets[u]; e < graph.offsets[u + 1]; ++e)
+                total += (weights ? weights[e] : 1.0) * x[graph.targets[e]];
+            y[u] = (T) total;
+        }
+    });
+}
+
+template int PageRank<float>(const CSRGraph &, const CSRGraph &, double,
+                             double, size_t, const double *, int, float *);
+template int PageRank<double>(const CSRGraph &, const CSRGraph &, double,
+                              double, size_t, const double *, int, double *);
+template void Propagate<float>(const CSRGraph &, const double *,
+                               const float *, int, float *);
+template void Propagate<double>(const CSRGraph &, const double *,
+                                const double *, int, double *);
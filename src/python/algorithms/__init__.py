@@ -7,3 +7,6 @@ __description__ = 'Some algorithm implementations as C/C++ extensions'
 __url__ = 'https://github.com/artemmavrin/algorithms'
 
 __doc__ = __description__
+
+from ._instrument import instrument
+from .containers import SortedList
@@ -0,0 +1,70 @@
+"""Operation counting for the C extension modules: see instrument()."""
+
+import importlib
+
+# Extension modules whose algorithms are instrumented
+MODULES = ('algorithms.selection', 'algorithms.sets', 'algorithms.sort')
+
+# Counters that are maxima over calls instead of totals
+MAXIMA = ('max_depth',)
+
+# Stats dicts of the instrument() blocks currently entered, outermost first
+_active = []
+
+
+def _modules():
+    return [importlib.import_module(name) for name in MODULES]
+
+
+def _start():
+    for module in _modules():
+        module._instrument(True)
+
+
+def _collect():
+    """Stop counting, and add the counts so far to every active block."""
+    for module in _modules():
+        for name, counts in module._instrument(False).items():
+            for stats in _active:
+                totals = stats.setdefault(name, dict.fromkeys(counts, 0))
+                for key, value in counts.items():
+                    if key in MAXIMA:
+                        totals[key] = max(totals[key], value)
+                    else:
+                        totals[key] += value
+
+
+class instrument:
+    """Context manager counting the operations performed by the algorithms
+    called inside it.
+
+        >>> with instrument() as stats:
+        ...     merge_sort(data)
+        >>> stats['merge_sort']['comparisons']
+
+    On exit, `stats` maps the name of every algorithm called in the block to a
+    dict of counters totalled over its calls: 'calls', 'comparisons' of Python
+    objects, 'swaps', other element 'moves', temporary 'allocations', the
+    largest recursion depth 'max_depth', and the wall time in 'seconds'.
+
+    Blocks can be nested, in which case the outer block's stats include the
+    inner block's. Counting is process-wide rather than per-thread, and
+    typed buffer kernels, which release the GIL, only count calls and time.
+    """
+
+    def __init__(self):
+        self.stats = {}
+
+    def __enter__(self):
+        if _active:
+            _collect()
+        _active.append(self.stats)
+        _start()
+        return self.stats
+
+    def __exit__(self, *exc_info):
+        _collect()
+        _active.remove(self.stats)
+        if _active:
+            _start()
+        return False
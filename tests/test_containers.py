@@ -0,0 +1,177 @@
+"""Unit tests for container data structures."""
+
+import bisect
+import functools
+import gc
+import random
+import unittest
+import weakref
+
+import algorithms
+from algorithms.containers import SortedList
+
+
+@functools.total_ordering
+class Item:
+    """Comparable by value, with a label to tell equal items apart."""
+
+    def __init__(self, value, label=None):
+        self.value = value
+        self.label = label
+
+    def __lt__(self, other):
+        return self.value < other.value
+
+    def __eq__(self, other):
+        return self.value == other.value
+
+    def __repr__(self):
+        return f'Item({self.value!r}, {self.label!r})'
+
+
+class SortedListTestCase(unittest.TestCase):
+    def check(self, items, expected):
+        self.assertEqual(len(items), len(expected))
+        self.assertEqual(list(items), expected)
+        self.assertEqual([items[i] for i in range(len(expected))], expected)
+
+    def test_random_operations(self):
+        rng = random.Random(0)
+        generators = [lambda: rng.randint(-50, 50),
+                      lambda: rng.uniform(-50, 50),
+                      lambda: str(rng.randint(0, 100))]
+        for generate in generators:
+            items, expected = SortedList(), []
+            for _ in range(3000):
+                op = rng.random()
+                x = generate()
+                if op < 0.45:
+                    items.add(x)
+                    bisect.insort(expected, x)
+                elif op < 0.75:
+                    if x in expected:
+                        expected.remove(x)
+                        items.remove(x)
+                    else:
+                        items.discard(x)
+                elif op < 0.8:
+                    batch = [generate() for _ in range(rng.randint(0, 500))]
+                    items.update(batch)
+                    expected = sorted(expected + batch)
+                elif op < 0.9 and expected:
+                    i = rng.randrange(-len(expected), len(expected))
+                    self.assertEqual(items.pop(i), expected.pop(i))
+                else:
+                    self.assertEqual(items.bisect_left(x),
+                                     bisect.bisect_left(expected, x))
+                    self.assertEqual(items.bisect_right(x),
+                                     bisect.bisect_right(expected, x))
+                    self.assertEqual(items.count(x), expected.count(x))
+                    self.assertEqual(x in items, x in expected)
+            self.check(items, expected)
+            self.assertEqual(items[::3], expected[::3])
+            self.assertEqual(items[-5::-2], expected[-5::-2])
+            self.assertEqual(list(reversed(items)), expected[::-1])
+
+    def test_equal_items_keep_their_order(self):
+        rng = random.Random(1)
+        labeled = [Item(rng.randrange(10), i) for i in range(2000)]
+        items = SortedList(labeled[:1000])
+        for item in labeled[1000:1100]:
+            items.add(item)
+        items.update(labeled[1100:])
+        expected = sorted(labeled, key=lambda item: item.value)
+        self.assertEqual([item.label for item in items],
+                         [item.label for item in expected])
+        items.remove(Item(3))
+        expected.remove(Item(3))
+        self.assertEqual([item.label for item in items],
+                         [item.label for item in expected])
+
+    def test_mixed_numbers(self):
+        # Typed int and float lists fall back to comparing objects
+        items = SortedList([3, 1, 2])
+        items.update([1.5, 0.5])
+        items.add(2 ** 70)
+        items.add(-0.0)
+        self.assertEqual(list(items), [-0.0, 0.5, 1, 1.5, 2, 3, 2 ** 70])
+        self.assertIn(2.0, items)
+        self.assertEqual(items.index(3.0), 5)
+        self.assertEqual(SortedList([0.0, -1.0]).index(-0.0), 1)
+        self.assertEqual(SortedList([2, 1]).bisect_left(1.5), 1)
+
+    def test_irange(self):
+        items = SortedList(range(0, 20, 2))
+        self.assertEqual(list(items.irange(4, 10)), [4, 6, 8, 10])
+        self.assertEqual(list(items.irange(3, 11)), [4, 6, 8, 10])
+        self.assertEqual(
+            list(items.irange(4, 10, inclusive=(False, False))), [6, 8])
+        self.assertEqual(list(items.irange(maximum=3)), [0, 2])
+        self.assertEqual(list(items.irange(15)), [16, 18])
+        self.assertEqual(list(items.irange(10, 4)), [])
+        with self.assertRaises(TypeError):
+            items.irange(inclusive=True)
+
+    def test_errors(self):
+        items = SortedList([1, 2, 3])
+        with self.assertRaisesRegex(ValueError, 'not in SortedList'):
+            items.remove(4)
+        with self.assertRaisesRegex(ValueError, 'not in SortedList'):
+            items.index(0)
+        with self.assertRaises(IndexError):
+            items[3]
+        with self.assertRaises(IndexError):
+            items.pop(-4)
+        with self.assertRaises(TypeError):
+            items['a']
+        with self.assertRaises(TypeError):
+            items.add('a')
+        with self.assertRaises(TypeError):
+            SortedList([1, 'a', 2])
+        self.assertEqual(list(items), [1, 2, 3])
+        with self.assertRaisesRegex(IndexError, 'empty'):
+            SortedList().pop()
+        with self.assertRaises(TypeError):
+            hash(items)
+
+    def test_modification_during_comparison(self):
+        items = SortedList()
+
+        class Meddler(Item):
+            def __lt__(self, other):
+                items.add(Item(0))
+                return super().__lt__(other)
+
+        items.update([Item(1), Item(2)])
+        with self.assertRaisesRegex(RuntimeError, 'comparing'):
+            items.add(Meddler(3))
+        self.assertEqual(len(items), 2)
+
+    def test_modification_during_iteration(self):
+        items = SortedList(range(10))
+        with self.assertRaisesRegex(RuntimeError, 'changed'):
+            for item in items:
+                items.discard(item)
+
+    def test_repr_and_clear(self):
+        items = SortedList('cab')
+        self.assertEqual(repr(items), "SortedList(['a', 'b', 'c'])")
+        items.clear()
+        self.assertEqual(repr(items), 'SortedList([])')
+        items.add(1.0)
+        self.assertEqual(list(items), [1.0])
+
+    def test_reference_cycles(self):
+        items = SortedList()
+        items.add(Item(0, items))
+        ref = weakref.ref(items[0])
+        del items
+        gc.collect()
+        self.assertIsNone(ref())
+
+    def test_package_export(self):
+        self.assertIs(algorithms.SortedList, SortedList)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -1,11 +1,26 @@
 """Graph algorithm unit tests."""
 
+import array
+import gc
+import random
 import unittest
+import heapq
+import math
+import os
+import struct
+import tempfile
+import threading
+import weakref
 from collections import deque
+from concurrent.futures import ThreadPoolExecutor
 from itertools import combinations, product
 from typing import Any, Iterable, Iterator, Mapping
 
-from algorithms.graph import bfs
+from algorithms.graph import (DisjointSet, Graph, astar, bfs, bfs_levels,
+                              connected_components, convert_edge_list, dfs,
+                              dijkstra, pagerank, propagate,
+                              shortest_path, strongly_connected_components,
+                              topological_sort)
 
 SIMPLE_GRAPHS = [
     {0: [1, 2], 1: [3, 4], 2: [5, 6], 4: [4, 5, 6, 0]},
@@ -41,6 +56,27 @@ def bfs_py(graph: Mapping[Any, Iterable[Any]], root: Any) -> Iterator[Any]:
             yield node
 
 
+def distances_py(graph: Mapping[Any, Iterable[Any]], roots) -> dict:
+    """Pure Python reference for the distance from the nearest root."""
+    distances = dict.fromkeys(roots, 0)
+    queue = deque(distances)
+    while queue:
+        node = queue.popleft()
+        for neighbor in graph.get(node, ()):
+            if neighbor not in distances:
+                distances[neighbor] = distances[node] + 1
+                queue.append(neighbor)
+    return distances
+
+
+def random_graph(rng, n, m):
+    """Random directed graph with n nodes and about m edges."""
+    graph = {}
+    for _ in range(m):
+        graph.setdefault(rng.randrange(n), []).append(rng.randrange(n))
+    return graph
+
+
 def all_sequences(n):
     for i in range(n + 1):
         yield from combinations(range(n), i)
@@ -73,3 +109,1194 @@ class BFSTestCase(unittest.TestCase):
                 self.assertEqual(b1, b2)
                 for v1, v2 in zip(b1, b2):
                     self.assertIs(v1, v2)
+
+
+class GraphTestCase(unittest.TestCase):
+    def test_from_mapping(self):
+        for graph in SIMPLE_GRAPHS:
+            g = Graph(graph)
+            self.assertEqual(len(g), len(vertices(graph)))
+            self.assertEqual(g.num_edges, sum(map(len, graph.values())))
+            self.assertEqual(set(g.nodes), vertices(graph))
+            self.assertEqual(len(g.offsets), g.num_nodes + 1)
+            self.assertEqual(len(g.targets), g.num_edges)
+            for i, node in enumerate(g.nodes):
+                self.assertIn(node, g)
+                neighbors = g.targets[g.offsets[i]:g.offsets[i + 1]]
+                self.assertEqual([g.nodes[j] for j in neighbors],
+                                 list(graph.get(node, [])))
+        self.assertNotIn('missing', Graph({0: [1]}))
+
+    def test_from_edges(self):
+        sources = array.array('q', [0, 0, 1, 2, 4])
+        targets = array.array('i', [1, 2, 3, 0, 4])
+        g = Graph.from_edges(sources, targets)
+        self.assertEqual(g.num_nodes, 5)
+        self.assertEqual(g.num_edges, 5)
+        self.assertEqual(g.nodes, [0, 1, 2, 3, 4])
+        self.assertEqual(list(g.offsets), [0, 2, 3, 4, 4, 5])
+        self.assertEqual(list(g.targets), [1, 2, 3, 0, 4])
+        self.assertEqual(Graph.from_edges(sources, targets, 7).num_nodes, 7)
+        with self.assertRaises(TypeError):
+            g.offsets[0] = 1  # Read-only
+
+    def test_from_edges_bad_input(self):
+        with self.assertRaises(ValueError):
+            Graph.from_edges(array.array('i', [0, 1]), array.array('i', [0]))
+        with self.assertRaises(ValueError):
+            Graph.from_edges(array.array('i', [-1]), array.array('i', [0]))
+        with self.assertRaises(ValueError):
+            Graph.from_edges(array.array('i', [5]), array.array('i', [0]), 3)
+        with self.assertRaises(TypeError):
+            Graph.from_edges(array.array('d', [0]), array.array('d', [0]))
+        with self.assertRaises(TypeError):
+            Graph.from_edges([0, 1], [1, 0])
+
+    def test_bfs_small_graphs(self):
+        for n in range(1, 5):
+            for graph in all_graphs(n):
+                g = Graph(graph)
+                for root in range(n):
+                    self.assertEqual(list(bfs(g, root)),
+                                     list(bfs_py(graph, root)))
+
+    def test_bfs_simple_graphs(self):
+        for graph in SIMPLE_GRAPHS:
+            g = Graph(graph)
+            for root in vertices(graph):
+                b1 = list(bfs(g, root))
+                b2 = list(bfs_py(graph, root))
+                self.assertEqual(b1, b2)
+                for v1, v2 in zip(b1, b2):
+                    self.assertIs(v1, v2)
+            with self.assertRaises(KeyError):
+                bfs(g, 'missing')
+
+    def test_bfs_from_edges(self):
+        rng = random.Random(0)
+        for _ in range(20):
+            n = rng.randint(1, 50)
+            edges = [(rng.randrange(n), rng.randrange(n))
+                     for _ in range(rng.randint(0, 3 * n))]
+            graph = {}
+            for u, v in edges:
+                graph.setdefault(u, []).append(v)
+            g = Graph.from_edges(array.array('i', [u for u, _ in edges]),
+                                 array.array('i', [v for _, v in edges]), n)
+            for root in range(n):
+                self.assertEqual(list(bfs(g, root)),
+                                 list(bfs_py(graph, root)))
+
+
+def levels_py(graph: Mapping[Any, Iterable[Any]], root: Any) -> list:
+    """Pure Python reference for the (node, depth, parent) items of a BFS."""
+    items = []
+    level = [(root, None)]
+    seen = {root}
+    depth = 0
+    while level:
+        next_level = []
+        for node, parent in level:
+            items.append((node, depth, parent))
+            for neighbor in graph.get(node, ()):
+                if neighbor not in seen:
+                    seen.add(neighbor)
+                    next_level.append((neighbor, node))
+        level = next_level
+        depth += 1
+    return items
+
+
+class BFSOptionsTestCase(unittest.TestCase):
+    def _graphs(self):
+        for graph in SIMPLE_GRAPHS:
+            for root in vertices(graph):
+                expected = levels_py(graph, root)
+                yield graph, root, expected
+                yield Graph(graph), root, expected
+
+    def test_depth_and_parent(self):
+        for graph, root, expected in self._graphs():
+            self.assertEqual(list(bfs(graph, root, with_depth=True)),
+                             [(u, d) for u, d, _ in expected])
+            self.assertEqual(list(bfs(graph, root, with_parent=True)),
+                             [(u, p) for u, _, p in expected])
+            self.assertEqual(
+                list(bfs(graph, root, with_depth=True, with_parent=True)),
+                expected)
+
+    def test_max_depth(self):
+        for graph, root, expected in self._graphs():
+            for max_depth in range(4):
+                self.assertEqual(
+                    list(bfs(graph, root, with_depth=True,
+                             max_depth=max_depth)),
+                    [(u, d) for u, d, _ in expected if d <= max_depth])
+        with self.assertRaises(ValueError):
+            bfs({}, 0, max_depth=-1)
+        with self.assertRaises(TypeError):
+            bfs({}, 0, True)  # Options are keyword-only
+
+    def test_next_batch(self):
+        for graph, root, expected in self._graphs():
+            for n in range(1, 4):
+                b = bfs(graph, root)
+                batches = []
+                while True:
+                    batch = b.next_batch(n)
+                    self.assertLessEqual(len(batch), n)
+                    if not batch:
+                        break
+                    batches.extend(batch)
+                self.assertEqual(batches, [u for u, _, _ in expected])
+        with self.assertRaises(ValueError):
+            bfs({}, 0).next_batch(-1)
+
+    def test_level(self):
+        for graph, root, expected in self._graphs():
+            b = bfs(graph, root, with_depth=True)
+            depth = 0
+            while True:
+                level = b.level()
+                if not level:
+                    break
+                self.assertEqual(level, [(u, d) for u, d, _ in expected
+                                         if d == depth])
+                depth += 1
+            self.assertEqual(list(b), [])
+
+            # A partially visited level is finished by level()
+            b = bfs(graph, root, with_depth=True)
+            first = next(b)
+            self.assertEqual(first, (root, 0))
+            self.assertEqual(b.level(), [(u, d) for u, d, _ in expected
+                                         if d == 1])
+
+
+class MultiSourceBFSTestCase(unittest.TestCase):
+    def test_roots(self):
+        for graph in SIMPLE_GRAPHS:
+            nodes = sorted(vertices(graph), key=str)
+            for k in range(len(nodes) + 1):
+                roots = nodes[:k]
+                distances = distances_py(graph, roots)
+                for g in (graph, Graph(graph)):
+                    items = list(bfs(g, roots=roots, with_depth=True))
+                    self.assertEqual(dict(items), distances)
+                    self.assertEqual([d for _, d in items],
+                                     sorted(distances.values()))
+                    # Duplicate roots are ignored
+                    self.assertEqual(list(bfs(g, roots=roots + roots,
+                                              with_depth=True)), items)
+
+    def test_targets(self):
+        for graph in SIMPLE_GRAPHS:
+            for root in vertices(graph):
+                order = list(bfs_py(graph, root))
+                for target in order:
+                    expected = order[:order.index(target) + 1]
+                    for g in (graph, Graph(graph)):
+                        self.assertEqual(
+                            list(bfs(g, root, targets=[target])), expected)
+                        self.assertEqual(
+                            list(bfs(g, root, targets=[target, root])),
+                            expected)
+                self.assertEqual(list(bfs(graph, root, targets=['missing'])),
+                                 order)
+                for g in (graph, Graph(graph)):
+                    with self.assertRaisesRegex(ValueError, 'target'):
+                        bfs(g, root, targets=[])
+                    with self.assertRaisesRegex(ValueError, 'target'):
+                        bfs(g, root, targets=iter(()))
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            bfs({0: [1]})
+        with self.assertRaises(TypeError):
+            bfs({0: [1]}, 0, roots=[0])
+        with self.assertRaises(KeyError):
+            bfs(Graph({0: [1]}), roots=[0, 2])
+        with self.assertRaises(KeyError):
+            bfs(Graph({0: [1]}), 0, targets=[2])
+        with self.assertRaisesRegex(TypeError, 'at most 2 positional'):
+            bfs({0: [1]}, 0, [0])
+        with self.assertRaisesRegex(TypeError, 'invalid keyword'):
+            bfs({0: [1]}, 0, depth=True)
+        with self.assertRaisesRegex(TypeError, 'given by name'):
+            bfs({0: [1]}, 0, root=0)
+        with self.assertRaisesRegex(TypeError, "missing required argument"):
+            bfs(root=0)
+
+    def test_arguments(self):
+        # Calls go through vectorcall, while explicit calls of __new__ pack the
+        # arguments in a tuple and a dict, but both must parse them the same
+        graph = {0: [1, 2], 1: [2]}
+        for make in (bfs, lambda *args, **kwargs: bfs.__new__(bfs, *args,
+                                                               **kwargs)):
+            self.assertEqual(list(make(graph, 0)), [0, 1, 2])
+            self.assertEqual(list(make(graph=graph, root=1)), [1, 2])
+            self.assertEqual(list(make(graph, roots=[1], with_depth=1)),
+                             [(1, 0), (2, 1)])
+            self.assertEqual(list(make(graph, 0, max_depth=0,
+                                       with_parent=True)), [(0, None)])
+            with self.assertRaisesRegex(TypeError, 'invalid keyword'):
+                make(graph, 0, **{'with_depth': True, 'bad': 1})
+            with self.assertRaisesRegex(TypeError, 'given by name'):
+                make(graph, 0, **{'graph': graph})
+            with self.assertRaisesRegex(TypeError, 'invalid keyword'):
+                make(graph, **{name: None for name in 'abcdefghij'})
+
+
+class ShortestPathTestCase(unittest.TestCase):
+    def _check(self, graph, g, source, target):
+        distances = distances_py(graph, [source])
+        path = shortest_path(g, source, target)
+        if target not in distances:
+            self.assertIsNone(path)
+            return
+        self.assertEqual(len(path), distances[target] + 1)
+        self.assertEqual(path[0], source)
+        self.assertEqual(path[-1], target)
+        for u, v in zip(path, path[1:]):
+            self.assertIn(v, graph[u])
+
+    def test_small_graphs(self):
+        for n in range(1, 4):
+            for graph in all_graphs(n):
+                g = Graph(graph)
+                for source, target in product(range(n), repeat=2):
+                    self._check(graph, graph, source, target)
+                    self._check(graph, g, source, target)
+
+    def test_large_random_graphs(self):
+        rng = random.Random(0)
+        for n, m in ((1000, 1500), (1000, 5000)):
+            graph = random_graph(rng, n, m)
+            g = Graph(graph)
+            for _ in range(50):
+                source, target = rng.choice(list(graph)), rng.choice(g.nodes)
+                self._check(graph, graph, source, target)
+                self._check(graph, g, source, target)
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            shortest_path(0, 0, 1)
+        with self.assertRaises(KeyError):
+            shortest_path(Graph({0: [1]}), 0, 2)
+
+
+class BFSLevelsTestCase(unittest.TestCase):
+    def _check(self, graph, roots, threads=0):
+        g = Graph(graph)
+        depth, parent = bfs_levels(g, roots, threads=threads)
+        distances = distances_py(graph, roots)
+        edges = {(u, v) for u in graph for v in graph[u]}
+        self.assertEqual(len(depth), g.num_nodes)
+        self.assertEqual(len(parent), g.num_nodes)
+        nodes = g.nodes
+        for i, node in enumerate(nodes):
+            self.assertEqual(depth[i], distances.get(node, -1))
+            if node in roots:
+                self.assertEqual(parent[i], i)
+            elif depth[i] < 0:
+                self.assertEqual(parent[i], -1)
+            else:
+                self.assertEqual(depth[parent[i]], depth[i] - 1)
+                self.assertIn((nodes[parent[i]], node), edges)
+
+    def test_simple_graphs(self):
+        for graph in SIMPLE_GRAPHS:
+            for root in vertices(graph):
+                self._check(graph, [root])
+            self._check(graph, list(vertices(graph)))
+            self._check(graph, [])
+
+    def test_large_random_graphs(self):
+        # Large and dense enough to use bottom-up steps and several threads
+        rng = random.Random(0)
+        for n, m in ((20000, 200000), (20000, 30000), (50000, 100000)):
+            graph = random_graph(rng, n, m)
+            for threads in (1, 4):
+                self._check(graph, [0, 1, n // 2], threads=threads)
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            bfs_levels({0: [1]}, [0])
+        with self.assertRaises(KeyError):
+            bfs_levels(Graph({0: [1]}), [2])
+
+
+def dijkstra_py(edges, source) -> dict:
+    """Pure Python reference for shortest path distances from a source, where
+    edges is a list of (source, target, weight) triples."""
+    neighbors = {}
+    for u, v, w in edges:
+        neighbors.setdefault(u, []).append((v, w))
+    distances = {}
+    heap = [(0.0, 0, source)]
+    count = 1
+    while heap:
+        d, _, node = heapq.heappop(heap)
+        if node in distances:
+            continue
+        distances[node] = d
+        for neighbor, w in neighbors.get(node, ()):
+            if neighbor not in distances:
+                heapq.heappush(heap, (d + w, count, neighbor))
+                count += 1
+    return distances
+
+
+def random_weighted_edges(rng, n, m):
+    """Random directed edges (without duplicates) with non-negative weights."""
+    edges = {}
+    for _ in range(m):
+        edges[rng.randrange(n), rng.randrange(n)] = rng.choice(
+            (0.0, rng.random(), float(rng.randrange(1, 10))))
+    return [(u, v, w) for (u, v), w in edges.items()]
+
+
+class DijkstraTestCase(unittest.TestCase):
+    def _check_mapping(self, edges, graph, source):
+        expected = dijkstra_py(edges, source)
+        distance, parent = dijkstra(graph, source)
+        self.assertEqual(distance.keys(), expected.keys())
+        weights = {(u, v): w for u, v, w in edges}
+        for node, d in expected.items():
+            self.assertAlmostEqual(distance[node], d)
+            if node == source:
+                self.assertIsNone(parent[node])
+            else:
+                p = parent[node]
+                self.assertAlmostEqual(distance[p] + weights[p, node], d)
+
+    def _check_graph(self, edges, g, source, weight=None):
+        expected = dijkstra_py(edges, source)
+        distance, parent = dijkstra(g, source, weight=weight)
+        self.assertEqual(len(distance), g.num_nodes)
+        self.assertEqual(len(parent), g.num_nodes)
+        weights = {(u, v): w for u, v, w in edges}
+        nodes = g.nodes
+        for v, node in enumerate(nodes):
+            if node not in expected:
+                self.assertEqual(distance[v], math.inf)
+                self.assertEqual(parent[v], -1)
+            elif node == source:
+                self.assertEqual(distance[v], 0.0)
+                self.assertEqual(parent[v], -1)
+            else:
+                self.assertAlmostEqual(distance[v], expected[node])
+                p = parent[v]
+                self.assertAlmostEqual(
+                    distance[p] + weights[nodes[p], node], distance[v])
+
+    def test_random_graphs(self):
+        rng = random.Random(0)
+        for n, m in ((1, 1), (10, 30), (200, 1000), (2000, 10000)):
+            edges = random_weighted_edges(rng, n, m)
+            graph = {}
+            for u, v, w in edges:
+                graph.setdefault(u, {})[v] = w
+            attributes = {u: {v: {'cost': w} for v, w in adj.items()}
+                          for u, adj in graph.items()}
+            sources = array.array('i', (u for u, _, _ in edges))
+            targets = array.array('i', (v for _, v, _ in edges))
+            weights = array.array('d', (w for _, _, w in edges))
+            g = Graph.from_edges(sources, targets, num_nodes=n,
+                                 weights=weights)
+            unweighted = Graph.from_edges(sources, targets, num_nodes=n)
+            for source in rng.sample(range(n), min(n, 5)):
+                self._check_mapping(edges, graph, source)
+                self._check_graph(edges, g, source)
+                # Weights given separately follow the graph's edge order
+                self._check_graph(edges, unweighted, source,
+                                  weight=g.weights)
+                self._check_graph(edges, Graph(graph), source)
+                distance, _ = dijkstra(attributes, source, weight='cost')
+                self.assertEqual(distance, dijkstra(graph, source)[0])
+
+    def test_unweighted(self):
+        for graph in SIMPLE_GRAPHS:
+            edges = [(u, v, 1.0) for u in graph for v in graph[u]]
+            for root in vertices(graph):
+                distance, _ = dijkstra(graph, root)
+                self.assertEqual(distance, distances_py(graph, [root]))
+                self._check_mapping(edges, graph, root)
+
+    def test_target(self):
+        # The search stops once the target is settled
+        graph = {0: {1: 1.0, 2: 5.0}, 1: {2: 1.0}, 2: {3: 1.0}}
+        distance, parent = dijkstra(graph, 0, target=1)
+        self.assertEqual(distance, {0: 0.0, 1: 1.0})
+        self.assertEqual(parent, {0: None, 1: 0})
+        distance, parent = dijkstra(Graph(graph), 0, target=2)
+        self.assertEqual(list(distance), [0.0, 1.0, 2.0, math.inf])
+        self.assertEqual(list(parent), [-1, 0, 1, -1])
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            dijkstra(0, 0)
+        with self.assertRaises(KeyError):
+            dijkstra(Graph({0: [1]}), 2)
+        with self.assertRaises(ValueError):
+            dijkstra({0: {1: -1.0}}, 0)
+        with self.assertRaises(ValueError):
+            dijkstra(Graph({0: {1: -1.0}}), 0)
+        with self.assertRaises(ValueError):
+            dijkstra(Graph({0: [1]}), 0, weight=array.array('d', [1.0, 2.0]))
+
+
+class AStarTestCase(unittest.TestCase):
+    def test_grid(self):
+        # Manhattan distance is an admissible heuristic on a grid
+        size = 30
+        rng = random.Random(0)
+        graph = {}
+        for x, y in product(range(size), repeat=2):
+            for dx, dy in ((1, 0), (-1, 0), (0, 1), (0, -1)):
+                if 0 <= x + dx < size and 0 <= y + dy < size \
+                        and rng.random() < 0.8:
+                    graph.setdefault((x, y), {})[x + dx, y + dy] = \
+                        1.0 + rng.randrange(3)
+
+        def manhattan(node, target):
+            return abs(node[0] - target[0]) + abs(node[1] - target[1])
+
+        g = Graph(graph)
+        for _ in range(20):
+            source = rng.choice(list(graph))
+            target = rng.choice(g.nodes)
+            expected = dijkstra(graph, source)[0].get(target, math.inf)
+            for graph_or_g in (graph, g):
+                distance, path = astar(graph_or_g, source, target, manhattan)
+                self.assertAlmostEqual(distance, expected)
+                if expected == math.inf:
+                    self.assertIsNone(path)
+                    continue
+                self.assertEqual(path[0], source)
+                self.assertEqual(path[-1], target)
+                self.assertAlmostEqual(
+                    sum(graph[u][v] for u, v in zip(path, path[1:])), distance)
+
+    def test_zero_heuristic(self):
+        rng = random.Random(1)
+        edges = random_weighted_edges(rng, 100, 400)
+        graph = {}
+        for u, v, w in edges:
+            graph.setdefault(u, {})[v] = w
+        g = Graph(graph)
+        distances = dijkstra_py(edges, 0)
+        for target in g.nodes:
+            distance, path = astar(g, 0, target, lambda node, target: 0)
+            self.assertAlmostEqual(distance, distances.get(target, math.inf))
+            self.assertEqual(path is None, target not in distances)
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            astar({0: [1]}, 0, 1, None)
+        with self.assertRaises(ZeroDivisionError):
+            astar({0: [1]}, 0, 1, lambda node, target: 1 / 0)
+        with self.assertRaises(ZeroDivisionError):
+            astar(Graph({0: [1]}), 0, 1, lambda node, target: 1 / 0)
+
+
+def dfs_py(graph, roots):
+    """Pure Python reference recursive depth-first search, yielding (node,
+    event) pairs."""
+    seen = set()
+
+    def visit(node):
+        seen.add(node)
+        yield node, 'pre'
+        for neighbor in graph.get(node, ()):
+            if neighbor not in seen:
+                yield from visit(neighbor)
+        yield node, 'post'
+
+    for root in roots:
+        if root not in seen:
+            yield from visit(root)
+
+
+def reachable_py(graph, root):
+    """Set of nodes reachable from a root."""
+    return set(distances_py(graph, [root]))
+
+
+class DFSTestCase(unittest.TestCase):
+    def _check(self, graph, g, roots=None, root=None):
+        if root is not None:
+            kwargs, expected_roots = {'root': root}, [root]
+        elif roots is not None:
+            kwargs, expected_roots = {'roots': roots}, roots
+        else:
+            kwargs, expected_roots = {}, list(graph)
+        events = list(dfs_py(graph, expected_roots))
+        self.assertEqual(list(dfs(g, order='events', **kwargs)), events)
+        self.assertEqual(list(dfs(g, **kwargs)),
+                         [node for node, event in events if event == 'pre'])
+        self.assertEqual(list(dfs(g, order='postorder', **kwargs)),
+                         [node for node, event in events if event == 'post'])
+
+    def test_simple_graphs(self):
+        for graph in SIMPLE_GRAPHS:
+            for root in vertices(graph):
+                self._check(graph, graph, root=root)
+            self._check(graph, graph)
+            self._check(graph, graph, roots=list(vertices(graph))[::-1])
+
+    def test_graph_objects(self):
+        # Graph objects with integer labels 0, ..., n - 1 visit neighbors in
+        # the same order as the adjacency lists
+        for n in range(1, 4):
+            for graph in all_graphs(n):
+                g = Graph.from_edges(
+                    array.array('i', (u for u in graph for _ in graph[u])),
+                    array.array('i', (v for u in graph for v in graph[u])),
+                    num_nodes=n)
+                graph = {u: graph.get(u, []) for u in range(n)}
+                for root in range(n):
+                    self._check(graph, g, root=root)
+                self._check(graph, g)
+                self._check(graph, g, roots=[n - 1, 0])
+
+    def test_labeled_graph(self):
+        graph = SIMPLE_GRAPHS[5]
+        g = Graph(graph)
+        self.assertEqual(list(dfs(g, 'A')), list(dfs(graph, 'A')))
+        self.assertEqual(set(dfs(g)), set(g.nodes))
+
+    def test_deep_graph(self):
+        # Far deeper than the recursion limit
+        n = 200000
+        graph = {i: [i + 1] for i in range(n)}
+        for g in (graph, Graph(graph)):
+            self.assertEqual(list(dfs(g, 0)), list(range(n + 1)))
+            self.assertEqual(list(dfs(g, 0, order='postorder')),
+                             list(range(n, -1, -1)))
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            dfs(0, 0)
+        with self.assertRaises(TypeError):
+            dfs({0: [1]}, 0, roots=[0])
+        with self.assertRaises(ValueError):
+            dfs({0: [1]}, 0, order='inorder')
+        with self.assertRaises(KeyError):
+            dfs(Graph({0: [1]}), 2)
+        with self.assertRaises(TypeError):
+            list(dfs({0: 1}, 0))
+
+
+class TopologicalSortTestCase(unittest.TestCase):
+    def _check(self, graph):
+        nodes = set(vertices(graph))
+        order = topological_sort(graph)
+        self.assertEqual(topological_sort(Graph(graph)), order)
+        self.assertEqual(sorted(order, key=str), sorted(nodes, key=str))
+        position = {node: i for i, node in enumerate(order)}
+        for u in graph:
+            for v in graph[u]:
+                self.assertLess(position[u], position[v])
+
+    def test_small_graphs(self):
+        for n in range(1, 4):
+            for graph in all_graphs(n):
+                acyclic = all(u < v for u in graph for v in graph[u])
+                if acyclic:
+                    self._check(graph)
+                elif any(u in reachable_py(graph, v)
+                         for u in graph for v in graph[u]):
+                    with self.assertRaises(ValueError):
+                        topological_sort(graph)
+
+    def test_random_dags(self):
+        rng = random.Random(0)
+        for n, m in ((10, 20), (1000, 5000), (100000, 300000)):
+            perm = list(range(n))
+            rng.shuffle(perm)
+            graph = {}
+            for _ in range(m):
+                u, v = sorted(rng.sample(range(n), 2))
+                graph.setdefault(perm[u], []).append(perm[v])
+            self._check(graph)
+
+    def test_cycles(self):
+        for graph in ({0: [0]}, {0: [1], 1: [2], 2: [0]},
+                      SIMPLE_GRAPHS[0], SIMPLE_GRAPHS[5]):
+            with self.assertRaises(ValueError):
+                topological_sort(graph)
+            with self.assertRaises(ValueError):
+                topological_sort(Graph(graph))
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            topological_sort(0)
+
+
+class StronglyConnectedComponentsTestCase(unittest.TestCase):
+    def _check(self, graph):
+        components = strongly_connected_components(graph)
+        self.assertEqual(strongly_connected_components(Graph(graph)),
+                         components)
+        nodes = list(vertices(graph))
+        self.assertEqual(sorted(map(str, sum(components, []))),
+                         sorted(map(str, nodes)))
+        which = {node: i for i, c in enumerate(components) for node in c}
+        reachable = {node: reachable_py(graph, node) for node in nodes}
+        for u, v in product(nodes, repeat=2):
+            same = v in reachable[u] and u in reachable[v]
+            self.assertEqual(which[u] == which[v], same)
+        # Reverse topological order of the components
+        for u in graph:
+            for v in graph[u]:
+                self.assertGreaterEqual(which[u], which[v])
+
+    def test_simple_graphs(self):
+        for graph in SIMPLE_GRAPHS:
+            self._check(graph)
+
+    def test_small_graphs(self):
+        for n in range(1, 4):
+            for graph in all_graphs(n):
+                self._check(graph)
+
+    def test_random_graphs(self):
+        rng = random.Random(0)
+        for n, m in ((30, 40), (100, 150), (200, 600)):
+            self._check(random_graph(rng, n, m))
+
+    def test_deep_graph(self):
+        # One huge cycle, and a long path of singletons
+        n = 200000
+        cycle = {i: [(i + 1) % n] for i in range(n)}
+        components = strongly_connected_components(Graph(cycle))
+        self.assertEqual(len(components), 1)
+        self.assertEqual(sorted(components[0]), list(range(n)))
+        path = {i: [i + 1] for i in range(n)}
+        components = strongly_connected_components(path)
+        self.assertEqual(components, [[i] for i in range(n, -1, -1)])
+
+    def test_bad_input(self):
+        with self.assertRaises(TypeError):
+            strongly_connected_components(0)
+
+
+def components_py(n, edges) -> list:
+    """Pure Python reference for the smallest node in each node's connected
+    component, ignoring the directions of the edges."""
+    neighbors = [[] for _ in range(n)]
+    for u, v in edges:
+        neighbors[u].append(v)
+        neighbors[v].append(u)
+    labels = [-1] * n
+    for root in range(n):
+        if labels[root] < 0:
+            labels[root] = root
+            stack = [root]
+            while stack:
+                for v in neighbors[stack.pop()]:
+                    if labels[v] < 0:
+                        labels[v] = root
+                        stack.append(v)
+    return labels
+
+
+class ConnectedComponentsTestCase(unittest.TestCase):
+    def _check(self, n, edges, threads=0):
+        expected = components_py(n, edges)
+        sources = array.array('i', (u for u, _ in edges))
+        targets = array.array('q', (v for _, v in edges))
+        labels = connected_components(sources, targets, num_nodes=n,
+                                      threads=threads)
+        self.assertEqual(labels.format, 'i')
+        self.assertEqual(list(labels), expected)
+        g = Graph.from_edges(sources, targets, num_nodes=n)
+        self.assertEqual(list(connected_components(g, threads=threads)),
+                         expected)
+
+    def test_small_graphs(self):
+        for n in range(1, 4):
+            for graph in all_graphs(n):
+                self._check(n, [(u, v) for u in graph for v in graph[u]])
+        self._check(0, [])
+        self._check(5, [])
+
+    def test_random_graphs(self):
+        # Large enough to be split among several threads
+        rng = random.Random(0)
+        for n, m in ((100, 50), (1000, 1000), (100000, 60000),
+                     (100000, 300000)):
+            edges = [(rng.randrange(n), rng.randrange(n)) for _ in range(m)]
+            for threads in (1, 4):
+                self._check(n, edges, threads=threads)
+
+    def test_default_num_nodes(self):
+        labels = connected_components(array.array('i', [0, 3]),
+                                      array.array('i', [1, 2]))
+        self.assertEqual(list(labels), [0, 0, 2, 2])
+
+    def test_bad_input(self):
+        edges = array.array('i', [0, 1])
+        with self.assertRaises(TypeError):
+            connected_components({0: [1]})
+        with self.assertRaises(ValueError):
+            connected_components(edges, array.array('i', [1]))
+        with self.assertRaises(ValueError):
+            connected_components(edges, array.array('i', [1, -1]))
+        with self.assertRaises(ValueError):
+            connected_components(edges, edges, num_nodes=1)
+        with self.assertRaises(TypeError):
+            connected_components(edges, array.array('d', [1.0, 2.0]))
+
+
+class DisjointSetTestCase(unittest.TestCase):
+    def test_example(self):
+        ds = DisjointSet('abcd')
+        self.assertEqual(len(ds), 4)
+        self.assertEqual(ds.num_sets, 4)
+        self.assertTrue(ds.union('a', 'b'))
+        self.assertTrue(ds.union('c', 'd'))
+        self.assertFalse(ds.union('b', 'a'))
+        self.assertTrue(ds.connected('a', 'b'))
+        self.assertFalse(ds.connected('a', 'c'))
+        self.assertEqual(ds.find('a'), ds.find('b'))
+        self.assertEqual(ds.set_size('d'), 2)
+        self.assertEqual(ds.sets(), [['a', 'b'], ['c', 'd']])
+        # Union adds missing elements
+        self.assertTrue(ds.union('e', 'a'))
+        self.assertIn('e', ds)
+        self.assertEqual(ds.set_size('b'), 3)
+        self.assertEqual(ds.num_sets, 2)
+        ds.add('f')
+        ds.add('f')
+        self.assertEqual(len(ds), 6)
+        self.assertEqual(ds.sets(), [['a', 'b', 'e'], ['c', 'd'], ['f']])
+
+    def test_random_unions(self):
+        rng = random.Random(0)
+        n = 2000
+        edges = [(rng.randrange(n), rng.randrange(n)) for _ in range(1500)]
+        labels = components_py(n, edges)
+        ds = DisjointSet(range(n))
+        for u, v in edges:
+            ds.union(u, v)
+        for u in range(n):
+            self.assertEqual(ds.set_size(u), labels.count(labels[u]))
+        for _ in range(1000):
+            u, v = rng.randrange(n), rng.randrange(n)
+            self.assertEqual(ds.connected(u, v), labels[u] == labels[v])
+        self.assertEqual(ds.num_sets, len(set(labels)))
+        self.assertEqual(sorted(map(min, ds.sets())), sorted(set(labels)))
+
+    def test_missing_elements(self):
+        ds = DisjointSet([1])
+        with self.assertRaises(KeyError):
+            ds.find(2)
+        with self.assertRaises(KeyError):
+            ds.connected(1, 2)
+        with self.assertRaises(KeyError):
+            ds.set_size(2)
+        with self.assertRaises(TypeError):
+            ds.add([])
+        self.assertEqual(len(ds), 1)
+        # Tuples are reported whole
+        with self.assertRaises(KeyError) as context:
+            ds.find((1, 2))
+        self.assertEqual(context.exception.args, ((1, 2),))
+
+    def test_reference_cycles(self):
+        class Element:
+            pass
+
+        element = Element()
+        element.sets = DisjointSet([element])
+        ref = weakref.ref(element)
+        del element
+        gc.collect()
+        self.assertIsNone(ref())
+
+
+class GraphFileTestCase(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+
+    def path(self, name):
+        return os.path.join(self.directory.name, name)
+
+    def assertSameGraph(self, g, h):
+        self.assertEqual(h.num_nodes, g.num_nodes)
+        self.assertEqual(h.num_edges, g.num_edges)
+        self.assertEqual(h.nodes, g.nodes)
+        self.assertEqual(h.offsets.tolist(), g.offsets.tolist())
+        self.assertEqual(h.targets.tolist(), g.targets.tolist())
+        if g.weights is None:
+            self.assertIsNone(h.weights)
+        else:
+            self.assertEqual(h.weights.tolist(), g.weights.tolist())
+
+    def test_round_trip(self):
+        rng = random.Random(0)
+        edges = random_weighted_edges(rng, 500, 2000)
+        weighted = {}
+        for u, v, w in edges:
+            weighted.setdefault(str(u), {})[str(v)] = w
+        graphs = [
+            Graph({}),
+            Graph(SIMPLE_GRAPHS[5]),
+            Graph(weighted),
+            Graph.from_edges(array.array('i', (u for u, _, _ in edges)),
+                             array.array('i', (v for _, v, _ in edges)),
+                             weights=array.array('d', (w for _, _, w in edges))),
+        ]
+        for i, g in enumerate(graphs):
+            path = self.path(f'graph{i}')
+            g.save(path)
+            for validate in (False, True):
+                h = Graph.load(path, validate=validate)
+                self.assertSameGraph(g, h)
+            # Loaded graphs work like any other, and can be saved again
+            for root in g.nodes[:5]:
+                self.assertEqual(list(bfs(h, root)), list(bfs(g, root)))
+            h.save(self.path('copy'))
+            self.assertSameGraph(g, Graph.load(self.path('copy')))
+
+    def test_arrays_are_read_only(self):
+        path = self.path('graph')
+        Graph({0: [1]}).save(path)
+        g = Graph.load(path)
+        with self.assertRaises(TypeError):
+            g.targets[0] = 0
+
+    def test_convert_text(self):
+        rng = random.Random(0)
+        edges = random_weighted_edges(rng, 1000, 5000)
+        sources = array.array('i', (u for u, _, _ in edges))
+        targets = array.array('i', (v for _, v, _ in edges))
+        weights = array.array('d', (w for _, _, w in edges))
+        with open(self.path('edges.txt'), 'w') as file:
+            file.write('# A comment\n% Another comment\n\n')
+            for u, v, w in edges:
+                file.write(f'{u}\t{v} {w!r}\r\n')
+        convert_edge_list(self.path('edges.txt'), self.path('graph'))
+        self.assertSameGraph(Graph.from_edges(sources, targets),
+                             Graph.load(self.path('graph')))
+        convert_edge_list(self.path('edges.txt'), self.path('graph'),
+                          weighted=True, num_nodes=2000)
+        self.assertSameGraph(
+            Graph.from_edges(sources, targets, num_nodes=2000, weights=weights),
+            Graph.load(self.path('graph'), validate=True))
+
+    def test_convert_binary(self):
+        rng = random.Random(1)
+        edges = random_weighted_edges(rng, 100, 500)
+        sources = array.array('i', (u for u, _, _ in edges))
+        targets = array.array('i', (v for _, v, _ in edges))
+        weights = array.array('d', (w for _, _, w in edges))
+        for code in 'iq':
+            with open(self.path('edges'), 'wb') as file:
+                for u, v, w in edges:
+                    file.write(struct.pack(f'={code}{code}', u, v))
+            convert_edge_list(self.path('edges'), self.path('graph'), code)
+            self.assertSameGraph(Graph.from_edges(sources, targets),
+                                 Graph.load(self.path('graph')))
+            with open(self.path('edges'), 'wb') as file:
+                for u, v, w in edges:
+                    file.write(struct.pack(f'={code}{code}d', u, v, w))
+            convert_edge_list(self.path('edges'), self.path('graph'), code,
+                              weighted=True)
+            self.assertSameGraph(
+                Graph.from_edges(sources, targets, weights=weights),
+                Graph.load(self.path('graph')))
+
+    def test_bad_edge_lists(self):
+        for contents, kwargs in (('0 1\n1\n', {}),
+                                 ('0 x\n', {}),
+                                 ('0 -1\n', {}),
+                                 ('0 1\n', {'weighted': True}),
+                                 ('0 5\n', {'num_nodes': 5})):
+            with open(self.path('edges.txt'), 'w') as file:
+                file.write(contents)
+            with self.assertRaises(ValueError):
+                convert_edge_list(self.path('edges.txt'), self.path('graph'),
+                                  **kwargs)
+        with open(self.path('edges'), 'wb') as file:
+            file.write(struct.pack('=iii', 0, 1, 2))
+        with self.assertRaises(ValueError):
+            convert_edge_list(self.path('edges'), self.path('graph'), 'i')
+        with self.assertRaises(ValueError):
+            convert_edge_list(self.path('edges'), self.path('graph'), 'd')
+        with self.assertRaises(OSError):
+            convert_edge_list(self.path('missing'), self.path('graph'))
+
+    def test_bad_graph_files(self):
+        path = self.path('graph')
+        Graph.from_edges(array.array('i', [0, 0, 1]),
+                         array.array('i', [1, 2, 2])).save(path)
+        with open(path, 'rb') as file:
+            contents = bytearray(file.read())
+
+        def check(data):
+            with open(path, 'wb') as file:
+                file.write(data)
+            with self.assertRaises(ValueError):
+                Graph.load(path)
+
+        check(b'')
+        check(b'NOTGRAPH' + contents[8:])
+        check(contents[:8] + struct.pack('=I', 99) + contents[12:])
+        check(contents[:-8])
+        # A target out of range is caught by validation, which is the default
+        # (after the 64-byte header and the 4 offsets)
+        first_target = 64 + 4 * 8
+        check(contents[:first_target] + struct.pack('=i', 7)
+              + contents[first_target + 4:])
+        Graph.load(path, validate=False)
+        with self.assertRaises(FileNotFoundError):
+            Graph.load(self.path('missing'))
+
+
+def pagerank_py(n, edges, damping=0.85, tol=1e-6, personalization=None):
+    """Pure Python reference PageRank by power iteration, with the rank of
+    nodes without out-edges redistributed like the teleportation."""
+    p = personalization or [1 / n] * n
+    total = sum(p)
+    p = [x / total for x in p]
+    out = [[] for _ in range(n)]
+    for u, v in edges:
+        out[u].append(v)
+    rank = [1 / n] * n
+    while True:
+        dangling = sum(rank[u] for u in range(n) if not out[u])
+        nxt = [(1 - damping + damping * dangling) * p[v] for v in range(n)]
+        for u in range(n):
+            for v in out[u]:
+                nxt[v] += damping * rank[u] / len(out[u])
+        error = sum(abs(a - b) for a, b in zip(nxt, rank))
+        rank = nxt
+        if error < n * tol:
+            return rank
+
+
+class PageRankTestCase(unittest.TestCase):
+    def _graph(self, rng, n, m):
+        edges = [(rng.randrange(n), rng.randrange(n)) for _ in range(m)]
+        g = Graph.from_edges(array.array('i', (u for u, _ in edges)),
+                             array.array('i', (v for _, v in edges)),
+                             num_nodes=n)
+        return g, edges
+
+    def test_random_graphs(self):
+        rng = random.Random(0)
+        for n, m in ((1, 0), (1, 1), (10, 5), (100, 400), (2000, 10000)):
+            g, edges = self._graph(rng, n, m)
+            expected = pagerank_py(n, edges, tol=1e-10)
+            for threads in (1, 4):
+                ranks = pagerank(g, tol=1e-10, threads=threads)
+                self.assertEqual(ranks.format, 'd')
+                for a, b in zip(ranks, expected):
+                    self.assertAlmostEqual(a, b, places=9)
+            self.assertAlmostEqual(sum(ranks), 1.0)
+            ranks = pagerank(g, tol=1e-7, dtype='f')
+            self.assertEqual(ranks.format, 'f')
+            for a, b in zip(ranks, expected):
+                self.assertAlmostEqual(a, b, places=5)
+
+    def test_personalization(self):
+        rng = random.Random(1)
+        n = 300
+        g, edges = self._graph(rng, n, 1000)
+        weights = [rng.choice((0, 0, 1, 2.5)) for _ in range(n)]
+        expected = pagerank_py(n, edges, damping=0.7, tol=1e-10,
+                               personalization=weights)
+        by_buffer = pagerank(g, 0.7, 1e-10, personalization=array.array(
+            'd', weights))
+        by_mapping = pagerank(g, 0.7, 1e-10, personalization={
+            v: w for v, w in enumerate(weights) if w})
+        for a, b, c in zip(by_buffer, by_mapping, expected):
+            self.assertAlmostEqual(a, c, places=9)
+            self.assertAlmostEqual(b, c, places=9)
+        # Labeled graphs take mappings of labels
+        g = Graph({'a': ['b'], 'b': ['a', 'c']})
+        ranks = pagerank(g, personalization={'c': 1})
+        self.assertGreater(ranks[g.nodes.index('c')], ranks[0])
+
+    def test_large_graph(self):
+        # More nodes than fit in a cache block of float or double ranks, and
+        # enough edges per node for the products to be cache-blocked
+        rng = random.Random(2)
+        n, m = 300000, 2400000
+        sources = array.array('i', rng.choices(range(n), k=m))
+        targets = array.array('i', rng.choices(range(n), k=m))
+        g = Graph.from_edges(sources, targets, num_nodes=n)
+        doubles = pagerank(g, tol=1e-12, threads=4)
+        floats = pagerank(g, tol=1e-9, threads=4, dtype='f')
+        self.assertLess(max(abs(a - b) for a, b in zip(doubles, floats)),
+                        1e-8)
+
+        # The ranks are a fixed point of one PageRank step, whose sums over
+        # in-edges are taken without blocking by propagate() on the reverse
+        # graph
+        degree = [0] * n
+        for u in sources:
+            degree[u] += 1
+        dangling = sum(r for r, d in zip(doubles, degree) if not d)
+        contribution = array.array('d', (r / d if d else 0.0
+                                         for r, d in zip(doubles, degree)))
+        reverse = Graph.from_edges(targets, sources, num_nodes=n)
+        sums = propagate(reverse, contribution)
+        teleport = (1 - 0.85 + 0.85 * dangling) / n
+        self.assertLess(max(abs(0.85 * s + teleport - r)
+                            for s, r in zip(sums, doubles)), 1e-10)
+
+    def test_convergence(self):
+        g = Graph({0: [1], 1: [0]})
+        with self.assertRaises(RuntimeError):
+            pagerank(Graph(SIMPLE_GRAPHS[0]), tol=0, max_iter=10)
+        self.assertEqual(list(pagerank(g, damping=1.0, max_iter=1)),
+                         [0.5, 0.5])
+        self.assertEqual(len(pagerank(Graph({}))), 0)
+
+    def test_bad_input(self):
+        g = Graph({0: [1]})
+        with self.assertRaises(TypeError):
+            pagerank({0: [1]})
+        with self.assertRaises(ValueError):
+            pagerank(g, damping=1.5)
+        with self.assertRaises(ValueError):
+            pagerank(g, dtype='i')
+        with self.assertRaises(ValueError):
+            pagerank(g, personalization={0: -1})
+        with self.assertRaises(ValueError):
+            pagerank(g, personalization={0: 0})
+        with self.assertRaises(ValueError):
+            pagerank(g, personalization=array.array('d', [1]))
+        with self.assertRaises(KeyError):
+            pagerank(g, personalization={2: 1})
+
+
+class PropagateTestCase(unittest.TestCase):
+    def test_random_graphs(self):
+        rng = random.Random(0)
+        for n, m in ((1, 1), (50, 200), (5000, 20000)):
+            edges = random_weighted_edges(rng, n, m)
+            sources = array.array('i', (u for u, _, _ in edges))
+            targets = array.array('i', (v for _, v, _ in edges))
+            weights = array.array('d', (w for _, _, w in edges))
+            g = Graph.from_edges(sources, targets, num_nodes=n,
+                                 weights=weights)
+            unweighted = Graph.from_edges(sources, targets, num_nodes=n)
+            x = [float(rng.randrange(-5, 5)) for _ in range(n)]
+            weighted_sum = [0.0] * n
+            plain_sum = [0.0] * n
+            for u, v, w in edges:
+                weighted_sum[u] += w * x[v]
+                plain_sum[u] += x[v]
+            for threads in (1, 4):
+                y = propagate(g, array.array('d', x), threads=threads)
+                self.assertEqual(y.format, 'd')
+                for a, b in zip(y, weighted_sum):
+                    self.assertAlmostEqual(a, b)
+            y = propagate(unweighted, array.array('i', map(int, x)))
+            self.assertEqual(list(y), plain_sum)
+            y = propagate(unweighted, array.array('f', x), weight=g.weights)
+            self.assertEqual(y.format, 'f')
+            for a, b in zip(y, weighted_sum):
+                self.assertAlmostEqual(a, b, places=3)
+
+    def test_bad_input(self):
+        g = Graph({0: [1]})
+        with self.assertRaises(TypeError):
+            propagate({0: [1]}, array.array('d', [1, 2]))
+        with self.assertRaises(ValueError):
+            propagate(g, array.array('d', [1]))
+        with self.assertRaises(ValueError):
+            propagate(g, array.array('d', [1, 2]), array.array('d', []))
+
+
+class ConcurrentCallsTestCase(unittest.TestCase):
+    def test_shared_graph(self):
+        # Threads racing to build the reverse of the same graph (lazily, and
+        # without the GIL) must all end up using a single consistent copy
+        rng = random.Random(0)
+        n, m = 20000, 100000
+        sources = array.array('i', rng.choices(range(n), k=m))
+        targets = array.array('i', rng.choices(range(n), k=m))
+        # Parents may differ between parallel traversals, but depths can't
+        expected_depth = list(bfs_levels(Graph.from_edges(sources, targets),
+                                         [0], threads=1)[0])
+        expected_ranks = list(pagerank(Graph.from_edges(sources, targets)))
+        for _ in range(5):
+            g = Graph.from_edges(sources, targets)
+            with ThreadPoolExecutor(max_workers=4) as executor:
+                levels = [executor.submit(bfs_levels, g, [0])
+                          for _ in range(4)]
+                ranks = [executor.submit(pagerank, g) for _ in range(4)]
+                for future in levels:
+                    self.assertEqual(list(future.result()[0]), expected_depth)
+                for future in ranks:
+                    self.assertEqual(list(future.result()), expected_ranks)
+
+    def test_independent_graphs(self):
+        rng = random.Random(1)
+        edge_lists = [(array.array('i', rng.choices(range(1000), k=5000)),
+                       array.array('i', rng.choices(range(1000), k=5000)))
+                      for _ in range(8)]
+
+        def build(edges):
+            g = Graph.from_edges(*edges, num_nodes=1000)
+            return list(connected_components(g, threads=1))
+
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            results = list(executor.map(build, edge_lists))
+        self.assertEqual(results, [build(edges) for edges in edge_lists])
+
+    def assign_during(self, call, sources):
+        """Call `call()` repeatedly while another thread keeps assigning an
+        invalid node and then a valid one to the last item of `sources`."""
+        stop = threading.Event()
+
+        def assign():
+            while not stop.is_set():
+                sources[-1] = 2_000_000_000
+                sources[-1] = 0
+
+        thread = threading.Thread(target=assign)
+        thread.start()
+        try:
+            for _ in range(50):
+                try:
+                    call()
+                except ValueError:
+                    pass
+        finally:
+            stop.set()
+            thread.join()
+
+    def test_edges_assigned_during_build(self):
+        # Edge buffers can be assigned to while a graph is built from them
+        # without the GIL, which must not let an invalid id into the graph
+        rng = random.Random(2)
+        n, m = 1000, 200000
+        sources = array.array('i', rng.choices(range(n), k=m))
+        targets = array.array('i', rng.choices(range(n), k=m))
+
+        def build():
+            g = Graph.from_edges(sources, targets, num_nodes=n)
+            self.assertEqual(len(g.nodes), n)
+            self.assertLess(max(g.targets, default=0), n)
+
+        self.assign_during(build, sources)
+
+    def test_edges_assigned_during_components(self):
+        rng = random.Random(3)
+        n, m = 1000, 200000
+        sources = array.array('i', rng.choices(range(n), k=m))
+        targets = array.array('i', rng.choices(range(n), k=m))
+
+        def components():
+            labels = connected_components(sources, targets, num_nodes=n)
+            self.assertEqual(len(labels), n)
+
+        self.assign_during(components, sources)
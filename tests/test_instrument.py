@@ -0,0 +1,116 @@
+"""Unit tests for operation counting."""
+
+import array
+import unittest
+
+from algorithms import instrument
+from algorithms.selection import min_max
+from algorithms.sort import (binary_insertion_sort, heap_sort, insertion_sort,
+                             merge_sort, quick_sort)
+
+
+class InstrumentTestCase(unittest.TestCase):
+    def test_insertion_sort_counts(self):
+        n = 20
+        with instrument() as stats:
+            insertion_sort(list(range(n)))
+        self.assertEqual(stats['insertion_sort']['calls'], 1)
+        self.assertEqual(stats['insertion_sort']['comparisons'], n - 1)
+        self.assertEqual(stats['insertion_sort']['swaps'], 0)
+
+        with instrument() as stats:
+            insertion_sort(list(range(n, 0, -1)))
+        self.assertEqual(stats['insertion_sort']['comparisons'],
+                         n * (n - 1) // 2)
+        self.assertEqual(stats['insertion_sort']['swaps'], n * (n - 1) // 2)
+        self.assertEqual(stats['insertion_sort']['max_depth'], 0)
+
+    def test_merge_sort_counts(self):
+        with instrument() as stats:
+            merge_sort([3, 1, 2])
+            merge_sort((4, 3, 2, 1, 8, 7, 6, 5))
+        counts = stats['merge_sort']
+        self.assertEqual(counts['calls'], 2)
+        self.assertEqual(counts['comparisons'], 3 + 12)
+        # One buffer per call, and one list for the tuple
+        self.assertEqual(counts['allocations'], 3)
+        self.assertEqual(counts['max_depth'], 4)
+        self.assertGreater(counts['moves'], 0)
+        self.assertGreaterEqual(counts['seconds'], 0.0)
+
+    def test_other_sorts(self):
+        with instrument() as stats:
+            heap_sort(list(range(100, 0, -1)))
+            quick_sort(list(range(50)))
+            binary_insertion_sort(list(range(10, 0, -1)))
+        self.assertGreater(stats['heap_sort']['comparisons'], 0)
+        self.assertGreater(stats['heap_sort']['swaps'], 0)
+        # Quick sort recurses once per element on sorted inputs
+        self.assertEqual(stats['quick_sort']['comparisons'], 50 * 49 // 2)
+        self.assertGreater(stats['quick_sort']['max_depth'], 50)
+        self.assertGreater(stats['binary_insertion_sort']['moves'], 0)
+        self.assertEqual(stats['binary_insertion_sort']['swaps'], 0)
+
+    def test_min_max_counts(self):
+        n = 100
+        with instrument() as stats:
+            min_max(list(range(n)))
+        self.assertEqual(stats['min_max']['comparisons'], 1 + 3 * (n - 2) // 2)
+
+    def test_typed_buffers_count_calls_only(self):
+        with instrument() as stats:
+            merge_sort(array.array('q', range(100, 0, -1)))
+            min_max(array.array('d', [1.0, 2.0]))
+        self.assertEqual(stats['merge_sort']['calls'], 1)
+        self.assertEqual(stats['merge_sort']['comparisons'], 0)
+        self.assertEqual(stats['min_max']['calls'], 1)
+
+    def test_only_inside_block(self):
+        merge_sort([2, 1])
+        with instrument() as stats:
+            pass
+        self.assertEqual(stats, {})
+        merge_sort([2, 1])
+        self.assertEqual(stats, {})
+
+    def test_nested_blocks(self):
+        with instrument() as outer:
+            merge_sort([2, 1])
+            with instrument() as inner:
+                merge_sort([2, 1])
+                min_max([1, 2])
+            merge_sort([2, 1])
+        self.assertEqual(inner['merge_sort']['calls'], 1)
+        self.assertEqual(inner['min_max']['calls'], 1)
+        self.assertEqual(outer['merge_sort']['calls'], 3)
+        self.assertEqual(outer['merge_sort']['comparisons'], 3)
+        self.assertEqual(outer['min_max']['calls'], 1)
+
+    def test_nested_calls(self):
+        # Sorting inside a comparison is counted separately from the outer sort
+        class Key:
+            def __init__(self, value):
+                self.value = value
+
+            def __lt__(self, other):
+                insertion_sort([1, 0])
+                return self.value < other.value
+
+        with instrument() as stats:
+            insertion_sort([Key(1), Key(0)])
+        self.assertEqual(stats['insertion_sort']['calls'], 2)
+        self.assertEqual(stats['insertion_sort']['comparisons'], 2)
+        self.assertEqual(stats['insertion_sort']['swaps'], 2)
+
+    def test_failures(self):
+        with self.assertRaises(TypeError):
+            with instrument() as stats:
+                merge_sort([1, 'a'])
+        self.assertEqual(stats['merge_sort']['calls'], 1)
+        self.assertEqual(stats['merge_sort']['comparisons'], 1)
+        merge_sort([2, 1])
+        self.assertEqual(stats['merge_sort']['calls'], 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,217 @@
+"""Unit tests for the state of the extension modules, which every module object
+(e.g., one in each interpreter) has a copy of."""
+
+import importlib.util
+import os
+import random
+import sys
+import sysconfig
+import textwrap
+import threading
+import unittest
+
+import algorithms
+from algorithms import containers, graph, selection, sort
+
+try:
+    import _xxsubinterpreters as interpreters
+except ImportError:
+    interpreters = None
+
+
+def fresh_module(module):
+    """Execute a new copy of an extension module."""
+    spec = importlib.util.find_spec(module.__name__)
+    copy = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(copy)
+    return copy
+
+
+def run_in_threads(work, count=4):
+    """Call work(i) for i in range(count) in as many threads, all at once, and
+    re-raise the first exception any of them raised."""
+    barrier = threading.Barrier(count)
+    errors = []
+
+    def run(i):
+        barrier.wait()
+        try:
+            work(i)
+        except BaseException as e:
+            errors.append(e)
+
+    threads = [threading.Thread(target=run, args=(i,)) for i in range(count)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    if errors:
+        raise errors[0]
+
+
+class ModuleStateTestCase(unittest.TestCase):
+    def test_types_are_per_module(self):
+        for module, names in [(containers, ['SortedList']),
+                              (selection, ['QuantileSketch',
+                                           'WindowedMinMax']),
+                              (graph, ['Graph', 'bfs', 'dfs',
+                                       'DisjointSet'])]:
+            copy = fresh_module(module)
+            self.assertIsNot(copy, module)
+            for name in names:
+                self.assertIsNot(getattr(copy, name), getattr(module, name))
+                self.assertEqual(getattr(copy, name).__name__, name)
+
+    def test_copies_work(self):
+        copy = fresh_module(containers)
+        self.assertEqual(list(copy.SortedList([3, 1, 2])), [1, 2, 3])
+        self.assertEqual(list(iter(copy.SortedList('ba'))), ['a', 'b'])
+
+        copy = fresh_module(graph)
+        g = copy.Graph({0: [1], 1: [2]})
+        self.assertEqual(list(copy.bfs(g, 0)), [0, 1, 2])
+        self.assertEqual(list(copy.dfs(g, 0, order='events'))[:2],
+                         [(0, 'pre'), (1, 'pre')])
+        self.assertEqual(copy.topological_sort(g), [0, 1, 2])
+
+        copy = fresh_module(selection)
+        sketch = copy.QuantileSketch(seed=0)
+        sketch.update(range(100))
+        sketch.merge(copy.QuantileSketch.from_bytes(sketch.to_bytes()))
+        self.assertEqual(sketch.count, 200)
+
+    def test_objects_of_other_copies(self):
+        copy = fresh_module(selection)
+        with self.assertRaises(TypeError):
+            selection.QuantileSketch().merge(copy.QuantileSketch())
+        copy = fresh_module(graph)
+        with self.assertRaises(TypeError):
+            graph.pagerank(copy.Graph({0: [1]}))
+
+    def test_decision_hooks_are_per_module(self):
+        copy = fresh_module(sort)
+        decisions = []
+        copy.set_decision_hook(decisions.append)
+        try:
+            sort.sort([3, 1, 2])
+            self.assertEqual(decisions, [])
+            copy.sort([3, 1, 2])
+            self.assertEqual(len(decisions), 1)
+        finally:
+            copy.set_decision_hook(None)
+
+    def test_threads(self):
+        # Calls in other threads are instrumented too, with their own counters
+        results = []
+
+        def work():
+            a = list(range(1000, 0, -1))
+            sort.merge_sort(a)
+            results.append(a == sorted(a))
+
+        with algorithms.instrument() as stats:
+            threads = [threading.Thread(target=work) for _ in range(4)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+        self.assertEqual(results, [True] * 4)
+        self.assertEqual(stats['merge_sort']['calls'], 4)
+
+    @unittest.skipUnless(sysconfig.get_config_var('Py_GIL_DISABLED'),
+                         'not a free-threaded build')
+    def test_gil_stays_disabled(self):
+        # Importing a module that needs the GIL would have switched it back on
+        self.assertFalse(sys._is_gil_enabled())
+
+    def test_shared_objects(self):
+        # Objects shared by threads are locked, and end up as if their threads
+        # had taken turns (which, without the GIL, they don't)
+        n = 2000
+        items = list(range(n))
+        random.Random(0).shuffle(items)
+
+        a = containers.SortedList()
+        w = selection.WindowedMinMax(10)
+        sketch = selection.QuantileSketch(seed=0)
+        ds = graph.DisjointSet()
+        sorter = sort.IncrementalSorter(items, budget=100)
+
+        def mutate(i):
+            mine = items[i::4]
+            for x in mine:
+                a.add(x)
+                w.push(x)
+                ds.union(x, (x + 1) % n)
+                self.assertIn(x, a)
+            try:
+                self.assertEqual(sorted(a.irange(0, 9)), list(a.irange(0, 9)))
+            except RuntimeError:
+                pass  # Another thread changed the list while iterating
+            sketch.update(mine)
+            a.update(mine)
+            for x in mine[::2]:
+                a.remove(x)
+            while not sorter.step():
+                pass
+
+        run_in_threads(mutate)
+        kept = [x for i in range(4) for x in items[i::4][1::2]]
+        self.assertEqual(list(a), sorted(items + kept))
+        self.assertEqual(len(w), 10)
+        self.assertEqual(w.count, n)
+        self.assertEqual(sketch.count, n)
+        self.assertEqual((sketch.min, sketch.max), (0, n - 1))
+        self.assertEqual((len(ds), ds.num_sets), (n, 1))
+        self.assertEqual(sorter.result(), list(range(n)))
+
+    def test_shared_traversals(self):
+        # Every node is visited once by the threads sharing a traversal, and
+        # the reverse graph they all need is built once
+        n = 2000
+        g = graph.Graph({v: [2 * v + 1, 2 * v + 2] for v in range(n // 2)})
+        b = graph.bfs(g, 0)
+        d = graph.dfs(g, 0)
+        visited = [[] for _ in range(4)]
+        levels = []
+
+        def traverse(i):
+            while True:
+                batch = b.next_batch(7)
+                if not batch:
+                    break
+                visited[i].extend(batch)
+                node = next(d, None)
+                if node is not None:
+                    visited[i].append(node)
+            visited[i].extend(d)
+            levels.append(list(graph.bfs_levels(g, [0])[0]))
+
+        run_in_threads(traverse)
+        nodes = [node for nodes in visited for node in nodes]
+        self.assertEqual(sorted(nodes), sorted(list(range(n + 1)) * 2))
+        self.assertEqual(levels, [levels[0]] * 4)
+        self.assertEqual(levels[0][n], 10)
+
+    @unittest.skipIf(interpreters is None, 'no subinterpreters')
+    def test_subinterpreter(self):
+        path = os.path.dirname(os.path.dirname(algorithms.__file__))
+        code = textwrap.dedent(f'''
+            import sys
+            sys.path.insert(0, {path!r})
+            from algorithms import containers, graph, random, sets, sort
+            assert list(containers.SortedList([2, 1])) == [1, 2]
+            assert list(graph.bfs(graph.Graph({{0: [1]}}), 0)) == [0, 1]
+            assert sets.union([1], [2]) == [1, 2]
+            assert sort.sort([2, 1]) == [1, 2]
+        ''')
+        interp = interpreters.create()
+        try:
+            interpreters.run_string(interp, code)
+        finally:
+            interpreters.destroy(interp)
+        self.assertEqual(list(containers.SortedList([2, 1])), [1, 2])
+
+
+if __name__ == '__main__':
+    unittest.main()
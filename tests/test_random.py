@@ -1,9 +1,11 @@
 """Unit tests for the miscellaneous algorithms."""
 
+import array
 import itertools
 import math
 import random
 import unittest
+from concurrent.futures import ThreadPoolExecutor
 
 from algorithms.random import sample
 
@@ -26,6 +28,17 @@ class SampleTestCase(unittest.TestCase):
         with self.assertRaises(ValueError):
             sample(range(10), size=11)
 
+        # Bad arguments
+        with self.assertRaises(TypeError):
+            sample()
+        with self.assertRaises(TypeError):
+            sample(range(10), 1, 0, 0)
+        with self.assertRaises(TypeError):
+            sample(range(10), 1, size=1)
+        with self.assertRaises(TypeError):
+            sample(range(10), sized=1)
+        self.assertEqual(len(sample(range(10), size=True)), 1)
+
     def test_range(self):
         for n, k in itertools.product((100, 1000, 10000), (1, 10, 100)):
             for population in (range(n), (i for i in range(n)), list(range(n))):
@@ -34,6 +47,32 @@ class SampleTestCase(unittest.TestCase):
                 for item in data:
                     self.assertTrue(0 <= item < n)
 
+    def test_buffers(self):
+        # Buffers are sampled by position, drawing the same random numbers as
+        # the iteration over any other population
+        rng = random.Random(0)
+        for typecode in 'bBiQfd':
+            values = rng.choices(range(100), k=1000)
+            buffer = array.array(typecode, values)
+            for k in (0, 1, 10, 1000):
+                self.assertEqual(sample(buffer, size=k, seed=k),
+                                 sample(buffer.tolist(), size=k, seed=k))
+        self.assertEqual(sample(b'abc', size=3, seed=0),
+                         sample([97, 98, 99], size=3, seed=0))
+        with self.assertRaises(ValueError):
+            sample(array.array('i', [1, 2]), size=3)
+        with self.assertRaises(TypeError):
+            sample(array.array('i', [1, 2]), seed='abc')
+
+    def test_concurrent_calls(self):
+        population = array.array('q', range(100000))
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            samples = list(executor.map(
+                lambda seed: sample(population, size=10, seed=seed),
+                range(16)))
+        self.assertEqual(samples, [sample(population, size=10, seed=seed)
+                                   for seed in range(16)])
+
     def test_distribution(self):
         # Test parameters
         n_repeats = 20000
@@ -1,10 +1,17 @@
 """Unit tests for selection algorithms."""
 
+import array
+import bisect
+import gc
 import itertools
 import random
+import struct
 import unittest
+import weakref
+from concurrent.futures import ThreadPoolExecutor
 
-from algorithms.selection import min_max
+from algorithms.selection import (QuantileSketch, WindowedMinMax, min_max,
+                                  rolling_min_max)
 
 
 class MinMaxTestCase(unittest.TestCase):
@@ -23,3 +30,275 @@ class MinMaxTestCase(unittest.TestCase):
             a_min, a_max = min_max(a)
             self.assertEqual(a_min, min(a))
             self.assertEqual(a_max, max(a))
+
+    def test_bad_arguments(self):
+        with self.assertRaisesRegex(TypeError, 'at least 1 positional'):
+            min_max()
+        with self.assertRaisesRegex(TypeError, 'at most 1 positional'):
+            min_max([1], [2])
+        with self.assertRaisesRegex(TypeError, 'invalid keyword'):
+            min_max([1], key=abs)
+
+    def test_typed_buffers(self):
+        rng = random.Random(0)
+        for typecode in 'bBhHiIlLqQfd':
+            for size in (1, 2, 3, 100, 1001):
+                if typecode in 'fd':
+                    values = [rng.uniform(-100, 100) for _ in range(size)]
+                else:
+                    values = rng.choices(range(100), k=size)
+                a = array.array(typecode, values)
+                result = min_max(a)
+                self.assertEqual(result, (min(a), max(a)))
+                self.assertEqual(type(result[0]), type(a[0]))
+        self.assertEqual(min_max(b'hello'), (101, 111))
+        self.assertEqual(min_max(array.array('Q', [2 ** 64 - 1, 0])),
+                         (0, 2 ** 64 - 1))
+        with self.assertRaisesRegex(ValueError, 'empty'):
+            min_max(array.array('i'))
+
+    def test_concurrent_calls(self):
+        rng = random.Random(1)
+        arrays = [array.array('d', (rng.random() for _ in range(10000)))
+                  for _ in range(16)]
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            results = list(executor.map(min_max, arrays))
+        self.assertEqual(results, [(min(a), max(a)) for a in arrays])
+
+
+class QuantileSketchTestCase(unittest.TestCase):
+    def check(self, sketch, values):
+        values = sorted(values)
+        n = len(values)
+        self.assertEqual(sketch.count, n)
+        self.assertEqual(sketch.min, values[0])
+        self.assertEqual(sketch.max, values[-1])
+        for q in (0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99):
+            x = sketch.quantile(q)
+            self.assertLessEqual(abs(bisect.bisect_right(values, x) / n - q),
+                                 sketch.error)
+        for x in values[::n // 50]:
+            expected = bisect.bisect_right(values, x) / n
+            self.assertLessEqual(abs(sketch.rank(x) - expected), sketch.error)
+
+    def test_random_streams(self):
+        rng = random.Random(0)
+        for k in (8, 50, 200):
+            values = [rng.gauss(0, 1) for _ in range(50000)]
+            sketch = QuantileSketch(k, seed=k)
+            for i in range(0, len(values), 1000):
+                sketch.update(values[i:i + 1000])
+            self.check(sketch, values)
+            self.assertLess(sketch.retained, 4 * k + 100)
+
+    def test_typed_buffers(self):
+        rng = random.Random(1)
+        for typecode in 'bhiqfd':
+            if typecode in 'fd':
+                values = [rng.uniform(-1000, 1000) for _ in range(30000)]
+            else:
+                values = [rng.randrange(-100, 100) for _ in range(30000)]
+            a = array.array(typecode, values)
+            sketch = QuantileSketch(seed=2)
+            sketch.update(a)
+            self.check(sketch, list(a))
+        sketch = QuantileSketch()
+        sketch.update(b'hello')
+        self.assertEqual((sketch.min, sketch.max), (101.0, 111.0))
+
+    def test_small_streams_are_exact(self):
+        sketch = QuantileSketch()
+        sketch.update([3, float('nan'), 1, 2, 4])
+        self.assertEqual(sketch.count, 4)
+        self.assertEqual(sketch.quantile(0), 1.0)
+        self.assertEqual(sketch.quantile(0.5), 2.0)
+        self.assertEqual(sketch.quantile(1), 4.0)
+        self.assertEqual(sketch.rank(2.5), 0.5)
+        self.assertEqual(sketch.rank(0), 0.0)
+
+    def test_merge(self):
+        rng = random.Random(3)
+        shards = [[rng.expovariate(1) for _ in range(rng.randrange(1, 20000))]
+                  for _ in range(8)]
+        merged = QuantileSketch(seed=4)
+        for i, shard in enumerate(shards):
+            sketch = QuantileSketch(100 if i == 5 else 200, seed=i)
+            sketch.update(array.array('d', shard))
+            merged.merge(sketch)
+        self.assertEqual(merged.k, 100)
+        self.check(merged, list(itertools.chain(*shards)))
+        merged.merge(merged)
+        self.assertEqual(merged.count, 2 * sum(map(len, shards)))
+        with self.assertRaises(TypeError):
+            merged.merge([1.0])
+
+    def test_serialization(self):
+        rng = random.Random(5)
+        values = [rng.random() for _ in range(40000)]
+        sketch = QuantileSketch(error=0.02, seed=6)
+        sketch.update(values)
+        data = sketch.to_bytes()
+        copy = QuantileSketch.from_bytes(data)
+        self.assertEqual(copy.to_bytes(), data)
+        self.assertEqual((copy.k, copy.count), (sketch.k, sketch.count))
+        self.check(copy, values)
+        self.assertEqual(QuantileSketch.from_bytes(
+            QuantileSketch().to_bytes()).count, 0)
+        for bad in (b'', data[:-1], data + b'\0', b'XXXX' + data[4:]):
+            with self.assertRaisesRegex(ValueError, 'invalid'):
+                QuantileSketch.from_bytes(bad)
+
+    def test_update_during_update(self):
+        # The sketch is busy while an iterable is consumed, since that runs
+        # Python code, which could update the sketch in between
+        sketch = QuantileSketch()
+
+        def items():
+            yield 1.0
+            with self.assertRaisesRegex(RuntimeError, 'being updated'):
+                sketch.update(array.array('d', [2.0]))
+            with self.assertRaisesRegex(RuntimeError, 'being updated'):
+                sketch.quantile(0.5)
+            yield 3.0
+
+        sketch.update(items())
+        self.assertEqual((sketch.count, sketch.min, sketch.max), (2, 1.0, 3.0))
+        sketch.update([2.0])
+        self.assertEqual(sketch.count, 3)
+
+    def test_crafted_bytes(self):
+        def craft(k, sizes, count, item=1.0):
+            header = struct.pack('=4siiQdd', b'KLL1', k, len(sizes), count,
+                                 item, item)
+            return (header + struct.pack(f'={len(sizes)}I', *sizes)
+                    + struct.pack('=d', item) * sum(sizes))
+
+        self.assertEqual(QuantileSketch.from_bytes(craft(8, [4], 4)).count, 4)
+        for bad in (
+                # Every level, which leaves no room to compact the top one
+                craft(200, [0] * 63 + [4096], 0),
+                # Weights adding up to the count only by wrapping around
+                craft(200, [0] * 62 + [4], 0),
+                # More items than fit in the sketch
+                craft(8, [100], 100)):
+            with self.assertRaisesRegex(ValueError, 'invalid'):
+                QuantileSketch.from_bytes(bad)
+
+    def test_bad_arguments(self):
+        with self.assertRaises(ValueError):
+            QuantileSketch(7)
+        with self.assertRaises(ValueError):
+            QuantileSketch(error=1.5)
+        with self.assertRaises(TypeError):
+            QuantileSketch(100, error=0.01)
+        self.assertLessEqual(QuantileSketch(error=0.01).error, 0.01)
+        sketch = QuantileSketch()
+        with self.assertRaisesRegex(ValueError, 'empty'):
+            sketch.quantile(0.5)
+        with self.assertRaisesRegex(ValueError, 'empty'):
+            sketch.rank(0)
+        self.assertIsNone(sketch.min)
+        sketch.update([1.0])
+        with self.assertRaises(ValueError):
+            sketch.quantile(1.5)
+        with self.assertRaises(TypeError):
+            sketch.update(['a'])
+
+
+def naive_rolling_min_max(values, window):
+    starts = range(len(values) - window + 1)
+    return ([min(values[i:i + window]) for i in starts],
+            [max(values[i:i + window]) for i in starts])
+
+
+class RollingMinMaxTestCase(unittest.TestCase):
+    def test_random_sequences(self):
+        rng = random.Random(0)
+        for _ in range(300):
+            values = [rng.randrange(rng.choice([3, 100]))
+                      for _ in range(rng.choice([0, 1, 10, 200]))]
+            window = rng.randint(1, 30)
+            expected = naive_rolling_min_max(values, window)
+            for seq in (values, tuple(values), iter(values)):
+                self.assertEqual(rolling_min_max(seq, window), expected)
+
+    def test_typed_buffers(self):
+        rng = random.Random(1)
+        for typecode in 'bBhHiIlLqQfd':
+            values = [rng.randrange(100) for _ in range(500)]
+            a = array.array(typecode, values)
+            for window in (1, 7, 100, 500, 1000):
+                mins, maxs = rolling_min_max(a, window=window)
+                self.assertIsInstance(mins, array.array)
+                self.assertEqual(mins.itemsize, a.itemsize)
+                self.assertEqual((list(mins), list(maxs)),
+                                 naive_rolling_min_max(values, window))
+
+    def test_bad_arguments(self):
+        with self.assertRaises(ValueError):
+            rolling_min_max([1, 2], 0)
+        with self.assertRaises(TypeError):
+            rolling_min_max([1, 2])
+        with self.assertRaises(TypeError):
+            rolling_min_max([1, 'a', 2], 2)
+
+
+class WindowedMinMaxTestCase(unittest.TestCase):
+    def test_random_streams(self):
+        rng = random.Random(2)
+        for window in (1, 2, 10, 100):
+            w = WindowedMinMax(window)
+            values = []
+            for _ in range(1000):
+                # Long monotonic runs make the deques grow
+                if rng.random() < 0.01:
+                    run = list(range(rng.randrange(1000), 200, -1))
+                    if rng.random() < 0.5:
+                        run.reverse()
+                    values.extend(run)
+                    w.extend(run)
+                else:
+                    values.append(rng.randrange(50))
+                    w.push(values[-1])
+                recent = values[-window:]
+                self.assertEqual((w.min, w.max), (min(recent), max(recent)))
+                self.assertEqual(len(w), len(recent))
+            self.assertEqual(w.count, len(values))
+            self.assertEqual(w.window, window)
+
+    def test_empty_and_errors(self):
+        w = WindowedMinMax(3)
+        self.assertEqual((w.min, w.max, len(w)), (None, None, 0))
+        with self.assertRaises(ValueError):
+            WindowedMinMax(0)
+        w.push(1)
+        with self.assertRaises(TypeError):
+            w.push('a')
+        self.assertEqual((w.min, w.max, w.count), (1, 1, 1))
+
+    def test_modification_during_comparison(self):
+        w = WindowedMinMax(5)
+
+        class Meddler(int):
+            def __lt__(self, other):
+                w.push(0)
+                return super().__lt__(other)
+
+        w.push(1)
+        with self.assertRaisesRegex(RuntimeError, 'comparing'):
+            w.push(Meddler(2))
+        self.assertEqual(w.count, 1)
+
+    def test_reference_cycles(self):
+        class Item:
+            def __lt__(self, other):
+                return False
+
+        w = WindowedMinMax(2)
+        item = Item()
+        item.window = w
+        w.push(item)
+        ref = weakref.ref(item)
+        del item, w
+        gc.collect()
+        self.assertIsNone(ref())
@@ -0,0 +1,116 @@
+"""Unit tests for set operations on sorted sequences."""
+
+import array
+import functools
+import random
+import unittest
+
+import algorithms
+from algorithms.sets import difference, intersect, union, unique
+
+
+def expected_results(seqs):
+    sets = [set(seq) for seq in seqs]
+    return {
+        unique: sorted(sets[0]),
+        intersect: sorted(set.intersection(*sets)),
+        union: sorted(set.union(*sets)),
+        difference: sorted(sets[0].difference(*sets[1:])),
+    }
+
+
+class SetOperationsTestCase(unittest.TestCase):
+    def check(self, seqs, typecode=None):
+        for operation, expected in expected_results(seqs).items():
+            if typecode is None:
+                args = seqs
+            else:
+                args = [array.array(typecode, seq) for seq in seqs]
+            if operation is unique:
+                args = args[:1]
+            result = operation(*args)
+            if typecode is None:
+                self.assertIsInstance(result, list)
+            else:
+                # The result has the same type of items, e.g., 'q' for 'l'
+                self.assertIsInstance(result, array.array)
+                self.assertEqual(result.itemsize, args[0].itemsize)
+            self.assertEqual(list(result), expected, operation.__name__)
+
+    def test_random_lists(self):
+        rng = random.Random(0)
+        for _ in range(500):
+            high = rng.choice([5, 100, 10000])
+            seqs = [sorted(rng.randrange(high)
+                           for _ in range(rng.choice([0, 1, 10, 300])))
+                    for _ in range(rng.randint(1, 4))]
+            self.check(seqs)
+            self.check([sorted(map(str, seq)) for seq in seqs])
+
+    def test_typed_buffers(self):
+        rng = random.Random(1)
+        for typecode in 'bBhHiIlLqQfd':
+            for _ in range(100):
+                high = rng.choice([5, 100, 127])
+                seqs = [sorted(rng.randrange(high)
+                               for _ in range(rng.choice([0, 3, 50, 400])))
+                        for _ in range(rng.randint(1, 4))]
+                self.check(seqs, typecode)
+        self.assertEqual(list(unique(b'aabbbc')), [97, 98, 99])
+        self.assertEqual(list(intersect(array.array('q', [-5, -1, 3]),
+                                        array.array('q', [-1, 3]))), [-1, 3])
+
+    def test_galloping(self):
+        # One operand much longer than the other, with and without SIMD
+        rng = random.Random(2)
+        long = sorted(rng.sample(range(10 ** 6), 50000))
+        for size in (1, 10, 1000):
+            short = sorted(rng.sample(range(10 ** 6), size) +
+                           rng.sample(long, size))
+            for typecode in (None, 'I', 'Q', 'd'):
+                self.check([short, long], typecode)
+                self.check([long, short], typecode)
+
+    def test_mixed_arguments(self):
+        # Buffers of different types, or buffers and lists, are compared as
+        # Python objects
+        a = array.array('i', [1, 2, 3])
+        self.assertEqual(intersect(a, array.array('d', [2.0, 3.0])),
+                         [2, 3])
+        self.assertEqual(union(a, [0, 4]), [0, 1, 2, 3, 4])
+        self.assertEqual(difference(range(6), a, (5,)), [0, 4])
+        self.assertEqual(intersect('abc', 'bcd', 'cde'), ['c'])
+
+    def test_comparison_errors(self):
+        @functools.total_ordering
+        class Bad:
+            def __eq__(self, other):
+                return self is other
+
+            def __lt__(self, other):
+                raise RuntimeError('comparison')
+
+        with self.assertRaisesRegex(RuntimeError, 'comparison'):
+            unique([Bad(), Bad()])
+        for operation in (intersect, union, difference):
+            with self.assertRaisesRegex(RuntimeError, 'comparison'):
+                operation([Bad(), Bad()], [Bad()])
+
+    def test_bad_arguments(self):
+        for operation in (intersect, union, difference):
+            with self.assertRaises(TypeError):
+                operation()
+        with self.assertRaises(TypeError):
+            unique(1)
+        with self.assertRaises(TypeError):
+            intersect([1, 2], [1, 'a'])
+
+    def test_instrumentation(self):
+        with algorithms.instrument() as stats:
+            intersect([1, 2, 3], [2, 3, 4])
+        self.assertEqual(stats['intersect']['calls'], 1)
+        self.assertGreater(stats['intersect']['comparisons'], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -1,22 +1,53 @@
 """Unit tests for the sorting algorithms."""
 
+import array
+import asyncio
 import itertools
+import os
 import random
+import struct
+import time
 import unittest
+from concurrent.futures import ThreadPoolExecutor
 from typing import Callable
 
+import algorithms
 from algorithms.sort import binary_insertion_sort
+from algorithms.sort import buffer_info
+from algorithms.sort import IncrementalSorter
 from algorithms.sort import heap_sort
 from algorithms.sort import insertion_sort
+from algorithms.sort import lexsort
 from algorithms.sort import merge_sort
 from algorithms.sort import quick_sort
 from algorithms.sort import quick_sort_random
+from algorithms.sort import release_buffers
+from algorithms.sort import set_buffer_cap
+from algorithms.sort import set_decision_hook
+from algorithms.sort import sort
+from algorithms.sort import sort_records
 
 _RNG_SEED = 0
 _MAX_PERMUTATION_SIZE = 8
 _LARGE_VALUE_POPULATION = range(100, 1000)
 _LARGE_SIZE_POPULATION = range(100, 1000)
 _N_REPETITIONS = 400
+_TYPECODES = 'bBhHiIlLqQfd'
+
+
+def random_array(rng, typecode, size):
+    """Random array.array of the given type, with repeated values."""
+    if typecode in 'fd':
+        values = (rng.uniform(-1e6, 1e6) for _ in range(size))
+    else:
+        bits = 8 * array.array(typecode).itemsize
+        if typecode.islower():
+            lo, hi = -2 ** (bits - 1), 2 ** (bits - 1) - 1
+        else:
+            lo, hi = 0, 2 ** bits - 1
+        pool = [rng.randint(lo, hi) for _ in range(max(1, size // 4))]
+        values = (rng.choice(pool + [lo, hi]) for _ in range(size))
+    return array.array(typecode, values)
 
 
 class SortTestCaseMixin:
@@ -75,6 +106,72 @@ class SortTestCaseMixin:
     def test_sort_large_random_tuple_many_repetitions(self):
         return self._test_sort_large_random_seq_many_repetitions(tuple)
 
+    def test_sort_typed_buffers(self):
+        for typecode in _TYPECODES:
+            for size in (0, 1, 2, 3, 10, 257):
+                a = random_array(self.rng, typecode, size)
+                before = a.tolist()
+                expected = sorted(a)
+                self.assertEqual(self.sort_fn(a), expected)
+                self.assertEqual(a.tolist(), before)
+                self.assertIs(self.sort_fn(a, inplace=True), a)
+                self.assertEqual(a.tolist(), expected)
+
+        # Other buffers are copied into a new list too, and writable ones can
+        # be sorted in-place
+        b = bytearray(self.rng.choices(range(256), k=100))
+        before = bytes(b)
+        expected = sorted(b)
+        self.assertEqual(self.sort_fn(b), expected)
+        self.assertEqual(b, before)
+        self.assertIs(self.sort_fn(b, inplace=True), b)
+        self.assertEqual(list(b), expected)
+        m = memoryview(bytearray(400)).cast('i')
+        m[:] = array.array('i', self.rng.choices(range(-50, 50), k=100))
+        expected = sorted(m)
+        self.assertIs(self.sort_fn(m, inplace=True), m)
+        self.assertEqual(m.tolist(), expected)
+        self.assertEqual(self.sort_fn(b'cab'), [97, 98, 99])
+
+        # Buffers of non-numbers are treated as sequences
+        self.assertEqual(self.sort_fn(memoryview(b'cab').cast('c')),
+                         [b'a', b'b', b'c'])
+
+        # Only lists and writable buffers can be sorted in-place
+        a = [3, 1, 2]
+        self.assertIs(self.sort_fn(a, inplace=True), a)
+        self.assertEqual(a, [1, 2, 3])
+        for seq in (b'cab', (3, 1, 2), memoryview(b'cab').cast('c')):
+            with self.assertRaisesRegex(TypeError, 'in-place'):
+                self.sort_fn(seq, inplace=True)
+
+    def test_sort_bounds(self):
+        a = [5, 4, 3, 2, 1, 0]
+        self.assertEqual(self.sort_fn(a, first=1, last=5), [5, 1, 2, 3, 4, 0])
+        b = array.array('d', [5, 4, 3, 2, 1, 0])
+        self.assertEqual(self.sort_fn(b, first=2), [5, 4, 0, 1, 2, 3])
+        self.sort_fn(b, first=2, inplace=True)
+        self.assertEqual(b.tolist(), [5, 4, 0, 1, 2, 3])
+        self.sort_fn(b, last=3, inplace=True)
+        self.assertEqual(b.tolist(), [0, 4, 5, 1, 2, 3])
+        with self.assertRaisesRegex(IndexError, 'out of range'):
+            self.sort_fn(b, last=7)
+
+    def test_sort_concurrently(self):
+        # Typed sorts run without the GIL, so threads sorting their own
+        # buffers don't interfere with each other
+        arrays = [random_array(self.rng, typecode, 2000)
+                  for typecode in _TYPECODES for _ in range(2)]
+        expected = [sorted(a) for a in arrays]
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            results = list(executor.map(self.sort_fn, arrays))
+            self.assertEqual(results, expected)
+            results = list(executor.map(
+                lambda a: self.sort_fn(a, inplace=True), arrays))
+        for a, result, e in zip(arrays, results, expected):
+            self.assertIs(result, a)
+            self.assertEqual(a.tolist(), e)
+
     def test_raises(self):
         # Bad argument types
         with self.assertRaisesRegex(TypeError, 'positional'):
@@ -103,6 +200,16 @@ class SortTestCaseMixin:
             self.sort_fn([0, 'abc'])  # Can't compare int and str
         with self.assertRaisesRegex(TypeError, 'not iterable'):
             self.sort_fn(0)
+        with self.assertRaisesRegex(TypeError, 'at most 3 positional'):
+            self.sort_fn([0, 1, 2], 0, 3, 4)
+        with self.assertRaisesRegex(TypeError, 'given by name'):
+            self.sort_fn([0, 1, 2], 0, first=0)
+
+    def test_keyword_arguments(self):
+        # Keyword names that aren't interned must match too
+        first = ''.join(['fir', 'st'])
+        self.assertEqual(self.sort_fn([2, 1, 0], **{first: 1}), [2, 0, 1])
+        self.assertEqual(self.sort_fn([2, 1, 0], last=2, first=0), [1, 2, 0])
 
 
 class BinaryInsertionSortTestCase(SortTestCaseMixin, unittest.TestCase):
@@ -127,3 +234,393 @@ class QuickSortTestCase(SortTestCaseMixin, unittest.TestCase):
 
 class QuickSortRandomTestCase(SortTestCaseMixin, unittest.TestCase):
     sort_fn = quick_sort_random
+
+    def test_pivots_vary_between_calls(self):
+        # The generator advances across calls instead of being reseeded the
+        # same way by each one, so repeated sorts pick different pivots
+        items = list(range(300))
+        random.Random(_RNG_SEED).shuffle(items)
+        counts = set()
+        for _ in range(5):
+            with algorithms.instrument() as stats:
+                quick_sort_random(list(items))
+            counts.add(stats['quick_sort_random']['comparisons'])
+        self.assertGreater(len(counts), 1)
+
+
+class SortTestCase(SortTestCaseMixin, unittest.TestCase):
+    sort_fn = sort
+
+
+class Key:
+    """Item compared by `key` alone, to check stability."""
+
+    def __init__(self, key, tag):
+        self.key = key
+        self.tag = tag
+
+    def __lt__(self, other):
+        return self.key < other.key
+
+    def __le__(self, other):
+        return self.key <= other.key
+
+    def __eq__(self, other):
+        return self.key == other.key
+
+
+class SortDispatchTestCase(unittest.TestCase):
+    def setUp(self):
+        self.rng = random.Random(_RNG_SEED)
+        self.decisions = []
+        self.hook = self.decisions.append
+        self.addCleanup(set_decision_hook, set_decision_hook(self.hook))
+
+    def decide(self, seq, **kwargs):
+        """Sort `seq`, check the result, and return the chosen algorithm."""
+        expected = sorted(seq)
+        result = sort(seq, **kwargs)
+        self.assertEqual(list(result), expected)
+        return self.decisions[-1]['algorithm']
+
+    def test_lists(self):
+        self.assertEqual(self.decide([3, 1, 2]), 'binary_insertion_sort')
+        ints = [self.rng.randint(-2 ** 63, 2 ** 63 - 1) for _ in range(1000)]
+        self.assertEqual(self.decide(ints), 'radix_sort')
+        self.assertEqual(self.decisions[-1]['items'], 'int')
+        floats = [self.rng.uniform(-1, 1) for _ in range(1000)]
+        floats += [0.0, -0.0, float('inf'), float('-inf')]
+        self.assertEqual(self.decide(floats), 'radix_sort')
+        self.assertEqual(self.decisions[-1]['items'], 'float')
+
+        # Too big for radix keys, or not all of the same type
+        self.assertEqual(self.decide([2 ** 64] + ints), 'adaptive_merge_sort')
+        self.assertEqual(self.decide(ints + [0.5]), 'adaptive_merge_sort')
+        self.assertEqual(self.decide([True, False] * 20), 'quick_sort_3way')
+        self.assertEqual(self.decisions[-1]['items'], 'object')
+
+        words = [str(self.rng.random()) for _ in range(1000)]
+        self.assertEqual(self.decide(words), 'adaptive_merge_sort')
+        self.assertEqual(self.decide(sorted(words)), 'adaptive_merge_sort')
+        self.assertEqual(self.decisions[-1]['descents'], 0)
+        self.assertEqual(self.decide(sorted(words, reverse=True)),
+                         'adaptive_merge_sort')
+
+        few = [str(self.rng.randrange(5)) for _ in range(1000)]
+        self.assertEqual(self.decide(few), 'quick_sort_3way')
+        self.assertFalse(self.decisions[-1]['stable'])
+        self.assertLessEqual(self.decisions[-1]['distinct'], 5)
+        self.assertEqual(self.decide(few, stable=True), 'adaptive_merge_sort')
+        self.assertTrue(self.decisions[-1]['stable'])
+
+    def test_stable(self):
+        for size in (10, 100, 1000):
+            keys = [Key(self.rng.randrange(10), i) for i in range(size)]
+            sort(keys, stable=True)
+            self.assertEqual([(k.key, k.tag) for k in keys],
+                             sorted((k.key, k.tag) for k in keys))
+
+        # Radix sorts keep equal ints in order
+        ints = [10 ** 6 + self.rng.randrange(3) for _ in range(1000)]
+        expected = sorted(ints)
+        sort(ints)
+        for a, b in zip(ints, expected):
+            self.assertIs(a, b)
+
+    def test_typed_buffers(self):
+        a = array.array('i', range(1000))
+        self.assertEqual(self.decide(a), 'none')
+        a.reverse()
+        self.assertEqual(self.decide(a), 'reverse')
+        self.assertEqual(self.decisions[-1]['items'], 'int32')
+        for typecode in _TYPECODES:
+            a = random_array(self.rng, typecode, 1000)
+            self.assertEqual(self.decide(a), 'radix_sort')
+        a = array.array('d', [0.0, -0.0, 1.0, -1.0] * 10)
+        self.assertEqual(self.decide(a), 'radix_sort')
+
+    def test_parallel(self):
+        size = 300_000
+        a = array.array('q', (self.rng.randint(-2 ** 63, 2 ** 63 - 1)
+                              for _ in range(size)))
+        self.assertEqual(self.decide(a, threads=3), 'parallel_radix_sort')
+        self.assertEqual(self.decisions[-1]['threads'], 3)
+        a = array.array('f', (self.rng.uniform(-1, 1) for _ in range(size)))
+        self.assertEqual(self.decide(a, threads=1), 'radix_sort')
+
+    def test_hook(self):
+        self.assertIs(set_decision_hook(None), self.hook)
+        sort([2, 1])
+        self.assertIsNone(set_decision_hook(self.hook))
+        self.assertEqual(self.decisions, [])
+        with self.assertRaisesRegex(TypeError, 'callable'):
+            set_decision_hook(0)
+
+        def fail(decision):
+            raise RuntimeError(decision['algorithm'])
+
+        set_decision_hook(fail)
+        a = [3, 2, 1]
+        with self.assertRaisesRegex(RuntimeError, 'binary_insertion_sort'):
+            sort(a)
+        self.assertEqual(a, [3, 2, 1])
+
+        set_decision_hook(lambda decision: a.append(0))
+        with self.assertRaisesRegex(ValueError, 'modified'):
+            sort(a)
+
+
+class ScratchBufferTestCase(unittest.TestCase):
+    def tearDown(self):
+        set_buffer_cap(64 << 20)
+        release_buffers()
+
+    def test_reuse(self):
+        release_buffers()
+        self.assertEqual(buffer_info()['cached'], 0)
+        hits = buffer_info()['hits']
+        for _ in range(3):
+            merge_sort(list(range(1000, 0, -1)))
+        info = buffer_info()
+        self.assertGreaterEqual(info['hits'], hits + 2)
+        self.assertEqual(info['buffers'], 1)
+        self.assertGreaterEqual(info['high_water'], 500)
+        self.assertGreater(release_buffers(), 0)
+        self.assertEqual(buffer_info()['cached'], 0)
+
+    def test_cap(self):
+        merge_sort(array.array('d', range(1000, 0, -1)))
+        self.assertEqual(set_buffer_cap(0), 64 << 20)
+        info = buffer_info()
+        self.assertEqual((info['cap'], info['cached']), (0, 0))
+        merge_sort(list(range(1000, 0, -1)))
+        self.assertEqual(buffer_info()['cached'], 0)
+        with self.assertRaises(OverflowError):
+            set_buffer_cap(-1)
+
+    def test_failed_merge(self):
+        # A failed comparison leaves every item in the list exactly once
+        a = list(range(100, 0, -1)) + ['x'] + list(range(100))
+        with self.assertRaises(TypeError):
+            merge_sort(a)
+        self.assertEqual(sorted(a, key=str), sorted(
+            list(range(100, 0, -1)) + ['x'] + list(range(100)), key=str))
+
+
+def expected_permutation(columns, descending):
+    # Stably sorting by each column from the last one is lexicographic
+    permutation = list(range(len(columns[0]) if columns else 0))
+    for column, reverse in reversed(list(zip(columns, descending))):
+        permutation.sort(key=column.__getitem__, reverse=reverse)
+    return permutation
+
+
+class LexsortTestCase(unittest.TestCase):
+    def test_random_columns(self):
+        rng = random.Random(0)
+        for _ in range(300):
+            size = rng.choice([0, 1, 5, 40, 300])
+            columns, values, descending = [], [], []
+            for _ in range(rng.randint(1, 5)):
+                kind = rng.choice(['list', 'str', *'bBhHiIlLqQfd'])
+                high = rng.choice([3, 100])
+                column = [rng.randrange(high) for _ in range(size)]
+                if kind == 'str':
+                    column = list(map(str, column))
+                elif kind in 'bhilqfd':
+                    column = [x - high // 2 for x in column]
+                values.append(column)
+                columns.append(column if kind in ('list', 'str')
+                               else array.array(kind, column))
+                descending.append(rng.random() < 0.5)
+            result = lexsort(columns, descending=descending)
+            self.assertEqual(list(result),
+                             expected_permutation(values, descending))
+            if all(isinstance(column, array.array) for column in columns):
+                self.assertIsInstance(result, array.array)
+            else:
+                self.assertIsInstance(result, list)
+
+    def test_descending(self):
+        a = [2, 1, 2, 1]
+        b = array.array('d', [0.5, 0.5, -1.0, 2.0])
+        self.assertEqual(lexsort([a, b]), [1, 3, 2, 0])
+        self.assertEqual(lexsort([a, b], descending=True), [0, 2, 3, 1])
+        self.assertEqual(lexsort([a, b], descending=[True, False]),
+                         [2, 0, 1, 3])
+
+    def test_bad_arguments(self):
+        with self.assertRaises(ValueError):
+            lexsort([])
+        with self.assertRaises(ValueError):
+            lexsort([[1, 2], [1]])
+        with self.assertRaises(ValueError):
+            lexsort([[1, 2]], descending=[True, False])
+        with self.assertRaises(TypeError):
+            lexsort([[1, 'a']])
+
+
+class SortRecordsTestCase(unittest.TestCase):
+    def test_random_records(self):
+        rng = random.Random(1)
+        for _ in range(100):
+            codes = [rng.choice('bBhHiIqQfd') for _ in range(rng.randint(1, 4))]
+            layout = '<' + ''.join(codes)
+            size = struct.calcsize(layout)
+            offsets = [struct.calcsize('<' + ''.join(codes[:i]))
+                       for i in range(len(codes))]
+            records = [tuple(rng.randrange(5) - (code in 'bhiqfd') * 2
+                             for code in codes)
+                       for _ in range(rng.choice([0, 1, 10, 200]))]
+            fields = rng.sample(range(len(codes)), rng.randint(1, len(codes)))
+            descending = [rng.random() < 0.5 for _ in fields]
+            buffer = bytearray(b''.join(struct.pack(layout, *record)
+                                        for record in records))
+            key_fields = [(offsets[i], '<' + codes[i], reverse)
+                          for i, reverse in zip(fields, descending)]
+            self.assertIs(sort_records(buffer, size, key_fields), buffer)
+            columns = list(zip(*records)) or [()] * len(codes)
+            expected = [records[i] for i in expected_permutation(
+                [columns[i] for i in fields], descending)]
+            self.assertEqual(list(struct.iter_unpack(layout, buffer)),
+                             expected)
+
+    def test_bad_arguments(self):
+        buffer = bytearray(12)
+        with self.assertRaises(ValueError):
+            sort_records(buffer, 5, [(0, 'i')])
+        with self.assertRaises(ValueError):
+            sort_records(buffer, 4, [(2, 'i')])
+        with self.assertRaises(ValueError):
+            sort_records(buffer, 4, [(0, 'x')])
+        with self.assertRaises(ValueError):
+            sort_records(buffer, 0, [(0, 'b')])
+        with self.assertRaises(TypeError):
+            sort_records(buffer, 4, [0])
+        with self.assertRaises(BufferError):
+            sort_records(bytes(12), 4, [(0, 'i')])
+
+
+class IncrementalSorterTestCase(unittest.TestCase):
+    def setUp(self):
+        self.rng = random.Random(_RNG_SEED)
+
+    def test_steps(self):
+        for size in (0, 1, 2, 3, 10, 100, 1000):
+            a = [self.rng.randrange(size // 2 + 1) for _ in range(size)]
+            sorter = IncrementalSorter(a, budget=10)
+            self.assertEqual(len(sorter), size)
+            progress = sorter.progress
+            while not sorter.step():
+                # Every step stops after exactly `budget` comparisons
+                self.assertEqual(sorter.comparisons % 10, 0)
+                self.assertFalse(sorter.done)
+                self.assertGreaterEqual(sorter.progress, progress)
+                progress = sorter.progress
+            self.assertTrue(sorter.done)
+            self.assertEqual(sorter.progress, 1.0)
+            self.assertEqual(sorter.result(), sorted(a))
+            self.assertTrue(sorter.step())
+
+    def test_stable(self):
+        items = [Key(self.rng.randrange(10), i) for i in range(500)]
+        sorter = IncrementalSorter(items)
+        while not sorter.step(7):
+            pass
+        self.assertEqual([(x.key, x.tag) for x in sorter.result()],
+                         [(x.key, x.tag) for x in sorted(items)])
+
+    def test_result_finishes(self):
+        a = [self.rng.random() for _ in range(1000)]
+        sorter = IncrementalSorter(a)
+        sorter.step(100)
+        self.assertEqual(sorter.result(), sorted(a))
+        # The items were copied, so the iterable is left alone
+        self.assertNotEqual(a, sorted(a))
+
+    def test_time_budget(self):
+        a = list(range(200000))
+        self.rng.shuffle(a)
+        sorter = IncrementalSorter(a)
+        start = time.perf_counter()
+        self.assertFalse(sorter.step(seconds=0.001))
+        self.assertLess(time.perf_counter() - start, 0.1)
+        self.assertGreater(sorter.comparisons, 0)
+
+    def test_await(self):
+        a = [self.rng.randrange(1000) for _ in range(5000)]
+        ticks = 0
+
+        async def tick():
+            nonlocal ticks
+            while True:
+                ticks += 1
+                await asyncio.sleep(0)
+
+        async def main():
+            ticker = asyncio.ensure_future(tick())
+            result = await IncrementalSorter(a, budget=1000)
+            ticker.cancel()
+            return result
+
+        self.assertEqual(asyncio.run(main()), sorted(a))
+        # The event loop ran other tasks between the steps
+        self.assertGreater(ticks, 10)
+
+    def test_failed_comparison(self):
+        a = list(range(50)) + ['x']
+        sorter = IncrementalSorter(a)
+        with self.assertRaises(TypeError):
+            sorter.result()
+        self.assertFalse(sorter.done)
+        with self.assertRaises(TypeError):
+            sorter.step()
+
+    def test_reentrancy(self):
+        sorter = None
+
+        class Evil:
+            def __lt__(self, other):
+                sorter.step()
+                return False
+
+        sorter = IncrementalSorter([Evil(), Evil()])
+        with self.assertRaises(RuntimeError):
+            sorter.result()
+
+    def test_bad_arguments(self):
+        with self.assertRaises(TypeError):
+            IncrementalSorter(1)
+        with self.assertRaises(ValueError):
+            IncrementalSorter([], budget=0)
+        sorter = IncrementalSorter([2, 1])
+        with self.assertRaises(ValueError):
+            sorter.step(0)
+        with self.assertRaises(ValueError):
+            sorter.step(seconds=-1.0)
+        with self.assertRaises(TypeError):
+            sorter.step(1, 2)
+
+
+@unittest.skipUnless((os.cpu_count() or 1) >= 4, 'needs at least 4 CPUs')
+class ConcurrentSortScalingTestCase(unittest.TestCase):
+    def test_threads_scale(self):
+        rng = random.Random(0)
+        arrays = [array.array('d', (rng.random() for _ in range(1_000_000)))
+                  for _ in range(4)]
+
+        def sort_inplace(a):
+            return merge_sort(a, inplace=True)
+
+        def elapsed(threads):
+            copies = [array.array('d', a) for a in arrays]
+            start = time.perf_counter()
+            with ThreadPoolExecutor(max_workers=threads) as executor:
+                list(executor.map(sort_inplace, copies))
+            return time.perf_counter() - start
+
+        # Four threads should finish four sorts before one thread does. The
+        # best of several runs is compared, so that a run slowed down by other
+        # processes doesn't fail the test
+        self.assertLess(min(elapsed(4) for _ in range(5)),
+                        0.9 * min(elapsed(1) for _ in range(5)))